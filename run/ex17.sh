@@ -0,0 +1,13 @@
+#!/bin/bash
+
+# This test vector deals with the arena of cache memory split into shards.
+# It defines a storage device with 100 blocks and formats it with an inode table of 56 inodes.
+# The arena is set to two shards, whatever the number of NUMA nodes of the machine. It allocates and frees some inodes
+# and data clusters, and then references data clusters past the direct ones, so that the cluster of single indirect
+# references is loaded into a slot of the arena, which sets the shards up.
+# The log shows the number of shards requested and the number of shards the arena was set up with.
+# The showblock_sofs14 application should be used in the end to check metadata.
+
+./createEmptyFile myDisk 100
+./mkfs_sofs14 -n SOFS14 -i 56 -z myDisk
+./testifuncs14 -b -l 873,873 -L testVector17.rst -n 2 myDisk <testVector17.cmd
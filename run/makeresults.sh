@@ -4,7 +4,7 @@
 rm *.rst
 
 # run all ./exX.sh and save its superblocks results to files
-for i in {1..16}
+for i in {1..17}
 do
  echo "A correr ./ex$i.sh"
  ./ex$i.sh
@@ -0,0 +1,19 @@
+1 #alloc inode for a directory
+1
+1 #alloc inode for a regular file
+2
+3 #alloc data cluster
+1
+4 #free data cluster
+1
+11 #handle file cluster: alloc
+2 7 1
+11 #handle file cluster: alloc
+2 8 1
+11 #handle file cluster: get
+2 7 0
+11 #handle file cluster: free
+2 8 2
+2 #free inode
+2
+0
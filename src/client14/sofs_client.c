@@ -0,0 +1,956 @@
+/**
+ *  \file sofs_client.c (implementation file)
+ *
+ *  \brief In-process client of the SOFS14 file system.
+ *
+ *  Every operation binds the file system context of the client to the calling thread, thus taking its lock, calls the
+ *  system call layer and binds the previous context again. The handles keep the number of the inode associated to the
+ *  file and the current position, which is only changed while the lock is held: the path is resolved once, when the
+ *  file is opened, and the open file is then accessed through the internal functions of the file system, as a file
+ *  descriptor of the operating system is, so that a handle follows its file if the file is renamed.
+ *
+ *  The following operations are defined:
+ *    \li mount a storage device as a new client
+ *    \li unmount the storage device of a client
+ *    \li get file system statistics
+ *    \li open a regular file
+ *    \li read data from an open regular file
+ *    \li write data into an open regular file
+ *    \li reposition the current position of an open regular file
+ *    \li synchronize an open regular file with the storage device
+ *    \li close a regular file
+ *    \li open a directory
+ *    \li read the next entry of an open directory
+ *    \li close a directory
+ *    \li execute a batch of operations.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include "sofs_probe.h"
+#include "sofs_const.h"
+#include "sofs_buffercache.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_direntry.h"
+#include "sofs_datacluster.h"
+#include "sofs_basicoper.h"
+#include "sofs_ifuncs_2.h"
+#include "sofs_ifuncs_3.h"
+#include "sofs_ifuncs_4.h"
+#include "sofs_atime.h"
+#include "sofs_inodecache.h"
+#include "sofs_statfs.h"
+#include "sofs_context.h"
+#include "sofs_syscalls.h"
+#include "sofs_client.h"
+
+/**
+ *  \brief Definition of a client.
+ */
+
+struct soClient
+{
+   /** \brief file system context the storage device is mounted in */
+    SOContext *ctx;
+   /** \brief number of open files and directories */
+    uint32_t nOpen;
+};
+
+/**
+ *  \brief Definition of the handle of an open regular file.
+ */
+
+struct soFile
+{
+   /** \brief client the file belongs to */
+    SOClient *p_cl;
+   /** \brief number of the inode associated to the file */
+    uint32_t nInode;
+   /** \brief flags the file was opened with */
+    int flags;
+   /** \brief current [byte] position */
+    int32_t pos;
+};
+
+/**
+ *  \brief Definition of the handle of an open directory.
+ */
+
+struct soDir
+{
+   /** \brief client the directory belongs to */
+    SOClient *p_cl;
+   /** \brief number of the inode associated to the directory */
+    uint32_t nInode;
+   /** \brief current [byte] position */
+    int32_t pos;
+};
+
+/* Allusion to internal functions */
+
+static int enter (SOClient *p_cl, SOContext **pp_prev);
+static void leave (SOContext *p_prev);
+static int execOp (SOClientOp *p_op);
+static int readData (uint32_t nInode, void *buff, uint32_t count, int32_t pos);
+static int writeData (uint32_t nInode, const void *buff, uint32_t count, int32_t pos);
+static int seekData (uint32_t nInode, int32_t pos, int whence);
+static int syncFile (uint32_t nInode);
+static int readEntry (uint32_t nInode, char *name, int32_t pos);
+
+/**
+ *  \brief Mount a storage device as a new client.
+ *
+ *  A new file system context is created and the storage device is mounted in it.
+ *
+ *  \param devname absolute path to the Linux file that simulates the storage device (as accepted by \e soMountSOFS)
+ *  \param pp_cl pointer to a location where the pointer to the client is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -<em>other specific error</em> issued by \e soMountSOFS
+ */
+
+int soClientMount (const char *devname, SOClient **pp_cl)
+{
+  soColorProbe (743, "07;31", "soClientMount (\"%s\", %p)\n", devname, pp_cl);
+
+  SOClient *p_cl;
+  SOContext *p_prev;
+  int stat;
+
+  if ((devname == NULL) || (pp_cl == NULL)) return -EINVAL;
+
+  if ((p_cl = calloc (1, sizeof (SOClient))) == NULL) return -ENOMEM;
+  if ((stat = soNewContext (&p_cl->ctx)) != 0)
+     { free (p_cl);
+       return stat;
+     }
+  if ((stat = enter (p_cl, &p_prev)) == 0)
+     { stat = soMountSOFS (devname);
+       leave (p_prev);
+     }
+  if (stat != 0)
+     { soFreeContext (p_cl->ctx);
+       free (p_cl);
+       return stat;
+     }
+  *pp_cl = p_cl;
+
+  return 0;
+}
+
+/**
+ *  \brief Unmount the storage device of a client.
+ *
+ *  Pending updates are stored, the storage device is unmounted and the client is destroyed.
+ *
+ *  \param p_cl pointer to the client
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EBUSY, if any file or directory is still open
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soUnmountSOFS
+ */
+
+int soClientUnmount (SOClient *p_cl)
+{
+  soColorProbe (744, "07;31", "soClientUnmount (%p)\n", p_cl);
+
+  SOContext *p_prev;
+  int stat;
+
+  if (p_cl == NULL) return -EINVAL;
+
+  if ((stat = enter (p_cl, &p_prev)) != 0) return stat;
+  if (p_cl->nOpen != 0)
+     stat = -EBUSY;
+  if ((stat == 0) &&
+      ((stat = soSyncAtime ()) == 0) &&          /* pending updates of the time of last access are stored first */
+      ((stat = soSyncInodes ()) == 0) &&         /* and so are the cached inodes not yet written back */
+      ((stat = soUnmountSOFS ()) == 0))
+     soDropStatFS ();                            /* the snapshot of the superblock counters is no longer valid */
+  leave (p_prev);
+  if (stat != 0) return stat;
+
+  soFreeContext (p_cl->ctx);
+  free (p_cl);
+
+  return 0;
+}
+
+/**
+ *  \brief Get file system statistics.
+ *
+ *  \param p_cl pointer to the client
+ *  \param st pointer to a statvfs structure
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soStatFS
+ */
+
+int soClientStatFS (SOClient *p_cl, struct statvfs *st)
+{
+  soColorProbe (745, "07;31", "soClientStatFS (%p, %p)\n", p_cl, st);
+
+  SOContext *p_prev;
+  int stat;
+
+  if ((p_cl == NULL) || (st == NULL)) return -EINVAL;
+
+  if ((stat = enter (p_cl, &p_prev)) != 0) return stat;
+  if (soGetStatFS (st) != 0)                     /* the snapshot of the superblock counters is not there */
+     stat = soStatFS ("/", st);
+  leave (p_prev);
+
+  return stat;
+}
+
+/**
+ *  \brief Open a regular file.
+ *
+ *  The current position is set to the beginning of the file.
+ *
+ *  \param p_cl pointer to the client
+ *  \param ePath path to the file
+ *  \param flags access mode (\c O_RDONLY, \c O_WRONLY or \c O_RDWR), possibly combined with \c O_CREAT, \c O_EXCL,
+ *               \c O_TRUNC and \c O_APPEND
+ *  \param mode permissions of the file, if it is created
+ *  \param pp_file pointer to a location where the pointer to the handle is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL or the access mode is not one of the above
+ *  \return -\c ENAMETOOLONG, if the path name exceeds the maximum allowed length
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soMknod, \e soOpen, \e soTruncate or \e soGetDirEntryByPath
+ */
+
+int soClientOpen (SOClient *p_cl, const char *ePath, int flags, mode_t mode, SOFile **pp_file)
+{
+  soColorProbe (746, "07;31", "soClientOpen (%p, \"%s\", %d, %o, %p)\n", p_cl, ePath, flags, mode, pp_file);
+
+  SOFile *p_file;
+  SOContext *p_prev;
+  int acc = flags & O_ACCMODE;                   /* access mode */
+  int stat;
+
+  if ((p_cl == NULL) || (ePath == NULL) || (pp_file == NULL) ||
+      ((acc != O_RDONLY) && (acc != O_WRONLY) && (acc != O_RDWR)))
+     return -EINVAL;
+  if (strlen (ePath) > MAX_PATH) return -ENAMETOOLONG;
+
+  if ((p_file = malloc (sizeof (SOFile))) == NULL) return -ENOMEM;
+  p_file->p_cl = p_cl;
+  p_file->flags = flags;
+  p_file->pos = 0;
+
+  if ((stat = enter (p_cl, &p_prev)) != 0)
+     { free (p_file);
+       return stat;
+     }
+  if ((flags & O_CREAT) == O_CREAT)
+     { stat = soMknod (ePath, S_IFREG | (mode & (S_IRWXU | S_IRWXG | S_IRWXO)));
+       if ((stat == -EEXIST) && ((flags & O_EXCL) != O_EXCL))
+          stat = 0;
+     }
+  if (stat == 0)
+     stat = soOpen (ePath, acc);
+  if ((stat == 0) && ((flags & O_TRUNC) == O_TRUNC) && (acc != O_RDONLY))
+     stat = soTruncate (ePath, 0);
+  if (stat == 0)
+     stat = soGetDirEntryByPath (ePath, NULL, &p_file->nInode);
+  if (stat == 0)
+     p_cl->nOpen += 1;
+  leave (p_prev);
+
+  if (stat != 0)
+     { free (p_file);
+       return stat;
+     }
+  *pp_file = p_file;
+
+  return 0;
+}
+
+/**
+ *  \brief Read data from an open regular file.
+ *
+ *  Data is read from the current position, which is advanced past it.
+ *
+ *  \param p_file pointer to the handle
+ *  \param buff pointer to the buffer where data to be read is to be stored
+ *  \param count number of bytes to be read
+ *
+ *  \return <em>number of bytes effectively read (0, if the end of file is reached)</em>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c EBADF, if the file was not opened for reading
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soReadInode or \e soReadFileCluster
+ */
+
+int soClientRead (SOFile *p_file, void *buff, uint32_t count)
+{
+  soColorProbe (747, "07;31", "soClientRead (%p, %p, %"PRIu32")\n", p_file, buff, count);
+
+  SOContext *p_prev;
+  int stat;
+
+  if ((p_file == NULL) || (buff == NULL)) return -EINVAL;
+  if ((p_file->flags & O_ACCMODE) == O_WRONLY) return -EBADF;
+
+  if ((stat = enter (p_file->p_cl, &p_prev)) != 0) return stat;
+  if ((stat = readData (p_file->nInode, buff, count, p_file->pos)) > 0)
+     p_file->pos += stat;
+  leave (p_prev);
+
+  return stat;
+}
+
+/**
+ *  \brief Write data into an open regular file.
+ *
+ *  Data is written at the current position (at the end of file, if it was opened with \c O_APPEND), which is advanced
+ *  past it.
+ *
+ *  \param p_file pointer to the handle
+ *  \param buff pointer to the buffer where data to be written is stored
+ *  \param count number of bytes to be written
+ *
+ *  \return <em>number of bytes effectively written</em>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c EBADF, if the file was not opened for writing
+ *  \return -\c EFBIG, if the data would pass the maximum size of a file
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soReadInode, \e soReadFileCluster, \e soWriteFileCluster or
+ *                                     \e soWriteInode
+ */
+
+int soClientWrite (SOFile *p_file, const void *buff, uint32_t count)
+{
+  soColorProbe (748, "07;31", "soClientWrite (%p, %p, %"PRIu32")\n", p_file, buff, count);
+
+  SOContext *p_prev;
+  SOInode inode;
+  int stat;
+
+  if ((p_file == NULL) || (buff == NULL)) return -EINVAL;
+  if ((p_file->flags & O_ACCMODE) == O_RDONLY) return -EBADF;
+
+  if ((stat = enter (p_file->p_cl, &p_prev)) != 0) return stat;
+  if (((p_file->flags & O_APPEND) == O_APPEND) && ((stat = soReadInode (&inode, p_file->nInode, IUIN)) == 0))
+     p_file->pos = (int32_t) inode.size;
+  if ((stat == 0) && ((stat = writeData (p_file->nInode, buff, count, p_file->pos)) > 0))
+     p_file->pos += stat;
+  leave (p_prev);
+
+  return stat;
+}
+
+/**
+ *  \brief Reposition the current position of an open regular file.
+ *
+ *  \param p_file pointer to the handle
+ *  \param offset [byte] offset, relative to the reference set by <tt>whence</tt>
+ *  \param whence \c SEEK_SET, \c SEEK_CUR or \c SEEK_END, for an offset from the beginning of the file, from the
+ *                current position or from the end of file, or \c SEEK_DATA or \c SEEK_HOLE, for the next region of
+ *                data or the next hole at or after the offset
+ *
+ *  \return <em>the new position</em>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL or <tt>whence</tt> is not one of the values above or the new position
+ *                      would be negative
+ *  \return -\c EOVERFLOW, if the new position can not be represented
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -\c ENXIO, for \c SEEK_DATA or \c SEEK_HOLE, if the offset is not before the end of file or, for
+ *                     \c SEEK_DATA, there is no data past it
+ *  \return -<em>other specific error</em> issued by \e soReadInode or \e soHandleFileCluster
+ */
+
+int soClientSeek (SOFile *p_file, int32_t offset, int whence)
+{
+  soColorProbe (749, "07;31", "soClientSeek (%p, %"PRIi32", %d)\n", p_file, offset, whence);
+
+  SOContext *p_prev;
+  SOInode inode;
+  int64_t pos = 0;                               /* new position */
+  int stat;
+
+  if ((p_file == NULL) ||
+      ((whence != SEEK_SET) && (whence != SEEK_CUR) && (whence != SEEK_END) && (whence != SEEK_DATA) &&
+       (whence != SEEK_HOLE)))
+     return -EINVAL;
+
+  if ((stat = enter (p_file->p_cl, &p_prev)) != 0) return stat;
+  switch (whence)
+  { case SEEK_SET:
+      pos = offset;
+      break;
+    case SEEK_CUR:
+      pos = (int64_t) p_file->pos + offset;
+      break;
+    case SEEK_END:
+      if ((stat = soReadInode (&inode, p_file->nInode, IUIN)) == 0)
+         pos = (int64_t) inode.size + offset;
+      break;
+    default:
+      if ((stat = seekData (p_file->nInode, offset, whence)) >= 0)
+         { pos = stat;
+           stat = 0;
+         }
+  }
+  if ((stat == 0) && (pos < 0))
+     stat = -EINVAL;
+  if ((stat == 0) && (pos > INT32_MAX))
+     stat = -EOVERFLOW;
+  if (stat == 0)
+     { p_file->pos = (int32_t) pos;
+       stat = p_file->pos;
+     }
+  leave (p_prev);
+
+  return stat;
+}
+
+/**
+ *  \brief Synchronize an open regular file with the storage device.
+ *
+ *  \param p_file pointer to the handle
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soSyncAtime, \e soSyncInodes or the buffercache
+ */
+
+int soClientFsync (SOFile *p_file)
+{
+  soColorProbe (750, "07;31", "soClientFsync (%p)\n", p_file);
+
+  SOContext *p_prev;
+  int stat;
+
+  if (p_file == NULL) return -EINVAL;
+
+  if ((stat = enter (p_file->p_cl, &p_prev)) != 0) return stat;
+  if (((stat = soSyncAtime ()) == 0) &&          /* pending updates of the time of last access are stored first */
+      ((stat = soSyncInodes ()) == 0))           /* and so are the cached inodes not yet written back */
+     stat = syncFile (p_file->nInode);
+  leave (p_prev);
+
+  return stat;
+}
+
+/**
+ *  \brief Close a regular file.
+ *
+ *  The data and the metadata of the file are stored, as \e soClose does. The handle is destroyed, even if they can
+ *  not be, unless the lock of the client can not be taken: the handle is then kept, so that the call may be retried.
+ *
+ *  \param p_file pointer to the handle
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by the buffercache
+ */
+
+int soClientClose (SOFile *p_file)
+{
+  soColorProbe (751, "07;31", "soClientClose (%p)\n", p_file);
+
+  SOContext *p_prev;
+  int stat;
+
+  if (p_file == NULL) return -EINVAL;
+
+  if ((stat = enter (p_file->p_cl, &p_prev)) != 0) return stat;
+  stat = syncFile (p_file->nInode);
+  p_file->p_cl->nOpen -= 1;
+  leave (p_prev);
+  free (p_file);
+
+  return stat;
+}
+
+/**
+ *  \brief Open a directory.
+ *
+ *  \param p_cl pointer to the client
+ *  \param ePath path to the directory
+ *  \param pp_dir pointer to a location where the pointer to the handle is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENAMETOOLONG, if the path name exceeds the maximum allowed length
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soOpendir or \e soGetDirEntryByPath
+ */
+
+int soClientOpendir (SOClient *p_cl, const char *ePath, SODir **pp_dir)
+{
+  soColorProbe (752, "07;31", "soClientOpendir (%p, \"%s\", %p)\n", p_cl, ePath, pp_dir);
+
+  SODir *p_dir;
+  SOContext *p_prev;
+  int stat;
+
+  if ((p_cl == NULL) || (ePath == NULL) || (pp_dir == NULL)) return -EINVAL;
+  if (strlen (ePath) > MAX_PATH) return -ENAMETOOLONG;
+
+  if ((p_dir = malloc (sizeof (SODir))) == NULL) return -ENOMEM;
+  p_dir->p_cl = p_cl;
+  p_dir->pos = 0;
+
+  if ((stat = enter (p_cl, &p_prev)) == 0)
+     { if (((stat = soOpendir (ePath)) == 0) && ((stat = soGetDirEntryByPath (ePath, NULL, &p_dir->nInode)) == 0))
+          p_cl->nOpen += 1;
+       leave (p_prev);
+     }
+  if (stat != 0)
+     { free (p_dir);
+       return stat;
+     }
+  *pp_dir = p_dir;
+
+  return 0;
+}
+
+/**
+ *  \brief Read the next entry of an open directory.
+ *
+ *  \param p_dir pointer to the handle
+ *  \param name pointer to a buffer, at least <tt>MAX_NAME + 1</tt> long, where the name of the entry is to be stored
+ *
+ *  \return <tt>1</tt>, if an entry was read
+ *  \return <tt>0 (zero)</tt>, if the end of the directory is reached
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soReadInode or \e soReadFileCluster
+ */
+
+int soClientReaddir (SODir *p_dir, char *name)
+{
+  soColorProbe (753, "07;31", "soClientReaddir (%p, %p)\n", p_dir, name);
+
+  SOContext *p_prev;
+  int stat;
+
+  if ((p_dir == NULL) || (name == NULL)) return -EINVAL;
+
+  if ((stat = enter (p_dir->p_cl, &p_prev)) != 0) return stat;
+  if ((stat = readEntry (p_dir->nInode, name, p_dir->pos)) > 0)
+     { p_dir->pos += stat;                       /* free directory entries skipped are accounted for */
+       stat = 1;
+     }
+  leave (p_prev);
+
+  return stat;
+}
+
+/**
+ *  \brief Close a directory.
+ *
+ *  The handle is destroyed, unless the lock of the client can not be taken: the handle is then kept, so that the call
+ *  may be retried.
+ *
+ *  \param p_dir pointer to the handle
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ */
+
+int soClientClosedir (SODir *p_dir)
+{
+  soColorProbe (754, "07;31", "soClientClosedir (%p)\n", p_dir);
+
+  SOContext *p_prev;
+  int stat;
+
+  if (p_dir == NULL) return -EINVAL;
+
+  if ((stat = enter (p_dir->p_cl, &p_prev)) != 0) return stat;
+  p_dir->p_cl->nOpen -= 1;
+  leave (p_prev);
+  free (p_dir);
+
+  return 0;
+}
+
+/**
+ *  \brief Execute a batch of operations.
+ *
+ *  The operations are executed in order, under a single acquisition of the lock of the client. A failed operation does
+ *  not stop the batch: the status of each operation is stored in its field <em>stat</em>.
+ *
+ *  The batch is a single metadata transaction: the superblock, which every allocation and every release of inodes and
+ *  data clusters changes, is stored once, at the end, rather than once per operation. That is all it saves: the
+ *  inodes, the directories and the data are written as each operation goes, and the batch is not atomic, the
+ *  operations which succeeded standing, whatever the status of the others.
+ *
+ *  \param p_cl pointer to the client
+ *  \param op pointer to the vector of operations
+ *  \param n number of operations
+ *
+ *  \return <em>number of operations which failed</em>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soStoreSuperBlock, if the superblock can not be stored
+ */
+
+int soClientBatch (SOClient *p_cl, SOClientOp *op, uint32_t n)
+{
+  soColorProbe (755, "07;31", "soClientBatch (%p, %p, %"PRIu32")\n", p_cl, op, n);
+
+  SOContext *p_prev;
+  uint32_t i;
+  int nFail = 0;                                 /* number of operations which failed */
+  int stat;
+
+  if ((p_cl == NULL) || (op == NULL)) return -EINVAL;
+
+  if ((stat = enter (p_cl, &p_prev)) != 0) return stat;
+  soBeginMetaTransaction ();
+  for (i = 0; i < n; i++)
+    if ((op[i].stat = execOp (&op[i])) < 0)
+       nFail += 1;
+  stat = soEndMetaTransaction ();
+  leave (p_prev);
+
+  return (stat != 0) ? stat : nFail;
+}
+
+/**
+ *  \brief Bind the file system context of a client to the calling thread.
+ *
+ *  \param p_cl pointer to the client
+ *  \param pp_prev pointer to a location where the pointer to the context previously bound is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ */
+
+static int enter (SOClient *p_cl, SOContext **pp_prev)
+{
+  int stat;
+
+  *pp_prev = soGetContext ();
+  if ((stat = soBindContext (p_cl->ctx)) != 0)
+     soBindContext (*pp_prev);
+
+  return stat;
+}
+
+/**
+ *  \brief Bind again the file system context previously bound to the calling thread.
+ *
+ *  \param p_prev pointer to the context, as stored by \e enter
+ */
+
+static void leave (SOContext *p_prev)
+{
+  soBindContext (p_prev);
+}
+
+/**
+ *  \brief Execute an operation of a batch.
+ *
+ *  \param p_op pointer to the operation
+ *
+ *  \return <em>status returned by the system call it maps to</em>
+ *  \return -\c EINVAL, if the operation is unknown
+ */
+
+static int execOp (SOClientOp *p_op)
+{
+  mode_t perm = p_op->mode & (S_IRWXU | S_IRWXG | S_IRWXO);
+
+  switch (p_op->op)
+  { case CLI_STAT:
+      return soStat (p_op->path, (struct stat *) p_op->buff);
+    case CLI_MKNOD:
+      return soMknod (p_op->path, S_IFREG | perm);
+    case CLI_MKDIR:
+      return soMkdir (p_op->path, S_IFDIR | perm);
+    case CLI_UNLINK:
+      return soUnlink (p_op->path);
+    case CLI_RMDIR:
+      return soRmdir (p_op->path);
+    case CLI_RENAME:
+      return soRename (p_op->path, p_op->newPath);
+    case CLI_LINK:
+      return soLink (p_op->path, p_op->newPath);
+    case CLI_SYMLINK:
+      return soSymlink (p_op->newPath, p_op->path);
+    case CLI_CHMOD:
+      return soChmod (p_op->path, perm);
+    case CLI_TRUNCATE:
+      return soTruncate (p_op->path, p_op->pos);
+    case CLI_READ:
+      return soRead (p_op->path, p_op->buff, p_op->count, p_op->pos);
+    case CLI_WRITE:
+      return soWrite (p_op->path, p_op->buff, p_op->count, p_op->pos);
+    case CLI_READDIR:
+      return soReaddir (p_op->path, p_op->buff, p_op->pos);
+    case CLI_CHOWN:
+      return soChown (p_op->path, p_op->owner, p_op->group);
+    case CLI_UTIMENS:
+      return soUtimens (p_op->path, (const struct timespec *) p_op->buff);
+    default:
+      return -EINVAL;
+  }
+}
+
+/**
+ *  \brief Read data from an open regular file.
+ *
+ *  The access rights were checked when the file was opened. Holes read as zeros.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param buff pointer to the buffer where data to be read is to be stored
+ *  \param count number of bytes to be read
+ *  \param pos starting [byte] position in the file data continuum where data is to be read from
+ *
+ *  \return <em>number of bytes effectively read</em>, on success
+ *  \return -\c EISDIR, if the inode is associated to a directory
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int readData (uint32_t nInode, void *buff, uint32_t count, int32_t pos)
+{
+  SOInode inode;
+  SODataClust dc;
+  uint32_t clustInd, offset;                     /* location of the current byte position in the file */
+  uint32_t n, done;                              /* number of bytes to copy from the data cluster, and copied so far */
+  int stat;
+
+  if ((stat = soReadInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+  if ((inode.mode & INODE_DIR) == INODE_DIR)
+     return -EISDIR;
+  if ((uint32_t) pos >= inode.size)              /* nothing is read past the end of file */
+     return 0;
+  if (count > inode.size - (uint32_t) pos)
+     count = inode.size - (uint32_t) pos;
+
+  for (done = 0; done < count; done += n)
+  { if ((stat = soConvertBPIDC ((uint32_t) pos + done, &clustInd, &offset)) != 0)
+       return stat;
+    n = ((BSLPC - offset) < (count - done)) ? BSLPC - offset : count - done;
+    if ((stat = soReadFileCluster (nInode, clustInd, &dc)) != 0)
+       return stat;
+    memcpy ((char *) buff + done, dc.info.data + offset, n);
+  }
+
+  return (int) count;
+}
+
+/**
+ *  \brief Write data into an open regular file.
+ *
+ *  The access rights were checked when the file was opened. The data clusters not yet allocated are allocated and the
+ *  size of the file is updated, if it grows.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param buff pointer to the buffer where data to be written is stored
+ *  \param count number of bytes to be written
+ *  \param pos starting [byte] position in the file data continuum where data is to be written into
+ *
+ *  \return <em>number of bytes effectively written</em>, on success
+ *  \return -\c EFBIG, if the data would pass the maximum size of a file
+ *  \return -\c EISDIR, if the inode is associated to a directory
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int writeData (uint32_t nInode, const void *buff, uint32_t count, int32_t pos)
+{
+  SOInode inode;
+  SODataClust dc;
+  uint32_t clustInd, offset;                     /* location of the current byte position in the file */
+  uint32_t n, done;                              /* number of bytes to copy into the data cluster, and copied so far */
+  int stat;
+
+  if (((uint32_t) pos > MAX_FILE_SIZE) || (count > MAX_FILE_SIZE - (uint32_t) pos))
+     return -EFBIG;
+  if ((stat = soReadInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+  if ((inode.mode & INODE_DIR) == INODE_DIR)
+     return -EISDIR;
+
+  for (done = 0; done < count; done += n)
+  { if ((stat = soConvertBPIDC ((uint32_t) pos + done, &clustInd, &offset)) != 0)
+       return stat;
+    n = ((BSLPC - offset) < (count - done)) ? BSLPC - offset : count - done;
+    if ((n != BSLPC) && ((stat = soReadFileCluster (nInode, clustInd, &dc)) != 0))
+       return stat;                              /* a partial data cluster keeps the rest of its data */
+    memcpy (dc.info.data + offset, (const char *) buff + done, n);
+    if ((stat = soWriteFileCluster (nInode, clustInd, &dc)) != 0)
+       return stat;
+  }
+
+  /* the size and the times of last access and modification are updated */
+
+  if ((stat = soReadInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+  if ((uint32_t) pos + count > inode.size)
+     inode.size = (uint32_t) pos + count;
+  if ((stat = soWriteInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+
+  return (int) count;
+}
+
+/**
+ *  \brief Find the next region of data or the next hole in an open regular file.
+ *
+ *  It is what \e soLseek does, for \c SEEK_DATA and \c SEEK_HOLE, but upon the inode.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param pos starting [byte] position in the file data continuum
+ *  \param whence \c SEEK_DATA or \c SEEK_HOLE
+ *
+ *  \return <em>the [byte] position found</em>, on success
+ *  \return -\c EINVAL, if <tt>pos</tt> is negative
+ *  \return -\c ENXIO, if <tt>pos</tt> is not before the end of file or, for \c SEEK_DATA, there is no data past it
+ *  \return -\c EISDIR, if the inode is associated to a directory
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int seekData (uint32_t nInode, int32_t pos, int whence)
+{
+  SOInode inode;
+  uint32_t clustInd, lastInd;                    /* indexes to the list of references */
+  uint32_t nClust;                               /* logical number of the data cluster */
+  int stat;
+
+  if (pos < 0) return -EINVAL;
+  if ((stat = soReadInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+  if ((inode.mode & INODE_DIR) == INODE_DIR)
+     return -EISDIR;
+  if ((uint32_t) pos >= inode.size)
+     return -ENXIO;
+
+  lastInd = (inode.size - 1) / BSLPC;
+  for (clustInd = (uint32_t) pos / BSLPC; clustInd <= lastInd; clustInd++)
+  { if ((stat = soHandleFileCluster (nInode, clustInd, GET, &nClust)) != 0)
+       return stat;
+    if ((nClust != NULL_CLUSTER) == (whence == SEEK_DATA))
+       break;
+  }
+
+  if (clustInd > lastInd)
+     return (whence == SEEK_DATA) ? -ENXIO : (int) inode.size;
+  if (clustInd * BSLPC <= (uint32_t) pos)
+     return pos;
+  return (int) (clustInd * BSLPC);
+}
+
+/**
+ *  \brief Store the data and the metadata of an open file.
+ *
+ *  It is what \e soFsync does, but upon the inode: the block of the table of inodes which holds it, the data clusters
+ *  and the clusters of references of the file are synchronized with the storage device.
+ *
+ *  \param nInode number of the inode associated to the file
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int syncFile (uint32_t nInode)
+{
+  SOSuperBlock *p_sb;
+  SOInode inode;
+  SODataClust *p_ref;
+  uint32_t clustInd, nClust, i;
+  int stat;
+
+  if (((stat = soSyncInode (nInode)) != 0) || ((stat = soReadInode (&inode, nInode, IUIN)) != 0) ||
+      ((stat = soLoadSuperBlock ()) != 0))
+     return stat;
+  p_sb = soGetSuperBlock ();
+  if ((stat = soSyncCacheBlock (p_sb->iTableStart + nInode / IPB)) != 0)
+     return stat;
+
+  for (clustInd = 0; clustInd * BSLPC < inode.size; clustInd++)
+  { if ((stat = soHandleFileCluster (nInode, clustInd, GET, &nClust)) != 0)
+       return stat;
+    if ((nClust != NULL_CLUSTER) &&
+        ((stat = soSyncCacheCluster (p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER)) != 0))
+       return stat;
+  }
+  if ((inode.i1 != NULL_CLUSTER) &&
+      ((stat = soSyncCacheCluster (p_sb->dZoneStart + inode.i1 * BLOCKS_PER_CLUSTER)) != 0))
+     return stat;
+  if (inode.i2 != NULL_CLUSTER)
+     { if (((stat = soSyncCacheCluster (p_sb->dZoneStart + inode.i2 * BLOCKS_PER_CLUSTER)) != 0) ||
+           ((stat = soLoadDirRefClust (p_sb->dZoneStart + inode.i2 * BLOCKS_PER_CLUSTER)) != 0))
+          return stat;
+       p_ref = soGetDirRefClust ();
+       for (i = 0; i < RPC; i++)
+         if ((p_ref->info.ref[i] != NULL_CLUSTER) &&
+             ((stat = soSyncCacheCluster (p_sb->dZoneStart + p_ref->info.ref[i] * BLOCKS_PER_CLUSTER)) != 0))
+            return stat;
+     }
+
+  return 0;
+}
+
+/**
+ *  \brief Read the next directory entry in use of an open directory.
+ *
+ *  It is what \e soReaddir does, but upon the inode: the free directory entries are skipped and accounted for in the
+ *  value returned.
+ *
+ *  \param nInode number of the inode associated to the directory
+ *  \param name pointer to a buffer, at least <tt>MAX_NAME + 1</tt> long, where the name of the entry is to be stored
+ *  \param pos starting [byte] position in the directory
+ *
+ *  \return <em>number of bytes read to get a directory entry in use (0, if the end is reached)</em>, on success
+ *  \return -\c EINVAL, if <tt>pos</tt> is not a multiple of the size of a directory entry
+ *  \return -\c ENOTDIR, if the inode is not associated to a directory
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int readEntry (uint32_t nInode, char *name, int32_t pos)
+{
+  SOInode inode;
+  SODataClust dc;
+  uint32_t idx, nEnt;                            /* index of the current directory entry and number of entries */
+  int stat;
+
+  if ((pos < 0) || (pos % sizeof (SODirEntry) != 0)) return -EINVAL;
+  if ((stat = soReadInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+  if ((inode.mode & INODE_DIR) != INODE_DIR)
+     return -ENOTDIR;
+
+  nEnt = inode.size / sizeof (SODirEntry);
+  for (idx = (uint32_t) pos / sizeof (SODirEntry); idx < nEnt; idx++)
+  { if (((idx == (uint32_t) pos / sizeof (SODirEntry)) || (idx % DPC == 0)) &&
+        ((stat = soReadFileCluster (nInode, idx / DPC, &dc)) != 0))
+       return stat;
+    if (dc.info.de[idx % DPC].name[0] != '\0')
+       { memcpy (name, dc.info.de[idx % DPC].name, MAX_NAME + 1);
+         return (int) ((idx + 1) * sizeof (SODirEntry) - (uint32_t) pos);
+       }
+  }
+
+  return 0;
+}
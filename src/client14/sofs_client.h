@@ -0,0 +1,345 @@
+/**
+ *  \file sofs_client.h (interface file)
+ *
+ *  \brief In-process client of the SOFS14 file system.
+ *
+ *  An application may link the file system directly, instead of going through a FUSE mount, so that each operation
+ *  is a function call rather than two crossings of the kernel boundary.
+ *
+ *  A client is a storage device mounted in a file system context of its own: many clients, each upon a different
+ *  storage device, may thus be served in parallel. A client is thread-safe: any thread may use it, the operations upon
+ *  the same client being serialized by the lock of its context. The context the calling thread was bound to before is
+ *  bound again upon return, so that clients can be mixed with direct calls to the system call layer.
+ *
+ *  Regular files and directories are accessed through handles, which keep the inode of the file and the current
+ *  position, as the file descriptors of the operating system do: a handle follows its file through renames. The inode
+ *  is not pinned, though: a file removed while it is open must not be accessed through its handle any longer. Any
+ *  other operation is submitted in a batch: a vector of operations executed in order under a single acquisition of the
+ *  lock and within a single metadata transaction, each with its own status.
+ *
+ *  The following operations are defined:
+ *    \li mount a storage device as a new client
+ *    \li unmount the storage device of a client
+ *    \li get file system statistics
+ *    \li open a regular file
+ *    \li read data from an open regular file
+ *    \li write data into an open regular file
+ *    \li reposition the current position of an open regular file
+ *    \li synchronize an open regular file with the storage device
+ *    \li close a regular file
+ *    \li open a directory
+ *    \li read the next entry of an open directory
+ *    \li close a directory
+ *    \li execute a batch of operations.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_CLIENT_H_
+#define SOFS_CLIENT_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+/** \brief client (its contents are private) */
+typedef struct soClient SOClient;
+
+/** \brief handle of an open regular file (its contents are private) */
+typedef struct soFile SOFile;
+
+/** \brief handle of an open directory (its contents are private) */
+typedef struct soDir SODir;
+
+/* Operations of a batch */
+
+/** \brief get file status (<em>buff</em> points to a stat structure) */
+#define CLI_STAT      0
+/** \brief create a regular file with size 0 (<em>mode</em> holds the permissions) */
+#define CLI_MKNOD     1
+/** \brief create a directory (<em>mode</em> holds the permissions) */
+#define CLI_MKDIR     2
+/** \brief delete the name of a file */
+#define CLI_UNLINK    3
+/** \brief delete a directory */
+#define CLI_RMDIR     4
+/** \brief change the name or the location of a file (to <em>newPath</em>) */
+#define CLI_RENAME    5
+/** \brief make a new name for a file (<em>newPath</em>) */
+#define CLI_LINK      6
+/** \brief make a symbolic link (holding <em>newPath</em>) */
+#define CLI_SYMLINK   7
+/** \brief change permissions of a file (to <em>mode</em>) */
+#define CLI_CHMOD     8
+/** \brief truncate a regular file (to <em>pos</em>) */
+#define CLI_TRUNCATE  9
+/** \brief read data from a regular file (<em>count</em> bytes, at <em>pos</em>, into <em>buff</em>) */
+#define CLI_READ      10
+/** \brief write data into a regular file (<em>count</em> bytes, at <em>pos</em>, from <em>buff</em>) */
+#define CLI_WRITE     11
+/** \brief read the next directory entry in use of a directory (at <em>pos</em>, its name into <em>buff</em>) */
+#define CLI_READDIR   12
+/** \brief change the ownership of a file (to <em>owner</em> and <em>group</em>) */
+#define CLI_CHOWN     13
+/** \brief change the last access and modification times of a file (<em>buff</em> points to two timespec structures) */
+#define CLI_UTIMENS   14
+
+/**
+ *  \brief Definition of an operation of a batch.
+ */
+
+typedef struct soClientOp
+{
+   /** \brief operation (one of the \c CLI_ values) */
+    uint32_t op;
+   /** \brief path to the file */
+    const char *path;
+   /** \brief second path, for \c CLI_RENAME, \c CLI_LINK and \c CLI_SYMLINK */
+    const char *newPath;
+   /** \brief permissions, for \c CLI_MKNOD, \c CLI_MKDIR and \c CLI_CHMOD */
+    mode_t mode;
+   /** \brief user id, for \c CLI_CHOWN (-1, if it is not to be changed) */
+    uid_t owner;
+   /** \brief group id, for \c CLI_CHOWN (-1, if it is not to be changed) */
+    gid_t group;
+   /** \brief pointer to a buffer, for \c CLI_STAT, \c CLI_READ, \c CLI_WRITE, \c CLI_READDIR and \c CLI_UTIMENS */
+    void *buff;
+   /** \brief number of bytes, for \c CLI_READ and \c CLI_WRITE */
+    uint32_t count;
+   /** \brief [byte] position, for \c CLI_READ, \c CLI_WRITE and \c CLI_READDIR, or length, for \c CLI_TRUNCATE */
+    int32_t pos;
+   /** \brief status of the operation, as returned by the system call it maps to (set upon execution) */
+    int stat;
+} SOClientOp;
+
+/**
+ *  \brief Mount a storage device as a new client.
+ *
+ *  A new file system context is created and the storage device is mounted in it.
+ *
+ *  \param devname absolute path to the Linux file that simulates the storage device (as accepted by \e soMountSOFS)
+ *  \param pp_cl pointer to a location where the pointer to the client is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -<em>other specific error</em> issued by \e soMountSOFS
+ */
+
+extern int soClientMount (const char *devname, SOClient **pp_cl);
+
+/**
+ *  \brief Unmount the storage device of a client.
+ *
+ *  Pending updates are stored, the storage device is unmounted and the client is destroyed.
+ *
+ *  \param p_cl pointer to the client
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EBUSY, if any file or directory is still open
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soUnmountSOFS
+ */
+
+extern int soClientUnmount (SOClient *p_cl);
+
+/**
+ *  \brief Get file system statistics.
+ *
+ *  \param p_cl pointer to the client
+ *  \param st pointer to a statvfs structure
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soStatFS
+ */
+
+extern int soClientStatFS (SOClient *p_cl, struct statvfs *st);
+
+/**
+ *  \brief Open a regular file.
+ *
+ *  The current position is set to the beginning of the file.
+ *
+ *  \param p_cl pointer to the client
+ *  \param ePath path to the file
+ *  \param flags access mode (\c O_RDONLY, \c O_WRONLY or \c O_RDWR), possibly combined with \c O_CREAT, \c O_EXCL,
+ *               \c O_TRUNC and \c O_APPEND
+ *  \param mode permissions of the file, if it is created
+ *  \param pp_file pointer to a location where the pointer to the handle is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL or the access mode is not one of the above
+ *  \return -\c ENAMETOOLONG, if the path name exceeds the maximum allowed length
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soMknod, \e soOpen, \e soTruncate or \e soGetDirEntryByPath
+ */
+
+extern int soClientOpen (SOClient *p_cl, const char *ePath, int flags, mode_t mode, SOFile **pp_file);
+
+/**
+ *  \brief Read data from an open regular file.
+ *
+ *  Data is read from the current position, which is advanced past it.
+ *
+ *  \param p_file pointer to the handle
+ *  \param buff pointer to the buffer where data to be read is to be stored
+ *  \param count number of bytes to be read
+ *
+ *  \return <em>number of bytes effectively read (0, if the end of file is reached)</em>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c EBADF, if the file was not opened for reading
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soReadInode or \e soReadFileCluster
+ */
+
+extern int soClientRead (SOFile *p_file, void *buff, uint32_t count);
+
+/**
+ *  \brief Write data into an open regular file.
+ *
+ *  Data is written at the current position (at the end of file, if it was opened with \c O_APPEND), which is advanced
+ *  past it.
+ *
+ *  \param p_file pointer to the handle
+ *  \param buff pointer to the buffer where data to be written is stored
+ *  \param count number of bytes to be written
+ *
+ *  \return <em>number of bytes effectively written</em>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c EBADF, if the file was not opened for writing
+ *  \return -\c EFBIG, if the data would pass the maximum size of a file
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soReadInode, \e soReadFileCluster, \e soWriteFileCluster or
+ *                                     \e soWriteInode
+ */
+
+extern int soClientWrite (SOFile *p_file, const void *buff, uint32_t count);
+
+/**
+ *  \brief Reposition the current position of an open regular file.
+ *
+ *  \param p_file pointer to the handle
+ *  \param offset [byte] offset, relative to the reference set by <tt>whence</tt>
+ *  \param whence \c SEEK_SET, \c SEEK_CUR or \c SEEK_END, for an offset from the beginning of the file, from the
+ *                current position or from the end of file, or \c SEEK_DATA or \c SEEK_HOLE, for the next region of
+ *                data or the next hole at or after the offset
+ *
+ *  \return <em>the new position</em>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL or <tt>whence</tt> is not one of the values above or the new position
+ *                      would be negative
+ *  \return -\c EOVERFLOW, if the new position can not be represented
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -\c ENXIO, for \c SEEK_DATA or \c SEEK_HOLE, if the offset is not before the end of file or, for
+ *                     \c SEEK_DATA, there is no data past it
+ *  \return -<em>other specific error</em> issued by \e soReadInode or \e soHandleFileCluster
+ */
+
+extern int soClientSeek (SOFile *p_file, int32_t offset, int whence);
+
+/**
+ *  \brief Synchronize an open regular file with the storage device.
+ *
+ *  \param p_file pointer to the handle
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soSyncAtime, \e soSyncInodes or the buffercache
+ */
+
+extern int soClientFsync (SOFile *p_file);
+
+/**
+ *  \brief Close a regular file.
+ *
+ *  The data and the metadata of the file are stored, as \e soClose does. The handle is destroyed, even if they can
+ *  not be, unless the lock of the client can not be taken: the handle is then kept, so that the call may be retried.
+ *
+ *  \param p_file pointer to the handle
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by the buffercache
+ */
+
+extern int soClientClose (SOFile *p_file);
+
+/**
+ *  \brief Open a directory.
+ *
+ *  \param p_cl pointer to the client
+ *  \param ePath path to the directory
+ *  \param pp_dir pointer to a location where the pointer to the handle is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENAMETOOLONG, if the path name exceeds the maximum allowed length
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soOpendir or \e soGetDirEntryByPath
+ */
+
+extern int soClientOpendir (SOClient *p_cl, const char *ePath, SODir **pp_dir);
+
+/**
+ *  \brief Read the next entry of an open directory.
+ *
+ *  \param p_dir pointer to the handle
+ *  \param name pointer to a buffer, at least <tt>MAX_NAME + 1</tt> long, where the name of the entry is to be stored
+ *
+ *  \return <tt>1</tt>, if an entry was read
+ *  \return <tt>0 (zero)</tt>, if the end of the directory is reached
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soReadInode or \e soReadFileCluster
+ */
+
+extern int soClientReaddir (SODir *p_dir, char *name);
+
+/**
+ *  \brief Close a directory.
+ *
+ *  The handle is destroyed, unless the lock of the client can not be taken: the handle is then kept, so that the call
+ *  may be retried.
+ *
+ *  \param p_dir pointer to the handle
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ */
+
+extern int soClientClosedir (SODir *p_dir);
+
+/**
+ *  \brief Execute a batch of operations.
+ *
+ *  The operations are executed in order, under a single acquisition of the lock of the client. A failed operation does
+ *  not stop the batch: the status of each operation is stored in its field <em>stat</em>.
+ *
+ *  The batch is a single metadata transaction: the superblock, which every allocation and every release of inodes and
+ *  data clusters changes, is stored once, at the end, rather than once per operation. That is all it saves: the
+ *  inodes, the directories and the data are written as each operation goes, and the batch is not atomic, the
+ *  operations which succeeded standing, whatever the status of the others.
+ *
+ *  \param p_cl pointer to the client
+ *  \param op pointer to the vector of operations
+ *  \param n number of operations
+ *
+ *  \return <em>number of operations which failed</em>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOLCK, if the lock of the client can not be taken
+ *  \return -<em>other specific error</em> issued by \e soStoreSuperBlock, if the superblock can not be stored
+ */
+
+extern int soClientBatch (SOClient *p_cl, SOClientOp *op, uint32_t n);
+
+#endif /* SOFS_CLIENT_H_ */
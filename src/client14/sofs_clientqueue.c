@@ -0,0 +1,283 @@
+/**
+ *  \file sofs_clientqueue.c (implementation file)
+ *
+ *  \brief Asynchronous submission of operations to a client.
+ *
+ *  The operations submitted are kept in a linked list of requests, in the order they were submitted. The worker thread
+ *  detaches the whole list at once, copies the operations into a vector, executes the vector as a batch of the client
+ *  and then stores the status of each operation and calls its callback, before it looks at the list again. Waiting for
+ *  the completion is done by comparing the number of operations submitted to the number of operations completed.
+ *
+ *  The following operations are defined:
+ *    \li create a queue of a client
+ *    \li submit an operation
+ *    \li wait for the completion of all the operations submitted
+ *    \li destroy a queue.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "sofs_probe.h"
+#include "sofs_client.h"
+#include "sofs_clientqueue.h"
+
+/**
+ *  \brief Definition of a request: an operation submitted and not yet executed.
+ */
+
+typedef struct soRequest
+{
+   /** \brief pointer to the operation */
+    SOClientOp *p_op;
+   /** \brief callback to be called upon completion */
+    SOClientCallback cb;
+   /** \brief argument to be passed to the callback */
+    void *arg;
+   /** \brief pointer to the next request */
+    struct soRequest *next;
+} SORequest;
+
+/**
+ *  \brief Definition of a queue of a client.
+ */
+
+struct soClientQueue
+{
+   /** \brief client the operations are executed upon */
+    SOClient *p_cl;
+   /** \brief worker thread */
+    pthread_t worker;
+   /** \brief lock protecting the fields below */
+    pthread_mutex_t lock;
+   /** \brief condition signalled when a request is added or the queue is being destroyed */
+    pthread_cond_t ready;
+   /** \brief condition signalled when a batch of requests is completed */
+    pthread_cond_t done;
+   /** \brief first request of the list */
+    SORequest *head;
+   /** \brief last request of the list */
+    SORequest *tail;
+   /** \brief number of operations submitted */
+    uint64_t nSubmit;
+   /** \brief number of operations completed */
+    uint64_t nDone;
+   /** \brief destruction state: \c true, if the queue is being destroyed */
+    bool stop;
+};
+
+/* Allusion to internal function */
+
+static void *work (void *arg);
+
+/**
+ *  \brief Create a queue of a client.
+ *
+ *  The worker thread of the queue is started.
+ *
+ *  \param p_cl pointer to the client
+ *  \param pp_q pointer to a location where the pointer to the queue is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c EAGAIN, if the worker thread can not be started
+ */
+
+int soNewClientQueue (SOClient *p_cl, SOClientQueue **pp_q)
+{
+  soColorProbe (756, "07;31", "soNewClientQueue (%p, %p)\n", p_cl, pp_q);
+
+  SOClientQueue *p_q;
+
+  if ((p_cl == NULL) || (pp_q == NULL)) return -EINVAL;
+
+  if ((p_q = calloc (1, sizeof (SOClientQueue))) == NULL) return -ENOMEM;
+  p_q->p_cl = p_cl;
+  pthread_mutex_init (&p_q->lock, NULL);
+  pthread_cond_init (&p_q->ready, NULL);
+  pthread_cond_init (&p_q->done, NULL);
+  if (pthread_create (&p_q->worker, NULL, work, p_q) != 0)
+     { pthread_cond_destroy (&p_q->done);
+       pthread_cond_destroy (&p_q->ready);
+       pthread_mutex_destroy (&p_q->lock);
+       free (p_q);
+       return -EAGAIN;
+     }
+  *pp_q = p_q;
+
+  return 0;
+}
+
+/**
+ *  \brief Submit an operation.
+ *
+ *  The operation and the buffers it points to must be kept until the callback is called.
+ *
+ *  \param p_q pointer to the queue
+ *  \param p_op pointer to the operation
+ *  \param cb callback to be called upon completion (\c NULL, if none)
+ *  \param arg argument to be passed to the callback
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c ESHUTDOWN, if the queue is being destroyed
+ */
+
+int soClientSubmit (SOClientQueue *p_q, SOClientOp *p_op, SOClientCallback cb, void *arg)
+{
+  soColorProbe (757, "07;31", "soClientSubmit (%p, %p, %p, %p)\n", p_q, p_op, cb, arg);
+
+  SORequest *p_req;
+
+  if ((p_q == NULL) || (p_op == NULL)) return -EINVAL;
+
+  if ((p_req = malloc (sizeof (SORequest))) == NULL) return -ENOMEM;
+  p_req->p_op = p_op;
+  p_req->cb = cb;
+  p_req->arg = arg;
+  p_req->next = NULL;
+
+  pthread_mutex_lock (&p_q->lock);
+  if (p_q->stop)
+     { pthread_mutex_unlock (&p_q->lock);
+       free (p_req);
+       return -ESHUTDOWN;
+     }
+  if (p_q->head == NULL)
+     p_q->head = p_req;
+     else p_q->tail->next = p_req;
+  p_q->tail = p_req;
+  p_q->nSubmit += 1;
+  pthread_cond_signal (&p_q->ready);
+  pthread_mutex_unlock (&p_q->lock);
+
+  return 0;
+}
+
+/**
+ *  \brief Wait for the completion of all the operations submitted.
+ *
+ *  The operations submitted by the callbacks meanwhile are waited for too.
+ *
+ *  \param p_q pointer to the queue
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EDEADLK, if it is called from a callback
+ */
+
+int soClientDrain (SOClientQueue *p_q)
+{
+  soColorProbe (758, "07;31", "soClientDrain (%p)\n", p_q);
+
+  if (p_q == NULL) return -EINVAL;
+  if (pthread_equal (pthread_self (), p_q->worker)) return -EDEADLK;
+
+  pthread_mutex_lock (&p_q->lock);
+  while (p_q->nDone != p_q->nSubmit)
+    pthread_cond_wait (&p_q->done, &p_q->lock);
+  pthread_mutex_unlock (&p_q->lock);
+
+  return 0;
+}
+
+/**
+ *  \brief Destroy a queue.
+ *
+ *  The operations submitted are waited for and the worker thread is stopped. The client is left mounted.
+ *
+ *  \param p_q pointer to the queue
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EDEADLK, if it is called from a callback
+ */
+
+int soFreeClientQueue (SOClientQueue *p_q)
+{
+  soColorProbe (759, "07;31", "soFreeClientQueue (%p)\n", p_q);
+
+  if (p_q == NULL) return -EINVAL;
+  if (pthread_equal (pthread_self (), p_q->worker)) return -EDEADLK;
+
+  pthread_mutex_lock (&p_q->lock);
+  p_q->stop = true;
+  pthread_cond_signal (&p_q->ready);
+  pthread_mutex_unlock (&p_q->lock);
+  pthread_join (p_q->worker, NULL);              /* the worker thread empties the list before it stops */
+
+  pthread_cond_destroy (&p_q->done);
+  pthread_cond_destroy (&p_q->ready);
+  pthread_mutex_destroy (&p_q->lock);
+  free (p_q);
+
+  return 0;
+}
+
+/**
+ *  \brief Life cycle of the worker thread of a queue.
+ *
+ *  \param arg pointer to the queue
+ *
+ *  \return \c NULL
+ */
+
+static void *work (void *arg)
+{
+  SOClientQueue *p_q = (SOClientQueue *) arg;
+  SORequest *list, *p_req, *next;                /* requests detached from the queue */
+  SOClientOp *op = NULL, *tmp;                   /* copies of their operations */
+  uint32_t size = 0;                             /* number of elements of op */
+  uint32_t n, i;
+  int stat;
+
+  pthread_mutex_lock (&p_q->lock);
+  while (true)
+  { while ((p_q->head == NULL) && !p_q->stop)
+      pthread_cond_wait (&p_q->ready, &p_q->lock);
+    if (p_q->head == NULL) break;
+    list = p_q->head;
+    p_q->head = p_q->tail = NULL;
+    pthread_mutex_unlock (&p_q->lock);
+
+    /* the operations are executed as a single batch, or one by one, if there is not enough memory to copy them */
+
+    for (n = 0, p_req = list; p_req != NULL; p_req = p_req->next)
+      n += 1;
+    if ((n > size) && ((tmp = realloc (op, n * sizeof (SOClientOp))) != NULL))
+       { op = tmp;
+         size = n;
+       }
+    if (n <= size)
+       { for (i = 0, p_req = list; p_req != NULL; i++, p_req = p_req->next)
+           op[i] = *p_req->p_op;
+         stat = soClientBatch (p_q->p_cl, op, n);
+         for (i = 0, p_req = list; p_req != NULL; i++, p_req = p_req->next)
+           p_req->p_op->stat = (stat < 0) ? stat : op[i].stat;
+       }
+       else for (p_req = list; p_req != NULL; p_req = p_req->next)
+              if ((stat = soClientBatch (p_q->p_cl, p_req->p_op, 1)) < 0)
+                 p_req->p_op->stat = stat;
+
+    for (p_req = list; p_req != NULL; p_req = next)
+    { next = p_req->next;
+      if (p_req->cb != NULL)
+         p_req->cb (p_req->p_op, p_req->arg);
+      free (p_req);
+    }
+
+    pthread_mutex_lock (&p_q->lock);
+    p_q->nDone += n;
+    pthread_cond_broadcast (&p_q->done);
+  }
+  pthread_mutex_unlock (&p_q->lock);
+  free (op);
+
+  return NULL;
+}
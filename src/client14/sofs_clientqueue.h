@@ -0,0 +1,107 @@
+/**
+ *  \file sofs_clientqueue.h (interface file)
+ *
+ *  \brief Asynchronous submission of operations to a client.
+ *
+ *  The operations of a client block the calling thread until the data clusters and the blocks of the table of inodes
+ *  they touch are read from the storage device. A queue lets a thread submit operations and go on: each operation is
+ *  executed later on, by a worker thread of the queue, and a callback is then called to report its completion. A
+ *  single thread may thus keep as many operations in flight as it wants.
+ *
+ *  The worker thread takes every operation waiting in the queue at once and executes them as a single batch of the
+ *  client (see \e soClientBatch), so that the lock of the client is taken once per batch rather than once per
+ *  operation. The operations are executed in the order they were submitted and so are the callbacks called, from the
+ *  worker thread, with the lock of the client released: a callback may thus submit further operations, or use the
+ *  client directly.
+ *
+ *  The following operations are defined:
+ *    \li create a queue of a client
+ *    \li submit an operation
+ *    \li wait for the completion of all the operations submitted
+ *    \li destroy a queue.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_CLIENTQUEUE_H_
+#define SOFS_CLIENTQUEUE_H_
+
+#include "sofs_client.h"
+
+/** \brief queue of a client (its contents are private) */
+typedef struct soClientQueue SOClientQueue;
+
+/**
+ *  \brief Callback reporting the completion of an operation.
+ *
+ *  \param p_op pointer to the operation, its field <em>stat</em> holding the status
+ *  \param arg argument given upon submission
+ */
+
+typedef void (*SOClientCallback) (SOClientOp *p_op, void *arg);
+
+/**
+ *  \brief Create a queue of a client.
+ *
+ *  The worker thread of the queue is started.
+ *
+ *  \param p_cl pointer to the client
+ *  \param pp_q pointer to a location where the pointer to the queue is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c EAGAIN, if the worker thread can not be started
+ */
+
+extern int soNewClientQueue (SOClient *p_cl, SOClientQueue **pp_q);
+
+/**
+ *  \brief Submit an operation.
+ *
+ *  The operation and the buffers it points to must be kept until the callback is called.
+ *
+ *  \param p_q pointer to the queue
+ *  \param p_op pointer to the operation
+ *  \param cb callback to be called upon completion (\c NULL, if none)
+ *  \param arg argument to be passed to the callback
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ *  \return -\c ESHUTDOWN, if the queue is being destroyed
+ */
+
+extern int soClientSubmit (SOClientQueue *p_q, SOClientOp *p_op, SOClientCallback cb, void *arg);
+
+/**
+ *  \brief Wait for the completion of all the operations submitted.
+ *
+ *  The operations submitted by the callbacks meanwhile are waited for too.
+ *
+ *  \param p_q pointer to the queue
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EDEADLK, if it is called from a callback
+ */
+
+extern int soClientDrain (SOClientQueue *p_q);
+
+/**
+ *  \brief Destroy a queue.
+ *
+ *  The operations submitted are waited for and the worker thread is stopped. The client is left mounted.
+ *
+ *  \param p_q pointer to the queue
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EDEADLK, if it is called from a callback
+ */
+
+extern int soFreeClientQueue (SOClientQueue *p_q);
+
+#endif /* SOFS_CLIENTQUEUE_H_ */
@@ -0,0 +1,997 @@
+/**
+ *  \file export_sofs14.c (implementation file)
+ *
+ *  \brief The SOFS14 export tool.
+ *
+ *  It copies the contents of a SOFS14 file system, without mounting it, either into a directory of the host file
+ *  system or as a tar stream (POSIX ustar format).
+ *
+ *  The directory tree is not walked: the storage device is read in physical order, with large sequential reads, so
+ *  that the export runs at sequential device speed. The table of inodes is read first, then the data clusters of
+ *  references, the data clusters of the directories and, at last, the data clusters of the regular files and the
+ *  symbolic links, each group in ascending order of their physical numbers. A window of successive data clusters is
+ *  read at a time, the data clusters in between which are not needed being read through.
+ *
+ *  When a directory of the host file system is written, every data cluster is written to its file as soon as it is
+ *  read. A tar stream, however, holds the files one after the other. The files are placed in the stream in the order
+ *  of their first data cluster and the data clusters of a file which are read before they can be written (those of a
+ *  file which comes later in the stream, or which are out of order within the file itself) are kept in a reordering
+ *  buffer. If the buffer is full, they are dropped and read again, directly, when they are needed.
+ *
+ *  Regular files, directories and symbolic links are exported, keeping their names, permissions, ownership and times
+ *  of last modification; extended attributes are not. Files with several hard links are exported as hard links.
+ *
+ *  SINOPSIS:
+ *  <P><PRE>                export_sofs14 [OPTIONS] [meta-file+]supp-file[,supp-file...]
+ *
+ *                OPTIONS:
+ *                 -o dir  --- export into a directory of the host file system, which must exist
+ *                 -t file --- write a tar stream into a file (default: write a tar stream into the standard output)
+ *                 -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)
+ *                 -m num  --- set the size of the reordering buffer in data clusters (default: 4096)
+ *                 -q      --- set quiet mode (default: not quiet)
+ *                 -h      --- print this help.</PRE>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_datacluster.h"
+#include "sofs_direntry.h"
+#include "sofs_refscan.h"
+
+/** \brief maximum number of data clusters read at a time */
+#define READ_CLUSTERS  256
+
+/** \brief size of a block of a tar stream */
+#define TAR_BLOCK      512
+
+/**
+ *  \brief Definition of a request: a data cluster to be read on behalf of a file.
+ */
+
+typedef struct soExportReq
+{
+   /** \brief logical number of the data cluster */
+    uint32_t clust;
+   /** \brief number of the inode of the file */
+    uint32_t nInode;
+   /** \brief index of the data cluster in the file (or of the group of references it holds) */
+    uint32_t ind;
+} SOExportReq;
+
+/**
+ *  \brief Definition of the state of a file being exported.
+ */
+
+typedef struct soExportFile
+{
+   /** \brief number of data clusters of the information content, holes included */
+    uint32_t nClust;
+   /** \brief logical numbers of the data clusters of the information content (NULL_CLUSTER, for holes) */
+    uint32_t *map;
+   /** \brief directory entries, if the file is a directory */
+    SODirEntry *de;
+   /** \brief path to the file, relative to the root directory (\c NULL, if it is not reachable) */
+    char *path;
+} SOExportFile;
+
+/**
+ *  \brief Definition of a hard link: a directory entry of a file which has already been reached.
+ */
+
+typedef struct soExportLink
+{
+   /** \brief number of the inode of the file */
+    uint32_t nInode;
+   /** \brief path to the directory entry, relative to the root directory */
+    char *path;
+} SOExportLink;
+
+/**
+ *  \brief Definition of a sweep: the data clusters of a group of requests, read in ascending order.
+ */
+
+typedef struct soSweep
+{
+   /** \brief logical numbers of the data clusters to be read, in ascending order and without repetitions */
+    uint32_t *clust;
+   /** \brief number of data clusters to be read */
+    uint32_t n;
+   /** \brief read state of each data cluster: \c true, if it has already been either handed out or dropped */
+    bool *done;
+   /** \brief index of the first data cluster in the window */
+    uint32_t lo;
+   /** \brief index of the data cluster which follows the last one in the window */
+    uint32_t hi;
+   /** \brief contents of the window, starting at data cluster clust[lo] */
+    unsigned char *win;
+   /** \brief number of slots of the reordering buffer */
+    uint32_t nSlot;
+   /** \brief contents of the slots of the reordering buffer */
+    unsigned char *slot;
+   /** \brief logical number of the data cluster kept in each slot */
+    uint32_t *key;
+   /** \brief next slot in the same hash chain, or in the list of free slots (-1, if none) */
+    int32_t *next;
+   /** \brief first slot of each hash chain (-1, if none) */
+    int32_t *head;
+   /** \brief number of hash chains (a power of two) */
+    uint32_t nHash;
+   /** \brief first free slot (-1, if none) */
+    int32_t free;
+   /** \brief number of data clusters read directly, out of order */
+    uint64_t nDirect;
+} SOSweep;
+
+/*
+ *  State of the export
+ */
+
+static SOSuperBlock sb;                          /* superblock */
+static SOInode *itable = NULL;                   /* table of inodes */
+static SOExportFile *file = NULL;                /* files being exported, indexed by inode number */
+static uint32_t *order = NULL;                   /* inodes reachable from the root directory, breadth first */
+static uint32_t nOrder = 0;                      /* number of inodes reachable from the root directory */
+static SOExportLink *link_ = NULL;               /* hard links */
+static uint32_t nLink = 0;                       /* number of hard links */
+static uint64_t nDirect = 0;                     /* number of data clusters read out of order */
+static uint32_t *first = NULL;                   /* logical number of the first data cluster of each file */
+
+/*
+ *  Allusion to internal functions
+ */
+
+static int loadInodes (void);
+static int loadRefs (void);
+static int loadDirs (void);
+static int exportDir (const char *dir);
+static int exportTar (FILE *out, uint32_t nSlot);
+static int tarHeader (FILE *out, const char *path, uint32_t nInode, char type, uint64_t size, const char *linkname);
+static int tarWrite (FILE *out, const void *buf, size_t n);
+static int newSweep (SOSweep *s, const SOExportReq *req, uint32_t n, uint32_t nSlot);
+static int getCluster (SOSweep *s, uint32_t clust, SODataClust *p_dc);
+static void freeSweep (SOSweep *s);
+static int cmpReq (const void *a, const void *b);
+static int cmpClust (const void *a, const void *b);
+static int cmpFirst (const void *a, const void *b);
+static bool inUse (uint32_t nInode);
+static void freeAll (void);
+static void printUsage (char *cmd_name);
+
+/* The main function */
+
+int main (int argc, char *argv[])
+{
+  char *dir = NULL;                              /* host directory the file system is exported into */
+  char *tar = NULL;                              /* file the tar stream is written into */
+  uint32_t nSlot = 4096;                         /* size of the reordering buffer */
+  int quiet = 0;                                 /* quiet mode, if kept set not quiet mode */
+
+  /* process command line options */
+
+  int opt;                                       /* selected option */
+
+  do
+  { switch ((opt = getopt (argc, argv, "o:t:s:m:qh")))
+    { case 'o': /* host directory */
+                dir = optarg;
+                break;
+      case 't': /* tar file */
+                tar = optarg;
+                break;
+      case 's': /* stripe unit */
+                if ((atoi (optarg) <= 0) || (soSetStripeUnit ((uint32_t) atoi (optarg)) != 0))
+                   { fprintf (stderr, "%s: Invalid stripe unit.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
+      case 'm': /* size of the reordering buffer */
+                if (atoi (optarg) < 0)
+                   { fprintf (stderr, "%s: Invalid size of the reordering buffer.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                nSlot = (uint32_t) atoi (optarg);
+                break;
+      case 'q': /* quiet mode */
+                quiet = 1;                       /* set quiet mode for processing: no messages are issued */
+                break;
+      case 'h': /* help mode */
+                printUsage (basename (argv[0]));
+                return EXIT_SUCCESS;
+      case -1:  break;
+      default:  fprintf (stderr, "%s: Wrong option.\n", basename (argv[0]));
+                printUsage (basename (argv[0]));
+                return EXIT_FAILURE;
+    }
+  } while (opt != -1);
+  if ((argc - optind) != 1)                      /* check existence of mandatory argument: storage device name */
+     { fprintf (stderr, "%s: Wrong number of mandatory arguments.\n", basename (argv[0]));
+       printUsage (basename (argv[0]));
+       return EXIT_FAILURE;
+     }
+  if ((dir != NULL) && (tar != NULL))
+     { fprintf (stderr, "%s: A host directory and a tar file can not be both given.\n", basename (argv[0]));
+       printUsage (basename (argv[0]));
+       return EXIT_FAILURE;
+     }
+
+  /* the messages go to the standard error, if the tar stream goes to the standard output */
+
+  FILE *msg = ((dir == NULL) && (tar == NULL)) ? stderr : stdout;
+  FILE *out = stdout;                            /* tar stream */
+  int status;                                    /* status of operation */
+  uint32_t dummy;                                /* dummy variable */
+
+  /* open a direct communication channel with the storage device */
+
+  if ((status = soOpenDevice (argv[optind], &dummy)) != 0)
+     { fprintf (stderr, "%s: Opening the storage device - %s.\n", basename (argv[0]), strerror (-status));
+       return EXIT_FAILURE;
+     }
+
+  /* read the metadata: the table of inodes, the data clusters of references and the directories */
+
+  if ((status = loadInodes ()) != 0)
+     fprintf (stderr, "%s: Reading the table of inodes - %s.\n", basename (argv[0]),
+              (status == -ELIBBAD) ? "Invalid file system" : strerror (-status));
+     else { if (!quiet && (sb.mStat != PRU))
+               fprintf (msg, "%s: The file system was not properly unmounted.\n", basename (argv[0]));
+            if ((status = loadRefs ()) != 0)
+               fprintf (stderr, "%s: Reading the data clusters of references - %s.\n", basename (argv[0]),
+                        (status == -ELIBBAD) ? "Inconsistent file system" : strerror (-status));
+               else if ((status = loadDirs ()) != 0)
+                       fprintf (stderr, "%s: Reading the directories - %s.\n", basename (argv[0]),
+                                (status == -ELIBBAD) ? "Inconsistent file system" : strerror (-status));
+          }
+
+  /* export the files */
+
+  if ((status == 0) && (tar != NULL) && ((out = fopen (tar, "w")) == NULL))
+     { status = -errno;
+       fprintf (stderr, "%s: Opening %s - %s.\n", basename (argv[0]), tar, strerror (errno));
+     }
+  if ((status == 0) && (dir != NULL) && ((status = exportDir (dir)) != 0))
+     fprintf (stderr, "%s: Exporting into %s - %s.\n", basename (argv[0]), dir, strerror (-status));
+  if ((status == 0) && (dir == NULL))
+     { if ((status = exportTar (out, nSlot)) != 0)
+          fprintf (stderr, "%s: Writing the tar stream - %s.\n", basename (argv[0]), strerror (-status));
+       if ((tar != NULL) && (fclose (out) != 0) && (status == 0))
+          { status = -errno;
+            fprintf (stderr, "%s: Writing the tar stream - %s.\n", basename (argv[0]), strerror (errno));
+          }
+     }
+
+  /* close the communication channel with the storage device */
+
+  int stat;
+
+  if ((stat = soCloseDevice ()) != 0)
+     { fprintf (stderr, "%s: Closing the storage device - %s.\n", basename (argv[0]), strerror (-stat));
+       status = stat;
+     }
+  if (status != 0)
+     { freeAll ();
+       return EXIT_FAILURE;
+     }
+
+  if (!quiet)
+     { uint32_t nDirs = 0, nFiles = 0, nLinks = 0;
+       uint32_t i;
+
+       for (i = 1; i < nOrder; i++)
+         if (itable[order[i]].mode & INODE_DIR)
+            nDirs += 1;
+            else if (itable[order[i]].mode & INODE_FILE)
+                    nFiles += 1;
+                    else nLinks += 1;
+       fprintf (msg, "Exported %"PRIu32" directories, %"PRIu32" files, %"PRIu32" symbolic links and %"PRIu32
+                " hard links (%"PRIu64" data clusters read out of order).\n", nDirs, nFiles, nLinks, nLink, nDirect);
+     }
+  freeAll ();
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * read the superblock and the table of inodes
+ */
+
+static int loadInodes (void)
+{
+  uint32_t n, cnt;
+  int stat;
+
+  if ((stat = soReadRawBlock (0, &sb)) != 0) return stat;
+  if ((sb.magic != MAGIC_NUMBER) || (sb.version != VERSION_NUMBER) || (sb.iTotal != sb.iTableSize * IPB))
+     return -ELIBBAD;
+
+  if ((itable = malloc ((size_t) sb.iTableSize * BLOCK_SIZE)) == NULL) return -ENOMEM;
+  if ((file = calloc (sb.iTotal, sizeof (SOExportFile))) == NULL) return -ENOMEM;
+  for (n = 0; n < sb.iTableSize; n += cnt)
+  { cnt = sb.iTableSize - n;
+    if (cnt > READ_CLUSTERS * BLOCKS_PER_CLUSTER) cnt = READ_CLUSTERS * BLOCKS_PER_CLUSTER;
+    if ((stat = soReadRawBlocks (sb.iTableStart + n, cnt, (unsigned char *) itable + (size_t) n * BLOCK_SIZE)) != 0)
+       return stat;
+  }
+  if (!inUse (0) || !(itable[0].mode & INODE_DIR)) return -ELIBBAD;
+
+  return 0;
+}
+
+/*
+ * build the map of the data clusters of every file in use: the data clusters of references are read in ascending
+ * order, those referred by the inodes first and those referred by the data clusters of double indirect references last
+ */
+
+static int loadRefs (void)
+{
+  SOExportReq *req, *tmp;
+  SOSweep s;
+  SODataClust dc;
+  uint32_t n, nReq, size, nLines, i, j, k;
+  int stat;
+
+  for (n = 0; n < sb.iTotal; n++)
+    if (inUse (n))
+       { if (itable[n].mode & INODE_DIR)
+            file[n].nClust = itable[n].size / sizeof (dc.info.de);
+            else file[n].nClust = (itable[n].size + BSLPC - 1) / BSLPC;
+         if (file[n].nClust > MAX_FILE_CLUSTERS) return -ELIBBAD;
+         if ((file[n].map = malloc ((file[n].nClust + 1) * sizeof (uint32_t))) == NULL) return -ENOMEM;
+         for (i = 0; i < file[n].nClust; i++)
+           file[n].map[i] = (i < N_DIRECT) ? itable[n].d[i] : NULL_CLUSTER;
+       }
+
+  /* single indirect references and the data clusters of double indirect references */
+
+  if ((req = malloc (2 * sb.iTotal * sizeof (SOExportReq))) == NULL) return -ENOMEM;
+  nReq = 0;
+  for (n = 0; n < sb.iTotal; n++)
+    if (inUse (n))
+       { if ((file[n].nClust > N_DIRECT) && (itable[n].i1 != NULL_CLUSTER))
+            req[nReq++] = (SOExportReq) { .clust = itable[n].i1, .nInode = n, .ind = 0 };
+         if ((file[n].nClust > N_DIRECT + RPC) && (itable[n].i2 != NULL_CLUSTER))
+            req[nReq++] = (SOExportReq) { .clust = itable[n].i2, .nInode = n, .ind = 1 };
+       }
+  if ((stat = newSweep (&s, req, nReq, 0)) != 0)
+     { free (req);
+       return stat;
+     }
+  qsort (req, nReq, sizeof (SOExportReq), cmpReq);
+  size = nReq;
+  for (k = 0, j = nReq, stat = 0; (stat == 0) && (k < j); k++)
+  { SOExportFile *p_f = &file[req[k].nInode];
+
+    if ((stat = getCluster (&s, req[k].clust, &dc)) != 0) break;
+    if (req[k].ind == 0)
+       { for (i = 0; (i < RPC) && (N_DIRECT + i < p_f->nClust); i++)
+           p_f->map[N_DIRECT+i] = dc.info.ref[i];
+         continue;
+       }
+    nLines = (p_f->nClust - N_DIRECT - RPC + RPC - 1) / RPC;
+    if (nLines > RPC) nLines = RPC;
+    for (i = soFindNextRef (dc.info.ref, 0, nLines); i < nLines; i = soFindNextRef (dc.info.ref, i + 1, nLines))
+    { if (nReq == size)
+         { if ((tmp = realloc (req, 2 * size * sizeof (SOExportReq))) == NULL)
+              { stat = -ENOMEM;
+                break;
+              }
+           req = tmp;
+           size *= 2;
+         }
+      req[nReq++] = (SOExportReq) { .clust = dc.info.ref[i], .nInode = req[k].nInode, .ind = i };
+    }
+  }
+  freeSweep (&s);
+
+  /* direct references held by the data clusters of double indirect references */
+
+  if ((stat == 0) && ((stat = newSweep (&s, req + j, nReq - j, 0)) == 0))
+     { qsort (req + j, nReq - j, sizeof (SOExportReq), cmpReq);
+       for (k = j; (stat == 0) && (k < nReq); k++)
+       { SOExportFile *p_f = &file[req[k].nInode];
+         uint32_t base = N_DIRECT + RPC + req[k].ind * RPC;
+
+         if ((stat = getCluster (&s, req[k].clust, &dc)) != 0) break;
+         for (i = 0; (i < RPC) && (base + i < p_f->nClust); i++)
+           p_f->map[base+i] = dc.info.ref[i];
+       }
+       freeSweep (&s);
+     }
+  free (req);
+  if (stat != 0) return stat;
+
+  for (n = 0; n < sb.iTotal; n++)
+  { if (inUse (n) && (itable[n].mode & INODE_SYMLINK) && ((file[n].nClust != 1) || (file[n].map[0] == NULL_CLUSTER)))
+       return -ELIBBAD;                          /* the path a symbolic link points to lies in a single data cluster */
+    for (i = 0; i < file[n].nClust; i++)
+      if ((file[n].map[i] != NULL_CLUSTER) && (file[n].map[i] >= sb.dZoneTotal)) return -ELIBBAD;
+  }
+
+  return 0;
+}
+
+/*
+ * read the data clusters of the directories, in ascending order, and find the path to every file reachable from the
+ * root directory, breadth first
+ */
+
+static int loadDirs (void)
+{
+  SOExportReq *req;
+  SOSweep s;
+  SODataClust dc;
+  uint32_t n, nReq, head, i, k;
+  int stat;
+
+  for (n = 0, nReq = 0; n < sb.iTotal; n++)
+    if (inUse (n) && (itable[n].mode & INODE_DIR))
+       { if ((file[n].de = calloc ((size_t) file[n].nClust * DPC, sizeof (SODirEntry))) == NULL) return -ENOMEM;
+         nReq += file[n].nClust;
+       }
+  if ((req = malloc ((nReq + 1) * sizeof (SOExportReq))) == NULL) return -ENOMEM;
+  for (n = 0, nReq = 0; n < sb.iTotal; n++)
+    if (file[n].de != NULL)
+       for (i = 0; i < file[n].nClust; i++)
+         if (file[n].map[i] != NULL_CLUSTER)
+            req[nReq++] = (SOExportReq) { .clust = file[n].map[i], .nInode = n, .ind = i };
+  if ((stat = newSweep (&s, req, nReq, 0)) != 0)
+     { free (req);
+       return stat;
+     }
+  qsort (req, nReq, sizeof (SOExportReq), cmpReq);
+  for (k = 0; (stat == 0) && (k < nReq); k++)
+    if ((stat = getCluster (&s, req[k].clust, &dc)) == 0)
+       memcpy (file[req[k].nInode].de + req[k].ind * DPC, dc.info.de, sizeof (dc.info.de));
+  freeSweep (&s);
+  free (req);
+  if (stat != 0) return stat;
+
+  if (((order = malloc (sb.iTotal * sizeof (uint32_t))) == NULL) ||
+      ((link_ = malloc (sb.iTotal * sizeof (SOExportLink))) == NULL) || ((file[0].path = strdup ("")) == NULL))
+     return -ENOMEM;
+  order[nOrder++] = 0;
+  for (head = 0; head < nOrder; head++)
+  { SOExportFile *p_d = &file[order[head]];
+
+    if (p_d->de == NULL) continue;
+    for (i = 0; i < p_d->nClust * DPC; i++)
+    { char name[MAX_NAME+1];
+      char *path;
+      uint32_t c = p_d->de[i].nInode;
+
+      if (p_d->de[i].name[0] == '\0') continue;  /* free entry */
+      memcpy (name, p_d->de[i].name, MAX_NAME);
+      name[MAX_NAME] = '\0';
+      if ((strcmp (name, ".") == 0) || (strcmp (name, "..") == 0)) continue;
+      if ((c >= sb.iTotal) || !inUse (c)) return -ELIBBAD;
+      if ((file[c].path != NULL) && (itable[c].mode & INODE_DIR)) continue;
+      if ((path = malloc (strlen (p_d->path) + strlen (name) + 2)) == NULL) return -ENOMEM;
+      if (p_d->path[0] == '\0')
+         strcpy (path, name);
+         else sprintf (path, "%s/%s", p_d->path, name);
+      if (file[c].path == NULL)
+         { file[c].path = path;
+           order[nOrder++] = c;
+         }
+         else { if (nLink == sb.iTotal)
+                   { free (path);
+                     return -ELIBBAD;
+                   }
+                link_[nLink++] = (SOExportLink) { .nInode = c, .path = path };
+              }
+    }
+    free (p_d->de);
+    p_d->de = NULL;
+  }
+
+  return 0;
+}
+
+/*
+ * export the files into a directory of the host file system
+ *   the directories are created writable and the regular files are created empty, with their final size; the data
+ *   clusters are then written as they are read; the attributes are set last, children before parents
+ */
+
+static int exportDir (const char *dir)
+{
+  SOExportReq *req;
+  SOSweep s;
+  SODataClust dc;
+  char hPath[PATH_MAX], hLink[PATH_MAX];
+  uint32_t n, nReq, i, k, cur = NULL_INODE;
+  int fd = -1, stat = 0;
+
+  for (i = 1, nReq = 0; i < nOrder; i++)
+  { n = order[i];
+    if ((size_t) snprintf (hPath, PATH_MAX, "%s/%s", dir, file[n].path) >= PATH_MAX) return -ENAMETOOLONG;
+    if (itable[n].mode & INODE_DIR)
+       { if (mkdir (hPath, S_IRWXU) != 0) return -errno;
+         continue;
+       }
+    nReq += file[n].nClust;
+    if (itable[n].mode & INODE_FILE)
+       { if ((fd = open (hPath, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) < 0) return -errno;
+         if (ftruncate (fd, itable[n].size) != 0)
+            { stat = -errno;
+              close (fd);
+              return stat;
+            }
+         if (close (fd) != 0) return -errno;
+         fd = -1;
+       }
+  }
+
+  /* the data clusters of the regular files and the symbolic links */
+
+  if ((req = malloc ((nReq + 1) * sizeof (SOExportReq))) == NULL) return -ENOMEM;
+  for (i = 1, nReq = 0; i < nOrder; i++)
+    if (!(itable[order[i]].mode & INODE_DIR))
+       for (k = 0; k < file[order[i]].nClust; k++)
+         if (file[order[i]].map[k] != NULL_CLUSTER)
+            req[nReq++] = (SOExportReq) { .clust = file[order[i]].map[k], .nInode = order[i], .ind = k };
+  if ((stat = newSweep (&s, req, nReq, 0)) != 0)
+     { free (req);
+       return stat;
+     }
+  qsort (req, nReq, sizeof (SOExportReq), cmpReq);
+  for (k = 0; (stat == 0) && (k < nReq); k++)
+  { uint32_t len;                                /* number of bytes of the data cluster in use */
+
+    n = req[k].nInode;
+    if ((stat = getCluster (&s, req[k].clust, &dc)) != 0) break;
+    len = itable[n].size - req[k].ind * BSLPC;
+    if (len > BSLPC) len = BSLPC;
+    snprintf (hPath, PATH_MAX, "%s/%s", dir, file[n].path);
+    if (itable[n].mode & INODE_SYMLINK)
+       { char target[BSLPC+1];
+
+         memcpy (target, dc.info.data, len);
+         target[len] = '\0';
+         if (symlink (target, hPath) != 0) stat = -errno;
+         continue;
+       }
+    if (n != cur)
+       { if ((fd != -1) && (close (fd) != 0))
+            { fd = -1;
+              stat = -errno;
+              break;
+            }
+         if ((fd = open (hPath, O_WRONLY)) < 0)
+            { stat = -errno;
+              break;
+            }
+         cur = n;
+       }
+    if (pwrite (fd, dc.info.data, len, (off_t) req[k].ind * BSLPC) != (ssize_t) len)
+       stat = (errno != 0) ? -errno : -EIO;
+  }
+  if ((fd != -1) && (close (fd) != 0) && (stat == 0)) stat = -errno;
+  nDirect += s.nDirect;
+  freeSweep (&s);
+  free (req);
+  if (stat != 0) return stat;
+
+  /* hard links and attributes */
+
+  for (i = 0; i < nLink; i++)
+  { snprintf (hPath, PATH_MAX, "%s/%s", dir, file[link_[i].nInode].path);
+    if ((size_t) snprintf (hLink, PATH_MAX, "%s/%s", dir, link_[i].path) >= PATH_MAX) return -ENAMETOOLONG;
+    if (link (hPath, hLink) != 0) return -errno;
+  }
+  for (i = nOrder - 1; i > 0; i--)
+  { struct timespec t[2];
+
+    n = order[i];
+    snprintf (hPath, PATH_MAX, "%s/%s", dir, file[n].path);
+    if ((geteuid () == 0) && (lchown (hPath, itable[n].owner, itable[n].group) != 0)) return -errno;
+    if (!(itable[n].mode & INODE_SYMLINK) && (chmod (hPath, itable[n].mode & (S_IRWXU | S_IRWXG | S_IRWXO)) != 0))
+       return -errno;
+    t[0] = (struct timespec) { .tv_sec = itable[n].vD1.aTime, .tv_nsec = 0 };
+    t[1] = (struct timespec) { .tv_sec = itable[n].vD2.mTime, .tv_nsec = 0 };
+    if (utimensat (AT_FDCWD, hPath, t, AT_SYMLINK_NOFOLLOW) != 0) return -errno;
+  }
+
+  return 0;
+}
+
+/*
+ * write the files as a tar stream
+ *   the directories go first, breadth first, the regular files and the symbolic links follow, in the order of their
+ *   first data cluster, and the hard links go last
+ */
+
+static int exportTar (FILE *out, uint32_t nSlot)
+{
+  SOExportReq *req;
+  SOSweep s;
+  SODataClust dc;
+  uint32_t *list, n, nList, nReq, i, k;
+  int stat = 0;
+
+  setvbuf (out, NULL, _IOFBF, READ_CLUSTERS * BSLPC);
+  for (i = 1; (stat == 0) && (i < nOrder); i++)
+    if (itable[order[i]].mode & INODE_DIR)
+       { char path[strlen (file[order[i]].path) + 2];
+
+         sprintf (path, "%s/", file[order[i]].path);
+         stat = tarHeader (out, path, order[i], '5', 0, NULL);
+       }
+  if (stat != 0) return stat;
+
+  /* the order of the regular files and the symbolic links */
+
+  list = malloc (nOrder * sizeof (uint32_t));
+  first = malloc (sb.iTotal * sizeof (uint32_t));
+  if ((list == NULL) || (first == NULL))
+     { free (list);
+       free (first);
+       return -ENOMEM;
+     }
+  for (i = 1, nList = 0, nReq = 0; i < nOrder; i++)
+    if (!(itable[order[i]].mode & INODE_DIR))
+       { n = order[i];
+         list[nList++] = n;
+         first[n] = NULL_CLUSTER;
+         for (k = 0; k < file[n].nClust; k++)
+           if (file[n].map[k] != NULL_CLUSTER)
+              { if (file[n].map[k] < first[n]) first[n] = file[n].map[k];
+                nReq += 1;
+              }
+       }
+  qsort (list, nList, sizeof (uint32_t), cmpFirst);
+
+  /* their data clusters */
+
+  if ((req = malloc ((nReq + 1) * sizeof (SOExportReq))) == NULL)
+     { free (list);
+       free (first);
+       return -ENOMEM;
+     }
+  for (i = 0, nReq = 0; i < nList; i++)
+    for (k = 0; k < file[list[i]].nClust; k++)
+      if (file[list[i]].map[k] != NULL_CLUSTER)
+         req[nReq++] = (SOExportReq) { .clust = file[list[i]].map[k], .nInode = list[i], .ind = k };
+  stat = newSweep (&s, req, nReq, nSlot);
+  free (req);
+  if (stat != 0)
+     { free (list);
+       free (first);
+       return stat;
+     }
+
+  for (i = 0; (stat == 0) && (i < nList); i++)
+  { n = list[i];
+    if (itable[n].mode & INODE_SYMLINK)
+       { char target[BSLPC+1];
+         uint32_t len = itable[n].size;
+
+         if ((stat = getCluster (&s, file[n].map[0], &dc)) != 0) break;
+         memcpy (target, dc.info.data, len);
+         target[len] = '\0';
+         stat = tarHeader (out, file[n].path, n, '2', 0, target);
+         continue;
+       }
+    if ((stat = tarHeader (out, file[n].path, n, '0', itable[n].size, NULL)) != 0) break;
+    for (k = 0; (stat == 0) && (k < file[n].nClust); k++)
+    { uint32_t len = itable[n].size - k * BSLPC;
+
+      if (len > BSLPC) len = BSLPC;
+      if (file[n].map[k] == NULL_CLUSTER)
+         memset (dc.info.data, 0, BSLPC);      /* hole */
+         else if ((stat = getCluster (&s, file[n].map[k], &dc)) != 0) break;
+      stat = tarWrite (out, dc.info.data, len);
+    }
+    if ((stat == 0) && ((itable[n].size % TAR_BLOCK) != 0))
+       { unsigned char pad[TAR_BLOCK] = { 0 };
+
+         stat = tarWrite (out, pad, TAR_BLOCK - itable[n].size % TAR_BLOCK);
+       }
+  }
+  nDirect += s.nDirect;
+  freeSweep (&s);
+  free (list);
+  free (first);
+  first = NULL;
+
+  /* the hard links and the end of the archive */
+
+  for (i = 0; (stat == 0) && (i < nLink); i++)
+    stat = tarHeader (out, link_[i].path, link_[i].nInode, '1', 0, file[link_[i].nInode].path);
+  if (stat == 0)
+     { unsigned char end[2*TAR_BLOCK] = { 0 };
+
+       stat = tarWrite (out, end, 2 * TAR_BLOCK);
+     }
+  if ((stat == 0) && (fflush (out) != 0)) stat = -errno;
+
+  return stat;
+}
+
+/*
+ * write the header of an entry of a tar stream
+ *   a path longer than the name field is split into a prefix and a name; a link name longer than its field is written
+ *   into a preceding extended header
+ */
+
+static int tarHeader (FILE *out, const char *path, uint32_t nInode, char type, uint64_t size, const char *linkname)
+{
+  unsigned char h[TAR_BLOCK];
+  size_t len = strlen (path), split = 0;
+  uint32_t sum = 0, i;
+  int stat;
+
+  if ((linkname != NULL) && (strlen (linkname) > 100))
+     { char rec[TAR_BLOCK];
+       size_t rlen = strlen (" linkpath=\n") + strlen (linkname), n = rlen;
+
+       while (n != rlen + (size_t) snprintf (NULL, 0, "%zu", n))
+         n = rlen + (size_t) snprintf (NULL, 0, "%zu", n);
+       snprintf (rec, TAR_BLOCK, "%zu linkpath=%s\n", n, linkname);
+       memset (rec + n, 0, TAR_BLOCK - n);
+       if (((stat = tarHeader (out, "PaxHeader", nInode, 'x', n, NULL)) != 0) ||
+           ((stat = tarWrite (out, rec, TAR_BLOCK)) != 0))
+          return stat;
+     }
+
+  if (len > 100)
+     { for (split = 1; split < len; split++)
+         if ((path[split] == '/') && (len - split - 1 <= 100)) break;
+       if ((split >= len) || (split > 155)) return -ENAMETOOLONG;
+     }
+
+  memset (h, 0, TAR_BLOCK);
+  if (split == 0)
+     memcpy (h, path, len);                                    /* name */
+     else { memcpy (h, path + split + 1, len - split - 1);
+            memcpy (h + 345, path, split);                     /* prefix */
+          }
+  snprintf ((char *) h + 100, 8, "%07o", itable[nInode].mode & (S_IRWXU | S_IRWXG | S_IRWXO));
+  snprintf ((char *) h + 108, 8, "%07"PRIo32, itable[nInode].owner);
+  snprintf ((char *) h + 116, 8, "%07"PRIo32, itable[nInode].group);
+  snprintf ((char *) h + 124, 12, "%011"PRIo64, size);
+  snprintf ((char *) h + 136, 12, "%011"PRIo32, itable[nInode].vD2.mTime);
+  memset (h + 148, ' ', 8);                                    /* checksum */
+  h[156] = (unsigned char) type;
+  if (linkname != NULL)
+     strncpy ((char *) h + 157, linkname, 100);
+  memcpy (h + 257, "ustar", 6);                                /* magic */
+  memcpy (h + 263, "00", 2);                                   /* version */
+  for (i = 0; i < TAR_BLOCK; i++)
+    sum += h[i];
+  snprintf ((char *) h + 148, 8, "%06"PRIo32, sum);
+
+  return tarWrite (out, h, TAR_BLOCK);
+}
+
+/*
+ * write into a tar stream
+ */
+
+static int tarWrite (FILE *out, const void *buf, size_t n)
+{
+  if (fwrite (buf, 1, n, out) != n) return (errno != 0) ? -errno : -EIO;
+
+  return 0;
+}
+
+/*
+ * start a sweep over the data clusters of a group of requests, with a reordering buffer of nSlot data clusters
+ */
+
+static int newSweep (SOSweep *s, const SOExportReq *req, uint32_t n, uint32_t nSlot)
+{
+  uint32_t i, k;
+
+  memset (s, 0, sizeof (SOSweep));
+  s->free = -1;
+  if (((s->clust = malloc ((n + 1) * sizeof (uint32_t))) == NULL) ||
+      ((s->done = calloc (n + 1, sizeof (bool))) == NULL) ||
+      ((s->win = malloc ((size_t) READ_CLUSTERS * CLUSTER_SIZE)) == NULL))
+     { freeSweep (s);
+       return -ENOMEM;
+     }
+  for (i = 0; i < n; i++)
+    s->clust[i] = req[i].clust;
+  qsort (s->clust, n, sizeof (uint32_t), cmpClust);
+  for (i = 0, k = 0; i < n; i++)
+    if ((k == 0) || (s->clust[i] != s->clust[k-1]))
+       s->clust[k++] = s->clust[i];
+  s->n = k;
+
+  if (nSlot != 0)
+     { for (s->nHash = 1; s->nHash < nSlot; s->nHash *= 2)
+         ;
+       if (((s->slot = malloc ((size_t) nSlot * CLUSTER_SIZE)) == NULL) ||
+           ((s->key = malloc (nSlot * sizeof (uint32_t))) == NULL) ||
+           ((s->next = malloc (nSlot * sizeof (int32_t))) == NULL) ||
+           ((s->head = malloc (s->nHash * sizeof (int32_t))) == NULL))
+          { freeSweep (s);
+            return -ENOMEM;
+          }
+       s->nSlot = nSlot;
+       for (i = 0; i < s->nHash; i++)
+         s->head[i] = -1;
+       for (i = 0; i < nSlot; i++)
+         s->next[i] = (i + 1 < nSlot) ? (int32_t) (i + 1) : -1;
+       s->free = 0;
+     }
+
+  return 0;
+}
+
+/*
+ * get the contents of a data cluster
+ *   if it is ahead of the window, the window is moved on, the data clusters it held which were not handed out being
+ *   kept in the reordering buffer, if there is room for them, or dropped; if it is behind the window, it is taken from
+ *   the reordering buffer or, if it was dropped, read directly
+ */
+
+static int getCluster (SOSweep *s, uint32_t clust, SODataClust *p_dc)
+{
+  uint32_t lo = 0, hi = s->n, mid, k, last;
+  int32_t j, *p_j;
+  int stat;
+
+  while (lo < hi)                                /* find the data cluster */
+  { mid = (lo + hi) / 2;
+    if (s->clust[mid] < clust)
+       lo = mid + 1;
+       else hi = mid;
+  }
+  if ((lo < s->n) && (s->clust[lo] == clust) && !s->done[lo])
+     { while (lo >= s->hi)                       /* move the window on */
+       { for (k = s->lo; k < s->hi; k++)
+           if (!s->done[k])
+              { if (s->free != -1)
+                   { j = s->free;
+                     s->free = s->next[j];
+                     s->key[j] = s->clust[k];
+                     memcpy (s->slot + (size_t) j * CLUSTER_SIZE,
+                             s->win + (size_t) (s->clust[k] - s->clust[s->lo]) * CLUSTER_SIZE, CLUSTER_SIZE);
+                     s->next[j] = s->head[s->clust[k] & (s->nHash - 1)];
+                     s->head[s->clust[k] & (s->nHash - 1)] = j;
+                   }
+                s->done[k] = true;
+              }
+         s->lo = s->hi;
+         for (s->hi = s->lo; (s->hi < s->n) && (s->clust[s->hi] - s->clust[s->lo] < READ_CLUSTERS); s->hi++)
+           ;
+         last = s->clust[s->hi-1];
+         if ((stat = soReadRawBlocks (sb.dZoneStart + s->clust[s->lo] * BLOCKS_PER_CLUSTER,
+                                      (last - s->clust[s->lo] + 1) * BLOCKS_PER_CLUSTER, s->win)) != 0)
+            return stat;
+       }
+       memcpy (p_dc, s->win + (size_t) (clust - s->clust[s->lo]) * CLUSTER_SIZE, CLUSTER_SIZE);
+       s->done[lo] = true;
+       return 0;
+     }
+
+  if (s->nSlot != 0)                             /* look it up in the reordering buffer */
+     for (p_j = &s->head[clust & (s->nHash - 1)]; *p_j != -1; p_j = &s->next[*p_j])
+       if (s->key[*p_j] == clust)
+          { j = *p_j;
+            memcpy (p_dc, s->slot + (size_t) j * CLUSTER_SIZE, CLUSTER_SIZE);
+            *p_j = s->next[j];
+            s->next[j] = s->free;
+            s->free = j;
+            return 0;
+          }
+
+  s->nDirect += 1;                               /* read it directly */
+  return soReadRawCluster (sb.dZoneStart + clust * BLOCKS_PER_CLUSTER, p_dc);
+}
+
+/*
+ * end a sweep
+ */
+
+static void freeSweep (SOSweep *s)
+{
+  free (s->clust);
+  free (s->done);
+  free (s->win);
+  free (s->slot);
+  free (s->key);
+  free (s->next);
+  free (s->head);
+  memset (s, 0, sizeof (SOSweep));
+}
+
+/*
+ * order of the requests: ascending logical number of the data cluster
+ */
+
+static int cmpReq (const void *a, const void *b)
+{
+  uint32_t ca = ((const SOExportReq *) a)->clust, cb = ((const SOExportReq *) b)->clust;
+
+  return (ca < cb) ? -1 : (ca > cb);
+}
+
+/*
+ * order of the data clusters: ascending logical number
+ */
+
+static int cmpClust (const void *a, const void *b)
+{
+  uint32_t ca = *(const uint32_t *) a, cb = *(const uint32_t *) b;
+
+  return (ca < cb) ? -1 : (ca > cb);
+}
+
+/*
+ * order of the files in a tar stream: ascending logical number of their first data cluster
+ */
+
+static int cmpFirst (const void *a, const void *b)
+{
+  uint32_t fa = first[*(const uint32_t *) a], fb = first[*(const uint32_t *) b];
+
+  return (fa < fb) ? -1 : (fa > fb);
+}
+
+/*
+ * check whether an inode is in use
+ */
+
+static bool inUse (uint32_t nInode)
+{
+  return ((itable[nInode].mode & INODE_FREE) == 0) && ((itable[nInode].mode & INODE_TYPE_MASK) != 0);
+}
+
+/*
+ * free the state of the export
+ */
+
+static void freeAll (void)
+{
+  uint32_t n, i;
+
+  if (file != NULL)
+     for (n = 0; n < sb.iTotal; n++)
+     { free (file[n].map);
+       free (file[n].de);
+       free (file[n].path);
+     }
+  for (i = 0; i < nLink; i++)
+    free (link_[i].path);
+  free (file);
+  free (itable);
+  free (order);
+  free (link_);
+}
+
+/*
+ * print help message
+ */
+
+static void printUsage (char *cmd_name)
+{
+  printf ("Sinopsis: %s [OPTIONS] [meta-file+]supp-file[,supp-file...]\n"
+          "  OPTIONS:\n"
+          "  -o dir  --- export into a directory of the host file system, which must exist\n"
+          "  -t file --- write a tar stream into a file (default: write a tar stream into the standard output)\n"
+          "  -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)\n"
+          "  -m num  --- set the size of the reordering buffer in data clusters (default: 4096)\n"
+          "  -q      --- set quiet mode (default: not quiet)\n"
+          "  -h      --- print this help\n", cmd_name);
+}
@@ -0,0 +1,34 @@
+/**
+ *  \file export_sofs14.h (interface file)
+ *
+ *  \brief The SOFS14 export tool.
+ *
+ *  It copies the contents of a SOFS14 file system, without mounting it, either into a directory of the host file
+ *  system or as a tar stream (POSIX ustar format).
+ *
+ *  The directory tree is not walked: the storage device is read in physical order, with large sequential reads, so
+ *  that the export runs at sequential device speed. The table of inodes is read first, then the data clusters of
+ *  references, the data clusters of the directories and, at last, the data clusters of the regular files and the
+ *  symbolic links, each group in ascending order of their physical numbers. A window of successive data clusters is
+ *  read at a time, the data clusters in between which are not needed being read through.
+ *
+ *  When a directory of the host file system is written, every data cluster is written to its file as soon as it is
+ *  read. A tar stream, however, holds the files one after the other. The files are placed in the stream in the order
+ *  of their first data cluster and the data clusters of a file which are read before they can be written (those of a
+ *  file which comes later in the stream, or which are out of order within the file itself) are kept in a reordering
+ *  buffer. If the buffer is full, they are dropped and read again, directly, when they are needed.
+ *
+ *  Regular files, directories and symbolic links are exported, keeping their names, permissions, ownership and times
+ *  of last modification; extended attributes are not. Files with several hard links are exported as hard links.
+ *
+ *  SINOPSIS:
+ *  <P><PRE>                export_sofs14 [OPTIONS] [meta-file+]supp-file[,supp-file...]
+ *
+ *                OPTIONS:
+ *                 -o dir  --- export into a directory of the host file system, which must exist
+ *                 -t file --- write a tar stream into a file (default: write a tar stream into the standard output)
+ *                 -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)
+ *                 -m num  --- set the size of the reordering buffer in data clusters (default: 4096)
+ *                 -q      --- set quiet mode (default: not quiet)
+ *                 -h      --- print this help.</PRE>
+ */
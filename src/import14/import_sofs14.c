@@ -0,0 +1,458 @@
+/**
+ *  \file import_sofs14.c (implementation file)
+ *
+ *  \brief The SOFS14 bulk import tool.
+ *
+ *  It copies a directory tree of the host file system into a SOFS14 file system, without mounting it.
+ *
+ *  The host tree is walked first and the whole import is planned up front: the number of inodes and data clusters it
+ *  requires is checked against the free space of the file system before anything is written. The tree is then
+ *  created in a single pass, directory by directory: each directory is followed by all its regular files and symbolic
+ *  links, with their data, and only then by its subdirectories. Since the free inodes and the free data clusters of a
+ *  freshly formatted file system are retrieved in sequence, each directory gets its entries and their data laid out
+ *  contiguously. Each directory is imported as a single metadata transaction.
+ *
+ *  Regular files, directories and symbolic links are imported, keeping their names and permissions; any other kind of
+ *  file is skipped. Hard links to the same file are imported as separate files.
+ *
+ *  SINOPSIS:
+ *  <P><PRE>                import_sofs14 [OPTIONS] [meta-file+]supp-file[,supp-file...] host-dir
+ *
+ *                OPTIONS:
+ *                 -d dir  --- set the directory of the file system the tree is imported into (default: "/")
+ *                 -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)
+ *                 -q      --- set quiet mode (default: not quiet)
+ *                 -h      --- print this help.</PRE>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_inode.h"
+#include "sofs_datacluster.h"
+#include "sofs_direntry.h"
+#include "sofs_basicoper.h"
+#include "sofs_atime.h"
+#include "sofs_inodecache.h"
+#include "sofs_syscalls.h"
+
+/** \brief number of bytes of a regular file copied at a time */
+#define CHUNK_SIZE  (256 * BSLPC)
+
+/**
+ *  \brief Definition of a node of the host tree.
+ */
+
+typedef struct soImportNode
+{
+   /** \brief name of the file */
+    char *name;
+   /** \brief type and permissions of the file */
+    mode_t mode;
+   /** \brief size of the file in bytes */
+    off_t size;
+   /** \brief first entry of the directory, if the file is a directory */
+    struct soImportNode *child;
+   /** \brief next entry of the directory the file belongs to */
+    struct soImportNode *next;
+} SOImportNode;
+
+/*
+ *  Plan of the import
+ */
+
+static uint32_t nDirs = 0;                       /* number of directories */
+static uint32_t nFiles = 0;                      /* number of regular files */
+static uint32_t nLinks = 0;                      /* number of symbolic links */
+static uint32_t nClusters = 0;                   /* number of data clusters required */
+
+/*
+ *  Allusion to internal functions
+ */
+
+static int scan (const char *hostPath, const char *name, size_t pathLen, SOImportNode **pp_node);
+static uint32_t fileClusters (uint64_t size);
+static int importDir (SOImportNode *p_dir, const char *hostPath, const char *ePath, bool top, char **p_where);
+static int importFile (SOImportNode *p_file, const char *hostPath, const char *ePath);
+static void freeTree (SOImportNode *p_node);
+static void printUsage (char *cmd_name);
+static char *realDevList (const char *devname);
+
+/* The main function */
+
+int main (int argc, char *argv[])
+{
+  char *dest = "/";                              /* directory the tree is imported into */
+  int quiet = 0;                                 /* quiet mode, if kept set not quiet mode */
+
+  /* process command line options */
+
+  int opt;                                       /* selected option */
+
+  do
+  { switch ((opt = getopt (argc, argv, "d:s:qh")))
+    { case 'd': /* destination directory */
+                dest = optarg;
+                break;
+      case 's': /* stripe unit */
+                if ((atoi (optarg) <= 0) || (soSetStripeUnit ((uint32_t) atoi (optarg)) != 0))
+                   { fprintf (stderr, "%s: Invalid stripe unit.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
+      case 'q': /* quiet mode */
+                quiet = 1;                       /* set quiet mode for processing: no messages are issued */
+                break;
+      case 'h': /* help mode */
+                printUsage (basename (argv[0]));
+                return EXIT_SUCCESS;
+      case -1:  break;
+      default:  fprintf (stderr, "%s: Wrong option.\n", basename (argv[0]));
+                printUsage (basename (argv[0]));
+                return EXIT_FAILURE;
+    }
+  } while (opt != -1);
+  if ((argc - optind) != 2)                      /* check existence of mandatory arguments: storage device name and
+                                                    host directory */
+     { fprintf (stderr, "%s: Wrong number of mandatory arguments.\n", basename (argv[0]));
+       printUsage (basename (argv[0]));
+       return EXIT_FAILURE;
+     }
+  if ((dest[0] != '/') || (strlen (dest) > MAX_PATH))
+     { fprintf (stderr, "%s: Invalid destination directory.\n", basename (argv[0]));
+       printUsage (basename (argv[0]));
+       return EXIT_FAILURE;
+     }
+
+  /* plan the import: the host tree is walked and the space it requires is evaluated */
+
+  char *hostDir = argv[optind+1];                /* host directory */
+  SOImportNode *root;                            /* host tree */
+  int status;                                    /* status of operation */
+
+  if ((status = scan (hostDir, "", strlen (dest), &root)) != 0)
+     { fprintf (stderr, "%s: Walking the host directory - %s.\n", basename (argv[0]), strerror (-status));
+       return EXIT_FAILURE;
+     }
+  if (!S_ISDIR (root->mode))
+     { fprintf (stderr, "%s: %s is not a directory.\n", basename (argv[0]), hostDir);
+       freeTree (root);
+       return EXIT_FAILURE;
+     }
+  nClusters -= fileClusters ((uint64_t) 2 * sizeof (SODirEntry)); /* the destination directory already exists */
+  nDirs -= 1;
+
+  /* open the file system */
+
+  char *devname;                                 /* list of absolute paths to the storage device */
+
+  if ((devname = realDevList (argv[optind])) == NULL)
+     { fprintf (stderr, "%s: Setting the absolute path - %s.\n", basename (argv[0]), strerror (errno));
+       freeTree (root);
+       return EXIT_FAILURE;
+     }
+  if ((status = soMountSOFS (devname)) != 0)
+     { fprintf (stderr, "%s: Mounting the file system - %s.\n", basename (argv[0]), strerror (-status));
+       free (devname);
+       freeTree (root);
+       return EXIT_FAILURE;
+     }
+
+  /* check the plan against the free space */
+
+  struct statvfs st;                             /* file system statistics */
+
+  if ((status = soStatFS (dest, &st)) == 0)
+     { if ((st.f_ffree < nDirs + nFiles + nLinks) || (st.f_bfree < nClusters))
+          status = -ENOSPC;
+     }
+  if (status != 0)
+     fprintf (stderr, "%s: Checking the free space - %s.\n", basename (argv[0]), strerror (-status));
+     else if (!quiet)
+             printf ("\e[34mImporting %"PRIu32" directories, %"PRIu32" files and %"PRIu32" symbolic links "
+                     "(%"PRIu32" data clusters) from %s into %s.\e[0m\n", nDirs, nFiles, nLinks, nClusters, hostDir,
+                     dest);
+
+  /* import the tree */
+
+  char *where = NULL;                            /* path to the file being imported, on error */
+
+  if ((status == 0) && ((status = importDir (root, hostDir, dest, true, &where)) != 0))
+     fprintf (stderr, "%s: Importing %s - %s.\n", basename (argv[0]), (where != NULL) ? where : dest,
+              strerror (-status));
+  free (where);
+  freeTree (root);
+
+  /* close the file system */
+
+  int stat;
+
+  if (((stat = soSyncAtime ()) != 0) || ((stat = soSyncInodes ()) != 0) || ((stat = soUnmountSOFS ()) != 0))
+     { fprintf (stderr, "%s: Unmounting the file system - %s.\n", basename (argv[0]), strerror (-stat));
+       status = stat;
+     }
+  free (devname);
+  if (status != 0) return EXIT_FAILURE;
+
+  if (!quiet) printf ("Import was successful.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * walk a host file and, if it is a directory, its entries, in alphabetical order, adding them to the plan
+ *   pathLen is the length of the path the file will get in the file system, minus the length of its name
+ *   the files which are neither regular files, nor directories, nor symbolic links are skipped (NULL is stored)
+ */
+
+static int scan (const char *hostPath, const char *name, size_t pathLen, SOImportNode **pp_node)
+{
+  SOImportNode *p_node, **pp_last;
+  struct stat st;
+  struct dirent **ent;
+  int n, i, stat;
+
+  *pp_node = NULL;
+  if (lstat (hostPath, &st) != 0) return -errno;
+  if (!S_ISREG (st.st_mode) && !S_ISDIR (st.st_mode) && !S_ISLNK (st.st_mode)) return 0;
+  if (strlen (name) > MAX_NAME) return -ENAMETOOLONG;
+  if ((pathLen + 1 + strlen (name)) > MAX_PATH) return -ENAMETOOLONG;
+  if (S_ISREG (st.st_mode) && (st.st_size > MAX_FILE_SIZE)) return -EFBIG;
+  if (S_ISLNK (st.st_mode) && (st.st_size > MAX_PATH)) return -ENAMETOOLONG;
+
+  if ((p_node = calloc (1, sizeof (SOImportNode))) == NULL) return -ENOMEM;
+  if ((p_node->name = strdup (name)) == NULL)
+     { free (p_node);
+       return -ENOMEM;
+     }
+  p_node->mode = st.st_mode;
+  p_node->size = st.st_size;
+  *pp_node = p_node;
+
+  if (S_ISREG (st.st_mode))
+     { nFiles += 1;
+       nClusters += fileClusters ((uint64_t) st.st_size);
+       return 0;
+     }
+  if (S_ISLNK (st.st_mode))
+     { nLinks += 1;
+       nClusters += 1;
+       return 0;
+     }
+
+  if ((n = scandir (hostPath, &ent, NULL, alphasort)) < 0) return -errno;
+  nDirs += 1;
+  nClusters += fileClusters ((uint64_t) n * sizeof (SODirEntry)); /* n includes "." and ".." */
+  pathLen += (name[0] == '\0') ? 0 : 1 + strlen (name);
+  pp_last = &p_node->child;
+  stat = 0;
+  for (i = 0; i < n; i++)
+  { if ((stat == 0) && (strcmp (ent[i]->d_name, ".") != 0) && (strcmp (ent[i]->d_name, "..") != 0))
+       { char path[strlen (hostPath) + strlen (ent[i]->d_name) + 2];
+
+         sprintf (path, "%s/%s", hostPath, ent[i]->d_name);
+         if (((stat = scan (path, ent[i]->d_name, pathLen, pp_last)) == 0) && (*pp_last != NULL))
+            pp_last = &(*pp_last)->next;
+       }
+    free (ent[i]);
+  }
+  free (ent);
+
+  return stat;
+}
+
+/*
+ * number of data clusters, references included, required by a file of the given size
+ */
+
+static uint32_t fileClusters (uint64_t size)
+{
+  uint32_t n = (uint32_t) ((size + BSLPC - 1) / BSLPC);         /* number of data clusters */
+  uint32_t nRef = 0;                                            /* number of clusters of references */
+
+  if (n > N_DIRECT)
+     nRef += 1;                                  /* single indirect references */
+  if (n > N_DIRECT + RPC)
+     nRef += 1 + (n - N_DIRECT - RPC + RPC - 1) / RPC; /* double indirect references */
+
+  return n + nRef;
+}
+
+/*
+ * import a directory: its regular files and symbolic links go first, as a single metadata transaction, its
+ * subdirectories follow
+ *   the directory itself is created first, unless it is the top one; its permissions are set last, so that entries
+ *   can be added to it even if it is not writable
+ *   on error, the path to the file being imported is stored in *p_where (it is dynamically allocated)
+ */
+
+static int importDir (SOImportNode *p_dir, const char *hostPath, const char *ePath, bool top, char **p_where)
+{
+  SOImportNode *p;
+  int stat = 0, end;
+
+  soBeginMetaTransaction ();
+  if (!top)
+     stat = soMkdir (ePath, S_IFDIR | (p_dir->mode & (S_IRWXU | S_IRWXG | S_IRWXO)) | S_IRWXU);
+  for (p = p_dir->child; (stat == 0) && (p != NULL); p = p->next)
+    if (!S_ISDIR (p->mode))
+       { char hPath[strlen (hostPath) + strlen (p->name) + 2];
+         char path[strlen (ePath) + strlen (p->name) + 2];
+
+         sprintf (hPath, "%s/%s", hostPath, p->name);
+         sprintf (path, "%s%s%s", ePath, (strcmp (ePath, "/") == 0) ? "" : "/", p->name);
+         if ((stat = importFile (p, hPath, path)) != 0)
+            *p_where = strdup (path);
+       }
+  end = soEndMetaTransaction ();
+  if (stat == 0) stat = end;
+  if (stat != 0)
+     { if (*p_where == NULL) *p_where = strdup (ePath);
+       return stat;
+     }
+
+  for (p = p_dir->child; (stat == 0) && (p != NULL); p = p->next)
+    if (S_ISDIR (p->mode))
+       { char hPath[strlen (hostPath) + strlen (p->name) + 2];
+         char path[strlen (ePath) + strlen (p->name) + 2];
+
+         sprintf (hPath, "%s/%s", hostPath, p->name);
+         sprintf (path, "%s%s%s", ePath, (strcmp (ePath, "/") == 0) ? "" : "/", p->name);
+         stat = importDir (p, hPath, path, false, p_where);
+       }
+
+  if ((stat == 0) && !top && ((p_dir->mode & S_IRWXU) != S_IRWXU) &&
+      ((stat = soChmod (ePath, p_dir->mode & (S_IRWXU | S_IRWXG | S_IRWXO))) != 0))
+     *p_where = strdup (ePath);
+
+  return stat;
+}
+
+/*
+ * import a regular file, with its data, or a symbolic link
+ *   a regular file is created writable, its permissions are set after its data is copied
+ */
+
+static int importFile (SOImportNode *p_file, const char *hostPath, const char *ePath)
+{
+  mode_t perm = p_file->mode & (S_IRWXU | S_IRWXG | S_IRWXO);   /* permissions */
+  char *buff;                                                   /* data being copied */
+  int32_t pos;                                                  /* position in the data continuum */
+  ssize_t n;
+  int fd, stat;
+
+  if (S_ISLNK (p_file->mode))
+     { char target[MAX_PATH+1];
+
+       if ((n = readlink (hostPath, target, MAX_PATH)) < 0) return -errno;
+       target[n] = '\0';
+       return soSymlink (target, ePath);
+     }
+
+  if ((stat = soMknod (ePath, S_IFREG | perm | S_IWUSR)) != 0) return stat;
+  if (p_file->size != 0)
+     { if ((buff = malloc (CHUNK_SIZE)) == NULL) return -ENOMEM;
+       if ((fd = open (hostPath, O_RDONLY)) < 0)
+          { free (buff);
+            return -errno;
+          }
+       pos = 0;
+       while ((stat == 0) && ((n = read (fd, buff, CHUNK_SIZE)) > 0))
+         if ((stat = soWrite (ePath, buff, (uint32_t) n, pos)) >= 0)
+            { pos += n;
+              stat = 0;
+            }
+       if ((stat == 0) && (n < 0)) stat = -errno;
+       close (fd);
+       free (buff);
+       if (stat != 0) return stat;
+     }
+  if ((perm & S_IWUSR) != S_IWUSR)
+     stat = soChmod (ePath, perm);
+
+  return stat;
+}
+
+/*
+ * free the nodes of a host tree
+ */
+
+static void freeTree (SOImportNode *p_node)
+{
+  SOImportNode *next;
+
+  for (; p_node != NULL; p_node = next)
+  { next = p_node->next;
+    freeTree (p_node->child);
+    free (p_node->name);
+    free (p_node);
+  }
+}
+
+/*
+ * print help message
+ */
+
+static void printUsage (char *cmd_name)
+{
+  printf ("Sinopsis: %s [OPTIONS] [meta-file+]supp-file[,supp-file...] host-dir\n"
+          "  OPTIONS:\n"
+          "  -d dir  --- set the directory of the file system the tree is imported into (default: \"/\")\n"
+          "  -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)\n"
+          "  -q      --- set quiet mode (default: not quiet)\n"
+          "  -h      --- print this help\n", cmd_name);
+}
+
+/*
+ * convert a list of paths to the storage device (metadata tier included) into a list of absolute paths
+ *   the returned string is dynamically allocated; on error, NULL is returned and errno is set
+ */
+
+static char *realDevList (const char *devname)
+{
+  char copy[strlen (devname) + 1];
+  char seps[] = { TIER_SEP, DEV_SEP, '\0' };
+  char *list = NULL, *tmp, *abs_path, *name, *next;
+  char sep = '\0';                               /* separator preceding the current path */
+  size_t len = 0;
+
+  strcpy (copy, devname);
+  for (name = copy; name != NULL; name = next)
+  { char cur = sep;
+
+    if ((next = strpbrk (name, seps)) != NULL)
+       { sep = *next;
+         *next++ = '\0';
+       }
+    if ((abs_path = realpath (name, NULL)) == NULL)
+       { free (list);
+         return NULL;
+       }
+    if ((tmp = realloc (list, len + strlen (abs_path) + 2)) == NULL)
+       { free (abs_path);
+         free (list);
+         return NULL;
+       }
+    list = tmp;
+    if (len != 0) list[len++] = cur;
+    strcpy (list + len, abs_path);
+    len += strlen (abs_path);
+    free (abs_path);
+  }
+
+  return list;
+}
@@ -0,0 +1,26 @@
+/**
+ *  \file import_sofs14.h (interface file)
+ *
+ *  \brief The SOFS14 bulk import tool.
+ *
+ *  It copies a directory tree of the host file system into a SOFS14 file system, without mounting it.
+ *
+ *  The host tree is walked first and the whole import is planned up front: the number of inodes and data clusters it
+ *  requires is checked against the free space of the file system before anything is written. The tree is then
+ *  created in a single pass, directory by directory: each directory is followed by all its regular files and symbolic
+ *  links, with their data, and only then by its subdirectories. Since the free inodes and the free data clusters of a
+ *  freshly formatted file system are retrieved in sequence, each directory gets its entries and their data laid out
+ *  contiguously. Each directory is imported as a single metadata transaction.
+ *
+ *  Regular files, directories and symbolic links are imported, keeping their names and permissions; any other kind of
+ *  file is skipped. Hard links to the same file are imported as separate files.
+ *
+ *  SINOPSIS:
+ *  <P><PRE>                import_sofs14 [OPTIONS] [meta-file+]supp-file[,supp-file...] host-dir
+ *
+ *                OPTIONS:
+ *                 -d dir  --- set the directory of the file system the tree is imported into (default: "/")
+ *                 -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)
+ *                 -q      --- set quiet mode (default: not quiet)
+ *                 -h      --- print this help.</PRE>
+ */
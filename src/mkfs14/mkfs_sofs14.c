@@ -13,15 +13,22 @@
  *     \li the contents of the root directory seen as empty.
  *
  *  SINOPSIS:
- *  <P><PRE>                mkfs_sofs14 [OPTIONS] supp-file
+ *  <P><PRE>                mkfs_sofs14 [OPTIONS] [meta-file+]supp-file[,supp-file...]
  *
  *                OPTIONS:
  *                 -n name --- set volume name (default: "SOFS14")
+ *                 -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)
  *                 -i num  --- set number of inodes (default: N/8, where N = number of blocks)
  *                 -z      --- set zero mode (default: not zero)
  *                 -q      --- set quiet mode (default: not quiet)
  *                 -h      --- print this help.</PRE>
  *
+ *  \remarks When several supp-files are given, the array of blocks is striped over them (RAID-0). The same list, in the
+ *           same order, and the same stripe unit must be used afterwards to mount the file system.
+ *  \remarks When a meta-file is given, the superblock, the table of inodes and the directory clusters are kept in it
+ *           and the supp-files only hold the clusters of the other files (tiered mode). The meta-file should be placed
+ *           on a faster host device; it is created as a sparse file and may be initially empty.
+ *
  *  \author Artur Carneiro Pereira - September 2008
  *  \author Miguel Oliveira e Silva - September 2009
  *  \author António Rui Borges - September 2010 - August 2011, September 2014
@@ -40,6 +47,7 @@
 #include <errno.h>
 
 #include "sofs_const.h"
+#include "sofs_rawdisk.h"
 #include "sofs_buffercache.h"
 #include "sofs_superblock.h"
 #include "sofs_inode.h"
@@ -71,7 +79,7 @@ int main(int argc, char *argv[]) {
     int opt; /* selected option */
 
     do {
-        switch ((opt = getopt(argc, argv, "n:i:qzh"))) {
+        switch ((opt = getopt(argc, argv, "n:i:s:qzh"))) {
             case 'n': /* volume name */
                 name = optarg;
                 break;
@@ -83,6 +91,13 @@ int main(int argc, char *argv[]) {
                 }
                 itotal = (uint32_t) atoi(optarg);
                 break;
+            case 's': /* stripe unit */
+                if ((atoi(optarg) <= 0) || (soSetStripeUnit((uint32_t) atoi(optarg)) != 0)) {
+                    fprintf(stderr, "%s: Invalid stripe unit.\n", basename(argv[0]));
+                    printUsage(basename(argv[0]));
+                    return EXIT_FAILURE;
+                }
+                break;
             case 'q': /* quiet mode */
                 quiet = 1; /* set quiet mode for processing: no messages are issued */
                 break;
@@ -107,17 +122,16 @@ int main(int argc, char *argv[]) {
 
     /* check for storage device conformity */
 
-    char *devname; /* path to the storage device in the Linux file system */
-    struct stat st; /* file attributes */
+    char *devname; /* list of paths to the storage device in the Linux file system */
+    uint32_t ntotal; /* total number of blocks */
+    int status; /* status of operation */
 
     devname = argv[optind];
-    if (stat(devname, &st) == -1) /* get file attributes */ {
-        printError(-errno, basename(argv[0]));
-        return EXIT_FAILURE;
-    }
-    if (st.st_size % BLOCK_SIZE != 0) /* check file size: the storage device must have a size in bytes
-                                                    multiple of block size */ {
-        fprintf(stderr, "%s: Bad size of support file.\n", basename(argv[0]));
+    if ((status = soGetDeviceSize(devname, &ntotal)) != 0) /* get the number of blocks: every supp-file must
+                                                    have a size in bytes multiple of block size */ {
+        if (status == -ELIBBAD)
+            fprintf(stderr, "%s: Bad size of support file.\n", basename(argv[0]));
+        else printError(status, basename(argv[0]));
         return EXIT_FAILURE;
     }
 
@@ -135,11 +149,9 @@ int main(int argc, char *argv[]) {
      * this is not always true, so a final adjustment may be made to the parameter NBlkTIN to warrant this
      */
 
-    uint32_t ntotal; /* total number of blocks */
     uint32_t iblktotal; /* number of blocks of the inode table */
     uint32_t nclusttotal; /* total number of clusters */
 
-    ntotal = st.st_size / BLOCK_SIZE;
     if (itotal == 0) itotal = ntotal >> 3;
     if ((itotal % IPB) == 0)
         iblktotal = itotal / IPB;
@@ -152,15 +164,22 @@ int main(int argc, char *argv[]) {
     /* formatting of the storage device is going to start */
 
     SOSuperBlock *p_sb; /* pointer to the superblock */
-    int status; /* status of operation */
 
     if (!quiet)
         printf("\e[34mInstalling a %"PRIu32"-inodes SOFS11 file system in %s.\e[0m\n", itotal, argv[optind]);
 
-    /* open a buffered communication channel with the storage device */
+    /* open a buffered communication channel with the storage device, whose headers are written anew */
+
+    if (((status = soSetFormatMode(true)) != 0) || ((status = soOpenBufferCache(argv[optind], BUF)) != 0)) {
+        printError(status, basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+
+    /* in tiered mode, the superblock, the table of inodes and the root directory are placed in the metadata tier */
 
-    if ((status = soOpenBufferCache(argv[optind], BUF)) != 0) {
+    if (((status = soSetMetaZone(1 + iblktotal)) != 0) || ((status = soSetClusterTier(1 + iblktotal, true)) != 0)) {
         printError(status, basename(argv[0]));
+        soCloseBufferCache();
         return EXIT_FAILURE;
     }
 
@@ -287,9 +306,10 @@ int main(int argc, char *argv[]) {
  */
 
 static void printUsage(char *cmd_name) {
-    printf("Sinopsis: %s [OPTIONS] supp-file\n"
+    printf("Sinopsis: %s [OPTIONS] [meta-file+]supp-file[,supp-file...]\n"
             "  OPTIONS:\n"
             "  -n name --- set volume name (default: \"SOFS14\")\n"
+            "  -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)\n"
             "  -i num  --- set number of inodes (default: N/8, where N = number of blocks)\n"
             "  -z      --- set zero mode (default: not zero)\n"
             "  -q      --- set quiet mode (default: not quiet)\n"
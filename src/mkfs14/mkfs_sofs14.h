@@ -13,15 +13,22 @@
  *     \li the contents of the root directory seen as empty.
  *
  *  SINOPSIS:
- *  <P><PRE>                mkfs_sofs14 [OPTIONS] supp-file
+ *  <P><PRE>                mkfs_sofs14 [OPTIONS] [meta-file+]supp-file[,supp-file...]
  *
  *                OPTIONS:
  *                 -n name --- set volume name (default: "SOFS14")
+ *                 -s num  --- set stripe unit in blocks, if several supp-files are given (default: 16)
  *                 -i num  --- set number of inodes (default: N/8, where N = number of blocks)
  *                 -z      --- set zero mode (default: not zero)
  *                 -q      --- set quiet mode (default: not quiet)
  *                 -h      --- print this help.</PRE>
  *
+ *  \remarks When several supp-files are given, the array of blocks is striped over them (RAID-0). The same list, in the
+ *           same order, and the same stripe unit must be used afterwards to mount the file system.
+ *  \remarks When a meta-file is given, the superblock, the table of inodes and the directory clusters are kept in it
+ *           and the supp-files only hold the clusters of the other files (tiered mode). The meta-file should be placed
+ *           on a faster host device; it is created as a sparse file and may be initially empty.
+ *
  *  \author Artur Carneiro Pereira - September 2008
  *  \author Miguel Oliveira e Silva - September 2009
  *  \author António Rui Borges - September 2010 - August 2011, September 2014
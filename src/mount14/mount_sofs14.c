@@ -6,12 +6,20 @@
  *  It provides a simple method to integrate the SOFS14 file system into Linux.
  *
  *  SINOPSIS:
- *  <P><PRE>                mount_sofs14 [OPTIONS] supp-file mount-point
+ *  <P><PRE>                mount_sofs14 [OPTIONS] [meta-file+]supp-file[,supp-file...] mount-point
  *
  *               OPTIONS:
  *                 -d       --- set debugging mode (default: no debugging)
  *                 -l depth --- set log depth (default: 0,0)
  *                 -L file  --- log file (default: stdout)
+ *                 -s num   --- set stripe unit in blocks, if several supp-files are given (default: 16)
+ *                 -c file  --- keep a persistent second-level cache in file (default: no second-level cache)
+ *                 -C num   --- set number of blocks of the second-level cache (default: 16384)
+ *                 -p file  --- save the buffercache profile in file upon fsync and unmounting and prefetch it upon
+ *                              mounting (default: none)
+ *                 -a mode  --- set access time update policy: strict, relatime, noatime or lazytime (default: relatime)
+ *                 -v level --- set validation level: full, sampled[,period] or trusted (default: full)
+ *                 -n num   --- set number of shards of the arena of cache memory (default: one per NUMA node)
  *                 -h       --- print this help.</PRE>
  *
  *  \author Artur Carneiro Pereira - October 2005
@@ -33,6 +41,14 @@
 
 #include "sofs_probe.h"
 #include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_l2cache.h"
+#include "sofs_arena.h"
+#include "sofs_buffercache.h"
+#include "sofs_atime.h"
+#include "sofs_validation.h"
+#include "sofs_inodecache.h"
+#include "sofs_statfs.h"
 #include "sofs_direntry.h"
 #include "sofs_syscalls.h"
 
@@ -42,6 +58,12 @@
 
 static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;                                         /* locking flag */
 
+/*
+ *  Counters of the quick consistency checks are printed upon unmounting, if a validation level was selected
+ */
+
+static int print_valid_stats = 0;
+
 /*
  *  Allusion to FUSE callbacks and other internal functions
  */
@@ -79,6 +101,9 @@ static int sofs_getxattr (const char *ePath, const char *name, char *value, size
 static int sofs_listxattr (const char *ePath, char *list, size_t size);
 static int sofs_removexattr (const char *ePath, const char *name);
 static void printUsage (char *cmd_name);
+static char *realDevList (const char *devname);
+static uint32_t atimePolicy (const char *name);
+static int validLevel (const char *arg);
 
 /*
  *  Set of FUSE operations (required by the FUSE filesystem)
@@ -139,6 +164,9 @@ int main(int argc, char *argv[])
   int lower = 0;                                 /* lower limit of log depth, if kept set to zero */
   int higher = 0;                                /* upper limit of log depth, if kept set to zero */
   int debug_mode = 0;                            /* debugging mode, if kept set to zero */
+  char *l2_file = NULL;                          /* second-level cache file, if kept set to NULL there is none */
+  int l2_slots = DEF_L2_SLOTS;                   /* number of blocks of the second-level cache */
+  char *prof_file = NULL;                        /* buffercache profile file, if kept set to NULL there is none */
   FILE *fl = NULL;                               /* log stream default */
 
   /* process command line options */
@@ -146,7 +174,7 @@ int main(int argc, char *argv[])
   int opt;                                       /* selected option */
 
   do
-  { switch ((opt = getopt (argc, argv, "l:L:dh")))
+  { switch ((opt = getopt (argc, argv, "l:L:s:c:C:p:a:v:n:dh")))
     { case 'l': /* log depth */
                 if (sscanf (optarg, "%d,%d", &lower, &higher) != 2)
                    { fprintf (stderr, "%s: Bad argument to l option.\n", basename (argv[0]));
@@ -163,6 +191,48 @@ int main(int argc, char *argv[])
                    }
                 soOpenProbe (fl);
                 break;
+      case 's': /* stripe unit */
+                if ((atoi (optarg) <= 0) || (soSetStripeUnit ((uint32_t) atoi (optarg)) != 0))
+                   { fprintf (stderr, "%s: Invalid stripe unit.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
+      case 'c': /* second-level cache file */
+                l2_file = optarg;
+                break;
+      case 'C': /* number of blocks of the second-level cache */
+                if ((l2_slots = atoi (optarg)) <= 0)
+                   { fprintf (stderr, "%s: Invalid second-level cache size.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
+      case 'p': /* buffercache profile file */
+                prof_file = optarg;
+                break;
+      case 'a': /* access time update policy */
+                if (soSetAtimePolicy (atimePolicy (optarg)) != 0)
+                   { fprintf (stderr, "%s: Invalid access time update policy.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
+      case 'v': /* validation level */
+                if (validLevel (optarg) != 0)
+                   { fprintf (stderr, "%s: Invalid validation level.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                print_valid_stats = 1;
+                break;
+      case 'n': /* number of shards of the arena */
+                if ((atoi (optarg) <= 0) || (soSetArenaNodes ((uint32_t) atoi (optarg)) != 0))
+                   { fprintf (stderr, "%s: Invalid number of shards.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
       case 'd': /* debugging mode */
                 debug_mode = 1;                  /* set debugging mode for processing: no FUSE messages are issued */
                 break;
@@ -181,13 +251,52 @@ int main(int argc, char *argv[])
        return EXIT_FAILURE;
      }
 
-  /* set the absolute path for the storage device name */
+  /* set the absolute path for every file of the storage device */
 
-  if ((sofs_supp_file = realpath(argv[optind], NULL)) == NULL)
+  if ((sofs_supp_file = realDevList (argv[optind])) == NULL)
      { fprintf (stderr, "%s: Setting the absolute path - %s.\n", basename (argv[0]), strerror (errno));
        return EXIT_FAILURE;
      }
 
+  /* set the absolute path for the second-level cache file, it is created if it does not exist */
+
+  if (l2_file != NULL)
+     { FILE *f;
+       char *l2_path;
+
+       int status;
+
+       if (((f = fopen (l2_file, "a")) == NULL) || (fclose (f) != 0) || ((l2_path = realpath (l2_file, NULL)) == NULL))
+          { fprintf (stderr, "%s: Setting the second-level cache - %s.\n", basename (argv[0]), strerror (errno));
+            return EXIT_FAILURE;
+          }
+       if ((status = soSetL2Cache (l2_path, (uint32_t) l2_slots)) != 0)
+          { fprintf (stderr, "%s: Setting the second-level cache - %s.\n", basename (argv[0]), strerror (-status));
+            return EXIT_FAILURE;
+          }
+       free (l2_path);
+     }
+
+  /* set the absolute path for the buffercache profile file, it is created if it does not exist */
+
+  if (prof_file != NULL)
+     { FILE *f;
+       char *prof_path;
+
+       int status;
+
+       if (((f = fopen (prof_file, "a")) == NULL) || (fclose (f) != 0) ||
+           ((prof_path = realpath (prof_file, NULL)) == NULL))
+          { fprintf (stderr, "%s: Setting the buffercache profile - %s.\n", basename (argv[0]), strerror (errno));
+            return EXIT_FAILURE;
+          }
+       if ((status = soSetCacheProfile (prof_path)) != 0)
+          { fprintf (stderr, "%s: Setting the buffercache profile - %s.\n", basename (argv[0]), strerror (-status));
+            return EXIT_FAILURE;
+          }
+       free (prof_path);
+     }
+
   if (fl == NULL)
      fl = stdout;                                /* if the switch -L was not used, set output to stdout */
      else stderr = fl;                           /* if the switch -L was used, set stderr to log file */
@@ -212,14 +321,95 @@ int main(int argc, char *argv[])
 
 static void printUsage (char *cmd_name)
 {
-  printf ("Sinopsis: %s [OPTIONS] supp-file mount-point\n"
+  printf ("Sinopsis: %s [OPTIONS] [meta-file+]supp-file[,supp-file...] mount-point\n"
           "  OPTIONS:\n"
           "  -d       --- set debugging mode (default: no debugging)\n"
           "  -l depth --- set log depth (default: 0,0)\n"
           "  -L file  --- log file (default: stdout)\n"
+          "  -s num   --- set stripe unit in blocks, if several supp-files are given (default: 16)\n"
+          "  -c file  --- keep a persistent second-level cache in file (default: no second-level cache)\n"
+          "  -C num   --- set number of blocks of the second-level cache (default: 16384)\n"
+          "  -p file  --- save the buffercache profile in file upon fsync and unmounting and prefetch it upon\n"
+          "               mounting (default: none)\n"
+          "  -a mode  --- set access time update policy: strict, relatime, noatime or lazytime (default: relatime)\n"
+          "  -v level --- set validation level: full, sampled[,period] or trusted (default: full)\n"
+          "  -n num   --- set number of shards of the arena of cache memory (default: one per NUMA node)\n"
           "  -h       --- print this help\n", cmd_name);
 }
 
+/*
+ * convert a list of paths to the storage device (metadata tier included) into a list of absolute paths
+ *   the returned string is dynamically allocated; on error, NULL is returned and errno is set
+ */
+
+static char *realDevList (const char *devname)
+{
+  char copy[strlen (devname) + 1];
+  char seps[] = { TIER_SEP, DEV_SEP, '\0' };
+  char *list = NULL, *tmp, *abs_path, *name, *next;
+  char sep = '\0';                               /* separator preceding the current path */
+  size_t len = 0;
+
+  strcpy (copy, devname);
+  for (name = copy; name != NULL; name = next)
+  { char cur = sep;
+
+    if ((next = strpbrk (name, seps)) != NULL)
+       { sep = *next;
+         *next++ = '\0';
+       }
+    if ((abs_path = realpath (name, NULL)) == NULL)
+       { free (list);
+         return NULL;
+       }
+    if ((tmp = realloc (list, len + strlen (abs_path) + 2)) == NULL)
+       { free (abs_path);
+         free (list);
+         return NULL;
+       }
+    list = tmp;
+    if (len != 0) list[len++] = cur;
+    strcpy (list + len, abs_path);
+    len += strlen (abs_path);
+    free (abs_path);
+  }
+
+  return list;
+}
+
+/*
+ * convert the name of an access time update policy into its code
+ *   an invalid code is returned if the name is unknown
+ */
+
+static uint32_t atimePolicy (const char *name)
+{
+  if (strcmp (name, "strict") == 0) return ATIME_STRICT;
+  if (strcmp (name, "relatime") == 0) return ATIME_RELATIME;
+  if (strcmp (name, "noatime") == 0) return ATIME_NOATIME;
+  if (strcmp (name, "lazytime") == 0) return ATIME_LAZY;
+  return ATIME_LAZY + 1;
+}
+
+/*
+ * select the validation level given by its name and, for the sampled level, optionally by its sampling period
+ *   a negative value is returned if the name or the sampling period are invalid
+ */
+
+static int validLevel (const char *arg)
+{
+  int period = VALID_DEFAULT_PERIOD;
+  char name[8];
+  char extra;
+
+  if (strcmp (arg, "full") == 0) return soSetValidation (VALID_FULL, 0);
+  if (strcmp (arg, "trusted") == 0) return soSetValidation (VALID_TRUSTED, 0);
+  if (strcmp (arg, "sampled") == 0) return soSetValidation (VALID_SAMPLED, period);
+  if ((sscanf (arg, "%7[a-z],%d%c", name, &period, &extra) != 2) || (strcmp (name, "sampled") != 0) || (period <= 0))
+     return -EINVAL;
+  return soSetValidation (VALID_SAMPLED, (uint32_t) period);
+}
+
 /* Functions to be implemented */
 
 /**
@@ -261,7 +451,11 @@ static void sofs_unmount (void *path)
 
   pthread_mutex_lock (&accessCR);                                    /* enter critical region */
 
+  soSyncAtime ();                                /* pending updates of the time of last access are stored */
+  soSyncInodes ();                               /* cached inodes not yet written back are stored */
   soUnmountSOFS ();
+  soDropStatFS ();                               /* the snapshot of the superblock counters is no longer valid */
+  if (print_valid_stats) soPrintValidationStats (stderr);
 
   pthread_mutex_unlock (&accessCR);                                  /* exit critical region */
 }
@@ -619,6 +813,9 @@ static int sofs_utime (const char *ePath, struct utimbuf *times)
  *
  *  The 'f_type' and 'f_fsid' fields are ignored.
  *
+ *  The statistics are taken from the snapshot of the superblock counters, outside the critical region, as long as
+ *  there is one; the path was already resolved by FUSE.
+ *
  *  \param ePath path to any file within the mounted file system
  *  \param st pointer to a statvfs structure
  *
@@ -631,6 +828,8 @@ static int sofs_statfs (const char *ePath, struct statvfs *st)
 
   int stat;
 
+  if (soGetStatFS (st) == 0) return 0;                              /* snapshot of the superblock counters */
+
   if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
      return -ENOLCK;
 
@@ -846,7 +1045,20 @@ static int sofs_fsync (const char *ePath, int isdatasync, struct fuse_file_info
 {
   soColorProbe(131, "07;31", "sofs_fsync_bin (\"%s\", %d, %p)\n", ePath, isdatasync, fi);
 
-  return soFsync (ePath);
+  int stat;
+
+  if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
+     return -ENOLCK;
+
+  if (((stat = soSyncAtime ()) == 0) &&          /* pending updates of the time of last access are stored first */
+      ((stat = soSyncInodes ()) == 0) &&         /* and so are the cached inodes not yet written back */
+      ((stat = soFsync (ePath)) == 0))
+     soSaveCacheProfile (NULL);                  /* the buffercache profile, if selected, is kept up to date */
+
+  if (pthread_mutex_unlock (&accessCR) != 0)                         /* exit critical region */
+     return -ENOLCK;
+
+  return stat;
 }
 
 /**
@@ -981,7 +1193,20 @@ static int sofs_fsyncdir (const char *ePath, int isdatasync, struct fuse_file_in
 {
   soColorProbe (135, "07;31", "sofs_fsyncdir_bin (\"%s\", %d, %p)\n", ePath, isdatasync, fi);
 
-  return soFsync (ePath);
+  int stat;
+
+  if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
+     return -ENOLCK;
+
+  if (((stat = soSyncAtime ()) == 0) &&          /* pending updates of the time of last access are stored first */
+      ((stat = soSyncInodes ()) == 0) &&         /* and so are the cached inodes not yet written back */
+      ((stat = soFsync (ePath)) == 0))
+     soSaveCacheProfile (NULL);                  /* the buffercache profile, if selected, is kept up to date */
+
+  if (pthread_mutex_unlock (&accessCR) != 0)                         /* exit critical region */
+     return -ENOLCK;
+
+  return stat;
 }
 
 /**
@@ -1050,7 +1275,13 @@ static int sofs_readlink (const char *ePath, char *buf, size_t size)
  *
  *  Equivalent to setxattr (man 2 setxattr).
  *
- *  \remarks UNIMPLEMENTED.
+ *  \param ePath path to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is stored
+ *  \param size length of the value
+ *  \param flags XATTR_CREATE, XATTR_REPLACE or 0 (zero)
+ *
+ *  \return 0 (zero), on success, and a negative value, on error
  */
 
 static int sofs_setxattr (const char *ePath, const char *name, const char *value, size_t size, int flags)
@@ -1058,7 +1289,17 @@ static int sofs_setxattr (const char *ePath, const char *name, const char *value
   soColorProbe (138, "07;31", "sofs_setxattr_bin (\"%s\", \"%s\", %p, %"PRIu32", %d)\n", ePath, name, value,
                 (uint32_t) size, flags);
 
-  return -ENOSYS;
+  int stat;
+
+  if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
+     return -ENOLCK;
+
+  stat = soSetxattr (ePath, name, value, (uint32_t) size, flags);
+
+  if (pthread_mutex_unlock (&accessCR) != 0)                         /* exit critical region */
+     return -ENOLCK;
+
+  return stat;
 }
 
 /**
@@ -1066,14 +1307,29 @@ static int sofs_setxattr (const char *ePath, const char *name, const char *value
  *
  *  Equivalent to getxattr (man 2 getxattr).
  *
- *  \remarks UNIMPLEMENTED.
+ *  \param ePath path to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is to be stored
+ *  \param size size of the buffer (if zero, only the length of the value is returned)
+ *
+ *  \return length of the value, on success, and a negative value, on error
  */
 
 static int sofs_getxattr (const char *ePath, const char *name, char *value, size_t size)
 {
   soColorProbe (139, "07;31", "sofs_getxattr_bin (\"%s\", \"%s\", %p, %"PRIu32")\n", ePath, name, value, (uint32_t) size);
 
-  return -ENOSYS;
+  int stat;
+
+  if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
+     return -ENOLCK;
+
+  stat = soGetxattr (ePath, name, value, (uint32_t) size);
+
+  if (pthread_mutex_unlock (&accessCR) != 0)                         /* exit critical region */
+     return -ENOLCK;
+
+  return stat;
 }
 
 /**
@@ -1081,14 +1337,28 @@ static int sofs_getxattr (const char *ePath, const char *name, char *value, size
  *
  *  Equivalent to listxattr (man 2 listxattr).
  *
- *  \remarks UNIMPLEMENTED.
+ *  \param ePath path to the file
+ *  \param list pointer to the buffer where the names, each one terminated by a null character, are to be stored
+ *  \param size size of the buffer (if zero, only the length of the list is returned)
+ *
+ *  \return length of the list, on success, and a negative value, on error
  */
 
 static int sofs_listxattr (const char *ePath, char *list, size_t size)
 {
-  soColorProbe (140, "07;31", "sofs_listxattr_bin (\"%s\", \"%s\", %"PRIu32")\n", ePath, list, (uint32_t) size);
+  soColorProbe (140, "07;31", "sofs_listxattr_bin (\"%s\", %p, %"PRIu32")\n", ePath, list, (uint32_t) size);
 
-  return -ENOSYS;
+  int stat;
+
+  if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
+     return -ENOLCK;
+
+  stat = soListxattr (ePath, list, (uint32_t) size);
+
+  if (pthread_mutex_unlock (&accessCR) != 0)                         /* exit critical region */
+     return -ENOLCK;
+
+  return stat;
 }
 
 /**
@@ -1096,14 +1366,27 @@ static int sofs_listxattr (const char *ePath, char *list, size_t size)
  *
  *  Equivalent to removexattr (man 2 removexattr).
  *
- *  \remarks UNIMPLEMENTED.
+ *  \param ePath path to the file
+ *  \param name name of the extended attribute
+ *
+ *  \return 0 (zero), on success, and a negative value, on error
  */
 
-int sofs_removexattr (const char *ePath, const char *name)
+static int sofs_removexattr (const char *ePath, const char *name)
 {
   soColorProbe (141, "07;31", "sofs_removexattr_bin (\"%s\", \"%s\")\n", ePath, name);
 
-  return -ENOSYS;
+  int stat;
+
+  if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
+     return -ENOLCK;
+
+  stat = soRemovexattr (ePath, name);
+
+  if (pthread_mutex_unlock (&accessCR) != 0)                         /* exit critical region */
+     return -ENOLCK;
+
+  return stat;
 }
 
 /**
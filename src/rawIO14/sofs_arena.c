@@ -0,0 +1,477 @@
+/**
+ *  \file sofs_arena.c (implementation file)
+ *
+ *  \brief Arena of cache memory.
+ *
+ *  The region is a list of chunks the size of a huge page, each of them owned by a single shard and carved into slots
+ *  of both types, as they are asked for. Every shard keeps the chunk it is carving and, for every type of slot, a list
+ *  of the slots that were freed: a slot is taken from the list, if it is not empty, otherwise from the chunk; when the
+ *  chunk is exhausted, a new one is mapped and bound to the node of the shard. Free slots are linked through their
+ *  first word.
+ *
+ *  The first cache line of every chunk is not handed out: it records the shard which owns the chunk, so that a freed
+ *  slot, whose chunk is found by aligning its address down to the size of a chunk, goes back to the shard it came
+ *  from.
+ *
+ *  A huge page is taken whole, and an explicit one is never given back to the pool, so the first chunk of a shard is
+ *  backed by ordinary pages: a shard whose slots all fit into it (the caches, as they are sized by default, take a few
+ *  tens of kilobytes) takes only the pages it touches. The chunks mapped after it are backed by huge pages, and the
+ *  first one is then marked as eligible for a transparent huge page, since it is full by then.
+ *
+ *  The NUMA nodes are those the process is allowed to allocate memory on (so that a process started by \e numactl with
+ *  a restricted set of nodes, or placed in a cpuset, only uses those), or else the online ones. The memory policy is
+ *  set by the \e mbind system call directly, so no NUMA library is required. If the nodes can not be read, or there is
+ *  only one, the arena has a single shard and no memory policy is set.
+ *
+ *  The node a thread is running on is asked to the kernel only every \c LOCAL_REFRESH calls, since threads seldom
+ *  migrate between nodes.
+ *
+ *  The following operations are defined:
+ *    \li set the number of shards
+ *    \li get the number of shards
+ *    \li get the shard local to the calling thread
+ *    \li allocate a slot from the shard local to the calling thread
+ *    \li allocate a slot from a given shard
+ *    \li free a slot.
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sofs_const.h"
+#include "sofs_probe.h"
+#include "sofs_arena.h"
+
+/** \brief Number of types of slot */
+#define ARENA_TYPES     2
+/** \brief Alignment of the slots (size of a cache line) */
+#define SLOT_ALIGN      64
+/** \brief Size of a slot which holds an object of the given size */
+#define SLOT_SIZE(s)    ((((s) + SLOT_ALIGN - 1) / SLOT_ALIGN) * SLOT_ALIGN)
+/** \brief Status of the process, which holds the list of the NUMA nodes it is allowed to allocate memory on */
+#define PROC_STATUS     "/proc/self/status"
+/** \brief Entry of the status of the process which holds the list of allowed NUMA nodes */
+#define MEMS_ALLOWED    "Mems_allowed_list:"
+/** \brief List of the NUMA nodes which are online */
+#define NODES_ONLINE    "/sys/devices/system/node/online"
+/** \brief Number of calls after which the node the calling thread is running on is asked again */
+#define LOCAL_REFRESH   64
+
+#ifndef MPOL_BIND
+/** \brief Memory policy which restricts the allocation to a set of nodes (from the Linux kernel interface) */
+#define MPOL_BIND       2
+#endif
+
+/**
+ *  \brief Definition of the state of a shard.
+ */
+
+typedef struct soArenaShard
+{
+   /** \brief access lock of the shard */
+    pthread_mutex_t lock;
+   /** \brief NUMA node the chunks are bound to (\c NULL_NODE, if they are not bound) */
+    uint32_t node;
+   /** \brief number of chunks mapped so far */
+    uint32_t nChunks;
+   /** \brief next slot to be carved from the current chunk (\c NULL, if no chunk was mapped yet) */
+    unsigned char *next;
+   /** \brief end of the current chunk */
+    unsigned char *end;
+   /** \brief heads of the lists of freed slots, in the order of the identifiers of the types of slot */
+    void *free[ARENA_TYPES];
+} SOArenaShard;
+
+/** \brief the chunks of a shard are not bound to any node */
+#define NULL_NODE       (~0U)
+
+/*
+ *  Internal data structure
+ */
+/** \brief Size of the slots, in the order of the identifiers of the types of slot */
+static const uint32_t slotSize[ARENA_TYPES] = { SLOT_SIZE (BLOCK_SIZE), SLOT_SIZE (CLUSTER_SIZE) };
+/** \brief Shards of the arena, which are shared by all file system contexts */
+static SOArenaShard shard[ARENA_MAX_NODES];
+/** \brief Number of shards in use */
+static uint32_t nShards = 1;
+/** \brief Number of shards requested by the application (\c 0, if they are to be detected) */
+static uint32_t reqShards = 0;
+/** \brief Setting up of the shards, which is done once for all threads */
+static pthread_once_t setUp = PTHREAD_ONCE_INIT;
+/** \brief State of the shards: \c true, if they were set up (they are fixed from then on) */
+static bool isSetUp = false;
+/** \brief Access lock of the number of shards requested and of the state of the shards */
+static pthread_mutex_t reqLock = PTHREAD_MUTEX_INITIALIZER;
+/** \brief Shard local to the calling thread, as last asked */
+static __thread uint32_t localShard = 0;
+/** \brief Number of calls left before the shard local to the calling thread is asked again */
+static __thread uint32_t localAge = 0;
+
+/* Allusion to internal functions */
+
+static void setUpShards (void);
+static uint32_t readNodes (uint32_t *node);
+static uint32_t parseNodes (const char *list, uint32_t *node);
+static void *allocSlot (uint32_t type, uint32_t s);
+static unsigned char *mapChunk (uint32_t s);
+static void bindChunk (void *p, uint32_t node);
+
+/**
+ *  \brief Set the number of shards.
+ *
+ *  It must be called before the first slot is allocated or the shards are asked about: the shards are set up then,
+ *  and are fixed afterwards. Shard \e i is bound to the \e i-th allowed node; the shards past the last allowed node
+ *  are not bound to any.
+ *
+ *  \param n number of shards (\c 0, to have one per allowed node)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e n is greater than \c ARENA_MAX_NODES
+ *  \return -\c EBUSY, if the shards were already set up
+ */
+
+int soSetArenaNodes (uint32_t n)
+{
+  soColorProbe (873, "07;31", "soSetArenaNodes(%"PRIu32")\n", n);
+
+  int stat = 0;
+
+  if (n > ARENA_MAX_NODES) return -EINVAL;
+  pthread_mutex_lock (&reqLock);
+  if (isSetUp)
+     stat = -EBUSY;                              /* the shards are fixed */
+     else reqShards = n;
+  pthread_mutex_unlock (&reqLock);
+
+  return stat;
+}
+
+/**
+ *  \brief Get the number of shards.
+ *
+ *  \return number of shards (<tt>1 (one)</tt>, on a single node machine)
+ */
+
+uint32_t soArenaNodes (void)
+{
+  pthread_once (&setUp, setUpShards);
+  return nShards;
+}
+
+/**
+ *  \brief Get the shard local to the calling thread.
+ *
+ *  It is the shard bound to the node of the processor the thread is running on. It is <tt>0 (zero)</tt>, if there is
+ *  only one shard or the node has no shard.
+ *
+ *  \return number of the shard
+ */
+
+uint32_t soArenaLocalNode (void)
+{
+  pthread_once (&setUp, setUpShards);
+  if (nShards == 1) return 0;
+  if (localAge-- != 0) return localShard;
+
+  localShard = 0;
+  localAge = LOCAL_REFRESH - 1;
+#ifdef SYS_getcpu
+  unsigned int cpu, node;
+  uint32_t s;
+
+  if (syscall (SYS_getcpu, &cpu, &node, NULL) == 0)
+     for (s = 0; s < nShards; s++)
+       if (shard[s].node == node)
+          { localShard = s;
+            break;
+          }
+#endif
+
+  return localShard;
+}
+
+/**
+ *  \brief Allocate a slot from the shard local to the calling thread.
+ *
+ *  The slot is aligned to a cache line and its contents are cleared.
+ *
+ *  \param type type of slot (\c ARENA_BLOCK or \c ARENA_CLUSTER)
+ *
+ *  \return <em>pointer to the slot</em>, on success
+ *  \return \c NULL, if the type is invalid or there is not enough memory
+ */
+
+void *soArenaAlloc (uint32_t type)
+{
+  soColorProbe (871, "07;31", "soArenaAlloc(%"PRIu32")\n", type);
+
+  if (type >= ARENA_TYPES) return NULL;          /* checking for type of slot */
+
+  return allocSlot (type, soArenaLocalNode ());
+}
+
+/**
+ *  \brief Allocate a slot from a given shard.
+ *
+ *  The slot is aligned to a cache line and its contents are cleared.
+ *
+ *  \param type type of slot (\c ARENA_BLOCK or \c ARENA_CLUSTER)
+ *  \param s number of the shard
+ *
+ *  \return <em>pointer to the slot</em>, on success
+ *  \return \c NULL, if the type or the shard are invalid or there is not enough memory
+ */
+
+void *soArenaAllocOn (uint32_t type, uint32_t s)
+{
+  soColorProbe (871, "07;31", "soArenaAllocOn(%"PRIu32", %"PRIu32")\n", type, s);
+
+  if (type >= ARENA_TYPES) return NULL;          /* checking for type of slot */
+  if (s >= soArenaNodes ()) return NULL;         /* checking for shard */
+
+  return allocSlot (type, s);
+}
+
+/**
+ *  \brief Free a slot.
+ *
+ *  The slot goes back to the shard it was allocated from. Nothing is done if the pointer is \c NULL.
+ *
+ *  \param p pointer to the slot, as returned by \e soArenaAlloc or \e soArenaAllocOn
+ *  \param type type of slot it was allocated as
+ */
+
+void soArenaFree (void *p, uint32_t type)
+{
+  soColorProbe (872, "07;31", "soArenaFree(%p, %"PRIu32")\n", p, type);
+
+  SOArenaShard *sh;
+
+  if ((p == NULL) || (type >= ARENA_TYPES)) return;
+
+  sh = &shard[*(uint32_t *) ((uintptr_t) p & ~((uintptr_t) ARENA_CHUNK - 1))];
+  pthread_mutex_lock (&sh->lock);
+  *(void **) p = sh->free[type];
+  sh->free[type] = p;
+  pthread_mutex_unlock (&sh->lock);
+}
+
+/**
+ *  \brief Set up the shards.
+ *
+ *  The number of shards is the one requested by the application, or else the number of nodes the process is allowed
+ *  to allocate memory on.
+ */
+
+static void setUpShards (void)
+{
+  uint32_t node[ARENA_MAX_NODES];
+  uint32_t nNodes, s, t;
+
+  nNodes = readNodes (node);
+  pthread_mutex_lock (&reqLock);
+  nShards = (reqShards != 0) ? reqShards : ((nNodes != 0) ? nNodes : 1);
+  isSetUp = true;
+  pthread_mutex_unlock (&reqLock);
+  for (s = 0; s < ARENA_MAX_NODES; s++)
+  { pthread_mutex_init (&shard[s].lock, NULL);
+    shard[s].node = ((nShards > 1) && (s < nNodes)) ? node[s] : NULL_NODE;
+    shard[s].nChunks = 0;
+    shard[s].next = shard[s].end = NULL;
+    for (t = 0; t < ARENA_TYPES; t++)
+      shard[s].free[t] = NULL;
+  }
+  soColorProbe (873, "07;31", "soArenaNodes: %"PRIu32" shard(s) over %"PRIu32" allowed node(s)\n", nShards, nNodes);
+}
+
+/**
+ *  \brief Read the nodes the process is allowed to allocate memory on.
+ *
+ *  If the status of the process has no list of them, the online nodes are read instead.
+ *
+ *  \param node pointer to an array where the node numbers are to be stored
+ *
+ *  \return number of nodes, or <tt>0 (zero)</tt>, if no list can be read
+ */
+
+static uint32_t readNodes (uint32_t *node)
+{
+  char line[256];
+  uint32_t n = 0;
+  FILE *f;
+
+  if ((f = fopen (PROC_STATUS, "r")) != NULL)
+     { while (fgets (line, sizeof (line), f) != NULL)
+         if (strncmp (line, MEMS_ALLOWED, strlen (MEMS_ALLOWED)) == 0)
+            { n = parseNodes (line + strlen (MEMS_ALLOWED), node);
+              break;
+            }
+       fclose (f);
+     }
+  if ((n == 0) && ((f = fopen (NODES_ONLINE, "r")) != NULL))
+     { if (fgets (line, sizeof (line), f) != NULL)
+          n = parseNodes (line, node);
+       fclose (f);
+     }
+
+  return n;
+}
+
+/**
+ *  \brief Parse a list of nodes.
+ *
+ *  The list has the format of a Linux cpulist (for instance, <tt>0-1,3</tt>). Only the first \c ARENA_MAX_NODES nodes
+ *  are kept.
+ *
+ *  \param list pointer to the list
+ *  \param node pointer to an array where the node numbers are to be stored
+ *
+ *  \return number of nodes
+ */
+
+static uint32_t parseNodes (const char *list, uint32_t *node)
+{
+  unsigned long lo, hi;
+  char *end;
+  uint32_t n = 0;
+
+  while (n < ARENA_MAX_NODES)
+  { lo = strtoul (list, &end, 10);
+    if (end == list) break;
+    hi = lo;
+    if (*end == '-')
+       { list = end + 1;
+         hi = strtoul (list, &end, 10);
+         if (end == list) break;
+       }
+    for (; (lo <= hi) && (n < ARENA_MAX_NODES); lo++)
+      node[n++] = (uint32_t) lo;
+    if (*end != ',') break;
+    list = end + 1;
+  }
+
+  return n;
+}
+
+/**
+ *  \brief Allocate a slot from a shard.
+ *
+ *  \param type type of slot
+ *  \param s number of the shard
+ *
+ *  \return pointer to the slot, or \c NULL if there is not enough memory
+ */
+
+static void *allocSlot (uint32_t type, uint32_t s)
+{
+  SOArenaShard *sh = &shard[s];
+  uint32_t size = slotSize[type];
+  void *slot;
+
+  pthread_mutex_lock (&sh->lock);
+  if (sh->free[type] != NULL)
+     { slot = sh->free[type];                    /* a freed slot is reused */
+       sh->free[type] = *(void **) slot;
+     }
+     else { if ((sh->next == NULL) || (sh->next + size > sh->end))
+               { if ((sh->next = mapChunk (s)) == NULL)
+                    { sh->end = NULL;
+                      pthread_mutex_unlock (&sh->lock);
+                      return NULL;
+                    }
+                 sh->end = sh->next + ARENA_CHUNK;
+                 *(uint32_t *) sh->next = s;     /* the first cache line records the owner of the chunk */
+                 sh->next += SLOT_ALIGN;
+               }
+            slot = sh->next;
+            sh->next += size;
+          }
+  pthread_mutex_unlock (&sh->lock);
+  memset (slot, 0, size);
+
+  return slot;
+}
+
+/**
+ *  \brief Map a new chunk.
+ *
+ *  Twice the size of a chunk is mapped and trimmed down to a chunk aligned to a huge page. The first chunk of a shard
+ *  is left on ordinary pages. The next ones are backed by an explicit huge page, if one can be had, otherwise they
+ *  are marked as eligible for a transparent huge page, and so is the chunk they follow, which is full. Either way, the
+ *  chunk is bound to the node of the shard before it is first touched.
+ *
+ *  \param s number of the shard which is to own the chunk
+ *
+ *  \return pointer to the chunk, or \c NULL if there is not enough memory
+ */
+
+static unsigned char *mapChunk (uint32_t s)
+{
+  SOArenaShard *sh = &shard[s];
+  void *p;
+  uintptr_t a;
+
+  if (sh->nChunks != 0)
+     {
+#ifdef MADV_HUGEPAGE
+       if ((sh->nChunks == 1) && (sh->end != NULL))          /* the first chunk, which is full */
+          madvise (sh->end - ARENA_CHUNK, ARENA_CHUNK, MADV_HUGEPAGE);
+#endif
+#ifdef MAP_HUGETLB
+       if ((p = mmap (NULL, ARENA_CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0))
+           != MAP_FAILED)
+          { bindChunk (p, sh->node);
+            sh->nChunks += 1;
+            soColorProbe (871, "07;31", "soArenaAlloc: chunk %p of shard %"PRIu32" backed by an explicit huge page\n",
+                          p, s);
+            return p;
+          }
+#endif
+     }
+  if ((p = mmap (NULL, 2 * ARENA_CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+     return NULL;
+  a = ((uintptr_t) p + ARENA_CHUNK - 1) & ~((uintptr_t) ARENA_CHUNK - 1);
+  if (a != (uintptr_t) p)
+     munmap (p, a - (uintptr_t) p);
+  munmap ((void *) (a + ARENA_CHUNK), (uintptr_t) p + ARENA_CHUNK - a);
+#ifdef MADV_HUGEPAGE
+  if (sh->nChunks != 0)
+     madvise ((void *) a, ARENA_CHUNK, MADV_HUGEPAGE);
+#endif
+  bindChunk ((void *) a, sh->node);
+  sh->nChunks += 1;
+  soColorProbe (871, "07;31", "soArenaAlloc: chunk %p of shard %"PRIu32"\n", (void *) a, s);
+
+  return (unsigned char *) a;
+}
+
+/**
+ *  \brief Bind a chunk to a node.
+ *
+ *  A failure (the kernel has no NUMA support, or the node is not allowed to the process) is not an error: the chunk is
+ *  then placed by the default memory policy, as on a single node machine.
+ *
+ *  \param p pointer to the chunk
+ *  \param node NUMA node (\c NULL_NODE, if the chunk is not to be bound)
+ */
+
+static void bindChunk (void *p, uint32_t node)
+{
+  if ((node == NULL_NODE) || (node >= 8 * sizeof (unsigned long))) return;
+
+#ifdef SYS_mbind
+  unsigned long mask = 1UL << node;
+
+  if (syscall (SYS_mbind, p, (unsigned long) ARENA_CHUNK, MPOL_BIND, &mask, 8 * sizeof (mask) + 1, 0) != 0)
+     soColorProbe (873, "07;31", "soArenaAlloc: chunk %p not bound to node %"PRIu32" (%s)\n", p, node,
+                   strerror (errno));
+#endif
+}
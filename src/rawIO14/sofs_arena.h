@@ -0,0 +1,122 @@
+/**
+ *  \file sofs_arena.h (interface file)
+ *
+ *  \brief Arena of cache memory.
+ *
+ *  The buffers of the nodes of the buffercache and the buffers of data clusters kept by the internal storage are not
+ *  allocated one by one from the heap, where they would be scattered over many pages: they are carved as fixed-size
+ *  slots from a region of memory set apart for them, so that a large cache spans as few entries of the translation
+ *  lookaside buffer as possible.
+ *
+ *  The region grows in chunks the size of a huge page, aligned to it, which both types of slot share. The first chunk
+ *  is backed by ordinary pages, so that caches which fit into it do not pin a whole huge page. The next ones are
+ *  backed, if possible, by an explicit huge page (from the pool configured by the system administrator), otherwise
+ *  they are marked as eligible for a transparent huge page, and so is the first one, once it is full. If neither is
+ *  available, they are backed by ordinary pages. Freed slots are kept for reuse by the same type of slot; the chunks
+ *  are never given back to the system.
+ *
+ *  The arena is shared by all file system contexts of the process. On a machine with several NUMA nodes, it is split
+ *  into shards, one per node, whose chunks are bound to the memory of that node: a thread allocates from the shard
+ *  local to the processor it is running on, unless it asks for a given shard, so that memory is not all placed on the
+ *  node of whichever thread touched it first. On a single node machine, there is a single shard and the arena behaves
+ *  as if it were not split.
+ *
+ *  The following operations are defined:
+ *    \li set the number of shards
+ *    \li get the number of shards
+ *    \li get the shard local to the calling thread
+ *    \li allocate a slot from the shard local to the calling thread
+ *    \li allocate a slot from a given shard
+ *    \li free a slot.
+ */
+
+#ifndef SOFS_ARENA_H_
+#define SOFS_ARENA_H_
+
+#include <stdint.h>
+
+/** \brief Size of the chunks the region grows by (one huge page) */
+#define ARENA_CHUNK     (2 * 1024 * 1024)
+
+/** \brief type of slot: block */
+#define ARENA_BLOCK     0
+/** \brief type of slot: data cluster */
+#define ARENA_CLUSTER   1
+
+/** \brief Maximum number of shards (NUMA nodes) */
+#define ARENA_MAX_NODES 8
+
+/**
+ *  \brief Set the number of shards.
+ *
+ *  It must be called before the first slot is allocated or the shards are asked about: the shards are set up then,
+ *  and are fixed afterwards. Shard \e i is bound to the \e i-th allowed node; the shards past the last allowed node
+ *  are not bound to any.
+ *
+ *  \param n number of shards (\c 0, to have one per allowed node)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e n is greater than \c ARENA_MAX_NODES
+ *  \return -\c EBUSY, if the shards were already set up
+ */
+
+extern int soSetArenaNodes (uint32_t n);
+
+/**
+ *  \brief Get the number of shards.
+ *
+ *  \return number of shards (<tt>1 (one)</tt>, on a single node machine)
+ */
+
+extern uint32_t soArenaNodes (void);
+
+/**
+ *  \brief Get the shard local to the calling thread.
+ *
+ *  It is the shard bound to the node of the processor the thread is running on. It is <tt>0 (zero)</tt>, if there is
+ *  only one shard or the node has no shard.
+ *
+ *  \return number of the shard
+ */
+
+extern uint32_t soArenaLocalNode (void);
+
+/**
+ *  \brief Allocate a slot from the shard local to the calling thread.
+ *
+ *  The slot is aligned to a cache line and its contents are cleared.
+ *
+ *  \param type type of slot (\c ARENA_BLOCK or \c ARENA_CLUSTER)
+ *
+ *  \return <em>pointer to the slot</em>, on success
+ *  \return \c NULL, if the type is invalid or there is not enough memory
+ */
+
+extern void *soArenaAlloc (uint32_t type);
+
+/**
+ *  \brief Allocate a slot from a given shard.
+ *
+ *  The slot is aligned to a cache line and its contents are cleared.
+ *
+ *  \param type type of slot (\c ARENA_BLOCK or \c ARENA_CLUSTER)
+ *  \param s number of the shard
+ *
+ *  \return <em>pointer to the slot</em>, on success
+ *  \return \c NULL, if the type or the shard are invalid or there is not enough memory
+ */
+
+extern void *soArenaAllocOn (uint32_t type, uint32_t s);
+
+/**
+ *  \brief Free a slot.
+ *
+ *  The slot goes back to the shard it was allocated from. Nothing is done if the pointer is \c NULL.
+ *
+ *  \param p pointer to the slot, as returned by \e soArenaAlloc or \e soArenaAllocOn
+ *  \param type type of slot it was allocated as
+ */
+
+extern void soArenaFree (void *p, uint32_t type);
+
+#endif /* SOFS_ARENA_H_ */
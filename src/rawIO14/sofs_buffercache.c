@@ -0,0 +1,942 @@
+/**
+ *  \file sofs_buffercache.c (implementation file)
+ *
+ *  \brief Access to buffered/unbuffered raw disk blocks and clusters.
+ *
+ *  The mean transfer time of a data block (cluster) between main memory and disk is typically at least tens of
+ *  thousands of times longer than the transfer time of an equal data block (cluster) between two different locations
+ *  in main memory.
+ *  Thus, the operating system tries to keep in a private storage area copies of the data blocks (clusters) whose
+ *  probability of access in the near future is higher.
+ *
+ *  The storage area is an array of \c BUFFERCACHE_SIZE nodes, which are organized in two double-linked lists: the
+ *  first, based on the physical block number of the storage device; the second, based on the order of last access to
+ *  the block. The contents of the blocks are not kept in the nodes, but in a pool of block-sized buffers carved from
+ *  the arena of cache memory when the storage area is assigned to the device, and given back when it is unassigned.
+ *  Thus, searching the lists, picking the node to be replaced and flushing the storage area only go through the array
+ *  of nodes, which is small and dense, and the buffers are touched just to transfer the contents of a block.
+ *
+ *  On a machine with several NUMA nodes, the buffers are spread evenly over the shards of the arena, so that each node
+ *  holds its share of the storage area. When a block is brought in, a free node whose buffer is local to the calling
+ *  thread is preferred; when a node is to be replaced, the least recently accessed node with a local buffer among the
+ *  last \c LOCAL_WINDOW ones of the list based on the last access time is chosen, and the least recently accessed node
+ *  otherwise. On a single node machine, every buffer is local and the replacement is plain LRU.
+ *
+ *  Optionally, the physical numbers of the blocks resident in the storage area may be saved in a profile file, upon
+ *  closing or on demand, and are prefetched when the storage area is next assigned to the device, so that the working
+ *  set is restored by sequential transfers.
+ *
+ *  The following operations are defined:
+ *    \li select the profile file of the storage area
+ *    \li save the profile of the storage area
+ *    \li get the generation of the contents of the storage device
+ *    \li initialize the storage area and assign it to the storage device
+ *    \li unassign the storage area from the storage device and perform the required housekeeping duties
+ *    \li read a block of data from the buffercache
+ *    \li write a block of data to the buffercache
+ *    \li flush a block of data to the storage device
+ *    \li synchronize a block of data with the same block in the storage device
+ *    \li read a cluster of data from the buffercache
+ *    \li write a cluster of data to the buffercache
+ *    \li flush a cluster of data to the storage device
+ *    \li synchronize a cluster of data with the same cluster in the storage device
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "sofs_const.h"
+#include "sofs_probe.h"
+#include "sofs_rawdisk.h"
+#include "sofs_l2cache.h"
+#include "sofs_buffercache.h"
+#include "sofs_buffercachenode.h"
+#include "sofs_buffercacheinternals.h"
+#include "sofs_arena.h"
+
+/** \brief Magic number of the profile file */
+#define PROFILE_MAGIC      0x50435353
+/** \brief Maximum length of the path to the profile file */
+#define PROFILE_MAX_PATH   255
+/** \brief Number of least recently accessed nodes searched for one whose buffer is local to the calling thread */
+#define LOCAL_WINDOW       8
+
+/**
+ *  \brief Definition of the state of the buffercache.
+ */
+
+typedef struct soBufferCacheState
+{
+   /** \brief number of blocks of the storage device */
+    uint32_t bnmax;
+   /** \brief storage area (the buffers are \c NULL, while it is not assigned to the device in the buffered case) */
+    SOBufferCacheNode node[BUFFERCACHE_SIZE];
+   /** \brief number of free nodes of the storage area */
+    uint32_t nFree;
+   /** \brief type of the communication channel (\c BUF or \c UNBUF) */
+    uint32_t chType;
+   /** \brief device open state */
+    bool opened;
+   /** \brief head of the double-linked list based on the physical block number */
+    SOBufferCacheNode *nLHead;
+   /** \brief head of the double-linked list based on the last access time */
+    SOBufferCacheNode *lATLHead;
+   /** \brief tail of the double-linked list based on the last access time */
+    SOBufferCacheNode *lATLTail;
+   /** \brief path to the profile file (empty, if none was selected) */
+    char profPath[PROFILE_MAX_PATH + 1];
+   /** \brief generation of the contents of the storage device */
+    uint32_t writeGen;
+} SOBufferCacheState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOBufferCacheState defState = { .bnmax = 0, .nFree = BUFFERCACHE_SIZE, .chType = BUF, .opened = false,
+                                       .nLHead = NULL, .lATLHead = NULL, .lATLTail = NULL, .profPath = "",
+                                       .writeGen = 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOBufferCacheState *cur = &defState;
+
+/* Allusion to internal functions */
+
+static SOBufferCacheNode *getFreeNode (int *p_stat, bool *p_evicted);
+static void giveBackNode (SOBufferCacheNode *p, bool evicted);
+static int flushCluster (uint32_t n, void *buf, SOBufferCacheNode *p[]);
+static int allocBuffers (void);
+static void freeBuffers (void);
+static void loadProfile (void);
+static int cmpBlockNumber (const void *a, const void *b);
+
+/**
+ *  \brief Select the profile file of the storage area.
+ *
+ *  If a profile file is selected, the blocks listed in it are prefetched when the storage area is assigned to the
+ *  storage device, and the profile is saved when the storage area is unassigned from it.
+ *
+ *  \param path path to the profile file (\c NULL, to select none)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the path is too long
+ */
+
+int soSetCacheProfile (const char *path)
+{
+  soColorProbe (821, "07;31", "soSetCacheProfile(\"%s\")\n", (path == NULL) ? "(null)" : path);
+
+  if (path == NULL)
+     { cur->profPath[0] = '\0';
+       return 0;
+     }
+  if (strlen (path) > PROFILE_MAX_PATH) return -EINVAL;
+  strcpy (cur->profPath, path);
+
+  return 0;
+}
+
+/**
+ *  \brief Save the profile of the storage area.
+ *
+ *  The physical numbers of the blocks resident in the storage area are saved, from the most to the least recently
+ *  accessed.
+ *
+ *  \param path path to the profile file (\c NULL, to use the selected one)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e path is \c NULL and no profile file was selected
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e fopen system call
+ */
+
+int soSaveCacheProfile (const char *path)
+{
+  soColorProbe (822, "07;31", "soSaveCacheProfile(\"%s\")\n", (path == NULL) ? "(null)" : path);
+
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if (path == NULL)
+     { if (cur->profPath[0] == '\0') return -EINVAL;
+       path = cur->profPath;
+     }
+
+  uint32_t list[BUFFERCACHE_SIZE + 2];           /* header and list of block numbers */
+  uint32_t cnt = 0;
+  SOBufferCacheNode *p;
+  FILE *f;
+
+  for (p = cur->lATLHead; (p != NULL) && (cnt < BUFFERCACHE_SIZE); p = p->access_next)
+    list[2 + cnt++] = p->n;
+  list[0] = PROFILE_MAGIC;
+  list[1] = cnt;
+  if ((f = fopen (path, "w")) == NULL) return -errno;
+  if (fwrite (list, sizeof (uint32_t), cnt + 2, f) != (cnt + 2))
+     { fclose (f);
+       return -EIO;
+     }
+  if (fclose (f) != 0) return -EIO;
+
+  return 0;
+}
+
+/**
+ *  \brief Get the generation of the contents of the storage device.
+ *
+ *  The generation changes whenever the storage area is assigned to a storage device and whenever a block is written
+ *  with contents different from the ones it had. So, any data derived from the contents of the storage device while the
+ *  generation was kept the same are still valid.
+ *
+ *  \return <em>the generation</em>
+ */
+
+uint32_t soGetCacheGeneration (void)
+{
+  return cur->writeGen;
+}
+
+/**
+ *  \brief Initialize the storage area and assign it to the storage device.
+ *
+ *  A communication channel is established with the storage device so that data transfers between main memory and the
+ *  storage device may be minimized.
+ *  This communication may be unbuffered or buffered: it will be unbuffered, if the second argument is \c UNBUF , and
+ *  buffered, in any other case.
+ *  In the buffered case, the blocks listed in the selected profile file, if any, are prefetched. The file is supposed
+ *  to be a hint: if it is missing or invalid, nothing is prefetched.
+ *
+ *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param type type of the communication channel that is opened
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the argument is \c NULL
+ *  \return -\c EBUSY, if the storage area is already in use or the device is already opened
+ *  \return -\c ELIBBAD, if the supporting file size is invalid
+ *  \return -\c ENOMEM, if there is not enough memory for the storage area
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soOpenBufferCache (const char *devname, uint32_t type)
+{
+  soColorProbe (811, "07;31", "soOpenBufferCache(\"%s\",%u)\n", devname, type);
+
+  int stat;
+
+  if (devname == NULL) return -EINVAL;           /* checking for null pointer */
+  if (cur->opened || (cur->nFree != BUFFERCACHE_SIZE))
+     return -EBUSY;                              /* checking for storage area in use */
+
+  if ((type != UNBUF) && ((stat = allocBuffers ()) != 0))
+     return stat;
+  if ((stat = soOpenDevice (devname, &cur->bnmax)) != 0)
+     { freeBuffers ();
+       return stat;
+     }
+  cur->chType = (type == UNBUF) ? UNBUF : BUF;
+  cur->opened = true;
+  cur->writeGen += 1;
+  if ((cur->chType == BUF) && (cur->profPath[0] != '\0'))
+     loadProfile ();
+
+  return 0;
+}
+
+/**
+ *  \brief Unassign the storage area from the storage device and perform the required housekeeping duties.
+ *
+ *  The buffered/unbuffered communication channel previously established with the storage device is closed.
+ *  This means, namely, that the contents of the storage area is flushed into the storage device to keep data
+ *  consistent. If a profile file was selected, the profile of the storage area is saved into it.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the internal data is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soCloseBufferCache (void)
+{
+  soColorProbe (812, "07;31", "soCloseBufferCache()\n");
+
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+
+  if (cur->chType == BUF)
+     { SOBufferCacheNode *p;
+       uint32_t i;
+       int stat;
+
+       /* the changed blocks are written in ascending order of their physical numbers */
+
+       for (i = 0; i < BUFFERCACHE_SIZE - cur->nFree; i++)
+       { p = (i == 0) ? getFirstNodeOnN (cur->nLHead) : getNextNodeOnN ();
+         if (p == NULL) return -ELIBBAD;
+         if ((p->stat == CHANGED) && ((stat = soWriteRawBlock (p->n, p->buffer)) != 0))
+            return stat;
+         p->stat = SAME;
+       }
+       if (cur->profPath[0] != '\0')
+          soSaveCacheProfile (NULL);
+     }
+
+  freeBuffers ();
+  cur->nFree = BUFFERCACHE_SIZE;
+  cur->nLHead = cur->lATLHead = cur->lATLTail = NULL;
+  cur->opened = false;
+  cur->chType = BUF;
+
+  return soCloseDevice ();
+}
+
+/**
+ *  \brief Read a block of data from the buffercache.
+ *
+ *  Both the physical number of the data block to be read and a pointer to a previously allocated buffer are supplied
+ *  as arguments.
+ *
+ *  \param n physical number of the data block to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soReadCacheBlock (uint32_t n, void *buf)
+{
+  soColorProbe (813, "07;31", "soReadCacheBlock(%u, %p)\n", n, buf);
+
+  SOBufferCacheNode *p;
+  bool evicted;
+  int stat;
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if (n >= cur->bnmax) return -EINVAL;           /* checking for block number */
+  if (cur->chType == UNBUF) return soReadRawBlock (n, buf);
+
+  if ((p = searchNodeOnN (n, cur->nLHead)) == NULL)
+     { /* the block is not in the storage area yet */
+       if ((p = getFreeNode (&stat, &evicted)) == NULL)
+          return stat;
+       if ((stat = soReadRawBlock (n, p->buffer)) != 0)
+          { giveBackNode (p, evicted);
+            return stat;
+          }
+       p->n = n;
+       p->stat = SAME;
+       insertNode (p, &cur->nLHead, &cur->lATLHead, &cur->lATLTail);
+     }
+     else moveNodeAtHeadLAT (p, &cur->lATLHead, &cur->lATLTail);
+  memcpy (buf, p->buffer, BLOCK_SIZE);
+
+  return 0;
+}
+
+/**
+ *  \brief Write a block of data to the buffercache.
+ *
+ *  Both the physical number of the data block to be written and a pointer to a previously allocated buffer are supplied
+ *  as arguments.
+ *
+ *  \param n physical number of the block to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soWriteCacheBlock (uint32_t n, void *buf)
+{
+  soColorProbe (814, "07;31", "soWriteCacheBlock(%u, %p)\n", n, buf);
+
+  SOBufferCacheNode *p;
+  int stat;
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if (n >= cur->bnmax) return -EINVAL;           /* checking for block number */
+  if (cur->chType == UNBUF)
+     { cur->writeGen += 1;
+       return soWriteRawBlock (n, buf);
+     }
+
+  if ((p = searchNodeOnN (n, cur->nLHead)) == NULL)
+     { /* the block is not in the storage area yet */
+       if ((p = getFreeNode (&stat, NULL)) == NULL)
+          return stat;
+       p->n = n;
+       insertNode (p, &cur->nLHead, &cur->lATLHead, &cur->lATLTail);
+       cur->writeGen += 1;
+     }
+     else { moveNodeAtHeadLAT (p, &cur->lATLHead, &cur->lATLTail);
+            if (memcmp (p->buffer, buf, BLOCK_SIZE) != 0) cur->writeGen += 1;
+          }
+  memcpy (p->buffer, buf, BLOCK_SIZE);
+  p->stat = CHANGED;
+
+  return 0;
+}
+
+/**
+ *  \brief Flush a block of data to the storage device.
+ *
+ *  Both the physical number of the data block to be written and a pointer to a previously allocated buffer are supplied
+ *  as arguments.
+ *
+ *  \param n physical number of the block to be flushed
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soFlushCacheBlock (uint32_t n, void *buf)
+{
+  soColorProbe (815, "07;31", "soFlushCacheBlock(%u, %p)\n", n, buf);
+
+  SOBufferCacheNode *p;
+  int stat;
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if (n >= cur->bnmax) return -EINVAL;           /* checking for block number */
+  if ((cur->chType == UNBUF) || ((p = searchNodeOnN (n, cur->nLHead)) == NULL))
+     { cur->writeGen += 1;                       /* the block is not in the storage area */
+       return soWriteRawBlock (n, buf);
+     }
+  if (memcmp (p->buffer, buf, BLOCK_SIZE) != 0) cur->writeGen += 1;
+  memcpy (p->buffer, buf, BLOCK_SIZE);
+  if ((stat = soWriteRawBlock (n, p->buffer)) != 0)
+     return stat;
+  p->stat = SAME;
+  moveNodeAtHeadLAT (p, &cur->lATLHead, &cur->lATLTail);
+
+  return 0;
+}
+
+/**
+ *  \brief Synchronize a block of data with the same block in the storage device.
+ *
+ *  The physical number of the data block to be synchronized is supplied as argument.
+ *
+ *  \param n physical number of the block to be synchronized
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSyncCacheBlock (uint32_t n)
+{
+  soColorProbe (816, "07;31", "soSyncCacheBlock(%u)\n", n);
+
+  SOBufferCacheNode *p;
+  int stat;
+
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if (n >= cur->bnmax) return -EINVAL;           /* checking for block number */
+  if (cur->chType == UNBUF) return 0;
+
+  if ((p = searchNodeOnN (n, cur->nLHead)) == NULL)
+     return 0;                                   /* the block is not in the storage area */
+  if (p->stat == CHANGED)
+     { if ((stat = soWriteRawBlock (n, p->buffer)) != 0)
+          return stat;
+       p->stat = SAME;
+     }
+  moveNodeAtHeadLAT (p, &cur->lATLHead, &cur->lATLTail);
+
+  return 0;
+}
+
+/**
+ *  \brief Read a cluster of data from the buffercache.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  Both the physical number of the first block of the data cluster to be read and a pointer to a previously allocated
+ *  buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the data cluster to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soReadCacheCluster (uint32_t n, void *buf)
+{
+  soColorProbe (817, "07;31", "soReadCacheCluster(%u, %p)\n", n, buf);
+
+  SOBufferCacheNode *p[BLOCKS_PER_CLUSTER];      /* nodes of the blocks of the cluster in the storage area */
+  unsigned char *b = buf;
+  int i, nres, stat;
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if ((n + BLOCKS_PER_CLUSTER) > cur->bnmax)     /* checking for cluster number */
+     return -EINVAL;
+  if (cur->chType == UNBUF) return soReadRawCluster (n, buf);
+
+  /* the cluster is read in a single transfer, unless all its blocks are in the storage area, whose contents
+     prevail */
+
+  for (i = nres = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if ((p[i] = searchNodeOnN (n + i, cur->nLHead)) != NULL) nres += 1;
+  if ((nres != BLOCKS_PER_CLUSTER) && ((stat = soReadRawCluster (n, buf)) != 0))
+     return stat;
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if (p[i] != NULL)
+       { memcpy (b + i * BLOCK_SIZE, p[i]->buffer, BLOCK_SIZE);
+         moveNodeAtHeadLAT (p[i], &cur->lATLHead, &cur->lATLTail);
+       }
+
+  /* the missing blocks are put in the storage area */
+
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if (p[i] == NULL)
+       { if ((p[i] = getFreeNode (&stat, NULL)) == NULL)
+            return stat;
+         memcpy (p[i]->buffer, b + i * BLOCK_SIZE, BLOCK_SIZE);
+         p[i]->n = n + i;
+         p[i]->stat = SAME;
+         insertNode (p[i], &cur->nLHead, &cur->lATLHead, &cur->lATLTail);
+       }
+
+  return 0;
+}
+
+/**
+ *  \brief Write a cluster of data to the buffercache.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  Both the physical number of the first block of the data cluster to be written and a pointer to a previously
+ *  allocated buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the data cluster to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soWriteCacheCluster (uint32_t n, void *buf)
+{
+  soColorProbe (818, "07;31", "soWriteCacheCluster(%u, %p)\n", n, buf);
+
+  SOBufferCacheNode *p[BLOCKS_PER_CLUSTER];      /* nodes of the blocks of the cluster in the storage area */
+  int i, nres;
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if ((n + BLOCKS_PER_CLUSTER) > cur->bnmax)     /* checking for cluster number */
+     return -EINVAL;
+  if (cur->chType == UNBUF)
+     { cur->writeGen += 1;
+       return soWriteRawCluster (n, buf);
+     }
+
+  /* if all the blocks of the cluster are in the storage area, their contents are changed there, otherwise the cluster
+     is written in a single transfer */
+
+  for (i = nres = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if ((p[i] = searchNodeOnN (n + i, cur->nLHead)) != NULL) nres += 1;
+  if (nres == BLOCKS_PER_CLUSTER)
+     { for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+       { moveNodeAtHeadLAT (p[i], &cur->lATLHead, &cur->lATLTail);
+         if (memcmp (p[i]->buffer, (unsigned char *) buf + i * BLOCK_SIZE, BLOCK_SIZE) != 0)
+            { memcpy (p[i]->buffer, (unsigned char *) buf + i * BLOCK_SIZE, BLOCK_SIZE);
+              p[i]->stat = CHANGED;
+              cur->writeGen += 1;
+            }
+       }
+       return 0;
+     }
+
+  return flushCluster (n, buf, p);
+}
+
+/**
+ *  \brief Flush a cluster of data to the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  Both the physical number of the first block of the data cluster to be flushed and a pointer to a previously
+ *  allocated buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the data cluster to be flushed
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soFlushCacheCluster (uint32_t n, void *buf)
+{
+  soColorProbe (819, "07;31", "soFlushCacheCluster(%u, %p)\n", n, buf);
+
+  SOBufferCacheNode *p[BLOCKS_PER_CLUSTER];      /* nodes of the blocks of the cluster in the storage area */
+  int i;
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if ((n + BLOCKS_PER_CLUSTER) > cur->bnmax)     /* checking for cluster number */
+     return -EINVAL;
+
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    p[i] = (cur->chType == UNBUF) ? NULL : searchNodeOnN (n + i, cur->nLHead);
+
+  return flushCluster (n, buf, p);
+}
+
+/**
+ *  \brief Synchronize a cluster of data with the same cluster in the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  The physical number of the data cluster to be synchronized is supplied as argument.
+ *
+ *  \param n physical number of the first block of the data cluster to be synchronized
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSyncCacheCluster (uint32_t n)
+{
+  soColorProbe (820, "07;31", "soSyncCacheCluster(%u)\n", n);
+
+  SOBufferCacheNode *p[BLOCKS_PER_CLUSTER];      /* nodes of the blocks of the cluster in the storage area */
+  unsigned char cluster[CLUSTER_SIZE];
+  int i, nres, nchg, stat;
+
+  if (!cur->opened) return -EBADF;               /* checking for device open state */
+  if ((n + BLOCKS_PER_CLUSTER) > cur->bnmax)     /* checking for cluster number */
+     return -EINVAL;
+  if (cur->chType == UNBUF) return 0;
+
+  for (i = nres = nchg = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if ((p[i] = searchNodeOnN (n + i, cur->nLHead)) != NULL)
+       { nres += 1;
+         if (p[i]->stat == CHANGED) nchg += 1;
+       }
+  if (nchg == 0) return 0;
+
+  /* if all the blocks of the cluster are in the storage area, the cluster is written in a single transfer, otherwise
+     the changed blocks are written one by one */
+
+  if (nres == BLOCKS_PER_CLUSTER)
+     { for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+         memcpy (cluster + i * BLOCK_SIZE, p[i]->buffer, BLOCK_SIZE);
+       if ((stat = soWriteRawCluster (n, cluster)) != 0)
+          return stat;
+     }
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if ((p[i] != NULL) && (p[i]->stat == CHANGED))
+       { if ((nres != BLOCKS_PER_CLUSTER) && ((stat = soWriteRawBlock (n + i, p[i]->buffer)) != 0))
+            return stat;
+         p[i]->stat = SAME;
+       }
+
+  return 0;
+}
+
+/**
+ *  \brief Allocate the state of the buffercache of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the storage area is not assigned to any storage device.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewBufferCacheState (void)
+{
+  SOBufferCacheState *p;
+
+  if ((p = calloc (1, sizeof (SOBufferCacheState))) == NULL) return NULL;
+  p->nFree = BUFFERCACHE_SIZE;
+  p->chType = BUF;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the buffercache of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewBufferCacheState, or \c NULL, for the default context
+ */
+
+void soBindBufferCacheState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOBufferCacheState *) p_state;
+}
+
+/**
+ *  \brief Get a node for a block which is not in the storage area.
+ *
+ *  A free node whose buffer is local to the calling thread is taken first. If there are no free nodes, the least
+ *  recently accessed node with a local buffer among the last \c LOCAL_WINDOW ones (or else the least recently accessed
+ *  node) is retrieved and its contents, if changed, written to the storage device, or else kept in the second-level
+ *  cache.
+ *
+ *  \param p_stat pointer to a location where the error code is to be stored, on failure
+ *  \param p_evicted pointer to a location where it is stored whether the node was retrieved from the lists, instead
+ *                   of taken from the free nodes (\c NULL, if it is not wanted)
+ *
+ *  \return pointer to the node, or \c NULL on failure
+ */
+
+static SOBufferCacheNode *getFreeNode (int *p_stat, bool *p_evicted)
+{
+  SOBufferCacheNode *p, *q;
+  uint32_t local = soArenaLocalNode (),
+           i;
+
+  if (cur->nFree != 0)
+     { p = &cur->node[BUFFERCACHE_SIZE - cur->nFree];
+       for (i = BUFFERCACHE_SIZE - cur->nFree + 1; (p->shard != local) && (i < BUFFERCACHE_SIZE); i++)
+         if (cur->node[i].shard == local)
+            { unsigned char *buffer = p->buffer;      /* the buffers of two free nodes are swapped */
+
+              p->buffer = cur->node[i].buffer;
+              cur->node[i].buffer = buffer;
+              cur->node[i].shard = p->shard;
+              p->shard = local;
+            }
+       cur->nFree -= 1;
+       if (p_evicted != NULL) *p_evicted = false;
+       return p;
+     }
+  for (q = cur->lATLTail, i = 0; (q != NULL) && (q->shard != local) && (i < LOCAL_WINDOW); q = q->access_prev, i++) ;
+  if ((q != NULL) && (i < LOCAL_WINDOW))
+     moveNodeAtTailLAT (q, &cur->lATLHead, &cur->lATLTail);
+  if ((p = retrieveNode (&cur->nLHead, &cur->lATLHead, &cur->lATLTail)) == NULL)
+     { *p_stat = -ELIBBAD;
+       return NULL;
+     }
+  if ((p->stat == CHANGED) && ((*p_stat = soWriteRawBlock (p->n, p->buffer)) != 0))
+     { insertNode (p, &cur->nLHead, &cur->lATLHead, &cur->lATLTail);
+       return NULL;
+     }
+  if (p->stat != CHANGED)                        /* a clean block is kept in the second-level cache */
+     soStoreL2Cache (p->n, p->buffer);
+  cur->nFree = 0;
+  if (p_evicted != NULL) *p_evicted = true;
+  return p;
+}
+
+/**
+ *  \brief Give a node which got no block back to the free nodes.
+ *
+ *  The free nodes are the last ones of the storage area, so a node taken from them is given back by just counting it
+ *  as free again. A node retrieved from the lists may be anywhere, though: the node in use just before the free nodes
+ *  is moved into it, links included, and becomes the first free node, with the buffer of the retrieved one.
+ *
+ *  \param p pointer to the node, as returned by \e getFreeNode
+ *  \param evicted whether the node was retrieved from the lists, as reported by \e getFreeNode
+ */
+
+static void giveBackNode (SOBufferCacheNode *p, bool evicted)
+{
+  SOBufferCacheNode *q = &cur->node[BUFFERCACHE_SIZE - cur->nFree - 1];
+
+  if (evicted && (p != q))
+     { unsigned char *buffer = p->buffer;       /* the buffer of the node retrieved from the lists */
+       uint32_t shard = p->shard;
+
+       *p = *q;
+       if (p->n_prev == NULL)
+          cur->nLHead = p;
+          else p->n_prev->n_next = p;
+       if (p->n_next != NULL) p->n_next->n_prev = p;
+       if (p->access_prev == NULL)
+          cur->lATLHead = p;
+          else p->access_prev->access_next = p;
+       if (p->access_next == NULL)
+          cur->lATLTail = p;
+          else p->access_next->access_prev = p;
+       q->n_prev = q->n_next = q->access_prev = q->access_next = NULL;
+       q->buffer = buffer;
+       q->shard = shard;
+     }
+  cur->nFree += 1;
+}
+
+/**
+ *  \brief Write a cluster of data to the storage device in a single transfer.
+ *
+ *  The blocks of the cluster that are in the storage area have their contents replaced and are marked as unchanged.
+ *
+ *  \param n physical number of the first block of the data cluster
+ *  \param buf pointer to the buffer containing the data to be written from
+ *  \param p array of the nodes of the blocks of the cluster in the storage area (\c NULL, if a block is not there)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+static int flushCluster (uint32_t n, void *buf, SOBufferCacheNode *p[])
+{
+  unsigned char *b = buf;
+  int i, stat;
+
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if ((p[i] == NULL) || (memcmp (p[i]->buffer, b + i * BLOCK_SIZE, BLOCK_SIZE) != 0))
+       { cur->writeGen += 1;
+         break;
+       }
+  if ((stat = soWriteRawCluster (n, buf)) != 0)
+     return stat;
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if (p[i] != NULL)
+       { memcpy (p[i]->buffer, b + i * BLOCK_SIZE, BLOCK_SIZE);
+         p[i]->stat = SAME;
+         moveNodeAtHeadLAT (p[i], &cur->lATLHead, &cur->lATLTail);
+       }
+
+  return 0;
+}
+
+/**
+ *  \brief Carve the buffers of the nodes of the storage area from the arena of cache memory.
+ *
+ *  The buffers are dealt out to the shards of the arena in turn.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOMEM, if there is not enough memory
+ */
+
+static int allocBuffers (void)
+{
+  uint32_t nShards = soArenaNodes (),
+           i;
+
+  for (i = 0; i < BUFFERCACHE_SIZE; i++)
+  { cur->node[i].shard = i % nShards;
+    if ((cur->node[i].buffer = soArenaAllocOn (ARENA_BLOCK, cur->node[i].shard)) == NULL)
+       { freeBuffers ();
+         return -ENOMEM;
+       }
+  }
+
+  return 0;
+}
+
+/**
+ *  \brief Give the buffers of the nodes of the storage area back to the arena of cache memory.
+ */
+
+static void freeBuffers (void)
+{
+  uint32_t i;
+
+  for (i = 0; i < BUFFERCACHE_SIZE; i++)
+  { soArenaFree (cur->node[i].buffer, ARENA_BLOCK);
+    cur->node[i].buffer = NULL;
+  }
+}
+
+/**
+ *  \brief Prefetch the blocks listed in the profile file.
+ *
+ *  The list is sorted by physical block number and runs of successive blocks are read in a single transfer. The nodes
+ *  are then inserted from the least to the most recently accessed, so the order of last access is restored.
+ *  Any error aborts the prefetching silently.
+ */
+
+static void loadProfile (void)
+{
+  uint32_t list[BUFFERCACHE_SIZE + 2];           /* header and list of block numbers, in order of last access */
+  uint64_t sorted[BUFFERCACHE_SIZE];             /* block numbers (high word) and their index in list */
+  SOBufferCacheNode *slot[BUFFERCACHE_SIZE];     /* node assigned to each entry of list */
+  unsigned char *run;                            /* contents of a run of successive blocks */
+  uint32_t cnt, m, i, j, k;
+  FILE *f;
+
+  if ((f = fopen (cur->profPath, "r")) == NULL) return;
+  cnt = fread (list, sizeof (uint32_t), BUFFERCACHE_SIZE + 2, f);
+  fclose (f);
+  if ((cnt < 2) || (list[0] != PROFILE_MAGIC) || (list[1] > BUFFERCACHE_SIZE) || (list[1] != cnt - 2)) return;
+  if (list[1] > cur->nFree) list[1] = cur->nFree;
+
+  /* sort the valid block numbers */
+
+  for (i = m = 0; i < list[1]; i++)
+    if (list[2 + i] < cur->bnmax)
+       sorted[m++] = ((uint64_t) list[2 + i] << 32) | i;
+  qsort (sorted, m, sizeof (uint64_t), cmpBlockNumber);
+  for (i = 0; i < list[1]; i++)
+    slot[i] = NULL;
+  if ((run = malloc ((size_t) m * BLOCK_SIZE)) == NULL) return;
+
+  /* read runs of successive blocks, duplicate entries are skipped */
+
+  for (i = 0; i < m; i = j)
+  { j = i + 1;
+    while ((j < m) && ((sorted[j] >> 32) == (sorted[j-1] >> 32) + 1)) j++;
+    if (soReadRawBlocks ((uint32_t) (sorted[i] >> 32), j - i, run) != 0) break;
+    for (k = i; k < j; k++)
+    { SOBufferCacheNode *p = &cur->node[BUFFERCACHE_SIZE - cur->nFree];
+
+      cur->nFree -= 1;
+      memcpy (p->buffer, run + (k - i) * BLOCK_SIZE, BLOCK_SIZE);
+      p->n = (uint32_t) (sorted[k] >> 32);
+      p->stat = SAME;
+      slot[sorted[k] & 0xFFFFFFFF] = p;
+    }
+    while ((j < m) && ((sorted[j] >> 32) == (sorted[j-1] >> 32))) j++;
+  }
+  free (run);
+
+  /* the least recently accessed block is inserted first */
+
+  for (i = list[1]; i > 0; i--)
+    if (slot[i-1] != NULL)
+       insertNode (slot[i-1], &cur->nLHead, &cur->lATLHead, &cur->lATLTail);
+}
+
+/**
+ *  \brief Compare two entries of the sorted list of block numbers (qsort callback).
+ */
+
+static int cmpBlockNumber (const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+  return (x < y) ? -1 : (x > y);
+}
@@ -25,7 +25,15 @@
  *        if needed (the status is marked <em>changed</em>), is first transfered to the device, then it becomes
  *        available for a new assignment.
  *
+ *  In order to shorten the warm-up period after the device is opened, the physical numbers of the blocks resident in
+ *  the storage area may be saved in a profile file, upon closing or on demand. The blocks listed in the profile are
+ *  prefetched, sorted and coalesced in runs of successive blocks, the next time the storage area is assigned to the
+ *  device.
+ *
  *  The following operations are defined:
+ *    \li select the profile file of the storage area
+ *    \li save the profile of the storage area
+ *    \li get the generation of the contents of the storage device
  *    \li initialize the storage area and assign it to the storage device
  *    \li unassign the storage area from the storage device and perform the required housekeeping duties
  *    \li read a block of data from the buffercache
@@ -35,7 +43,9 @@
  *    \li read a cluster of data from the buffercache
  *    \li write a cluster of data to the buffercache
  *    \li flush a cluster of data to the storage device
- *    \li synchronize a cluster of data with the same cluster in the storage device.
+ *    \li synchronize a cluster of data with the same cluster in the storage device
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
  *
  *  \author Artur Carneiro Pereira - September 2007
  *  \author Miguel Oliveira e Silva - September 2009
@@ -50,11 +60,58 @@
 #define SOFS_BUFFERCACHE_H_
 
 #include <stdint.h>
+
+/** \brief Number of nodes of the storage area */
+#define BUFFERCACHE_SIZE  100
+
 /** \brief the communication channel to the storage device is buffered */
 #define BUF    0
 /** \brief the communication channel to the storage device is unbuffered */
 #define UNBUF  1
 
+/**
+ *  \brief Select the profile file of the storage area.
+ *
+ *  If a profile file is selected, the blocks listed in it are prefetched when the storage area is assigned to the
+ *  storage device, and the profile is saved when the storage area is unassigned from it.
+ *
+ *  \param path path to the profile file (\c NULL, to select none)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the path is too long
+ */
+
+extern int soSetCacheProfile (const char *path);
+
+/**
+ *  \brief Save the profile of the storage area.
+ *
+ *  The physical numbers of the blocks resident in the storage area are saved, from the most to the least recently
+ *  accessed.
+ *
+ *  \param path path to the profile file (\c NULL, to use the selected one)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e path is \c NULL and no profile file was selected
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e fopen system call
+ */
+
+extern int soSaveCacheProfile (const char *path);
+
+/**
+ *  \brief Get the generation of the contents of the storage device.
+ *
+ *  The generation changes whenever the storage area is assigned to a storage device and whenever a block is written
+ *  with contents different from the ones it had. So, any data derived from the contents of the storage device while the
+ *  generation was kept the same are still valid.
+ *
+ *  \return <em>the generation</em>
+ */
+
+extern uint32_t soGetCacheGeneration (void);
+
 /**
  *  \brief Initialize the storage area and assign it to the storage device.
  *
@@ -62,6 +119,8 @@
  *  storage device may be minimized.
  *  This communication may be unbuffered or buffered: it will be unbuffered, if the second argument is \c UNBUF , and
  *  buffered, in any other case.
+ *  In the buffered case, the blocks listed in the selected profile file, if any, are prefetched. The file is supposed
+ *  to be a hint: if it is missing or invalid, nothing is prefetched.
  *
  *  \param devname absolute path to the Linux file that simulates the storage device
  *  \param type type of the communication channel that is opened
@@ -80,7 +139,7 @@ extern int soOpenBufferCache (const char *devname, uint32_t type);
  *
  *  The buffered/unbuffered communication channel previously established with the storage device is closed.
  *  This means, namely, that the contents of the storage area is flushed into the storage device to keep data
- *  consistent.
+ *  consistent. If a profile file was selected, the profile of the storage area is saved into it.
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EBADF, if the device is not already opened
@@ -243,4 +302,23 @@ extern int soFlushCacheCluster (uint32_t n, void *buf);
 
 extern int soSyncCacheCluster (uint32_t n);
 
+/**
+ *  \brief Allocate the state of the buffercache of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the storage area is not assigned to any storage device.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewBufferCacheState (void);
+
+/**
+ *  \brief Bind the state of the buffercache of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewBufferCacheState, or \c NULL, for the default context
+ */
+
+extern void soBindBufferCacheState (void *p_state);
+
 #endif /* SOFS_BUFFERCACHE_H_ */
@@ -0,0 +1,251 @@
+/**
+ *  \file sofs_buffercacheinternals.c (implementation file)
+ *
+ *  \brief Set of operations to internally manage the buffercache.
+ *
+ *  The buffercache is conceived as two double-linked lists: the first, based on the physical block number of the
+ *  storage device it is referencing; the second, based on the order of last access to the block. Hence, one needs to
+ *  define operations to insert, retrieve and access its nodes.
+ *  One should notice that this module does not stand alone: it supposes a very tight coupling with the buffercache
+ *  implementation, its only application.
+ *
+ *  Both lists are linear: the first node has a \c NULL <em>previous</em> pointer and the last node a \c NULL
+ *  <em>next</em> pointer. The list based on the physical block number is kept sorted in ascending order.
+ *
+ *  The following operations are defined:
+ *    \li access the first node of the double-linked list based on the physical block number of the storage device
+ *    \li access the next node of the double-linked list based on the physical block number of the storage device
+ *    \li check if a given block, whose physical number is given, has already been stored in the storage area
+ *    \li insert a node in the two double-linked lists infrastructure
+ *    \li retrieve a node from the two double-linked lists infrastructure
+ *    \li move a node already present in the storage area to the head of the double-linked list based on the last access
+ *        time
+ *    \li move a node already present in the storage area to the tail of the double-linked list based on the last access
+ *        time.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "sofs_buffercachenode.h"
+#include "sofs_buffercacheinternals.h"
+
+/*
+ *  Internal data structure
+ */
+/** \brief Iterator on the double-linked list based on the physical block number (one per thread) */
+static __thread SOBufferCacheNode *iter = NULL;
+
+/**
+ *  \brief Access the first node of the double-linked list based on the physical block number of the storage device.
+ *
+ *  An iterator internal variable is set to the value of the argument and a pointer to the node pointed to by the
+ *  iterator variable is returned.
+ *
+ *  \param head pointer to the head of the linked list based on the physical block number of the storage device
+ *
+ *  \return value of the <em>iterator</em> variable
+ */
+
+SOBufferCacheNode *getFirstNodeOnN (SOBufferCacheNode *head)
+{
+  iter = head;
+  return iter;
+}
+
+/**
+ *  \brief Access the next node of the double-linked list based on the physical block number of the storage device.
+ *
+ *  The iterator internal variable is iterated if it does not already point to the last node of the linked list, and
+ *  a pointer to the node pointed to by the iterator variable is returned.
+ *
+ *  \return value of the <em>iterator</em> variable
+ */
+
+SOBufferCacheNode *getNextNodeOnN (void)
+{
+  if ((iter != NULL) && (iter->n_next != NULL))
+     iter = iter->n_next;
+  return iter;
+}
+
+/**
+ *  \brief Check if a given block, whose physical number is given, has already been stored in the storage area.
+ *
+ *  The double-linked list based on the physical block number of the storage device is traversed from the node pointed
+ *  to by the second argument to find out if there is a node whose contents belongs to the block whose physical number
+ *  is passed as the first argument.
+ *
+ *  \param nBlock physical block number
+ *  \param head pointer to the head of the linked list based on the block number of the storage device
+ *
+ *  \return pointer to the node where the block contents is stored, or \c NULL if the block has not been stored yet
+ */
+
+SOBufferCacheNode *searchNodeOnN (uint32_t nBlock, SOBufferCacheNode *head)
+{
+  SOBufferCacheNode *node;
+
+  for (node = head; (node != NULL) && (node->n < nBlock); node = node->n_next) ;
+  if ((node != NULL) && (node->n == nBlock))
+     return node;
+  return NULL;
+}
+
+/**
+ *  \brief Insert a node in the two double-linked lists infrastructure.
+ *
+ *  A node whose contents belongs to a block of the storage device, which is supposed not to be stored in the storage
+ *  area yet, is inserted in the two double-linked lists infrastructure. If the node is already present or the storage
+ *  area is inconsistent, nothing is done.
+ *
+ *  \param node pointer to the node to be inserted
+ *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
+ *                  block number of the storage device, is stored
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ */
+
+void insertNode (SOBufferCacheNode *node, SOBufferCacheNode **p_nLHead, SOBufferCacheNode **p_lATLHead,
+                 SOBufferCacheNode **p_lATLTail)
+{
+  SOBufferCacheNode *prev, *next;
+
+  if ((node == NULL) || (p_nLHead == NULL) || (p_lATLHead == NULL) || (p_lATLTail == NULL)) return;
+  if ((*p_lATLHead == NULL) != (*p_lATLTail == NULL)) return;
+
+  /* double-linked list based on the physical block number: the node is inserted in ascending order */
+
+  for (prev = NULL, next = *p_nLHead; (next != NULL) && (next->n < node->n); prev = next, next = next->n_next) ;
+  if ((next != NULL) && (next->n == node->n)) return;
+  node->n_prev = prev;
+  node->n_next = next;
+  if (prev == NULL)
+     *p_nLHead = node;
+     else prev->n_next = node;
+  if (next != NULL) next->n_prev = node;
+
+  /* double-linked list based on the last access time: the node is inserted at the head */
+
+  node->access_prev = NULL;
+  node->access_next = *p_lATLHead;
+  if (*p_lATLHead == NULL)
+     *p_lATLTail = node;
+     else (*p_lATLHead)->access_prev = node;
+  *p_lATLHead = node;
+}
+
+/**
+ *  \brief Retrieve a node from the two double-linked lists infrastructure.
+ *
+ *  The node which the tail of the double-linked list based on last access time points to, is retrieved from the two
+ *  double-linked lists infrastructure. If the storage area is inconsistent, nothing is done.
+ *
+ *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
+ *                  block number of the storage device, is stored
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ *
+ *  \return pointer to the retrieved node, or \c NULL if the storage area is empty or inconsistent
+ */
+
+SOBufferCacheNode *retrieveNode (SOBufferCacheNode **p_nLHead, SOBufferCacheNode **p_lATLHead,
+                                 SOBufferCacheNode **p_lATLTail)
+{
+  SOBufferCacheNode *node;
+
+  if ((p_nLHead == NULL) || (p_lATLHead == NULL) || (p_lATLTail == NULL)) return NULL;
+  if ((*p_nLHead == NULL) || (*p_lATLHead == NULL) || ((node = *p_lATLTail) == NULL)) return NULL;
+
+  /* double-linked list based on the last access time */
+
+  if (node->access_prev == NULL)
+     *p_lATLHead = NULL;
+     else node->access_prev->access_next = NULL;
+  *p_lATLTail = node->access_prev;
+
+  /* double-linked list based on the physical block number */
+
+  if (node->n_prev == NULL)
+     *p_nLHead = node->n_next;
+     else node->n_prev->n_next = node->n_next;
+  if (node->n_next != NULL) node->n_next->n_prev = node->n_prev;
+
+  node->n_prev = node->n_next = node->access_prev = node->access_next = NULL;
+
+  return node;
+}
+
+/**
+ *  \brief Move the node to the head of the double-linked list based on last access time.
+ *
+ *  The node which is supposed to have been accessed, is retrieved from its location in the double-linked list based on
+ *  the last access time and placed at the head of the list. If the node pointer is \c NULL or the storage area is
+ *  inconsistent, nothing is done.
+ *
+ *  \param node pointer to the node to be inserted
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ */
+
+void moveNodeAtHeadLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail)
+{
+  if ((node == NULL) || (p_lATLHead == NULL) || (p_lATLTail == NULL)) return;
+  if ((*p_lATLHead == NULL) || (*p_lATLTail == NULL)) return;
+  if (node == *p_lATLHead) return;               /* it is already at the head */
+
+  /* take it out */
+
+  node->access_prev->access_next = node->access_next;
+  if (node->access_next == NULL)
+     *p_lATLTail = node->access_prev;
+     else node->access_next->access_prev = node->access_prev;
+
+  /* put it at the head */
+
+  node->access_prev = NULL;
+  node->access_next = *p_lATLHead;
+  (*p_lATLHead)->access_prev = node;
+  *p_lATLHead = node;
+}
+
+/**
+ *  \brief Move the node to the tail of the double-linked list based on last access time.
+ *
+ *  The node is retrieved from its location in the double-linked list based on the last access time and placed at the
+ *  tail of the list, so that it is the next one to be retrieved. If the node pointer is \c NULL or the storage area is
+ *  inconsistent, nothing is done.
+ *
+ *  \param node pointer to the node to be moved
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ */
+
+void moveNodeAtTailLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail)
+{
+  if ((node == NULL) || (p_lATLHead == NULL) || (p_lATLTail == NULL)) return;
+  if ((*p_lATLHead == NULL) || (*p_lATLTail == NULL)) return;
+  if (node == *p_lATLTail) return;               /* it is already at the tail */
+
+  /* take it out */
+
+  node->access_next->access_prev = node->access_prev;
+  if (node->access_prev == NULL)
+     *p_lATLHead = node->access_next;
+     else node->access_prev->access_next = node->access_next;
+
+  /* put it at the tail */
+
+  node->access_next = NULL;
+  node->access_prev = *p_lATLTail;
+  (*p_lATLTail)->access_next = node;
+  *p_lATLTail = node;
+}
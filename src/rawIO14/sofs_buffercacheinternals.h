@@ -16,6 +16,8 @@
  *    \li insert a node in the two double-linked lists infrastructure
  *    \li retrieve a node from the two double-linked lists infrastructure
  *    \li move a node already present in the storage area to the head of the double-linked list based on the last access
+ *        time
+ *    \li move a node already present in the storage area to the tail of the double-linked list based on the last access
  *        time.
  *
  *  \author António Rui Borges - July 2010 / August 2011
@@ -121,4 +123,20 @@ extern SOBufferCacheNode *retrieveNode (SOBufferCacheNode **p_nLHead, SOBufferCa
 
 extern void moveNodeAtHeadLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail);
 
+/**
+ *  \brief Move the node to the tail of the double-linked list based on last access time.
+ *
+ *  The node is retrieved from its location in the double-linked list based on the last access time and placed at the
+ *  tail of the list, so that it is the next one to be retrieved. If the node pointer is \c NULL or the storage area is
+ *  inconsistent, nothing is done.
+ *
+ *  \param node pointer to the node to be moved
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ */
+
+extern void moveNodeAtTailLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail);
+
 #endif /* SOFS_BUFFERCACHEINTERNALS_H_ */
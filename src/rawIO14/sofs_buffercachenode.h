@@ -19,16 +19,18 @@
  *  The buffercache is conceived as two double-linked lists: the first, based on the block number of the storage device
  *  it is referencing; the second, based on the order of last access to the block.
  *  So, besides the pointers which are required to implement this dynamic structure, each node contains:
- *    \li a buffer area to store locally the contents of the referenced block
  *    \li the physical block number
  *    \li a status flag which signals whether the block contents is, or is not, synchronized with the contents of the
- *        corresponding block in the storage device.
+ *        corresponding block in the storage device
+ *    \li a pointer to the buffer area where the contents of the referenced block is stored locally
+ *    \li the shard of the arena of cache memory (NUMA node) the buffer area was carved from.
+ *
+ *  The buffer areas are kept apart from the nodes, in a pool of their own: walking the lists only touches the nodes,
+ *  which are small and packed together, and not the contents of the blocks.
  */
 
 typedef struct soBufferCacheNode
 {
-   /** \brief contents of the data block */
-    unsigned char buffer[BLOCK_SIZE];
    /** \brief physical block number */
     uint32_t n;
    /** \brief status of the data block
@@ -50,6 +52,11 @@ typedef struct soBufferCacheNode
    /** \brief double-linked list based on last access time:
     *         pointer to next node */
     struct soBufferCacheNode *access_next;
+
+   /** \brief pointer to the contents of the data block */
+    unsigned char *buffer;
+   /** \brief shard of the arena of cache memory the buffer was carved from */
+    uint32_t shard;
 } SOBufferCacheNode;
 
 /** \brief the contents of a block in the storage area is the same as the corresponding block in the storage device */
@@ -0,0 +1,410 @@
+/**
+ *  \file sofs_l2cache.c (implementation file)
+ *
+ *  \brief Persistent second-level cache of blocks of the storage device.
+ *
+ *  The second-level cache is a Linux file, supposedly placed on a local fast device, which keeps copies of the clean
+ *  blocks evicted from the buffercache. Blocks written to the storage device have their copies dropped, they are not
+ *  written through. Contrary to the buffercache, it survives the closing of the device, so the next time the device
+ *  is opened, read operations may be served by it from the start.
+ *
+ *  Layout of the Linux file:
+ *    \li block 0: header
+ *    \li next blocks: table of slots (physical number of the cached block and checksum of its contents)
+ *    \li remaining blocks: contents of the slots
+ *
+ *  The following operations are defined:
+ *    \li select the Linux file that holds the second-level cache
+ *    \li open the second-level cache
+ *    \li close the second-level cache
+ *    \li look up a block in the second-level cache
+ *    \li store a block in the second-level cache
+ *    \li drop the copies of a group of successive blocks from the second-level cache
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "sofs_const.h"
+#include "sofs_probe.h"
+#include "sofs_l2cache.h"
+
+/** \brief Magic number of the header */
+#define L2_MAGIC           0x4c32534f
+/** \brief Maximum length of the path to the Linux file */
+#define L2_MAX_PATH        255
+/** \brief Value of the field \e n of an empty slot */
+#define L2_EMPTY           0xFFFFFFFF
+
+/**
+ *  \brief Definition of the header of the second-level cache.
+ */
+
+typedef struct soL2Header
+{
+   /** \brief magic number */
+    uint32_t magic;
+   /** \brief number of blocks of the storage device */
+    uint32_t bnmax;
+   /** \brief number of slots */
+    uint32_t nslots;
+   /** \brief cache state: \c true, if it was properly closed */
+    uint32_t clean;
+   /** \brief stamp of the Linux files that simulate the storage device upon closing */
+    uint64_t stamp;
+} SOL2Header;
+
+/**
+ *  \brief Definition of a slot descriptor.
+ */
+
+typedef struct soL2Slot
+{
+   /** \brief physical number of the cached block (\c L2_EMPTY, if the slot is empty) */
+    uint32_t n;
+   /** \brief checksum of the block contents */
+    uint32_t sum;
+} SOL2Slot;
+
+/**
+ *  \brief Definition of the state of the second-level cache.
+ */
+
+typedef struct soL2State
+{
+   /** \brief path to the Linux file that holds the second-level cache */
+    char l2path[L2_MAX_PATH + 1];
+   /** \brief number of slots */
+    uint32_t l2slots;
+   /** \brief file descriptor of the Linux file that holds the second-level cache (-1, if not opened) */
+    int l2fd;
+   /** \brief table of slots */
+    SOL2Slot *slot;
+   /** \brief number of blocks of the table of slots */
+    uint32_t tblks;
+   /** \brief header of the opened second-level cache */
+    SOL2Header hdr;
+} SOL2State;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOL2State defState = { .l2path = "", .l2slots = DEF_L2_SLOTS, .l2fd = -1, .slot = NULL, .tblks = 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOL2State *cur = &defState;
+
+/* Allusion to internal functions */
+
+static uint32_t checksum (const unsigned char *buf);
+static int storeHeader (SOL2Header *p_hdr);
+
+/**
+ *  \brief Select the Linux file that holds the second-level cache.
+ *
+ *  It must be called before the storage device is opened. The file is created if it does not exist; its contents are
+ *  discarded if it has a different number of slots or was built for a different storage device.
+ *
+ *  \param path path to the Linux file (\c NULL, to disable the second-level cache)
+ *  \param nslots number of slots (blocks) of the second-level cache
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e path is not \c NULL and \e nslots is zero, or \e path is too long
+ *  \return -\c EBUSY, if the second-level cache is already opened
+ */
+
+int soSetL2Cache (const char *path, uint32_t nslots)
+{
+  soColorProbe (861, "07;31", "soSetL2Cache(\"%s\", %"PRIu32")\n", (path == NULL) ? "(null)" : path, nslots);
+
+  if (cur->l2fd != -1) return -EBUSY;            /* checking for cache open state */
+  if (path == NULL)
+     { cur->l2path[0] = '\0';
+       return 0;
+     }
+  if ((nslots == 0) || (strlen (path) > L2_MAX_PATH))
+     return -EINVAL;
+
+  strcpy (cur->l2path, path);
+  cur->l2slots = nslots;
+
+  return 0;
+}
+
+/**
+ *  \brief Open the second-level cache.
+ *
+ *  Nothing is done if no Linux file was selected.
+ *
+ *  \param bnmax number of blocks of the storage device
+ *  \param stamp stamp of the Linux files that simulate the storage device
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOMEM, if there is no memory for the table of slots
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e open, \e ftruncate or \e lseek system calls
+ */
+
+int soOpenL2Cache (uint32_t bnmax, uint64_t stamp)
+{
+  soColorProbe (862, "07;31", "soOpenL2Cache(%"PRIu32", %"PRIu64")\n", bnmax, stamp);
+
+  if (cur->l2path[0] == '\0') return 0;          /* the second-level cache is disabled */
+  if (cur->l2fd != -1) return -EBUSY;            /* checking for cache open state */
+
+  unsigned char blk[BLOCK_SIZE];
+  uint32_t i;
+  ssize_t len;
+  int stat;
+
+  cur->tblks = (cur->l2slots * sizeof (SOL2Slot) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  len = (ssize_t) BLOCK_SIZE * cur->tblks;
+  if ((cur->slot = calloc (len, 1)) == NULL)
+     return -ENOMEM;
+  if ((cur->l2fd = open (cur->l2path, O_RDWR | O_CREAT, 0600)) == -1)
+     { stat = -errno;
+       goto fail;
+     }
+
+  /* the contents are kept only if the header matches and the cache was properly closed */
+
+  memset (blk, 0, BLOCK_SIZE);
+  if (pread (cur->l2fd, blk, BLOCK_SIZE, 0) < 0)
+     { stat = -errno;
+       goto fail;
+     }
+  memcpy (&cur->hdr, blk, sizeof (SOL2Header));
+  if ((cur->hdr.magic == L2_MAGIC) && (cur->hdr.bnmax == bnmax) && (cur->hdr.nslots == cur->l2slots) &&
+      cur->hdr.clean && (cur->hdr.stamp == stamp) && (pread (cur->l2fd, cur->slot, len, BLOCK_SIZE) == len))
+     soColorProbe (862, "07;31", "soOpenL2Cache: warm start\n");
+     else { if (ftruncate (cur->l2fd, (off_t) BLOCK_SIZE * (1 + cur->tblks + cur->l2slots)) == -1)
+               { stat = -errno;
+                 goto fail;
+               }
+            for (i = 0; i < cur->l2slots; i++)
+              cur->slot[i].n = L2_EMPTY;
+          }
+
+  /* until it is closed, the cache is marked as not valid */
+
+  cur->hdr.magic = L2_MAGIC;
+  cur->hdr.bnmax = bnmax;
+  cur->hdr.nslots = cur->l2slots;
+  cur->hdr.clean = false;
+  cur->hdr.stamp = 0;
+  if ((stat = storeHeader (&cur->hdr)) != 0)
+     goto fail;
+
+  return 0;
+
+fail:
+  if (cur->l2fd != -1) close (cur->l2fd);
+  cur->l2fd = -1;
+  free (cur->slot);
+  cur->slot = NULL;
+  return stat;
+}
+
+/**
+ *  \brief Close the second-level cache.
+ *
+ *  The table of slots is stored and the cache is marked as valid for the given stamp.
+ *
+ *  \param stamp stamp of the Linux files that simulate the storage device, after the last write operation
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soCloseL2Cache (uint64_t stamp)
+{
+  soColorProbe (863, "07;31", "soCloseL2Cache(%"PRIu64")\n", stamp);
+
+  if (cur->l2fd == -1) return 0;                 /* the second-level cache is not opened */
+
+  ssize_t len = (ssize_t) BLOCK_SIZE * cur->tblks;
+  int stat;
+
+  /* the table of slots must reach the disk before the cache is marked as valid */
+
+  if (pwrite (cur->l2fd, cur->slot, len, BLOCK_SIZE) != len)
+     stat = -EIO;
+     else if (fdatasync (cur->l2fd) == -1)
+             stat = -errno;
+     else { cur->hdr.clean = true;
+            cur->hdr.stamp = stamp;
+            stat = storeHeader (&cur->hdr);
+          }
+  close (cur->l2fd);
+  cur->l2fd = -1;
+  free (cur->slot);
+  cur->slot = NULL;
+
+  return stat;
+}
+
+/**
+ *  \brief Look up a block in the second-level cache.
+ *
+ *  \param n physical number of the block
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, if the block was found
+ *  \return -\c ENOENT, if the second-level cache is not opened or the block was not found
+ */
+
+int soLookupL2Cache (uint32_t n, void *buf)
+{
+  soColorProbe (864, "07;31", "soLookupL2Cache(%"PRIu32", %p)\n", n, buf);
+
+  if (cur->l2fd == -1) return -ENOENT;           /* the second-level cache is not opened */
+
+  uint32_t i = n % cur->l2slots;                 /* slot where the block may be stored */
+
+  if (cur->slot[i].n != n) return -ENOENT;
+  if ((pread (cur->l2fd, buf, BLOCK_SIZE, (off_t) BLOCK_SIZE * (1 + cur->tblks + i)) != BLOCK_SIZE) ||
+      (checksum (buf) != cur->slot[i].sum))
+     { cur->slot[i].n = L2_EMPTY;                /* the slot contents are not valid */
+       return -ENOENT;
+     }
+
+  return 0;
+}
+
+/**
+ *  \brief Store a block in the second-level cache.
+ *
+ *  The block replaces the one previously stored in its slot. Nothing is done if the second-level cache is not opened.
+ *
+ *  \param n physical number of the block
+ *  \param buf pointer to the buffer containing the data
+ */
+
+void soStoreL2Cache (uint32_t n, void *buf)
+{
+  soColorProbe (865, "07;31", "soStoreL2Cache(%"PRIu32", %p)\n", n, buf);
+
+  if (cur->l2fd == -1) return;                   /* the second-level cache is not opened */
+
+  uint32_t i = n % cur->l2slots;                 /* slot where the block is to be stored */
+
+  if (pwrite (cur->l2fd, buf, BLOCK_SIZE, (off_t) BLOCK_SIZE * (1 + cur->tblks + i)) != BLOCK_SIZE)
+     { cur->slot[i].n = L2_EMPTY;                /* the slot contents are not valid */
+       return;
+     }
+  cur->slot[i].n = n;
+  cur->slot[i].sum = checksum (buf);
+}
+
+/**
+ *  \brief Drop the copies of a group of successive blocks from the second-level cache.
+ *
+ *  It must be called whenever the blocks are written to the storage device. Nothing is done if the second-level cache
+ *  is not opened.
+ *
+ *  \param n physical number of the first block
+ *  \param nblk number of blocks
+ */
+
+void soDropL2Cache (uint32_t n, uint32_t nblk)
+{
+  soColorProbe (868, "07;31", "soDropL2Cache(%"PRIu32", %"PRIu32")\n", n, nblk);
+
+  if (cur->l2fd == -1) return;                   /* the second-level cache is not opened */
+
+  uint32_t i;
+
+  for (i = 0; i < nblk; i++)
+    if (cur->slot[(n + i) % cur->l2slots].n == n + i)
+       cur->slot[(n + i) % cur->l2slots].n = L2_EMPTY;
+}
+
+/**
+ *  \brief Allocate the state of the second-level cache of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the second-level cache is disabled.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewL2CacheState (void)
+{
+  SOL2State *p;
+
+  if ((p = calloc (1, sizeof (SOL2State))) == NULL) return NULL;
+  p->l2slots = DEF_L2_SLOTS;
+  p->l2fd = -1;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the second-level cache of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewL2CacheState, or \c NULL, for the default context
+ */
+
+void soBindL2CacheState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOL2State *) p_state;
+}
+
+/**
+ *  \brief Compute the checksum of a block (Fletcher-32).
+ *
+ *  \param buf pointer to the buffer containing the data
+ *
+ *  \return <em>the checksum</em>
+ */
+
+static uint32_t checksum (const unsigned char *buf)
+{
+  uint32_t s1 = 0xFFFF, s2 = 0xFFFF;
+  int i;
+
+  for (i = 0; i < BLOCK_SIZE; i += 2)
+  { s1 += (uint32_t) buf[i] | ((uint32_t) buf[i+1] << 8);
+    s2 += s1;
+    if ((i & 0xFF) == 0xFE)                      /* fold the sums every 128 words to avoid overflow */
+       { s1 = (s1 & 0xFFFF) + (s1 >> 16);
+         s2 = (s2 & 0xFFFF) + (s2 >> 16);
+       }
+  }
+  s1 = (s1 & 0xFFFF) + (s1 >> 16);
+  s2 = (s2 & 0xFFFF) + (s2 >> 16);
+
+  return (s2 << 16) | s1;
+}
+
+/**
+ *  \brief Store the header of the second-level cache.
+ *
+ *  \param p_hdr pointer to the header
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIO, if it fails on writing
+ */
+
+static int storeHeader (SOL2Header *p_hdr)
+{
+  unsigned char blk[BLOCK_SIZE];
+
+  memset (blk, 0, BLOCK_SIZE);
+  memcpy (blk, p_hdr, sizeof (SOL2Header));
+  if (pwrite (cur->l2fd, blk, BLOCK_SIZE, 0) != BLOCK_SIZE) return -EIO;
+  if (fdatasync (cur->l2fd) == -1) return -EIO;
+
+  return 0;
+}
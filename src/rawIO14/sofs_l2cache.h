@@ -0,0 +1,142 @@
+/**
+ *  \file sofs_l2cache.h (interface file)
+ *
+ *  \brief Persistent second-level cache of blocks of the storage device.
+ *
+ *  The second-level cache is a Linux file, supposedly placed on a local fast device, which keeps copies of the clean
+ *  blocks evicted from the buffercache. Blocks written to the storage device have their copies dropped, they are not
+ *  written through. Contrary to the buffercache, it survives the closing of the device, so
+ *  the next time the device is opened, read operations may be served by it from the start.
+ *
+ *  It is organized as a direct-mapped array of slots: block \e n may only be kept in slot <tt>n % (number of
+ *  slots)</tt>. Each slot is validated by a checksum of its contents. The cache as a whole is validated by a stamp of
+ *  the Linux files that simulate the storage device taken upon closing, so that it is discarded if the device was
+ *  changed in the meantime, or if it was not properly closed.
+ *
+ *  The following operations are defined:
+ *    \li select the Linux file that holds the second-level cache
+ *    \li open the second-level cache
+ *    \li close the second-level cache
+ *    \li look up a block in the second-level cache
+ *    \li store a block in the second-level cache
+ *    \li drop the copies of a group of successive blocks from the second-level cache
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  Only the first operation is meant to be used by applications. The block store is used by the buffercache, the
+ *  remaining ones by the raw disk module.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_L2CACHE_H_
+#define SOFS_L2CACHE_H_
+
+#include <stdint.h>
+
+/** \brief Default number of slots of the second-level cache */
+#define DEF_L2_SLOTS       16384
+
+/**
+ *  \brief Select the Linux file that holds the second-level cache.
+ *
+ *  It must be called before the storage device is opened. The file is created if it does not exist; its contents are
+ *  discarded if it has a different number of slots or was built for a different storage device.
+ *
+ *  \param path path to the Linux file (\c NULL, to disable the second-level cache)
+ *  \param nslots number of slots (blocks) of the second-level cache
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e path is not \c NULL and \e nslots is zero, or \e path is too long
+ *  \return -\c EBUSY, if the second-level cache is already opened
+ */
+
+extern int soSetL2Cache (const char *path, uint32_t nslots);
+
+/**
+ *  \brief Open the second-level cache.
+ *
+ *  Nothing is done if no Linux file was selected.
+ *
+ *  \param bnmax number of blocks of the storage device
+ *  \param stamp stamp of the Linux files that simulate the storage device
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOMEM, if there is no memory for the table of slots
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e open, \e ftruncate or \e lseek system calls
+ */
+
+extern int soOpenL2Cache (uint32_t bnmax, uint64_t stamp);
+
+/**
+ *  \brief Close the second-level cache.
+ *
+ *  The table of slots is stored and the cache is marked as valid for the given stamp.
+ *
+ *  \param stamp stamp of the Linux files that simulate the storage device, after the last write operation
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soCloseL2Cache (uint64_t stamp);
+
+/**
+ *  \brief Look up a block in the second-level cache.
+ *
+ *  \param n physical number of the block
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, if the block was found
+ *  \return -\c ENOENT, if the second-level cache is not opened or the block was not found
+ */
+
+extern int soLookupL2Cache (uint32_t n, void *buf);
+
+/**
+ *  \brief Store a block in the second-level cache.
+ *
+ *  The block replaces the one previously stored in its slot. Nothing is done if the second-level cache is not opened.
+ *
+ *  \param n physical number of the block
+ *  \param buf pointer to the buffer containing the data
+ */
+
+extern void soStoreL2Cache (uint32_t n, void *buf);
+
+/**
+ *  \brief Drop the copies of a group of successive blocks from the second-level cache.
+ *
+ *  It must be called whenever the blocks are written to the storage device. Nothing is done if the second-level cache
+ *  is not opened.
+ *
+ *  \param n physical number of the first block
+ *  \param nblk number of blocks
+ */
+
+extern void soDropL2Cache (uint32_t n, uint32_t nblk);
+
+/**
+ *  \brief Allocate the state of the second-level cache of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the second-level cache is disabled.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewL2CacheState (void);
+
+/**
+ *  \brief Bind the state of the second-level cache of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewL2CacheState, or \c NULL, for the default context
+ */
+
+extern void soBindL2CacheState (void *p_state);
+
+#endif /* SOFS_L2CACHE_H_ */
@@ -3,14 +3,24 @@
  *
  *  \brief Access to raw disk blocks and clusters.
  *
- *  The storage device is presently a Linux file which simulates a magnetic disk.
+ *  The storage device is presently a Linux file which simulates a magnetic disk, or a list of Linux files over which
+ *  the array of blocks is striped (RAID-0), so that the aggregate bandwidth grows with the number of host disks.
+ *  Optionally, the metadata may be kept in a separate Linux file, placed on a faster host device (tiered mode).
  *  The following operations are defined:
+ *    \li set the stripe unit of a striped storage device
+ *    \li set the format mode of the storage device
+ *    \li get the number of blocks of the storage device without opening it
+ *    \li set the extent of the metadata zone of a tiered storage device
+ *    \li assign a data cluster of a tiered storage device to the metadata or the data tier
  *    \li open a communication channel with the storage device
  *    \li close the communication channel previously established
  *    \li read a block of data from the storage device
  *    \li write a block of data to the storage device
  *    \li read a cluster of data from the storage device
- *    \li write a cluster of data to the storage device.
+ *    \li write a cluster of data to the storage device
+ *    \li read a group of successive blocks of data from the storage device
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
  *
  *  \author Artur Carneiro Pereira - September 2007
  *  \author Miguel Oliveira e Silva - September 2009
@@ -18,36 +28,232 @@
  */
 
 #include <sys/stat.h>
+#include <sys/types.h>
 #include <unistd.h>
+#include <time.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #define __USE_GNU
 #include <fcntl.h>
 
 #include "sofs_const.h"
 #include "sofs_probe.h"
+#include "sofs_rawdisk.h"
+#include "sofs_l2cache.h"
+
+/**
+ *  \brief Definition of the state of the access to the storage device.
+ */
+
+typedef struct soRawDiskState
+{
+   /** \brief file descriptors of the Linux files that simulate the magnetic disk */
+    int fd[MAX_DEVICES];
+   /** \brief number of Linux files that simulate the magnetic disk (zero, if the device is not opened) */
+    int ndev;
+   /** \brief number of blocks of the storage device */
+    uint32_t bnmax;
+   /** \brief stripe unit (in number of blocks) */
+    uint32_t stripe;
+   /** \brief file descriptor of the Linux file that holds the metadata tier (-1, if not in tiered mode) */
+    int mfd;
+   /** \brief number of blocks at the beginning of the device that belong to the metadata tier */
+    uint32_t mzone;
+   /** \brief map of the data clusters assigned to the metadata tier (one bit per cluster) */
+    unsigned char *tmap;
+   /** \brief size in bytes of the map of the data clusters assigned to the metadata tier */
+    uint32_t tmapsize;
+   /** \brief format mode: the headers are written, instead of checked, when the device is opened */
+    bool format;
+} SORawDiskState;
 
 /*
  *  Internal data structure
  */
-/** \brief File descriptor of the Linux file that simulates the magnetic disk */
-static int fd = -1;
-/** \brief Number of blocks of the storage device */
-static uint32_t bnmax = 0;
+/** \brief State of the default file system context */
+static SORawDiskState defState = { .ndev = 0, .bnmax = 0, .stripe = DEF_STRIPE_UNIT, .mfd = -1, .mzone = 0,
+                                   .tmap = NULL, .tmapsize = 0, .format = false };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SORawDiskState *cur = &defState;
+
+/** \brief Magic number of the header of the tier map */
+#define TMAP_MAGIC         0x54465353
+
+/**
+ *  \brief Definition of the header of the tier map.
+ *
+ *  It is stored in the metadata tier, in the block following the last block of the device, and is followed by the
+ *  map itself.
+ */
+
+typedef struct soTierHeader
+{
+   /** \brief magic number */
+    uint32_t magic;
+   /** \brief number of blocks of the device */
+    uint32_t bnmax;
+   /** \brief number of blocks at the beginning of the device that belong to the metadata tier */
+    uint32_t mzone;
+} SOTierHeader;
+
+/** \brief Magic number of the header of a member of a striped storage device */
+#define MEMB_MAGIC         0x4d465353
+
+/**
+ *  \brief Definition of the header of a member of a striped storage device.
+ *
+ *  It is stored in each Linux file of the list, in the block following the last block used by the stripe units, and
+ *  records the layout the device was formatted with.
+ */
+
+typedef struct soMemberHeader
+{
+   /** \brief magic number */
+    uint32_t magic;
+   /** \brief identification of the device (common to all its members) */
+    uint32_t id;
+   /** \brief stripe unit (in number of blocks) */
+    uint32_t stripe;
+   /** \brief number of Linux files that simulate the storage device */
+    uint32_t ndev;
+   /** \brief position of the Linux file in the list */
+    uint32_t index;
+} SOMemberHeader;
+
+/* Allusion to internal functions */
+
+static int splitDevList (const char *devname, char *store, char *name[], char **p_meta);
+static uint32_t evalBnmax (int n, off_t minsize);
+static int openMembers (void);
+static int openMetaTier (const char *mname);
+static int storeTierMap (uint32_t idx);
+static bool isMetaBlock (uint32_t n);
+static int transfer (uint32_t n, void *buf, uint32_t nblk, bool write_op);
+static int stripeTransfer (uint32_t n, void *buf, uint32_t nblk, bool write_op);
+static uint64_t devStamp (void);
+
+/**
+ *  \brief Set the stripe unit of a striped storage device.
+ *
+ *  The array of blocks of a storage device made of several Linux files is split into stripe units, which are
+ *  assigned to the files in a round-robin fashion.
+ *  The stripe unit must be set before the device is opened and must be the same every time a given device is used.
+ *  It has no effect on a storage device made of a single Linux file.
+ *
+ *  \param su stripe unit (in number of blocks)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the stripe unit is zero
+ *  \return -\c EBUSY, if the device is already opened
+ */
+
+int soSetStripeUnit (uint32_t su)
+{
+  soColorProbe (857, "07;31", "soSetStripeUnit(%"PRIu32")\n", su);
+
+  if (su == 0) return -EINVAL;                   /* checking for stripe unit */
+  if (cur->ndev != 0) return -EBUSY;             /* checking for device open state */
+
+  cur->stripe = su;
+
+  return 0;
+}
+
+/**
+ *  \brief Set the format mode of the storage device.
+ *
+ *  The layout of a striped storage device and the tier map of a tiered one are recorded in headers, which are checked
+ *  every time the device is opened. In format mode, the headers are written instead, so the device is taken as new.
+ *  It must be set before the device is opened and is meant to be used only when the device is formatted.
+ *
+ *  \param format \c true, if the device is going to be formatted, \c false, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBUSY, if the device is already opened
+ */
+
+int soSetFormatMode (bool format)
+{
+  soColorProbe (867, "07;31", "soSetFormatMode(%d)\n", format);
+
+  if (cur->ndev != 0) return -EBUSY;             /* checking for device open state */
+
+  cur->format = format;
+
+  return 0;
+}
+
+/**
+ *  \brief Get the number of blocks of the storage device.
+ *
+ *  The Linux files that simulate the storage device are checked for conformity, but they are not opened.
+ *  In tiered mode, the file that holds the metadata tier is ignored.
+ *
+ *  \param devname list of paths to the Linux files that simulate the storage device, separated by \c DEV_SEP and
+ *                 optionally preceded by the path to the metadata tier and \c TIER_SEP
+ *  \param p_bnmax pointer to a location where the number of blocks of the device is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL, or the list of files is malformed
+ *  \return -\c ELIBBAD, if the size of some supporting file is invalid
+ *  \return -<em>other specific error</em> issued by \e stat system call
+ */
+
+int soGetDeviceSize (const char *devname, uint32_t *p_bnmax)
+{
+  soColorProbe (858, "07;31", "soGetDeviceSize(\"%s\", %p)\n", devname, p_bnmax);
+
+  if ((devname == NULL) || (p_bnmax == NULL))
+     return -EINVAL;                             /* checking for null pointers */
+
+  char store[strlen (devname) + 1];              /* storage area for the list of paths */
+  char *name[MAX_DEVICES];                       /* paths to the Linux files */
+  char *mname;                                   /* path to the metadata tier */
+  int n;                                         /* number of Linux files */
+  int i;
+  struct stat st;
+  off_t minsize = 0;                             /* size of the smallest Linux file */
+
+  if ((n = splitDevList (devname, store, name, &mname)) < 0)
+     return n;
+  for (i = 0; i < n; i++)
+  { if (stat (name[i], &st) == -1) return -errno;
+    if ((st.st_size % BLOCK_SIZE) != 0) return -ELIBBAD;
+    if ((i == 0) || (st.st_size < minsize)) minsize = st.st_size;
+  }
+  *p_bnmax = evalBnmax (n, minsize);
+
+  return 0;
+}
 
 /**
  *  \brief Open the storage device.
  *
  *  A communication channel is established with the storage device.
  *  It is supposed that no communication channel was previously established.
- *  The Linux file that simulates the storage device must exist and have a size multiple of the block size.
+ *  The Linux files that simulate the storage device must exist and have a size multiple of the block size.
+ *  When several files are given, the array of blocks is striped over them and each file holds as many whole stripe
+ *  units as fit in the smallest one, keeping a spare block. The block that follows the stripe units in each file holds
+ *  a header with the stripe unit, the number of files and the position of the file in the list; it is written in format
+ *  mode and must match otherwise.
+ *  In tiered mode, the metadata blocks are stored in their own Linux file at the same offsets they have in the device,
+ *  followed by the tier map, so the file is extended, if needed, to the size of the whole device plus the map. It is a
+ *  sparse file: only the metadata blocks are allocated, so a small and fast file system is enough, but it must be
+ *  copied with a tool that preserves holes. The header of the tier map is written in format mode and must be present
+ *  otherwise.
  *
- *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param devname list of absolute paths to the Linux files that simulate the storage device, separated by
+ *                 \c DEV_SEP and optionally preceded by the absolute path to the metadata tier and \c TIER_SEP
  *  \param p_bnmax pointer to a location where the number of blocks of the device is to be stored
  *
  *  \return <tt>0 (zero)</tt>, on success
- *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL
+ *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL, the list of files is malformed, or, not in format
+ *          mode, the headers of a striped device are missing or do not match the stripe unit and the list of files,
+ *          or the header of the tier map is missing
  *  \return -\c EBUSY, if the device is already opened
  *  \return -\c ELIBBAD, if the supporting file size is invalid
  *  \return -<em>other specific error</em> issued by \e lseek system call
@@ -59,25 +265,142 @@ int soOpenDevice (const char *devname, uint32_t *p_bnmax)
 
   if ((devname == NULL) || (p_bnmax == NULL))
      return -EINVAL;                             /* checking for null pointers */
-  if (fd != -1) return -EBUSY;                   /* checking for device open state */
+  if (cur->ndev != 0) return -EBUSY;             /* checking for device open state */
 
-  /* opening supporting file in async mode for read and write */
+  char store[strlen (devname) + 1];              /* storage area for the list of paths */
+  char *name[MAX_DEVICES];                       /* paths to the Linux files */
+  char *mname;                                   /* path to the metadata tier */
+  int n;                                         /* number of Linux files */
+  int i, err = 0;
+  struct stat st;
+  off_t minsize = 0;                             /* size of the smallest Linux file */
 
-  if ((fd = open (devname, O_RDWR)) == -1)
-     return -errno;                              /* checking for opening error */
+  if ((n = splitDevList (devname, store, name, &mname)) < 0)
+     return n;
 
-  /* checking device for conformity */
+  /* opening supporting files for read and write and checking them for conformity */
 
-  struct stat st;
-  if (stat (devname, &st) == -1) return -errno;
-  if ((st.st_size % BLOCK_SIZE) != 0) return -ELIBBAD;
+  for (i = 0; i < n; i++)
+  { if ((cur->fd[i] = open (name[i], O_RDWR)) == -1)
+       { err = -errno;                           /* checking for opening error */
+         break;
+       }
+    if (fstat (cur->fd[i], &st) == -1)
+       err = -errno;
+       else if ((st.st_size % BLOCK_SIZE) != 0)
+               err = -ELIBBAD;
+    if (err != 0)
+       { close (cur->fd[i]);
+         break;
+       }
+    if ((i == 0) || (st.st_size < minsize)) minsize = st.st_size;
+  }
+  if (err != 0)
+     { while (i > 0)                             /* undo the opening of the previous files */
+         close (cur->fd[--i]);
+       return err;
+     }
 
-  bnmax = st.st_size / BLOCK_SIZE;               /* get number of blocks of the device */
-  *p_bnmax = bnmax;
+  cur->ndev = n;
+  cur->bnmax = evalBnmax (n, minsize);           /* get number of blocks of the device */
+  if (((n > 1) && ((err = openMembers ()) != 0)) ||
+      ((mname != NULL) && ((err = openMetaTier (mname)) != 0)) ||
+      ((err = soOpenL2Cache (cur->bnmax, devStamp ())) != 0))
+     { while (cur->ndev > 0)
+         close (cur->fd[--cur->ndev]);
+       if (cur->mfd != -1)
+          { close (cur->mfd);
+            cur->mfd = -1;
+            free (cur->tmap);
+            cur->tmap = NULL;
+            cur->tmapsize = cur->mzone = 0;
+          }
+       cur->bnmax = 0;
+       return err;
+     }
+  *p_bnmax = cur->bnmax;
 
   return 0;
 }
 
+/**
+ *  \brief Set the extent of the metadata zone of a tiered storage device.
+ *
+ *  The blocks <tt>[0, nblk[</tt> (the superblock and the table of inodes) are placed in the metadata tier. Every data
+ *  cluster is assigned back to the data tier.
+ *  It is meant to be used when the device is formatted and has no effect if the device is not in tiered mode.
+ *
+ *  \param nblk number of blocks at the beginning of the device that belong to the metadata tier
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e nblk is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSetMetaZone (uint32_t nblk)
+{
+  soColorProbe (859, "07;31", "soSetMetaZone(%"PRIu32")\n", nblk);
+
+  if (cur->ndev == 0) return -EBADF;             /* checking for device closed state */
+  if (nblk > cur->bnmax) return -EINVAL;         /* checking for block number */
+  if (cur->mfd == -1) return 0;                  /* nothing to be done in single tier mode */
+
+  uint32_t i;
+  int stat;
+
+  cur->mzone = nblk;
+  memset (cur->tmap, 0, cur->tmapsize);
+  for (i = 0; i <= cur->tmapsize / BLOCK_SIZE; i++) /* store the header and the map */
+    if ((stat = storeTierMap (i * BLOCK_SIZE * 8)) != 0)
+       return stat;
+
+  return 0;
+}
+
+/**
+ *  \brief Assign a data cluster of a tiered storage device to the metadata or the data tier.
+ *
+ *  Clusters of directories should be placed in the metadata tier, clusters of other files in the data tier.
+ *  If the tier changes, the cluster contents are copied to the new one.
+ *  It has no effect if the device is not in tiered mode.
+ *
+ *  \param n physical number of the first block of the data cluster
+ *  \param meta \c true, if the cluster is to be placed in the metadata tier, \c false, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or it is not the first block of a data cluster
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSetClusterTier (uint32_t n, bool meta)
+{
+  soColorProbe (860, "07;31", "soSetClusterTier(%"PRIu32", %s)\n", n, meta ? "true" : "false");
+
+  if (cur->ndev == 0) return -EBADF;             /* checking for device closed state */
+  if (cur->mfd == -1) return 0;                  /* nothing to be done in single tier mode */
+  if ((n < cur->mzone) || ((n + BLOCKS_PER_CLUSTER) > cur->bnmax) || (((n - cur->mzone) % BLOCKS_PER_CLUSTER) != 0))
+     return -EINVAL;                             /* checking for cluster number */
+  if (isMetaBlock (n) == meta) return 0;         /* it is already in place */
+
+  unsigned char buf[CLUSTER_SIZE];               /* cluster contents */
+  uint32_t idx = (n - cur->mzone) / BLOCKS_PER_CLUSTER;
+  int stat;
+
+  if ((stat = transfer (n, buf, BLOCKS_PER_CLUSTER, false)) != 0)
+     return stat;
+  if (meta)
+     cur->tmap[idx >> 3] |= (1 << (idx & 7));
+     else cur->tmap[idx >> 3] &= ~(1 << (idx & 7));
+  if ((stat = transfer (n, buf, BLOCKS_PER_CLUSTER, true)) != 0)
+     return stat;
+
+  return storeTierMap (idx);
+}
+
 /**
  *  \brief Close the storage device.
  *
@@ -91,12 +414,19 @@ int soCloseDevice (void)
 {
   soColorProbe (852, "07;31", "soCloseDevice()\n");
 
-  if (fd == -1) return -EBADF;                   /* checking for device close state */
+  if (cur->ndev == 0) return -EBADF;             /* checking for device close state */
 
-  close (fd);                                    /* close the device */
-  bnmax = 0;                                     /* reset number of blocks of the storage device */
-  fd = -1;                                       /* reset file descriptor of the Linux file that simulates the
-                                                    magnetic disk */
+  soCloseL2Cache (devStamp ());                  /* the second-level cache is valid for the present contents */
+  while (cur->ndev > 0)                          /* close the Linux files that simulate the magnetic disk */
+    close (cur->fd[--cur->ndev]);
+  if (cur->mfd != -1)                            /* close the metadata tier */
+     { close (cur->mfd);
+       cur->mfd = -1;
+       free (cur->tmap);
+       cur->tmap = NULL;
+       cur->tmapsize = cur->mzone = 0;
+     }
+  cur->bnmax = 0;                                /* reset number of blocks of the storage device */
 
   return 0;
 }
@@ -123,13 +453,17 @@ int soReadRawBlock (uint32_t n, void *buf)
   soColorProbe (853, "07;31", "soReadRawBlock(%"PRIu32", %p)\n", n, buf);
 
   if (buf == NULL) return -EINVAL;               /* checking for null pointer */
-  if (n >= bnmax) return -EINVAL;                /* checking for block number */
-  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+  if (n >= cur->bnmax) return -EINVAL;           /* checking for block number */
+  if (cur->ndev == 0) return -EBADF;             /* checking for device closed state */
+
+  /* look up the block in the second-level cache, otherwise set the current position of the proper file to the
+     required block and read its contents */
 
-  /* set file current position to the required block and read its contents */
+  int stat;
 
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
+  if (soLookupL2Cache (n, buf) == 0) return 0;
+  if ((stat = transfer (n, buf, 1, false)) != 0)
+     return stat;
 
   return 0;
 }
@@ -156,13 +490,17 @@ int soWriteRawBlock (uint32_t n, void *buf)
   soColorProbe (854, "07;31", "soWriteRawBlock(%"PRIu32", %p)\n", n, buf);
 
   if (buf == NULL) return -EINVAL;               /* checking for null pointer */
-  if (n >= bnmax) return -EINVAL;                /* checking for block number */
-  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+  if (n >= cur->bnmax) return -EINVAL;           /* checking for block number */
+  if (cur->ndev == 0) return -EBADF;             /* checking for device closed state */
 
-  /* set file current position to the required block and write its contents */
+  /* set the current position of the proper file to the required block and write its contents, the copy in the
+     second-level cache is dropped */
 
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
+  int stat;
+
+  if ((stat = transfer (n, buf, 1, true)) != 0)
+     return stat;
+  soDropL2Cache (n, 1);
 
   return 0;
 }
@@ -189,14 +527,21 @@ int soReadRawCluster (uint32_t n, void *buf)
   soColorProbe (855, "07;31", "soReadRawCluster(%"PRIu32", %p)\n", n, buf);
 
   if (buf == NULL) return -EINVAL;               /* checking for null pointer */
-  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+  if ((n + BLOCKS_PER_CLUSTER) > cur->bnmax)     /* checking for cluster number */
      return -EINVAL;
-  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+  if (cur->ndev == 0) return -EBADF;             /* checking for device closed state */
+
+  /* look up the blocks in the second-level cache, otherwise read blocks contents in succession, the cluster may span
+     more than one stripe unit */
 
-  /* Set file current position to first block of the required cluster and read blocks contents in succession */
+  unsigned char *p = buf;
+  int i, stat;
 
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (read (fd, buf, CLUSTER_SIZE) != CLUSTER_SIZE) return -EIO;
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if (soLookupL2Cache (n + i, p + i * BLOCK_SIZE) != 0) break;
+  if (i == BLOCKS_PER_CLUSTER) return 0;
+  if ((stat = transfer (n, buf, BLOCKS_PER_CLUSTER, false)) != 0)
+     return stat;
 
   return 0;
 }
@@ -223,14 +568,458 @@ int soWriteRawCluster (uint32_t n, void *buf)
   soColorProbe (856, "07;31", "soWriteRawCluster(%"PRIu32", %p)\n", n, buf);
 
   if (buf == NULL) return -EINVAL;               /* checking for null pointer */
-  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+  if ((n + BLOCKS_PER_CLUSTER) > cur->bnmax)     /* checking for cluster number */
      return -EINVAL;
-  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+  if (cur->ndev == 0) return -EBADF;             /* checking for device closed state */
 
-  /* Set file current position to first block of the required cluster and write blocks contents in succession */
+  /* write blocks contents in succession, the cluster may span more than one stripe unit, the copies in the
+     second-level cache are dropped */
 
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (write (fd, buf, CLUSTER_SIZE) != CLUSTER_SIZE) return -EIO;
+  int stat;
+
+  if ((stat = transfer (n, buf, BLOCKS_PER_CLUSTER, true)) != 0)
+     return stat;
+  soDropL2Cache (n, BLOCKS_PER_CLUSTER);
 
   return 0;
 }
+
+/**
+ *  \brief Read a group of successive blocks of data from the storage device.
+ *
+ *  The blocks are read with as few transfers as the layout of the device allows, so that prefetching a run of blocks
+ *  costs much less than reading them one by one.
+ *  Both the physical number of the first block of the group to be read, the number of blocks and a pointer to a
+ *  previously allocated buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the group to be read from
+ *  \param cnt number of blocks of the group
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block numbers</em> are out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soReadRawBlocks (uint32_t n, uint32_t cnt, void *buf)
+{
+  soColorProbe (866, "07;31", "soReadRawBlocks(%"PRIu32", %"PRIu32", %p)\n", n, cnt, buf);
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if ((cnt == 0) || (n >= cur->bnmax) || (cnt > cur->bnmax - n)) /* checking for block numbers */
+     return -EINVAL;
+  if (cur->ndev == 0) return -EBADF;             /* checking for device closed state */
+
+  /* the second-level cache is not looked up, the group is supposed to be a run of blocks missing from main memory */
+
+  int stat;
+
+  if ((stat = transfer (n, buf, cnt, false)) != 0)
+     return stat;
+
+  return 0;
+}
+
+/**
+ *  \brief Allocate the state of the access to the storage device of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the storage device is not opened.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewRawDiskState (void)
+{
+  SORawDiskState *p;
+
+  if ((p = calloc (1, sizeof (SORawDiskState))) == NULL) return NULL;
+  p->stripe = DEF_STRIPE_UNIT;
+  p->mfd = -1;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the access to the storage device of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewRawDiskState, or \c NULL, for the default context
+ */
+
+void soBindRawDiskState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SORawDiskState *) p_state;
+}
+
+/**
+ *  \brief Split a list of paths to Linux files.
+ *
+ *  \param devname list of paths separated by \c DEV_SEP, optionally preceded by a path and \c TIER_SEP
+ *  \param store storage area, at least as long as \e devname, where the list is copied to
+ *  \param name array of \c MAX_DEVICES pointers where the starting addresses of the paths are to be stored
+ *  \param p_meta pointer to a location where the starting address of the path preceding \c TIER_SEP is to be
+ *                stored (\c NULL, if there is none)
+ *
+ *  \return <em>the number of paths</em>, on success
+ *  \return -\c EINVAL, if some path is empty or there are more than \c MAX_DEVICES paths
+ */
+
+static int splitDevList (const char *devname, char *store, char *name[], char **p_meta)
+{
+  int n = 0;                                     /* number of paths */
+  int i;
+  char *p = store;
+
+  strcpy (store, devname);
+  *p_meta = NULL;
+  if ((p = strchr (store, TIER_SEP)) != NULL)
+     { *p++ = '\0';
+       if ((store[0] == '\0') || (strchr (store, DEV_SEP) != NULL))
+          return -EINVAL;
+       *p_meta = store;
+     }
+     else p = store;
+  while (true)
+  { if (n == MAX_DEVICES) return -EINVAL;
+    name[n++] = p;
+    if ((p = strchr (p, DEV_SEP)) == NULL) break;
+    *p++ = '\0';
+  }
+  for (i = 0; i < n; i++)
+    if (name[i][0] == '\0') return -EINVAL;
+
+  return n;
+}
+
+/**
+ *  \brief Evaluate the number of blocks of the storage device.
+ *
+ *  \param n number of Linux files that simulate the storage device
+ *  \param minsize size in bytes of the smallest one
+ *
+ *  \return <em>the number of blocks</em>
+ */
+
+static uint32_t evalBnmax (int n, off_t minsize)
+{
+  uint64_t nblk = minsize / BLOCK_SIZE;          /* number of blocks per file */
+  uint64_t row = (uint64_t) cur->stripe * n;     /* number of blocks of a row of stripe units */
+
+  if (n == 1) return (nblk > UINT32_MAX) ? UINT32_MAX : (uint32_t) nblk;
+  if (nblk == 0) return 0;
+  nblk = ((nblk - 1) / cur->stripe) * row;       /* only whole stripe units are used, the last block holds the header */
+  if (nblk > UINT32_MAX) nblk = (UINT32_MAX / row) * row;
+
+  return (uint32_t) nblk;
+}
+
+/**
+ *  \brief Write or check the headers of the members of a striped storage device.
+ *
+ *  The header is stored in each Linux file in the block following the last block used by the stripe units. In format
+ *  mode, the headers are written; otherwise, they must all be present and agree with the stripe unit and the order of
+ *  the list of Linux files.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if some header is missing or the device was formatted with a different stripe unit, a
+ *          different number of members or the members in a different order
+ *  \return -\c ELIBBAD, if the supporting files are too small to hold a single row of stripe units
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+static int openMembers (void)
+{
+  SOMemberHeader hdr;
+  unsigned char blk[BLOCK_SIZE];
+  off_t pos = (off_t) BLOCK_SIZE * (cur->bnmax / cur->ndev); /* position of the header */
+  uint32_t id = 0;                               /* identification of the device */
+  int i;
+
+  if (cur->bnmax == 0) return -ELIBBAD;
+  if (cur->format)
+     id = (uint32_t) time (NULL) ^ ((uint32_t) getpid () << 16);
+  for (i = 0; i < cur->ndev; i++)
+  { if (lseek (cur->fd[i], pos, SEEK_SET) == -1) return -errno;
+    if (cur->format)
+       { memset (blk, 0, BLOCK_SIZE);
+         hdr.magic = MEMB_MAGIC;
+         hdr.id = id;
+         hdr.stripe = cur->stripe;
+         hdr.ndev = (uint32_t) cur->ndev;
+         hdr.index = (uint32_t) i;
+         memcpy (blk, &hdr, sizeof (SOMemberHeader));
+         if (write (cur->fd[i], blk, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
+       }
+       else { if (read (cur->fd[i], blk, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
+              memcpy (&hdr, blk, sizeof (SOMemberHeader));
+              if (i == 0) id = hdr.id;
+              if ((hdr.magic != MEMB_MAGIC) || (hdr.id != id) || (hdr.stripe != cur->stripe) ||
+                  (hdr.ndev != (uint32_t) cur->ndev) || (hdr.index != (uint32_t) i))
+                 return -EINVAL;
+            }
+  }
+
+  return 0;
+}
+
+/**
+ *  \brief Open the metadata tier.
+ *
+ *  The blocks of the metadata tier are stored at the same offsets they have in the device, so the Linux file is sparse:
+ *  its apparent size is the size of the whole device plus the tier map, although only the metadata blocks are
+ *  allocated. It must be copied with a tool that preserves holes.
+ *  The header of the tier map is validated and the map is loaded. In format mode, the header is written instead and
+ *  the metadata zone is set to be empty.
+ *
+ *  \param mname path to the Linux file that holds the metadata tier
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if, not in format mode, the header of the tier map is missing
+ *  \return -\c ELIBBAD, if the tier map refers to a device of a different size
+ *  \return -\c ENOMEM, if there is no memory for the tier map
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e open, \e fstat, \e ftruncate or \e lseek system calls
+ */
+
+static int openMetaTier (const char *mname)
+{
+  SOTierHeader hdr;
+  unsigned char blk[BLOCK_SIZE];
+  struct stat st;
+  off_t size;                                    /* minimum size of the Linux file */
+  int stat;
+
+  cur->tmapsize = (cur->bnmax / BLOCKS_PER_CLUSTER + 7) / 8;
+  size = (off_t) BLOCK_SIZE * (cur->bnmax + 1 + (cur->tmapsize + BLOCK_SIZE - 1) / BLOCK_SIZE);
+  if ((cur->tmap = calloc (cur->tmapsize + BLOCK_SIZE, 1)) == NULL)
+     return -ENOMEM;
+  if ((cur->mfd = open (mname, O_RDWR)) == -1)
+     { stat = -errno;
+       goto fail;
+     }
+  if (fstat (cur->mfd, &st) == -1)
+     { stat = -errno;
+       goto fail;
+     }
+  if ((st.st_size < size) && (ftruncate (cur->mfd, size) == -1))
+     { stat = -errno;
+       goto fail;
+     }
+
+  /* read the header and the map */
+
+  if (lseek (cur->mfd, (off_t) BLOCK_SIZE * cur->bnmax, SEEK_SET) == -1)
+     { stat = -errno;
+       goto fail;
+     }
+  if (read (cur->mfd, blk, BLOCK_SIZE) != BLOCK_SIZE)
+     { stat = -EIO;
+       goto fail;
+     }
+  memcpy (&hdr, blk, sizeof (SOTierHeader));
+  if (cur->format)
+     { cur->mzone = 0;                           /* new metadata tier */
+       if ((stat = storeTierMap (0)) != 0)
+          goto fail;
+       return 0;
+     }
+  if (hdr.magic != TMAP_MAGIC)
+     { stat = -EINVAL;
+       goto fail;
+     }
+  if ((hdr.bnmax != cur->bnmax) || (hdr.mzone > cur->bnmax))
+     { stat = -ELIBBAD;
+       goto fail;
+     }
+  cur->mzone = hdr.mzone;
+  if (read (cur->mfd, cur->tmap, cur->tmapsize) != cur->tmapsize)
+     { stat = -EIO;
+       goto fail;
+     }
+
+  return 0;
+
+fail:
+  if (cur->mfd != -1) close (cur->mfd);
+  cur->mfd = -1;
+  free (cur->tmap);
+  cur->tmap = NULL;
+  cur->tmapsize = 0;
+  return stat;
+}
+
+/**
+ *  \brief Store the header of the tier map and the block of the map where a given data cluster is described.
+ *
+ *  \param idx index of the data cluster in the data zone
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+static int storeTierMap (uint32_t idx)
+{
+  SOTierHeader hdr;
+  unsigned char blk[BLOCK_SIZE];
+  uint32_t nb = idx / (8 * BLOCK_SIZE);          /* block of the map */
+
+  memset (blk, 0, BLOCK_SIZE);
+  hdr.magic = TMAP_MAGIC;
+  hdr.bnmax = cur->bnmax;
+  hdr.mzone = cur->mzone;
+  memcpy (blk, &hdr, sizeof (SOTierHeader));
+  if (lseek (cur->mfd, (off_t) BLOCK_SIZE * cur->bnmax, SEEK_SET) == -1) return -errno;
+  if (write (cur->mfd, blk, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
+  if (nb * BLOCK_SIZE >= cur->tmapsize) return 0;
+  if (lseek (cur->mfd, (off_t) BLOCK_SIZE * (cur->bnmax + 1 + nb), SEEK_SET) == -1) return -errno;
+  if (write (cur->mfd, cur->tmap + nb * BLOCK_SIZE, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
+
+  return 0;
+}
+
+/**
+ *  \brief Check if a block belongs to the metadata tier.
+ *
+ *  \param n physical number of the block
+ *
+ *  \return \c true, if it does, \c false, otherwise
+ */
+
+static bool isMetaBlock (uint32_t n)
+{
+  uint32_t idx;
+
+  if (cur->mfd == -1) return false;
+  if (n < cur->mzone) return true;
+  idx = (n - cur->mzone) / BLOCKS_PER_CLUSTER;
+  return (cur->tmap[idx >> 3] & (1 << (idx & 7))) != 0;
+}
+
+/**
+ *  \brief Transfer a group of successive blocks between main memory and the storage device.
+ *
+ *  In tiered mode, the transfer is split in runs of blocks that belong to the same tier. Blocks of the metadata tier
+ *  are stored in the Linux file that holds it at the same position they have in the device.
+ *
+ *  \param n physical number of the first block
+ *  \param buf pointer to the buffer
+ *  \param nblk number of blocks to be transferred
+ *  \param write_op \c true, if it is a write operation, \c false, if it is a read operation
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+static int transfer (uint32_t n, void *buf, uint32_t nblk, bool write_op)
+{
+  unsigned char *p = buf;
+  uint32_t cnt;                                  /* number of blocks in the run */
+  bool meta;                                     /* tier of the run */
+  ssize_t len;
+  int stat;
+
+  if (cur->mfd == -1)
+     return stripeTransfer (n, buf, nblk, write_op);
+  while (nblk > 0)
+  { meta = isMetaBlock (n);
+    for (cnt = 1; (cnt < nblk) && (isMetaBlock (n + cnt) == meta); cnt++) ;
+    len = (ssize_t) BLOCK_SIZE * cnt;
+    if (!meta)
+       { if ((stat = stripeTransfer (n, p, cnt, write_op)) != 0)
+            return stat;
+       }
+       else { if (lseek (cur->mfd, (off_t) BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
+              if (write_op)
+                 { if (write (cur->mfd, p, len) != len) return -EIO; }
+                 else { if (read (cur->mfd, p, len) != len) return -EIO; }
+            }
+    n += cnt;
+    p += len;
+    nblk -= cnt;
+  }
+
+  return 0;
+}
+
+/**
+ *  \brief Transfer a group of successive blocks between main memory and the (possibly striped) data tier.
+ *
+ *  Block \e n lies in stripe unit <tt>s = n / stripe</tt>, which is stored in file <tt>s % ndev</tt> at block
+ *  <tt>(s / ndev) * stripe + n % stripe</tt>. The transfer is split at every stripe unit boundary.
+ *
+ *  \param n physical number of the first block
+ *  \param buf pointer to the buffer
+ *  \param nblk number of blocks to be transferred
+ *  \param write_op \c true, if it is a write operation, \c false, if it is a read operation
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+static int stripeTransfer (uint32_t n, void *buf, uint32_t nblk, bool write_op)
+{
+  unsigned char *p = buf;
+  uint32_t cnt;                                  /* number of blocks transferred in a single operation */
+  uint32_t s;                                    /* number of the stripe unit */
+  uint32_t blk;                                  /* block number within the selected file */
+  int d;                                         /* index of the selected file */
+  ssize_t len;
+
+  while (nblk > 0)
+  { if (cur->ndev == 1)
+       { d = 0;
+         blk = n;
+         cnt = nblk;
+       }
+       else { s = n / cur->stripe;
+              d = s % cur->ndev;
+              blk = (s / cur->ndev) * cur->stripe + n % cur->stripe;
+              cnt = cur->stripe - n % cur->stripe;
+              if (cnt > nblk) cnt = nblk;
+            }
+    if (lseek (cur->fd[d], (off_t) BLOCK_SIZE * blk, SEEK_SET) == -1) return -errno;
+    len = (ssize_t) BLOCK_SIZE * cnt;
+    if (write_op)
+       { if (write (cur->fd[d], p, len) != len) return -EIO; }
+       else { if (read (cur->fd[d], p, len) != len) return -EIO; }
+    n += cnt;
+    p += len;
+    nblk -= cnt;
+  }
+
+  return 0;
+}
+
+/**
+ *  \brief Get a stamp of the Linux files that simulate the storage device.
+ *
+ *  It changes whenever the contents of any of the files are changed, so it is used to validate the second-level cache.
+ *
+ *  \return <em>the stamp</em>
+ */
+
+static uint64_t devStamp (void)
+{
+  struct stat st;
+  uint64_t stamp = 0;
+  int i;
+
+  for (i = 0; i <= cur->ndev; i++)
+  { if (i == cur->ndev)                          /* the metadata tier is the last one */
+       { if (cur->mfd == -1) break;
+         if (fstat (cur->mfd, &st) == -1) return 0;
+       }
+       else if (fstat (cur->fd[i], &st) == -1) return 0;
+    stamp = stamp * 31 + (uint64_t) st.st_ino;
+    stamp = stamp * 31 + (uint64_t) st.st_size;
+    stamp = stamp * 31 + (uint64_t) st.st_mtim.tv_sec * 1000000000 + (uint64_t) st.st_mtim.tv_nsec;
+  }
+
+  return stamp;
+}
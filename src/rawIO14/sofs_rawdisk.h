@@ -3,14 +3,24 @@
  *
  *  \brief Access to raw disk blocks and clusters.
  *
- *  The storage device is presently a Linux file which simulates a magnetic disk.
+ *  The storage device is presently a Linux file which simulates a magnetic disk, or a list of Linux files over which
+ *  the array of blocks is striped (RAID-0), so that the aggregate bandwidth grows with the number of host disks.
+ *  Optionally, the metadata may be kept in a separate Linux file, placed on a faster host device (tiered mode).
  *  The following operations are defined:
+ *    \li set the stripe unit of a striped storage device
+ *    \li set the format mode of the storage device
+ *    \li get the number of blocks of the storage device without opening it
+ *    \li set the extent of the metadata zone of a tiered storage device
+ *    \li assign a data cluster of a tiered storage device to the metadata or the data tier
  *    \li open a communication channel with the storage device
  *    \li close the communication channel previously established
  *    \li read a block of data from the storage device
  *    \li write a block of data to the storage device
  *    \li read a cluster of data from the storage device
- *    \li write a cluster of data to the storage device.
+ *    \li write a cluster of data to the storage device
+ *    \li read a group of successive blocks of data from the storage device
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
  *
  *  \author Artur Carneiro Pereira - September 2007
  *  \author Miguel Oliveira e Silva - September 2009
@@ -25,19 +35,93 @@
 #define SOFS_RAWDISK_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "sofs_const.h"
+
+/** \brief Separator of the paths in a list of Linux files that simulate the storage device */
+#define DEV_SEP            ','
+/** \brief Separator of the path to the metadata tier from the list of Linux files that hold the data tier */
+#define TIER_SEP           '+'
+/** \brief Maximum number of Linux files that simulate the storage device */
+#define MAX_DEVICES        16
+/** \brief Default stripe unit (in number of blocks) */
+#define DEF_STRIPE_UNIT    (4 * BLOCKS_PER_CLUSTER)
+
+/**
+ *  \brief Set the stripe unit of a striped storage device.
+ *
+ *  The array of blocks of a storage device made of several Linux files is split into stripe units, which are
+ *  assigned to the files in a round-robin fashion.
+ *  The stripe unit must be set before the device is opened and must be the same every time a given device is used.
+ *  It has no effect on a storage device made of a single Linux file.
+ *
+ *  \param su stripe unit (in number of blocks)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the stripe unit is zero
+ *  \return -\c EBUSY, if the device is already opened
+ */
+
+extern int soSetStripeUnit (uint32_t su);
+
+/**
+ *  \brief Set the format mode of the storage device.
+ *
+ *  The layout of a striped storage device and the tier map of a tiered one are recorded in headers, which are checked
+ *  every time the device is opened. In format mode, the headers are written instead, so the device is taken as new.
+ *  It must be set before the device is opened and is meant to be used only when the device is formatted.
+ *
+ *  \param format \c true, if the device is going to be formatted, \c false, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBUSY, if the device is already opened
+ */
+
+extern int soSetFormatMode (bool format);
+
+/**
+ *  \brief Get the number of blocks of the storage device.
+ *
+ *  The Linux files that simulate the storage device are checked for conformity, but they are not opened.
+ *  In tiered mode, the file that holds the metadata tier is ignored.
+ *
+ *  \param devname list of paths to the Linux files that simulate the storage device, separated by \c DEV_SEP and
+ *                 optionally preceded by the path to the metadata tier and \c TIER_SEP
+ *  \param p_bnmax pointer to a location where the number of blocks of the device is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL, or the list of files is malformed
+ *  \return -\c ELIBBAD, if the size of some supporting file is invalid
+ *  \return -<em>other specific error</em> issued by \e stat system call
+ */
+
+extern int soGetDeviceSize (const char *devname, uint32_t *p_bnmax);
 
 /**
  *  \brief Open the storage device.
  *
  *  A communication channel is established with the storage device.
  *  It is supposed that no communication channel was previously established.
- *  The Linux file that simulates the storage device must exist and have a size multiple of the block size.
+ *  The Linux files that simulate the storage device must exist and have a size multiple of the block size.
+ *  When several files are given, the array of blocks is striped over them and each file holds as many whole stripe
+ *  units as fit in the smallest one, keeping a spare block. The block that follows the stripe units in each file holds
+ *  a header with the stripe unit, the number of files and the position of the file in the list; it is written in format
+ *  mode and must match otherwise.
+ *  In tiered mode, the metadata blocks are stored in their own Linux file at the same offsets they have in the device,
+ *  followed by the tier map, so the file is extended, if needed, to the size of the whole device plus the map. It is a
+ *  sparse file: only the metadata blocks are allocated, so a small and fast file system is enough, but it must be
+ *  copied with a tool that preserves holes. The header of the tier map is written in format mode and must be present
+ *  otherwise.
  *
- *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param devname list of absolute paths to the Linux files that simulate the storage device, separated by
+ *                 \c DEV_SEP and optionally preceded by the absolute path to the metadata tier and \c TIER_SEP
  *  \param p_bnmax pointer to a location where the number of blocks of the device is to be stored
  *
  *  \return <tt>0 (zero)</tt>, on success
- *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL
+ *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL, the list of files is malformed, or, not in format
+ *          mode, the headers of a striped device are missing or do not match the stripe unit and the list of files,
+ *          or the header of the tier map is missing
  *  \return -\c EBUSY, if the device is already opened
  *  \return -\c ELIBBAD, if the supporting file size is invalid
  *  \return -<em>other specific error</em> issued by \e lseek system call
@@ -45,6 +129,43 @@
 
 extern int soOpenDevice (const char *devname, uint32_t *p_bnmax);
 
+/**
+ *  \brief Set the extent of the metadata zone of a tiered storage device.
+ *
+ *  The blocks <tt>[0, nblk[</tt> (the superblock and the table of inodes) are placed in the metadata tier. Every data
+ *  cluster is assigned back to the data tier.
+ *  It is meant to be used when the device is formatted and has no effect if the device is not in tiered mode.
+ *
+ *  \param nblk number of blocks at the beginning of the device that belong to the metadata tier
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if \e nblk is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSetMetaZone (uint32_t nblk);
+
+/**
+ *  \brief Assign a data cluster of a tiered storage device to the metadata or the data tier.
+ *
+ *  Clusters of directories should be placed in the metadata tier, clusters of other files in the data tier.
+ *  If the tier changes, the cluster contents are copied to the new one.
+ *  It has no effect if the device is not in tiered mode.
+ *
+ *  \param n physical number of the first block of the data cluster
+ *  \param meta \c true, if the cluster is to be placed in the metadata tier, \c false, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or it is not the first block of a data cluster
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSetClusterTier (uint32_t n, bool meta);
+
 /**
  *  \brief Close the storage device.
  *
@@ -132,4 +253,44 @@ extern int soReadRawCluster (uint32_t n, void *buf);
 
 extern int soWriteRawCluster (uint32_t n, void *buf);
 
+/**
+ *  \brief Read a group of successive blocks of data from the storage device.
+ *
+ *  The blocks are read with as few transfers as the layout of the device allows, so that prefetching a run of blocks
+ *  costs much less than reading them one by one.
+ *  Both the physical number of the first block of the group to be read, the number of blocks and a pointer to a
+ *  previously allocated buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the group to be read from
+ *  \param cnt number of blocks of the group
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block numbers</em> are out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soReadRawBlocks (uint32_t n, uint32_t cnt, void *buf);
+
+/**
+ *  \brief Allocate the state of the access to the storage device of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the storage device is not opened.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewRawDiskState (void);
+
+/**
+ *  \brief Bind the state of the access to the storage device of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewRawDiskState, or \c NULL, for the default context
+ */
+
+extern void soBindRawDiskState (void *p_state);
+
 #endif /* SOFS_RAWDISK_H_ */
@@ -0,0 +1,201 @@
+/**
+ *  \file sofs_accesscache.c (implementation file)
+ *
+ *  \brief Cache of access decisions.
+ *
+ *  The cache is direct-mapped on the inode number: an inode accessed with different credentials keeps only the
+ *  decision for the last ones.
+ *
+ *  The following operations are defined:
+ *    \li get the set of operations the calling process is allowed to perform on an inode
+ *    \li look up the set of operations the calling process is allowed to perform on an inode
+ *    \li invalidate the entries of the inodes of a block of the table of inodes which were changed
+ *    \li invalidate the entry of an inode
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "sofs_probe.h"
+#include "sofs_inode.h"
+#include "sofs_ifuncs_2.h"
+#include "sofs_accesscache.h"
+
+/**
+ *  \brief Definition of an entry of the cache of access decisions.
+ */
+
+typedef struct soAccessEntry
+{
+   /** \brief entry state: \c true, if it holds a decision */
+    bool valid;
+   /** \brief number of the inode */
+    uint32_t nInode;
+   /** \brief user ID of the process */
+    uid_t uid;
+   /** \brief group ID of the process */
+    gid_t gid;
+   /** \brief inode mode the decision was taken upon */
+    uint16_t mode;
+   /** \brief user ID of the file owner the decision was taken upon */
+    uint32_t owner;
+   /** \brief group ID of the file owner the decision was taken upon */
+    uint32_t group;
+   /** \brief set of operations the process is allowed to perform */
+    uint32_t mask;
+} SOAccessEntry;
+
+/**
+ *  \brief Definition of the state of the cache of access decisions.
+ */
+
+typedef struct soAccessCacheState
+{
+   /** \brief cache of access decisions */
+    SOAccessEntry entry[ACCESS_CACHE_SIZE];
+} SOAccessCacheState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOAccessCacheState defState = { 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOAccessCacheState *cur = &defState;
+
+/**
+ *  \brief Get the set of operations the calling process is allowed to perform on an inode.
+ *
+ *  The set is taken from the cache, if it is there; otherwise, it is computed from the supplied inode data, which are
+ *  supposed to be up to date and consistent, and stored in the cache.
+ *
+ *  When the calling process is <em>root</em>, all operations are allowed.
+ *
+ *  \param nInode number of the inode
+ *  \param p_inode pointer to the inode data
+ *
+ *  \return <em>a bitwise combination of R, W, and X</em>
+ */
+
+uint32_t soAccessMask (uint32_t nInode, SOInode *p_inode)
+{
+  soColorProbe (728, "07;31", "soAccessMask (%"PRIu32", %p)\n", nInode, p_inode);
+
+  SOAccessEntry *p = &cur->entry[nInode % ACCESS_CACHE_SIZE];
+  uint32_t mask;
+
+  if (soLookupAccessMask (nInode, &mask) == 0) return mask;
+
+  /* the permissions of owner, group and other are bits 8-6, 5-3 and 2-0 of the mode */
+
+  p->uid = getuid ();
+  p->gid = getgid ();
+  if (p->uid == 0)
+     p->mask = R | W | X;
+     else if (p->uid == p_inode->owner)
+             p->mask = (p_inode->mode >> 6) & 0x7;
+     else if (p->uid == p_inode->group)
+             p->mask = (p_inode->mode >> 3) & 0x7;
+     else p->mask = p_inode->mode & 0x7;
+  p->nInode = nInode;
+  p->mode = p_inode->mode;
+  p->owner = p_inode->owner;
+  p->group = p_inode->group;
+  p->valid = true;
+
+  return p->mask;
+}
+
+/**
+ *  \brief Look up the set of operations the calling process is allowed to perform on an inode.
+ *
+ *  \param nInode number of the inode
+ *  \param p_mask pointer to a location where the bitwise combination of R, W, and X is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it was found
+ *  \return -\c ENOENT, if it was not found
+ */
+
+int soLookupAccessMask (uint32_t nInode, uint32_t *p_mask)
+{
+  SOAccessEntry *p = &cur->entry[nInode % ACCESS_CACHE_SIZE];
+
+  if (!p->valid || (p->nInode != nInode) || (p->uid != getuid ()) || (p->gid != getgid ()))
+     return -ENOENT;
+  *p_mask = p->mask;
+
+  return 0;
+}
+
+/**
+ *  \brief Invalidate the entries of the inodes of a block of the table of inodes which were changed.
+ *
+ *  It should be called whenever a block of the table of inodes is about to be stored.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+void soCheckAccessBlock (SOInode *p_blk, uint32_t nBlk)
+{
+  SOAccessEntry *p;
+  uint32_t i;
+
+  for (i = 0; i < IPB; i++)
+  { p = &cur->entry[(nBlk * IPB + i) % ACCESS_CACHE_SIZE];
+    if (p->valid && (p->nInode == nBlk * IPB + i) &&
+        ((p->mode != p_blk[i].mode) || (p->owner != p_blk[i].owner) || (p->group != p_blk[i].group)))
+       p->valid = false;
+  }
+}
+
+/**
+ *  \brief Invalidate the entry of an inode.
+ *
+ *  \param nInode number of the inode
+ */
+
+void soInvalidateAccess (uint32_t nInode)
+{
+  soColorProbe (729, "07;31", "soInvalidateAccess (%"PRIu32")\n", nInode);
+
+  SOAccessEntry *p = &cur->entry[nInode % ACCESS_CACHE_SIZE];
+
+  if (p->nInode == nInode) p->valid = false;
+}
+
+/**
+ *  \brief Allocate the state of the cache of access decisions of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewAccessCacheState (void)
+{
+  SOAccessCacheState *p;
+
+  if ((p = calloc (1, sizeof (SOAccessCacheState))) == NULL) return NULL;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the cache of access decisions of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewAccessCacheState, or \c NULL, for the default context
+ */
+
+void soBindAccessCacheState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOAccessCacheState *) p_state;
+}
@@ -0,0 +1,106 @@
+/**
+ *  \file sofs_accesscache.h (interface file)
+ *
+ *  \brief Cache of access decisions.
+ *
+ *  Checking the access rights of the calling process to an inode requires loading the block of the table of inodes
+ *  where it is stored and checking its consistency, which was usually done just before, when the inode was read.
+ *  So, for each inode, the set of operations the calling process is allowed to perform is kept, keyed by the process
+ *  credentials (user and group IDs).
+ *
+ *  The cache is direct-mapped on the inode number. Each entry keeps a copy of the inode fields the decision depends on
+ *  (mode, owner and group): whenever a block of the table of inodes is stored, the entries of the inodes whose fields
+ *  were changed, namely by a \e chmod or \e chown operation, or because the inode was freed, are invalidated. Since the
+ *  cache of inodes writes them back later on, \e soWriteInode and \e soFreeInode invalidate the entry of the inode
+ *  at once, so a hit always refers to an inode in use with the same fields.
+ *
+ *  The following operations are defined:
+ *    \li get the set of operations the calling process is allowed to perform on an inode
+ *    \li look up the set of operations the calling process is allowed to perform on an inode
+ *    \li invalidate the entries of the inodes of a block of the table of inodes which were changed
+ *    \li invalidate the entry of an inode
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_ACCESSCACHE_H_
+#define SOFS_ACCESSCACHE_H_
+
+#include <stdint.h>
+
+#include "sofs_inode.h"
+
+/** \brief Number of entries of the cache of access decisions */
+#define ACCESS_CACHE_SIZE  256
+
+/**
+ *  \brief Get the set of operations the calling process is allowed to perform on an inode.
+ *
+ *  The set is taken from the cache, if it is there; otherwise, it is computed from the supplied inode data, which are
+ *  supposed to be up to date and consistent, and stored in the cache.
+ *
+ *  When the calling process is <em>root</em>, all operations are allowed.
+ *
+ *  \param nInode number of the inode
+ *  \param p_inode pointer to the inode data
+ *
+ *  \return <em>a bitwise combination of R, W, and X</em>
+ */
+
+extern uint32_t soAccessMask (uint32_t nInode, SOInode *p_inode);
+
+/**
+ *  \brief Look up the set of operations the calling process is allowed to perform on an inode.
+ *
+ *  \param nInode number of the inode
+ *  \param p_mask pointer to a location where the bitwise combination of R, W, and X is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it was found
+ *  \return -\c ENOENT, if it was not found
+ */
+
+extern int soLookupAccessMask (uint32_t nInode, uint32_t *p_mask);
+
+/**
+ *  \brief Invalidate the entries of the inodes of a block of the table of inodes which were changed.
+ *
+ *  It should be called whenever a block of the table of inodes is about to be stored.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+extern void soCheckAccessBlock (SOInode *p_blk, uint32_t nBlk);
+
+/**
+ *  \brief Invalidate the entry of an inode.
+ *
+ *  \param nInode number of the inode
+ */
+
+extern void soInvalidateAccess (uint32_t nInode);
+
+/**
+ *  \brief Allocate the state of the cache of access decisions of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewAccessCacheState (void);
+
+/**
+ *  \brief Bind the state of the cache of access decisions of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewAccessCacheState, or \c NULL, for the default context
+ */
+
+extern void soBindAccessCacheState (void *p_state);
+
+#endif /* SOFS_ACCESSCACHE_H_ */
@@ -0,0 +1,231 @@
+/**
+ *  \file sofs_atime.c (implementation file)
+ *
+ *  \brief Policies for updating the time of last file access.
+ *
+ *  Under \c ATIME_LAZY, the pending updates are kept in a small table, holding the inode number and the new time of
+ *  last file access. They are stored together with any other change to the same block of the table of inodes, or
+ *  upon synchronization. A pending update never sets the time of last file access backwards.
+ *
+ *  The following operations are defined:
+ *    \li select the policy
+ *    \li get the selected policy
+ *    \li update the time of last file access of an inode upon reading
+ *    \li apply the pending updates to a block of the table of inodes
+ *    \li store all the pending updates
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <time.h>
+
+#include "sofs_probe.h"
+#include "sofs_inode.h"
+#include "sofs_basicoper.h"
+#include "sofs_atime.h"
+
+/**
+ *  \brief Definition of a pending update.
+ */
+
+typedef struct soAtimePending
+{
+   /** \brief number of the inode */
+    uint32_t nInode;
+   /** \brief new time of last file access */
+    uint32_t aTime;
+} SOAtimePending;
+
+/**
+ *  \brief Definition of the state of the deferred updates of the time of last access.
+ */
+
+typedef struct soAtimeState
+{
+   /** \brief selected policy */
+    uint32_t atimePolicy;
+   /** \brief table of pending updates */
+    SOAtimePending pending[ATIME_MAX_PENDING];
+   /** \brief number of pending updates */
+    uint32_t npending;
+} SOAtimeState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOAtimeState defState = { .atimePolicy = ATIME_RELATIME, .npending = 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOAtimeState *cur = &defState;
+
+/**
+ *  \brief Select the policy for updating the time of last file access.
+ *
+ *  The pending updates, if any, should be stored before the policy is changed.
+ *
+ *  \param policy the policy (\c ATIME_STRICT, \c ATIME_RELATIME, \c ATIME_NOATIME or \c ATIME_LAZY)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the policy is invalid
+ */
+
+int soSetAtimePolicy (uint32_t policy)
+{
+  soColorProbe (725, "07;31", "soSetAtimePolicy (%"PRIu32")\n", policy);
+
+  if (policy > ATIME_LAZY) return -EINVAL;       /* checking for policy */
+  cur->atimePolicy = policy;
+
+  return 0;
+}
+
+/**
+ *  \brief Get the policy for updating the time of last file access.
+ *
+ *  \return <em>the selected policy</em>
+ */
+
+uint32_t soGetAtimePolicy (void)
+{
+  return cur->atimePolicy;
+}
+
+/**
+ *  \brief Update the time of last file access of an inode upon reading.
+ *
+ *  The inode is supposed to be in use and to be resident in the block of the table of inodes presently held in
+ *  internal storage. Under \c ATIME_LAZY, the update is recorded as pending; if there is no room for it, it is handled
+ *  as under \c ATIME_STRICT.
+ *
+ *  \param p_inode pointer to the inode, within the block of the table of inodes held in internal storage
+ *  \param nInode number of the inode
+ *  \param p_copy pointer to a copy of the inode that is also to be updated (\c NULL, if there is none)
+ *
+ *  \return \c true, if the block of the table of inodes has to be stored, \c false, otherwise
+ */
+
+bool soTouchAtime (SOInode *p_inode, uint32_t nInode, SOInode *p_copy)
+{
+  soColorProbe (726, "07;31", "soTouchAtime (%p, %"PRIu32", %p)\n", p_inode, nInode, p_copy);
+
+  uint32_t now = time (NULL);
+  uint32_t i;
+
+  switch (cur->atimePolicy)
+  { case ATIME_NOATIME:
+         return false;
+    case ATIME_RELATIME:
+         if ((p_inode->vD1.aTime > p_inode->vD2.mTime) &&
+             ((now - p_inode->vD1.aTime) < ATIME_RELATIME_PERIOD))
+            return false;
+         break;
+    case ATIME_LAZY:
+         for (i = 0; (i < cur->npending) && (cur->pending[i].nInode != nInode); i++) ;
+         if ((i < cur->npending) || (cur->npending < ATIME_MAX_PENDING))
+            { cur->pending[i].nInode = nInode;
+              cur->pending[i].aTime = now;
+              if (i == cur->npending) cur->npending += 1;
+              if (p_copy != NULL) p_copy->vD1.aTime = now;
+              return false;
+            }
+         break;                                  /* there is no room for it */
+  }
+
+  p_inode->vD1.aTime = now;
+  if (p_copy != NULL) p_copy->vD1.aTime = now;
+
+  return true;
+}
+
+/**
+ *  \brief Apply the pending updates to a block of the table of inodes.
+ *
+ *  It should be called whenever a block of the table of inodes is about to be stored, so that the pending updates are
+ *  stored with it at no cost. The updates to inodes which are no longer in use are discarded.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes held in internal storage
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+void soApplyAtime (SOInode *p_blk, uint32_t nBlk)
+{
+  uint32_t i, offset;
+
+  for (i = 0; i < cur->npending; )
+    if ((cur->pending[i].nInode / IPB) == nBlk)
+       { offset = cur->pending[i].nInode % IPB;
+         if (((p_blk[offset].mode & INODE_FREE) == 0) && (p_blk[offset].vD1.aTime < cur->pending[i].aTime))
+            p_blk[offset].vD1.aTime = cur->pending[i].aTime;
+         cur->pending[i] = cur->pending[--cur->npending]; /* the entry is removed */
+       }
+       else i++;
+}
+
+/**
+ *  \brief Store all the pending updates.
+ *
+ *  The updates are grouped by block of the table of inodes, so that each block is stored only once.
+ *  The updates to inodes which are no longer in use are discarded.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSyncAtime (void)
+{
+  soColorProbe (727, "07;31", "soSyncAtime ()\n");
+
+  uint32_t nBlk, offset;
+  int stat;
+
+  /* the block held in internal storage applies all its pending updates upon being stored */
+
+  while (cur->npending > 0)
+  { if ((stat = soConvertRefInT (cur->pending[0].nInode, &nBlk, &offset)) != 0)
+       return stat;
+    if ((stat = soLoadBlockInT (nBlk)) != 0)
+       return stat;
+    if ((stat = soStoreBlockInT ()) != 0)
+       return stat;
+  }
+
+  return 0;
+}
+
+/**
+ *  \brief Allocate the state of the deferred access times of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the policy is relatime and there are no pending updates.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewAtimeState (void)
+{
+  SOAtimeState *p;
+
+  if ((p = calloc (1, sizeof (SOAtimeState))) == NULL) return NULL;
+  p->atimePolicy = ATIME_RELATIME;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the deferred access times of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewAtimeState, or \c NULL, for the default context
+ */
+
+void soBindAtimeState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOAtimeState *) p_state;
+}
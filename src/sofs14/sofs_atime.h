@@ -0,0 +1,135 @@
+/**
+ *  \file sofs_atime.h (interface file)
+ *
+ *  \brief Policies for updating the time of last file access.
+ *
+ *  Updating the <em>time of last file access</em> of an inode upon every read dirties the block of the table of inodes
+ *  where it is stored, turning a read-only workload into a write workload. So, one of the following policies may be
+ *  selected upon mounting:
+ *    \li \c ATIME_STRICT - the time of last file access is updated and stored upon every read
+ *    \li \c ATIME_RELATIME - it is updated and stored only if it is not later than the time of last file modification,
+ *        or if it is older than \c ATIME_RELATIME_PERIOD seconds
+ *    \li \c ATIME_NOATIME - it is never updated upon reading
+ *    \li \c ATIME_LAZY - it is updated in main memory and only stored together with some other change to the same
+ *        block of the table of inodes, or upon synchronization
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  The following operations are defined:
+ *    \li select the policy
+ *    \li get the selected policy
+ *    \li update the time of last file access of an inode upon reading
+ *    \li apply the pending updates to a block of the table of inodes
+ *    \li store all the pending updates.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_ATIME_H_
+#define SOFS_ATIME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sofs_inode.h"
+
+/** \brief the time of last file access is updated and stored upon every read */
+#define ATIME_STRICT            0
+/** \brief the time of last file access is updated and stored only if it is not recent */
+#define ATIME_RELATIME          1
+/** \brief the time of last file access is never updated upon reading */
+#define ATIME_NOATIME           2
+/** \brief the time of last file access is updated in main memory and stored later on */
+#define ATIME_LAZY              3
+
+/** \brief period after which the time of last file access is always updated under \c ATIME_RELATIME (in seconds) */
+#define ATIME_RELATIME_PERIOD   (24 * 60 * 60)
+/** \brief maximum number of pending updates under \c ATIME_LAZY */
+#define ATIME_MAX_PENDING       256
+
+/**
+ *  \brief Select the policy for updating the time of last file access.
+ *
+ *  The pending updates, if any, should be stored before the policy is changed.
+ *
+ *  \param policy the policy (\c ATIME_STRICT, \c ATIME_RELATIME, \c ATIME_NOATIME or \c ATIME_LAZY)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the policy is invalid
+ */
+
+extern int soSetAtimePolicy (uint32_t policy);
+
+/**
+ *  \brief Get the policy for updating the time of last file access.
+ *
+ *  \return <em>the selected policy</em>
+ */
+
+extern uint32_t soGetAtimePolicy (void);
+
+/**
+ *  \brief Update the time of last file access of an inode upon reading.
+ *
+ *  The inode is supposed to be in use and to be resident in the block of the table of inodes presently held in
+ *  internal storage. Under \c ATIME_LAZY, the update is recorded as pending; if there is no room for it, it is handled
+ *  as under \c ATIME_STRICT.
+ *
+ *  \param p_inode pointer to the inode, within the block of the table of inodes held in internal storage
+ *  \param nInode number of the inode
+ *  \param p_copy pointer to a copy of the inode that is also to be updated (\c NULL, if there is none)
+ *
+ *  \return \c true, if the block of the table of inodes has to be stored, \c false, otherwise
+ */
+
+extern bool soTouchAtime (SOInode *p_inode, uint32_t nInode, SOInode *p_copy);
+
+/**
+ *  \brief Apply the pending updates to a block of the table of inodes.
+ *
+ *  It should be called whenever a block of the table of inodes is about to be stored, so that the pending updates are
+ *  stored with it at no cost. The updates to inodes which are no longer in use are discarded.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes held in internal storage
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+extern void soApplyAtime (SOInode *p_blk, uint32_t nBlk);
+
+/**
+ *  \brief Store all the pending updates.
+ *
+ *  The updates are grouped by block of the table of inodes, so that each block is stored only once.
+ *  The updates to inodes which are no longer in use are discarded.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSyncAtime (void);
+
+/**
+ *  \brief Allocate the state of the deferred access times of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the policy is relatime and there are no pending updates.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewAtimeState (void);
+
+/**
+ *  \brief Bind the state of the deferred access times of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewAtimeState, or \c NULL, for the default context
+ */
+
+extern void soBindAtimeState (void *p_state);
+
+#endif /* SOFS_ATIME_H_ */
@@ -9,6 +9,8 @@
  *      \li load the contents of the superblock into internal storage
  *      \li get a pointer to the contents of the superblock
  *      \li store the contents of the superblock resident in internal storage to the storage device
+ *      \li begin a metadata transaction
+ *      \li end a metadata transaction
  *      \li convert the inode number, which translates to an entry of the inode table, into the logical number (the
  *          ordinal, starting at zero, of the succession blocks that the table of inodes comprises) and the offset of
  *          the block where it is stored
@@ -27,67 +29,94 @@
  *          storage
  *      \li get a pointer to the contents of a specific cluster of the table of direct references to data clusters
  *      \li store the contents of a specific cluster of the table of direct references to data clusters resident in
- *          internal storage to the storage device.
+ *          internal storage to the storage device
+ *      \li allocate the state of a new file system context
+ *      \li free the state of a file system context
+ *      \li bind the state of a file system context to the calling thread.
  *
  *  \author António Rui Borges - August 2010 - August 2011, September 2014
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <errno.h>
 #include <inttypes.h>
 
 #include "sofs_probe.h"
 #include "sofs_const.h"
 #include "sofs_buffercache.h"
+#include "sofs_arena.h"
 #include "sofs_superblock.h"
 #include "sofs_inode.h"
 #include "sofs_datacluster.h"
 #include "sofs_direntry.h"
+#include "sofs_atime.h"
+#include "sofs_accesscache.h"
+#include "sofs_inodecache.h"
+#include "sofs_statfs.h"
+
+/**
+ *  \brief Definition of the state of the internal storage.
+ */
+
+typedef struct soBasicOperState
+{
+   /** \brief storage area for superblock */
+    SOSuperBlock sb;
+   /** \brief area validation: -1 - an error has occurred while reading or writing superblock data
+    *                           0 - superblock data has not been read yet
+    *                           1 - superblock data has already been read
+    */
+    int sbLoaded;
+   /** \brief status of reading or writing superblock data */
+    int sbError;
+   /** \brief nesting depth of metadata transactions (0, if none is going on) */
+    uint32_t transDepth;
+   /** \brief superblock state within a metadata transaction: \c true, if it was changed and not yet stored */
+    bool sbChanged;
+   /** \brief storage area for one block of the table of inodes */
+    SOInode inode[IPB];
+   /** \brief validation area: -2 - an error occurred while reading or writing a data block
+    *                          -1 - no block of the table of inodes has been read yet
+    *                           * - logical block number of table of inodes that has been read
+    */
+    int nBlkInTLoaded;
+   /** \brief status of reading or writing a data block of the table of inodes */
+    int intError;
+   /** \brief storage area for a cluster of single indirect references to data clusters (carved from the arena of cache
+    *         memory when it is first needed) */
+    SODataClust *sngIndRefClust;
+   /** \brief validation area: -2 - an error occurred while reading or writing a data cluster
+    *                          -1 - no cluster of single indirect references to data clusters has been read yet
+    *                           * - physical cluster number of single indirect references to data clusters that has
+    *                               been read
+    */
+    int nClustSIRef;
+   /** \brief status of reading or writing a cluster of single indirect references to data clusters */
+    int sircError;
+   /** \brief storage area for a cluster of direct references to data clusters (carved from the arena of cache memory
+    *         when it is first needed) */
+    SODataClust *dirRefClust;
+   /** \brief validation area: -2 - an error occurred while reading or writing a data cluster
+    *                          -1 - no cluster of direct references to data clusters has been read yet
+    *                           * - physical cluster number of direct references to data clusters that has been read
+    */
+    int nClustDRef;
+   /** \brief status of reading or writing a cluster of direct references to data clusters */
+    int drcError;
+} SOBasicOperState;
 
 /*
  *  Internal data structure
  */
 
-/** \brief Storage area for superblock */
-static SOSuperBlock sb;
-/** \brief area validation: -1 - an error has occurred while reading or writing superblock data
- *                           0 - superblock data has not been read yet
- *                           1 - superblock data has already been read
- */
-static int sbLoaded = 0;
-/** \brief status of reading or writing superblock data */
-static int sbError = 0;
-
-/** \brief storage area for one block of the table of inodes */
-static SOInode inode[IPB];
-/** \brief validation area: -2 - an error occurred while reading or writing a data block
- *                          -1 - no block of the table of inodes has been read yet
- *                           * - logical block number of table of inodes that has been read
- */
-static int nBlkInTLoaded = -1;
-/** \brief status of reading or writing a data block of the table of inodes */
-static int intError = 0;
-
-/** \brief storage area for a cluster of single indirect references to data clusters */
-static SODataClust sngIndRefClust;
-/** \brief validation area: -2 - an error occurred while reading or writing a data cluster
- *                          -1 - no cluster of single indirect references to data clusters has been read yet
- *                           * - physical cluster number of single indirect references to data clusters that has been
- *                               read
- */
-static int nClustSIRef = 0;
-/** \brief status of reading or writing a cluster of single indirect references to data clusters */
-static int sircError = 0;
-
-/** \brief storage area for a cluster of direct references to data clusters */
-static SODataClust dirRefClust;
-/** \brief validation area: -2 - an error occurred while reading or writing a data cluster
- *                          -1 - no cluster of direct references to data clusters has been read yet
- *                           * - physical cluster number of direct references to data clusters that has been read
- */
-static int nClustDRef = 0;
-/** \brief status of reading or writing a cluster of direct references to data clusters */
-static int drcError = 0;
+/** \brief State of the default file system context */
+static SOBasicOperState defState = { .sbLoaded = 0, .sbError = 0, .transDepth = 0, .sbChanged = false,
+                                     .nBlkInTLoaded = -1, .intError = 0, .sngIndRefClust = NULL, .nClustSIRef = 0,
+                                     .sircError = 0, .dirRefClust = NULL, .nClustDRef = 0, .drcError = 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOBasicOperState *cur = &defState;
 
 /**
  *  \brief Load the contents of the superblock into internal storage.
@@ -108,13 +137,15 @@ int soLoadSuperBlock (void)
 
   int stat;                                      /* status of operation */
 
-  if (sbError != 0) return sbError;              /* a previous error has occurred */
-  if (sbLoaded == 1) return 0;                   /* superblock has already been read */
-  stat = soReadCacheBlock (0, &sb);
+  if (cur->sbError != 0) return cur->sbError;    /* a previous error has occurred */
+  if (cur->sbLoaded == 1) return 0;              /* superblock has already been read */
+  stat = soReadCacheBlock (0, &cur->sb);
   if (stat == 0)
-     sbLoaded = 1;                               /* operation carried out with success */
-     else { sbLoaded = -1;
-            sbError = stat;                      /* an error has occurred while reading */
+     { cur->sbLoaded = 1;                        /* operation carried out with success */
+       soTakeStatFS (&cur->sb);
+     }
+     else { cur->sbLoaded = -1;
+            cur->sbError = stat;                 /* an error has occurred while reading */
           }
 
   return stat;
@@ -134,8 +165,8 @@ SOSuperBlock *soGetSuperBlock (void)
 {
   soColorProbe (712, "07;31", "soGetSuperBlock ()\n");
 
-  if (sbLoaded == 1)
-     return &sb;
+  if (cur->sbLoaded == 1)
+     return &cur->sb;
      else return NULL;
 }
 
@@ -143,6 +174,7 @@ SOSuperBlock *soGetSuperBlock (void)
  *  \brief Store the contents of the superblock resident in internal storage to the storage device.
  *
  *  Any type of previous / current error on loading / storing the superblock data will disable the operation.
+ *  Within a metadata transaction, the superblock is only marked as changed.
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EBADF, if the device is not already opened
@@ -158,21 +190,72 @@ int soStoreSuperBlock (void)
 
   int stat;                                      /* status of operation */
 
-  if (sbError != 0) return sbError;              /* a previous error has occurred */
-  if (sbLoaded == 0)
-     { sbLoaded = -1;
-       sbError = -ELIBBAD;                       /* superblock has not been read yet */
-       return sbError;
+  if (cur->sbError != 0) return cur->sbError;    /* a previous error has occurred */
+  if (cur->sbLoaded == 0)
+     { cur->sbLoaded = -1;
+       cur->sbError = -ELIBBAD;                  /* superblock has not been read yet */
+       return cur->sbError;
      }
-  stat = soWriteCacheBlock (0, &sb);
+  if (cur->transDepth != 0)                      /* it is stored when the metadata transaction ends */
+     { cur->sbChanged = true;
+       soTakeStatFS (&cur->sb);
+       return 0;
+     }
+  stat = soWriteCacheBlock (0, &cur->sb);
   if (stat != 0)
-     { sbLoaded = -1;
-       sbError = stat;                           /* an error has occurred while writing */
+     { cur->sbLoaded = -1;
+       cur->sbError = stat;                      /* an error has occurred while writing */
      }
+     else soTakeStatFS (&cur->sb);               /* the counters may have been changed */
 
   return stat;
 }
 
+/**
+ *  \brief Begin a metadata transaction.
+ *
+ *  Until the transaction ends, storing the superblock only marks it as changed: it is stored once, when the
+ *  transaction ends. The superblock is never read from the storage device but through the internal storage, so the
+ *  operations which take place meanwhile see it as it is. Transactions may be nested: only the outermost one counts.
+ *
+ *  It defers the stores of the superblock and nothing else: it is neither atomic nor isolated. The blocks of the table
+ *  of inodes, the directories and the clusters of references are written, through the buffercache, as each operation
+ *  goes, since the consistency checks of the allocation functions read them from there; so, an operation which fails
+ *  within a transaction does not undo the ones which took place before it, and a crash before the transaction ends
+ *  leaves the counters and the lists of free inodes and data clusters in the superblock behind those blocks.
+ */
+
+void soBeginMetaTransaction (void)
+{
+  soColorProbe (760, "07;31", "soBeginMetaTransaction ()\n");
+
+  cur->transDepth += 1;
+}
+
+/**
+ *  \brief End a metadata transaction.
+ *
+ *  The superblock is stored, if it was changed since the outermost transaction began. Nothing else is stored here:
+ *  the other metadata was stored as it was changed.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if no transaction was begun
+ *  \return -<em>other specific error</em> issued by \e soStoreSuperBlock
+ */
+
+int soEndMetaTransaction (void)
+{
+  soColorProbe (761, "07;31", "soEndMetaTransaction ()\n");
+
+  if (cur->transDepth == 0) return -EINVAL;
+
+  cur->transDepth -= 1;
+  if ((cur->transDepth != 0) || !cur->sbChanged) return 0;
+  cur->sbChanged = false;
+
+  return soStoreSuperBlock ();
+}
+
 /**
  *  \brief Convert the inode number, which translates to an entry of the inode table, into the logical number (the
  *         ordinal, starting at zero, of the succession blocks that the table of inodes comprises) and the offset of
@@ -198,7 +281,7 @@ int soConvertRefInT (uint32_t nInode, uint32_t *p_nBlk, uint32_t *p_offset)
   int stat;                                      /* status of operation */
 
   if ((stat = soLoadSuperBlock ()) != 0) return stat;
-  if ((nInode >= sb.iTotal) || (p_nBlk == NULL) || (p_offset == NULL))
+  if ((nInode >= cur->sb.iTotal) || (p_nBlk == NULL) || (p_offset == NULL))
      return -EINVAL;
 
   *p_nBlk = nInode / IPB;
@@ -230,15 +313,17 @@ int soLoadBlockInT (uint32_t nBlk)
   int stat;                                      /* status of operation */
 
   if ((stat = soLoadSuperBlock ()) != 0) return stat;
-  if (nBlk >= sb.iTableSize) return -EINVAL;
+  if (nBlk >= cur->sb.iTableSize) return -EINVAL;
 
-  if (intError != 0) return intError;            /* a previous error has occurred */
-  if (nBlk == nBlkInTLoaded) return 0;           /* the block has already been read */
-  stat = soReadCacheBlock (sb.iTableStart + nBlk, inode);
+  if (cur->intError != 0) return cur->intError;  /* a previous error has occurred */
+  if (nBlk == cur->nBlkInTLoaded) return 0;      /* the block has already been read */
+  stat = soReadCacheBlock (cur->sb.iTableStart + nBlk, cur->inode);
   if (stat == 0)
-     nBlkInTLoaded = nBlk;                       /* operation carried out with success */
-     else { nBlkInTLoaded = -1;
-            intError = stat;                     /* an error has occurred while reading */
+     { cur->nBlkInTLoaded = nBlk;                /* operation carried out with success */
+       soMergeInodeBlock (cur->inode, nBlk);     /* cached inodes not yet written back take precedence */
+     }
+     else { cur->nBlkInTLoaded = -1;
+            cur->intError = stat;                /* an error has occurred while reading */
           }
 
   return stat;
@@ -258,8 +343,8 @@ SOInode *soGetBlockInT (void)
 {
   soColorProbe (716, "07;31", "soGetBlockInT ()\n");
 
-  if (nBlkInTLoaded >= 0)
-     return inode;
+  if (cur->nBlkInTLoaded >= 0)
+     return cur->inode;
      else return NULL;
 }
 
@@ -281,17 +366,20 @@ int soStoreBlockInT (void)
 
   int stat;                                      /* status of operation */
 
-  if (intError != 0) return intError;            /* a previous error has occurred */
-  if (nBlkInTLoaded < 0)
-     { nBlkInTLoaded = -2;
-       intError = -ELIBBAD;                      /* no block of the bitmap table of inodes has not been
+  if (cur->intError != 0) return cur->intError;  /* a previous error has occurred */
+  if (cur->nBlkInTLoaded < 0)
+     { cur->nBlkInTLoaded = -2;
+       cur->intError = -ELIBBAD;                 /* no block of the bitmap table of inodes has not been
                                                     read yet */
-       return intError;
+       return cur->intError;
      }
-  stat = soWriteCacheBlock (sb.iTableStart + nBlkInTLoaded, inode);
+  soApplyAtime (cur->inode, cur->nBlkInTLoaded); /* pending updates of the time of last access go with it */
+  soCheckAccessBlock (cur->inode, cur->nBlkInTLoaded); /* cached access decisions on changed inodes are dropped */
+  soSyncInodeBlock (cur->inode, cur->nBlkInTLoaded); /* cached inodes are updated and become clean */
+  stat = soWriteCacheBlock (cur->sb.iTableStart + cur->nBlkInTLoaded, cur->inode);
   if (stat != 0)
-     { nBlkInTLoaded = -2;
-       intError = stat;                          /* an error has occurred while writing */
+     { cur->nBlkInTLoaded = -2;
+       cur->intError = stat;                     /* an error has occurred while writing */
      }
 
   return stat;
@@ -344,6 +432,7 @@ int soConvertBPIDC (uint32_t p, uint32_t *p_clustInd, uint32_t *p_offset)
  *  \return -\c EIO, if it fails on reading or writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
+ *  \return -\c ENOMEM, if there is not enough memory for the internal storage
  *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
@@ -354,17 +443,19 @@ int soLoadSngIndRefClust (uint32_t nClust)
   int stat;                                      /* status of operation */
 
   if ((stat = soLoadSuperBlock ()) != 0) return stat;
-  if ((nClust < sb.dZoneStart) || (((nClust - sb.dZoneStart) % BLOCKS_PER_CLUSTER) != 0) ||
-      (nClust >= (sb.dZoneStart + sb.dZoneTotal * BLOCKS_PER_CLUSTER)))
+  if ((nClust < cur->sb.dZoneStart) || (((nClust - cur->sb.dZoneStart) % BLOCKS_PER_CLUSTER) != 0) ||
+      (nClust >= (cur->sb.dZoneStart + cur->sb.dZoneTotal * BLOCKS_PER_CLUSTER)))
      return -EINVAL;
 
-  if (sircError != 0) return sircError;          /* a previous error has occurred */
-  if (nClust == nClustSIRef) return 0;           /* the cluster has already been read */
-  stat = soReadCacheCluster (nClust, &sngIndRefClust);
+  if (cur->sircError != 0) return cur->sircError; /* a previous error has occurred */
+  if (nClust == cur->nClustSIRef) return 0;      /* the cluster has already been read */
+  if ((cur->sngIndRefClust == NULL) && ((cur->sngIndRefClust = soArenaAlloc (ARENA_CLUSTER)) == NULL))
+     return -ENOMEM;
+  stat = soReadCacheCluster (nClust, cur->sngIndRefClust);
   if (stat == 0)
-     nClustSIRef = nClust;                       /* operation carried out with success */
-     else { nClustSIRef = -2;
-            sircError = stat;                    /* an error has occurred while reading */
+     cur->nClustSIRef = nClust;                  /* operation carried out with success */
+     else { cur->nClustSIRef = -2;
+            cur->sircError = stat;               /* an error has occurred while reading */
           }
 
   return stat;
@@ -386,8 +477,8 @@ SODataClust *soGetSngIndRefClust (void)
 {
   soColorProbe (720, "07;31", "soGetSngIndRefClust ()\n");
 
-  if (nClustSIRef >= 0)
-     return &sngIndRefClust;
+  if (cur->nClustSIRef >= 0)
+     return cur->sngIndRefClust;
      else return NULL;
 }
 
@@ -412,17 +503,17 @@ int soStoreSngIndRefClust (void)
 
   int stat;                                      /* status of operation */
 
-  if (sircError != 0) return sircError;          /* a previous error has occurred */
-  if (nClustSIRef < 0)
-     { nClustSIRef = -2;
-       sircError = -ELIBBAD;                     /* no cluster of the table of single indirect references has not been
+  if (cur->sircError != 0) return cur->sircError; /* a previous error has occurred */
+  if (cur->nClustSIRef < 0)
+     { cur->nClustSIRef = -2;
+       cur->sircError = -ELIBBAD;                /* no cluster of the table of single indirect references has not been
                                                     read yet */
-       return sircError;
+       return cur->sircError;
      }
-  stat = soWriteCacheCluster (nClustSIRef, &sngIndRefClust);
+  stat = soWriteCacheCluster (cur->nClustSIRef, cur->sngIndRefClust);
   if (stat != 0)
-     { nClustSIRef = -2;
-       sircError = stat;                          /* an error has occurred while writing */
+     { cur->nClustSIRef = -2;
+       cur->sircError = stat;                     /* an error has occurred while writing */
      }
 
   return stat;
@@ -443,6 +534,7 @@ int soStoreSngIndRefClust (void)
  *  \return -\c EIO, if it fails on reading or writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
+ *  \return -\c ENOMEM, if there is not enough memory for the internal storage
  *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
@@ -453,17 +545,19 @@ int soLoadDirRefClust (uint32_t nClust)
   int stat;                                      /* status of operation */
 
   if ((stat = soLoadSuperBlock ()) != 0) return stat;
-  if ((nClust < sb.dZoneStart) || (((nClust - sb.dZoneStart) % BLOCKS_PER_CLUSTER) != 0) ||
-      (nClust >= (sb.dZoneStart + sb.dZoneTotal * BLOCKS_PER_CLUSTER)))
+  if ((nClust < cur->sb.dZoneStart) || (((nClust - cur->sb.dZoneStart) % BLOCKS_PER_CLUSTER) != 0) ||
+      (nClust >= (cur->sb.dZoneStart + cur->sb.dZoneTotal * BLOCKS_PER_CLUSTER)))
      return -EINVAL;
 
-  if (drcError != 0) return drcError;            /* a previous error has occurred */
-  if (nClust == nClustDRef) return 0;            /* the cluster has already been read */
-  stat = soReadCacheCluster (nClust, &dirRefClust);
+  if (cur->drcError != 0) return cur->drcError;  /* a previous error has occurred */
+  if (nClust == cur->nClustDRef) return 0;       /* the cluster has already been read */
+  if ((cur->dirRefClust == NULL) && ((cur->dirRefClust = soArenaAlloc (ARENA_CLUSTER)) == NULL))
+     return -ENOMEM;
+  stat = soReadCacheCluster (nClust, cur->dirRefClust);
   if (stat == 0)
-	  nClustDRef = nClust;                       /* operation carried out with success */
-     else { nClustDRef = -2;
-            drcError = stat;                     /* an error has occurred while reading */
+	  cur->nClustDRef = nClust;                  /* operation carried out with success */
+     else { cur->nClustDRef = -2;
+            cur->drcError = stat;                /* an error has occurred while reading */
           }
 
   return stat;
@@ -484,8 +578,8 @@ SODataClust *soGetDirRefClust (void)
 {
   soColorProbe (723, "07;31", "soGetDirRefClust ()\n");
 
-  if (nClustDRef >= 0)
-     return &dirRefClust;
+  if (cur->nClustDRef >= 0)
+     return cur->dirRefClust;
      else return NULL;
 }
 
@@ -510,18 +604,65 @@ int soStoreDirRefClust (void)
 
   int stat;                                      /* status of operation */
 
-  if (drcError != 0) return drcError;            /* a previous error has occurred */
-  if (nClustDRef < 0)
-     { nClustDRef = -2;
-       drcError = -ELIBBAD;                      /* no cluster of the table of direct references has not been
+  if (cur->drcError != 0) return cur->drcError;  /* a previous error has occurred */
+  if (cur->nClustDRef < 0)
+     { cur->nClustDRef = -2;
+       cur->drcError = -ELIBBAD;                 /* no cluster of the table of direct references has not been
                                                     read yet */
-       return sircError;
+       return cur->sircError;
      }
-  stat = soWriteCacheCluster (nClustDRef, &dirRefClust);
+  stat = soWriteCacheCluster (cur->nClustDRef, cur->dirRefClust);
   if (stat != 0)
-     { nClustDRef = -2;
-       drcError = stat;                          /* an error has occurred while writing */
+     { cur->nClustDRef = -2;
+       cur->drcError = stat;                     /* an error has occurred while writing */
      }
 
   return stat;
 }
+
+/**
+ *  \brief Allocate the state of the internal storage of a new file system context.
+ *
+ *  The state is set as it is when the process starts: nothing has been read yet.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewBasicOperState (void)
+{
+  SOBasicOperState *p;
+
+  if ((p = calloc (1, sizeof (SOBasicOperState))) == NULL) return NULL;
+  p->nBlkInTLoaded = -1;
+
+  return p;
+}
+
+/**
+ *  \brief Free the state of the internal storage of a file system context.
+ *
+ *  The storage areas for clusters of references are given back to the arena of cache memory.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewBasicOperState
+ */
+
+void soFreeBasicOperState (void *p_state)
+{
+  SOBasicOperState *p = (SOBasicOperState *) p_state;
+
+  soArenaFree (p->sngIndRefClust, ARENA_CLUSTER);
+  soArenaFree (p->dirRefClust, ARENA_CLUSTER);
+  free (p);
+}
+
+/**
+ *  \brief Bind the state of the internal storage of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewBasicOperState, or \c NULL, for the default context
+ */
+
+void soBindBasicOperState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOBasicOperState *) p_state;
+}
@@ -10,6 +10,8 @@
  *      \li load the contents of the superblock into internal storage
  *      \li get a pointer to the contents of the superblock
  *      \li store the contents of the superblock resident in internal storage to the storage device
+ *      \li begin a metadata transaction
+ *      \li end a metadata transaction
  *      \li convert the inode number, which translates to an entry of the inode table, into the logical number (the
  *          ordinal, starting at zero, of the succession blocks that the table of inodes comprises) and the offset of
  *          the block where it is stored
@@ -28,7 +30,10 @@
  *          storage
  *      \li get a pointer to the contents of a specific cluster of the table of direct references to data clusters
  *      \li store the contents of a specific cluster of the table of direct references to data clusters resident in
- *          internal storage to the storage device.
+ *          internal storage to the storage device
+ *      \li allocate the state of a new file system context
+ *      \li free the state of a file system context
+ *      \li bind the state of a file system context to the calling thread.
  *
  *  \author António Rui Borges - August 2010 - August 2011, September 2014
  *
@@ -76,6 +81,7 @@ extern SOSuperBlock *soGetSuperBlock (void);
  *  \brief Store the contents of the superblock resident in internal storage to the storage device.
  *
  *  Any type of previous / current error on loading / storing the superblock data will disable the operation.
+ *  Within a metadata transaction, the superblock is only marked as changed.
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EBADF, if the device is not already opened
@@ -87,6 +93,35 @@ extern SOSuperBlock *soGetSuperBlock (void);
 
 extern int soStoreSuperBlock (void);
 
+/**
+ *  \brief Begin a metadata transaction.
+ *
+ *  Until the transaction ends, storing the superblock only marks it as changed: it is stored once, when the
+ *  transaction ends. The superblock is never read from the storage device but through the internal storage, so the
+ *  operations which take place meanwhile see it as it is. Transactions may be nested: only the outermost one counts.
+ *
+ *  It defers the stores of the superblock and nothing else: it is neither atomic nor isolated. The blocks of the table
+ *  of inodes, the directories and the clusters of references are written, through the buffercache, as each operation
+ *  goes, since the consistency checks of the allocation functions read them from there; so, an operation which fails
+ *  within a transaction does not undo the ones which took place before it, and a crash before the transaction ends
+ *  leaves the counters and the lists of free inodes and data clusters in the superblock behind those blocks.
+ */
+
+extern void soBeginMetaTransaction (void);
+
+/**
+ *  \brief End a metadata transaction.
+ *
+ *  The superblock is stored, if it was changed since the outermost transaction began. Nothing else is stored here:
+ *  the other metadata was stored as it was changed.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if no transaction was begun
+ *  \return -<em>other specific error</em> issued by \e soStoreSuperBlock
+ */
+
+extern int soEndMetaTransaction (void);
+
 /**
  *  \brief Convert the inode number, which translates to an entry of the inode table, into the logical number (the
  *         ordinal, starting at zero, of the succession blocks that the table of inodes comprises) and the offset of
@@ -187,6 +222,7 @@ extern int soConvertBPIDC (uint32_t p, uint32_t *p_clustInd, uint32_t *p_offset)
  *  \return -\c EIO, if it fails on reading or writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
+ *  \return -\c ENOMEM, if there is not enough memory for the internal storage
  *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
@@ -238,6 +274,7 @@ extern int soStoreSngIndRefClust (void);
  *  \return -\c EIO, if it fails on reading or writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
+ *  \return -\c ENOMEM, if there is not enough memory for the internal storage
  *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
@@ -273,4 +310,33 @@ extern SODataClust *soGetDirRefClust (void);
 
 extern int soStoreDirRefClust (void);
 
+/**
+ *  \brief Allocate the state of the internal storage of a new file system context.
+ *
+ *  The state is set as it is when the process starts: nothing has been read yet.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewBasicOperState (void);
+
+/**
+ *  \brief Free the state of the internal storage of a file system context.
+ *
+ *  The storage areas for clusters of references are given back to the arena of cache memory.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewBasicOperState
+ */
+
+extern void soFreeBasicOperState (void *p_state);
+
+/**
+ *  \brief Bind the state of the internal storage of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewBasicOperState, or \c NULL, for the default context
+ */
+
+extern void soBindBasicOperState (void *p_state);
+
 #endif /* SOFS_BASICOPER_H_ */
@@ -0,0 +1,212 @@
+/**
+ *  \file sofs_context.c (implementation file)
+ *
+ *  \brief File system contexts.
+ *
+ *  A context is a set of states, one for each module which keeps any: binding a context to a thread binds each of
+ *  these states to it. The states are allocated and bound by the modules themselves, so that their contents remain
+ *  private.
+ *
+ *  The following operations are defined:
+ *    \li create a new file system context
+ *    \li bind a file system context to the calling thread
+ *    \li get the file system context bound to the calling thread
+ *    \li destroy a file system context.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "sofs_probe.h"
+#include "sofs_rawdisk.h"
+#include "sofs_l2cache.h"
+#include "sofs_buffercache.h"
+#include "sofs_basicoper.h"
+#include "sofs_inodecache.h"
+#include "sofs_accesscache.h"
+#include "sofs_atime.h"
+#include "sofs_dircount.h"
+#include "sofs_symlinkcache.h"
+#include "sofs_xattr.h"
+#include "sofs_statfs.h"
+#include "sofs_validation.h"
+#include "sofs_context.h"
+
+/** \brief Number of modules which keep a state */
+#define NSTATES  12
+
+/**
+ *  \brief Definition of a module which keeps a state.
+ */
+
+typedef struct soStateOps
+{
+   /** \brief allocate the state of a new file system context */
+    void *(*newState) (void);
+   /** \brief bind the state of a file system context to the calling thread */
+    void (*bindState) (void *p_state);
+   /** \brief free the state of a file system context */
+    void (*freeState) (void *p_state);
+} SOStateOps;
+
+/**
+ *  \brief Definition of a file system context.
+ */
+
+struct soContext
+{
+   /** \brief lock held by the thread the context is bound to */
+    pthread_mutex_t lock;
+   /** \brief states of the modules, in the order of \e module */
+    void *state[NSTATES];
+};
+
+/*
+ *  Internal data structure
+ */
+/** \brief Modules which keep a state */
+static const SOStateOps module[NSTATES] = { { soNewRawDiskState, soBindRawDiskState, free },
+                                            { soNewL2CacheState, soBindL2CacheState, free },
+                                            { soNewBufferCacheState, soBindBufferCacheState, free },
+                                            { soNewBasicOperState, soBindBasicOperState, soFreeBasicOperState },
+                                            { soNewInodeCacheState, soBindInodeCacheState, free },
+                                            { soNewAccessCacheState, soBindAccessCacheState, free },
+                                            { soNewAtimeState, soBindAtimeState, free },
+                                            { soNewDirCountState, soBindDirCountState, free },
+                                            { soNewSymlinkCacheState, soBindSymlinkCacheState, free },
+                                            { soNewXattrCacheState, soBindXattrCacheState, free },
+                                            { soNewStatFSState, soBindStatFSState, free },
+                                            { soNewValidationState, soBindValidationState, free } };
+/** \brief File system context bound to the calling thread (\c NULL, for the default context) */
+static __thread SOContext *bound = NULL;
+
+/* Allusion to internal function */
+
+static void bindStates (SOContext *p_ctx);
+
+/**
+ *  \brief Create a new file system context.
+ *
+ *  The context is set as the default one is when the process starts: no storage device is opened.
+ *
+ *  \param pp_ctx pointer to a location where the pointer to the context is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ */
+
+int soNewContext (SOContext **pp_ctx)
+{
+  soColorProbe (740, "07;31", "soNewContext (%p)\n", pp_ctx);
+
+  SOContext *p_ctx;
+  int i;
+
+  if (pp_ctx == NULL) return -EINVAL;
+
+  if ((p_ctx = calloc (1, sizeof (SOContext))) == NULL) return -ENOMEM;
+  for (i = 0; i < NSTATES; i++)
+    if ((p_ctx->state[i] = module[i].newState ()) == NULL)
+       { while (i > 0)
+         { i -= 1;
+           module[i].freeState (p_ctx->state[i]);
+         }
+         free (p_ctx);
+         return -ENOMEM;
+       }
+  pthread_mutex_init (&p_ctx->lock, NULL);
+  *pp_ctx = p_ctx;
+
+  return 0;
+}
+
+/**
+ *  \brief Bind a file system context to the calling thread.
+ *
+ *  The context previously bound to the calling thread, if any, is unbound first. If the context is bound to another
+ *  thread, the calling thread waits until it is unbound.
+ *
+ *  \param p_ctx pointer to the context (\c NULL, for the default context)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOLCK, if the context can not be locked (the calling thread is then bound to the default context)
+ */
+
+int soBindContext (SOContext *p_ctx)
+{
+  soColorProbe (741, "07;31", "soBindContext (%p)\n", p_ctx);
+
+  if (p_ctx == bound) return 0;
+
+  /* the previous context is unbound before waiting for the new one, so that two threads swapping contexts do not
+     deadlock */
+  if (bound != NULL)
+     pthread_mutex_unlock (&bound->lock);
+  bound = NULL;
+  bindStates (NULL);
+
+  if (p_ctx == NULL) return 0;
+  if (pthread_mutex_lock (&p_ctx->lock) != 0) return -ENOLCK;
+  bound = p_ctx;
+  bindStates (p_ctx);
+
+  return 0;
+}
+
+/**
+ *  \brief Get the file system context bound to the calling thread.
+ *
+ *  \return <em>pointer to the context</em>, or \c NULL, if it is the default context
+ */
+
+SOContext *soGetContext (void)
+{
+  return bound;
+}
+
+/**
+ *  \brief Destroy a file system context.
+ *
+ *  The storage device must have been unmounted and the context must not be bound to any thread.
+ *
+ *  \param p_ctx pointer to the context
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EBUSY, if the context is bound to a thread
+ */
+
+int soFreeContext (SOContext *p_ctx)
+{
+  soColorProbe (742, "07;31", "soFreeContext (%p)\n", p_ctx);
+
+  int i;
+
+  if (p_ctx == NULL) return -EINVAL;
+  if ((p_ctx == bound) || (pthread_mutex_trylock (&p_ctx->lock) != 0)) return -EBUSY;
+  pthread_mutex_unlock (&p_ctx->lock);
+
+  pthread_mutex_destroy (&p_ctx->lock);
+  for (i = 0; i < NSTATES; i++)
+    module[i].freeState (p_ctx->state[i]);
+  free (p_ctx);
+
+  return 0;
+}
+
+/**
+ *  \brief Bind the states of a file system context to the calling thread.
+ *
+ *  \param p_ctx pointer to the context (\c NULL, for the default context)
+ */
+
+static void bindStates (SOContext *p_ctx)
+{
+  int i;
+
+  for (i = 0; i < NSTATES; i++)
+    module[i].bindState ((p_ctx == NULL) ? NULL : p_ctx->state[i]);
+}
@@ -0,0 +1,92 @@
+/**
+ *  \file sofs_context.h (interface file)
+ *
+ *  \brief File system contexts.
+ *
+ *  A file system context holds the whole state of the access to a storage device: the raw disk, the second-level cache
+ *  and the buffercache, the internal storage of the superblock, of a block of the table of inodes and of clusters of
+ *  references, and the caches kept on top of them (inodes, access decisions, times of last access, counts of
+ *  directory entries, symbolic links, extended attributes, file system statistics and validation).
+ *
+ *  The interface of the file system is not changed: every operation works upon the context bound to the calling
+ *  thread. A thread which never binds a context works upon the default one, which is there from the start, so that a
+ *  process which accesses a single storage device needs not know about contexts at all.
+ *
+ *  One process may thus mount many storage devices, one per context, and serve them in parallel, from different
+ *  threads. A context is bound to one thread at a time: a thread which tries to bind a context already bound to
+ *  another thread waits until it is unbound. The default context is not protected in this way: as before, the
+ *  threads which share it must serialize their operations.
+ *
+ *  The isolation is not complete, though: the prebuilt implementation of the system calls (\e sofs_syscalls.o) keeps
+ *  the path of the mounted storage device in a single static variable of the process, set by \e soMountSOFS and used
+ *  by \e soStat. When storage devices are mounted in several contexts, it holds the path of the one mounted last,
+ *  whatever the context bound to the calling thread.
+ *
+ *  The following operations are defined:
+ *    \li create a new file system context
+ *    \li bind a file system context to the calling thread
+ *    \li get the file system context bound to the calling thread
+ *    \li destroy a file system context.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_CONTEXT_H_
+#define SOFS_CONTEXT_H_
+
+/** \brief File system context (its contents are private) */
+typedef struct soContext SOContext;
+
+/**
+ *  \brief Create a new file system context.
+ *
+ *  The context is set as the default one is when the process starts: no storage device is opened.
+ *
+ *  \param pp_ctx pointer to a location where the pointer to the context is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c ENOMEM, if there is not enough memory
+ */
+
+extern int soNewContext (SOContext **pp_ctx);
+
+/**
+ *  \brief Bind a file system context to the calling thread.
+ *
+ *  The context previously bound to the calling thread, if any, is unbound first. If the context is bound to another
+ *  thread, the calling thread waits until it is unbound.
+ *
+ *  \param p_ctx pointer to the context (\c NULL, for the default context)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOLCK, if the context can not be locked (the calling thread is then bound to the default context)
+ */
+
+extern int soBindContext (SOContext *p_ctx);
+
+/**
+ *  \brief Get the file system context bound to the calling thread.
+ *
+ *  \return <em>pointer to the context</em>, or \c NULL, if it is the default context
+ */
+
+extern SOContext *soGetContext (void);
+
+/**
+ *  \brief Destroy a file system context.
+ *
+ *  The storage device must have been unmounted and the context must not be bound to any thread.
+ *
+ *  \param p_ctx pointer to the context
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EBUSY, if the context is bound to a thread
+ */
+
+extern int soFreeContext (SOContext *p_ctx);
+
+#endif /* SOFS_CONTEXT_H_ */
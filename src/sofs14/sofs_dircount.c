@@ -0,0 +1,139 @@
+/**
+ *  \file sofs_dircount.c (implementation file)
+ *
+ *  \brief Counts of live entries of directories.
+ *
+ *  The table is direct-mapped on the inode number: a directory whose count is set takes the place of any other
+ *  directory mapped to the same entry, which will have its count computed again when needed.
+ *
+ *  The following operations are defined:
+ *    \li get the number of entries in use of a directory
+ *    \li set the number of entries in use of a directory
+ *    \li forget the number of entries in use of a directory
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include "sofs_probe.h"
+#include "sofs_dircount.h"
+
+/**
+ *  \brief Definition of an entry of the table of counts.
+ */
+
+typedef struct soDirCount
+{
+   /** \brief entry state: \c true, if it holds a count */
+    bool valid;
+   /** \brief number of the inode associated to the directory */
+    uint32_t nInodeDir;
+   /** \brief number of entries in use, besides "." and ".." */
+    uint32_t count;
+} SODirCount;
+
+/**
+ *  \brief Definition of the state of the table of counts.
+ */
+
+typedef struct soDirCountState
+{
+   /** \brief table of counts */
+    SODirCount entry[DIR_COUNT_SIZE];
+} SODirCountState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SODirCountState defState = { 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SODirCountState *cur = &defState;
+
+/**
+ *  \brief Get the number of entries in use of a directory, besides "." and "..".
+ *
+ *  \param nInodeDir number of the inode associated to the directory
+ *  \param p_count pointer to a location where the number of entries is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it is known
+ *  \return -\c ENOENT, if it is not known
+ */
+
+int soGetDirCount (uint32_t nInodeDir, uint32_t *p_count)
+{
+  SODirCount *p = &cur->entry[nInodeDir % DIR_COUNT_SIZE];
+
+  if (!p->valid || (p->nInodeDir != nInodeDir))
+     return -ENOENT;
+  *p_count = p->count;
+
+  return 0;
+}
+
+/**
+ *  \brief Set the number of entries in use of a directory, besides "." and "..".
+ *
+ *  \param nInodeDir number of the inode associated to the directory
+ *  \param count number of entries
+ */
+
+void soSetDirCount (uint32_t nInodeDir, uint32_t count)
+{
+  soColorProbe (733, "07;31", "soSetDirCount (%"PRIu32", %"PRIu32")\n", nInodeDir, count);
+
+  SODirCount *p = &cur->entry[nInodeDir % DIR_COUNT_SIZE];
+
+  p->valid = true;
+  p->nInodeDir = nInodeDir;
+  p->count = count;
+}
+
+/**
+ *  \brief Forget the number of entries in use of a directory.
+ *
+ *  It should be called before a directory is changed in a way the count can not follow, or when its inode is freed.
+ *
+ *  \param nInodeDir number of the inode associated to the directory
+ */
+
+void soForgetDirCount (uint32_t nInodeDir)
+{
+  SODirCount *p = &cur->entry[nInodeDir % DIR_COUNT_SIZE];
+
+  if (p->nInodeDir == nInodeDir) p->valid = false;
+}
+
+/**
+ *  \brief Allocate the state of the counts of live entries of directories of a new file system context.
+ *
+ *  The state is set as it is when the process starts: no count is known.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewDirCountState (void)
+{
+  SODirCountState *p;
+
+  if ((p = calloc (1, sizeof (SODirCountState))) == NULL) return NULL;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the counts of live entries of directories of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewDirCountState, or \c NULL, for the default context
+ */
+
+void soBindDirCountState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SODirCountState *) p_state;
+}
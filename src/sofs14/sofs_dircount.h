@@ -0,0 +1,84 @@
+/**
+ *  \file sofs_dircount.h (interface file)
+ *
+ *  \brief Counts of live entries of directories.
+ *
+ *  Checking whether a directory is empty requires parsing all its entries, to assert that only "." and ".." are in
+ *  use. So, for each directory, the number of entries in use, besides "." and "..", is kept once it is known: it is
+ *  computed by the first emptiness check, or set to zero when the directory is created, and it is kept up to date by
+ *  the functions which add, attach, remove or detach entries. Thereafter, the emptiness check is a lookup.
+ *
+ *  The table is direct-mapped on the inode number. The on-disk format is not changed: the counts are lost upon
+ *  unmounting and computed again when needed.
+ *
+ *  The following operations are defined:
+ *    \li get the number of entries in use of a directory
+ *    \li set the number of entries in use of a directory
+ *    \li forget the number of entries in use of a directory
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_DIRCOUNT_H_
+#define SOFS_DIRCOUNT_H_
+
+#include <stdint.h>
+
+/** \brief Number of entries of the table of counts */
+#define DIR_COUNT_SIZE  256
+
+/**
+ *  \brief Get the number of entries in use of a directory, besides "." and "..".
+ *
+ *  \param nInodeDir number of the inode associated to the directory
+ *  \param p_count pointer to a location where the number of entries is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it is known
+ *  \return -\c ENOENT, if it is not known
+ */
+
+extern int soGetDirCount (uint32_t nInodeDir, uint32_t *p_count);
+
+/**
+ *  \brief Set the number of entries in use of a directory, besides "." and "..".
+ *
+ *  \param nInodeDir number of the inode associated to the directory
+ *  \param count number of entries
+ */
+
+extern void soSetDirCount (uint32_t nInodeDir, uint32_t count);
+
+/**
+ *  \brief Forget the number of entries in use of a directory.
+ *
+ *  It should be called before a directory is changed in a way the count can not follow, or when its inode is freed.
+ *
+ *  \param nInodeDir number of the inode associated to the directory
+ */
+
+extern void soForgetDirCount (uint32_t nInodeDir);
+
+/**
+ *  \brief Allocate the state of the counts of live entries of directories of a new file system context.
+ *
+ *  The state is set as it is when the process starts: no count is known.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewDirCountState (void);
+
+/**
+ *  \brief Bind the state of the counts of live entries of directories of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewDirCountState, or \c NULL, for the default context
+ */
+
+extern void soBindDirCountState (void *p_state);
+
+#endif /* SOFS_DIRCOUNT_H_ */
@@ -10,7 +10,8 @@
  *      \li allocate a free inode
  *      \li free the referenced inode
  *      \li allocate a free data cluster
- *      \li free the referenced data cluster.
+ *      \li free the referenced data cluster
+ *      \li begin and end a batch of data clusters to be freed.
  *
  *  \author Artur Carneiro Pereira September 2008
  *  \author Miguel Oliveira e Silva September 2009
@@ -149,4 +150,33 @@ extern int soAllocDataCluster (uint32_t nInode, uint32_t *p_nClust);
 
 extern int soFreeDataCluster (uint32_t nClust);
 
+/**
+ *  \brief Begin a batch of data clusters to be freed.
+ *
+ *  The check whether a data cluster is allocated, carried out by \e soQCheckStatDC, searches the caches and the
+ *  double-linked list of free data clusters each time. Until the batch ends, \e soFreeDataCluster looks the data
+ *  cluster up instead in a map of the free data clusters, built here by a single pass over them and kept up to date
+ *  as the data clusters of the batch are freed.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBUSY, if a batch was already begun
+ *  \return -\c ENOMEM, if there is not enough memory for the map
+ *  \return -\c ESBFCCINVAL, if the free data clusters caches in the superblock are inconsistent
+ *  \return -\c EFCDLLINVAL, if the double-linked list of free data clusters is inconsistent
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soBeginFreeBatch (void);
+
+/**
+ *  \brief End a batch of data clusters to be freed.
+ *
+ *  The map of the free data clusters is discarded: \e soFreeDataCluster checks each data cluster on its own again.
+ */
+
+extern void soEndFreeBatch (void);
+
 #endif /* SOFS_IFUNCS_1_H_ */
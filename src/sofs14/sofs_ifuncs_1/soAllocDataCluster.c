@@ -13,12 +13,14 @@
 #include <sys/types.h>
 
 #include "sofs_probe.h"
+#include "sofs_rawdisk.h"
 #include "sofs_buffercache.h"
 #include "sofs_superblock.h"
 #include "sofs_inode.h"
 #include "sofs_datacluster.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_validation.h"
 #define  CLEAN_CLUSTER 
 #ifdef CLEAN_CLUSTER
 #include "sofs_ifuncs_3.h"
@@ -69,6 +71,7 @@ int soAllocDataCluster(uint32_t nInode, uint32_t *p_nClust) {
     SODataClust cluster; //ponteiro para o cluster que vai ser reservado
     SOInode *p_inode;
     uint32_t nBlock, offset, nClust, clusterStat, NFClt;
+    bool isDir;
 
     //carregar o super bloco
     if ((stat = soLoadSuperBlock()) != 0)
@@ -79,7 +82,7 @@ int soAllocDataCluster(uint32_t nInode, uint32_t *p_nClust) {
     //if ((stat = soQCheckSuperBlock(p_sb)) != 0)
     //    return stat;
 
-    if ((stat = soQCheckDZ(p_sb)) != 0)
+    if ((stat = soVCheckWrite(VCHK_DZ, p_sb, NULL)) != 0)
         return stat;
 
     //carregar inode pretendido
@@ -92,9 +95,12 @@ int soAllocDataCluster(uint32_t nInode, uint32_t *p_nClust) {
     p_inode = soGetBlockInT();
 
     //teste de consistencia ao inode
-    if ((stat = soQCheckInodeIU(p_sb, &p_inode[offset])) != 0)
+    if ((stat = soVCheckWrite(VCHK_INODEIU, p_sb, &p_inode[offset])) != 0)
         return stat;
 
+    // directory clusters are placed in the metadata tier, if the device is tiered
+    isDir = (p_inode[offset].mode & INODE_DIR) == INODE_DIR;
+
     //guardar o inode so precisavamos de testar a consistencia
     if ((stat = soStoreBlockInT()) != 0)
         return stat;
@@ -129,6 +135,9 @@ int soAllocDataCluster(uint32_t nInode, uint32_t *p_nClust) {
     //NFClt = dzone_start + NLClt * BLOCKS_PER_CLUSTER;
     NFClt = p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER;
 
+    if ((stat = soSetClusterTier(NFClt, isDir)) != 0)
+        return stat;
+
     if ((stat = soReadCacheCluster(NFClt, &cluster)) != 0)
         return stat;
     
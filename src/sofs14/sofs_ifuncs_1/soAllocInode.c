@@ -18,6 +18,7 @@
 #include "sofs_datacluster.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_validation.h"
 #define  CLEAN_INODE
 #ifdef CLEAN_INODE
 #include "sofs_ifuncs_2.h"
@@ -103,7 +104,7 @@ int soAllocInode(uint32_t type, uint32_t* p_nInode) {
         // se não está clean, então só pode estar dirty
 
         // check if the inode is dirty
-        if ((stat = soQCheckFDInode(p_sb, &p_itable[offset])) != 0) 
+        if ((stat = soVCheckWrite(VCHK_FDINODE, p_sb, &p_itable[offset])) != 0) 
             return stat;
 
             // codigo deste if, vem do pdf "manipulacao do cluster de dados", slide 23
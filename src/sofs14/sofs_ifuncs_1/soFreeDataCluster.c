@@ -5,6 +5,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
@@ -24,6 +26,9 @@
 
 int soDeplete(SOSuperBlock *p_sb);
 
+/** \brief map of the free data clusters, while a batch of data clusters is being freed (\c NULL, otherwise) */
+static __thread uint8_t *freeMap = NULL;
+
 /**
  *  \brief Free the referenced data cluster.
  *
@@ -64,10 +69,12 @@ int soFreeDataCluster(uint32_t nClust) {
     p_sb = soGetSuperBlock();
 
     // check if the data cluster number is in the right range
-    if (nClust > p_sb->dZoneTotal || nClust == 0) return -EINVAL;
+    if (nClust >= p_sb->dZoneTotal || nClust == 0) return -EINVAL;
 
-    // check if the data cluster is allocated
-    if ((stat = soQCheckStatDC(p_sb, nClust, &cluster_stat)) != 0)
+    // check if the data cluster is allocated (within a batch, the map built when it began is looked up instead)
+    if (freeMap != NULL)
+        cluster_stat = (freeMap[nClust / 8] & (1 << (nClust % 8))) ? FREE_CLT : ALLOC_CLT;
+    else if ((stat = soQCheckStatDC(p_sb, nClust, &cluster_stat)) != 0)
         return stat;
 
     if (cluster_stat == FREE_CLT) return -EDCNALINVAL;
@@ -103,6 +110,10 @@ int soFreeDataCluster(uint32_t nClust) {
     // get superblock pointer data
     p_sb = soGetSuperBlock();
 
+    // the data cluster is free from now on, for the remainder of the batch
+    if (freeMap != NULL)
+        freeMap[nClust / 8] |= (uint8_t) (1 << (nClust % 8));
+
     // insert freed data cluster in insert cache list
     p_sb->dZoneInsert.cache[p_sb->dZoneInsert.cacheIdx] = nClust;
     p_sb->dZoneInsert.cacheIdx += 1;
@@ -115,6 +126,93 @@ int soFreeDataCluster(uint32_t nClust) {
     return 0;
 }
 
+/**
+ *  \brief Begin a batch of data clusters to be freed.
+ *
+ *  The check whether a data cluster is allocated, carried out by \e soQCheckStatDC, searches the caches and the
+ *  double-linked list of free data clusters each time. Until the batch ends, \e soFreeDataCluster looks the data
+ *  cluster up instead in a map of the free data clusters, built here by a single pass over them and kept up to date
+ *  as the data clusters of the batch are freed.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBUSY, if a batch was already begun
+ *  \return -\c ENOMEM, if there is not enough memory for the map
+ *  \return -\c ESBFCCINVAL, if the free data clusters caches in the superblock are inconsistent
+ *  \return -\c EFCDLLINVAL, if the double-linked list of free data clusters is inconsistent
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soBeginFreeBatch(void) {
+    soColorProbe(615, "07;33", "soBeginFreeBatch ()\n");
+
+    int stat; // function return status control
+    SOSuperBlock *p_sb; // super block pointer
+    SODataClust datacluster;
+    uint32_t nClust, k, n; // data cluster logical number, cache position and number of data clusters visited
+    uint8_t *map; // map of the free data clusters
+
+    if (freeMap != NULL) return -EBUSY;
+
+    // load super block
+    if ((stat = soLoadSuperBlock()) != 0)
+        return stat;
+
+    // get superblock pointer data
+    p_sb = soGetSuperBlock();
+
+    if ((map = calloc((p_sb->dZoneTotal + 7) / 8, 1)) == NULL)
+        return -ENOMEM;
+
+    // the filled positions of both caches
+    for (k = p_sb->dZoneRetriev.cacheIdx; k < DZONE_CACHE_SIZE; k++) {
+        if ((nClust = p_sb->dZoneRetriev.cache[k]) >= p_sb->dZoneTotal) {
+            free(map);
+            return -ESBFCCINVAL;
+        }
+        map[nClust / 8] |= (uint8_t) (1 << (nClust % 8));
+    }
+    for (k = 0; k < p_sb->dZoneInsert.cacheIdx; k++) {
+        if ((nClust = p_sb->dZoneInsert.cache[k]) >= p_sb->dZoneTotal) {
+            free(map);
+            return -ESBFCCINVAL;
+        }
+        map[nClust / 8] |= (uint8_t) (1 << (nClust % 8));
+    }
+
+    // the double-linked list, which can not be longer than the data zone
+    for (nClust = p_sb->dHead, n = 0; nClust != NULL_CLUSTER; nClust = datacluster.next, n++) {
+        if ((nClust >= p_sb->dZoneTotal) || (n == p_sb->dZoneTotal)) {
+            free(map);
+            return -EFCDLLINVAL;
+        }
+        if ((stat = soReadCacheCluster(p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER, &datacluster)) != 0) {
+            free(map);
+            return stat;
+        }
+        map[nClust / 8] |= (uint8_t) (1 << (nClust % 8));
+    }
+
+    freeMap = map;
+
+    return 0;
+}
+
+/**
+ *  \brief End a batch of data clusters to be freed.
+ *
+ *  The map of the free data clusters is discarded: \e soFreeDataCluster checks each data cluster on its own again.
+ */
+
+void soEndFreeBatch(void) {
+    soColorProbe(616, "07;33", "soEndFreeBatch ()\n");
+
+    free(freeMap);
+    freeMap = NULL;
+}
+
 /**
  *  \brief Deplete the insertion cache of free data cluster references.
  *
@@ -18,6 +18,10 @@
 #include "sofs_datacluster.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_validation.h"
+#include "sofs_xattr.h"
+#include "sofs_symlinkcache.h"
+#include "sofs_accesscache.h"
 
 /**
  *  \brief Free the referenced inode.
@@ -25,6 +29,7 @@
  *  The inode must be in use, belong to one of the legal file types and have no directory entries associated with it
  *  (refcount = 0).
  *  The inode is marked free in the dirty state and inserted in the list of free inodes.
+ *  Its extended attributes, if there are any, are freed.
  *
  *  Notice that the inode 0, supposed to belong to the file system root directory, can not be freed.
  *
@@ -67,7 +72,7 @@ int soFreeInode(uint32_t nInode) {
         return -EINVAL;
 
     // Verificar inconsistencia da tabela iNode  
-    if ((stat = soQCheckInT(p_sb)) != 0)
+    if ((stat = soVCheckWrite(VCHK_INT, p_sb, NULL)) != 0)
         return stat;
 
     // Converter o numero do nó-i nInode no numero do bloco e seu offset 
@@ -82,9 +87,24 @@ int soFreeInode(uint32_t nInode) {
     p_itable = soGetBlockInT();
     
     // Verificar se é um no-i free está livre, mas em dirty-state
-    if ((stat = soQCheckInodeIU(p_sb,&p_itable[offset])) != 0)
+    if ((stat = soVCheckWrite(VCHK_INODEIU, p_sb, &p_itable[offset])) != 0)
         return stat;
 
+    // Libertar os atributos estendidos associados ao no-i, depois de validado
+    if ((stat = soFreeXattr(nInode)) != 0)
+        return stat;
+
+    // Esquecer o alvo, se for um atalho
+    soForgetSymlink(nInode);
+
+    // Recarregar o super bloco e o bloco da tabela de inodes, que a libertacao pode ter alterado
+    if ((stat = soLoadSuperBlock()) != 0)
+        return stat;
+    p_sb = soGetSuperBlock();
+    if ((stat = soLoadBlockInT(nBlk)) != 0)
+        return stat;
+    p_itable = soGetBlockInT();
+
     // Se estiver vazia 
     if (p_sb->iFree == 0) {
         p_itable[offset].mode |= INODE_FREE;
@@ -113,6 +133,9 @@ int soFreeInode(uint32_t nInode) {
 
     p_sb->iFree += 1;
 
+    // A decisao de acesso em cache deixa de ser valida, o no-i ja nao esta em uso
+    soInvalidateAccess(nInode);
+
     // Gravar o super bloco 
     if ((stat = soStoreSuperBlock()) != 0)
         return stat;
@@ -9,7 +9,8 @@
  *      \li read specific inode data from the table of inodes
  *      \li write specific inode data to the table of inodes
  *      \li clean an inode
- *      \li check the inode access permissions against a given operation.
+ *      \li check the inode access permissions against a given operation
+ *      \li read specific inode data and get its access permissions in a single pass.
  *
  *  \author Artur Carneiro Pereira September 2008
  *  \author Miguel Oliveira e Silva September 2009
@@ -43,7 +44,8 @@
  *  \brief Read specific inode data from the table of inodes.
  *
  *  The inode may be either in use and belong to one of the legal file types or be free in the dirty state.
- *  Upon reading, the <em>time of last file access</em> field is set to current time, if the inode is in use.
+ *  Upon reading, the <em>time of last file access</em> field is set to current time, if the inode is in use, according
+ *  to the policy selected by \e soSetAtimePolicy.
  *
  *  \param p_inode pointer to the buffer where inode data must be read into
  *  \param nInode number of the inode to be read from
@@ -145,4 +147,30 @@ extern int soCleanInode (uint32_t nInode);
 
 extern int soAccessGranted (uint32_t nInode, uint32_t opRequested);
 
+/**
+ *  \brief Read specific inode data from the table of inodes and get its access permissions in a single pass.
+ *
+ *  The inode must be in use and belong to one of the legal file types.
+ *  It is read as by \e soReadInode and the set of operations the calling process is allowed to perform on it is
+ *  returned, as it would be checked by \e soAccessGranted, without a new pass over the table of inodes. Callers may
+ *  thus check several operations in the order and with the error codes they require.
+ *
+ *  \param p_inode pointer to the buffer where inode data must be read into
+ *  \param nInode number of the inode to be read from
+ *  \param p_mask pointer to a location where the allowed operations are to be stored:
+ *                a bitwise combination of R, W, and X
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the <em>pointers</em> is \c NULL or the <em>inode number</em> is out of range
+ *  \return -\c EIUININVAL, if the inode in use is inconsistent
+ *  \return -\c ELDCININVAL, if the list of data cluster references belonging to an inode is inconsistent
+ *  \return -\c EDCINVAL, if the data cluster header is inconsistent
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soReadInodeAccess (SOInode *p_inode, uint32_t nInode, uint32_t *p_mask);
+
 #endif /* SOFS_IFUNCS_2_H_ */
@@ -17,6 +17,9 @@
 #include "sofs_inode.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_validation.h"
+#include "sofs_accesscache.h"
+#include "sofs_inodecache.h"
 
 /** \brief inode in use status */
 #define IUIN  0
@@ -64,14 +67,17 @@ int soAccessGranted(uint32_t nInode, uint32_t opRequested) {
     soColorProbe(514, "07;31", "soAccessGranted (%"PRIu32", %"PRIu32")\n", nInode, opRequested);
 
     int stat; // function return status control
-    uint32_t nBlk, offset; // inode block position and offset
-    SOInode *p_itable; // pointer to inode table for nBlk block position
+    SOInode *p_in; // pointer to the inode in the cache of inodes
     SOSuperBlock *p_sb; // pointer to the Super Block
-    unsigned int owner, group, other; // owner, group and other permissions
+    uint32_t mask; // operations the calling process is allowed to perform
 
     // check permissions range
     if (opRequested > 7 || opRequested == 0) return -EINVAL;
 
+    // a cached decision was taken upon a consistent inode in use, which has not been changed nor freed since
+    if (soLookupAccessMask(nInode, &mask) == 0)
+        return ((opRequested & mask) == opRequested) ? 0 : -EACCES;
+
     // load super block
     if ((stat = soLoadSuperBlock()) != 0)
         return stat;
@@ -83,62 +89,29 @@ int soAccessGranted(uint32_t nInode, uint32_t opRequested) {
     if (nInode > p_sb->iTotal)
         return -EINVAL;
 
-    // convert inode number to its block position and offset
-    if ((stat = soConvertRefInT(nInode, & nBlk, &offset)) != 0)
+    // get a reference to the inode in the cache of inodes
+    if ((stat = soGetInode(nInode, &p_in)) != 0)
         return stat;
 
-    // get pointer to loaded inode table in nBlk block position
-    if ((stat = soLoadBlockInT(nBlk)) != 0)
-        return 0;
-
-    p_itable = soGetBlockInT();
-
     //check if inode is in use
-    if ((p_itable[offset].mode ^ 0 << 12) == 0) return -EINVAL;
-    //if ((((p_itable[offset].mode >> 12) & 0x1) ^ 0) == 0 ) return -EINVAL;
+    if ((p_in->mode ^ 0 << 12) == 0) {
+        soPutInode(p_in, false);
+        return -EINVAL;
+    }
+    //if ((((p_in->mode >> 12) & 0x1) ^ 0) == 0 ) return -EINVAL;
 
     // check if inode in use is consistent
-    if ((stat = soQCheckInodeIU(p_sb, &p_itable[offset])) != 0)
+    if ((stat = soVCheckInodeIU(p_sb, p_in)) != 0) {
+        soPutInode(p_in, false);
         return stat;
+    }
 
     // end of validations
 
-    /* align owner, group and other permissions bits to right and apply a mask
-     * to the first 3 bits of each group 
-     * 
-     *       |owner|group|other|
-     *  bit: |8|7|6|5|4|3|2|1|0|
-     * perm: |r|w|x|r|w|x|r|w|x|
-     * 
-     */
-
-    owner = (p_itable[offset].mode >> 6) & 0x7;
-    group = (p_itable[offset].mode >> 3) & 0x7;
-    other = p_itable[offset].mode & 0x7;
-
-    if (getuid() == 0) {
-        // root permissions
-
-        // check if requesting for read or write permissions
-        if ((opRequested & (R | W)) > 0) return 0;
-
-        // check if requesting execution permissions
-        if ((opRequested & X) > 0) return 0;
-
-        return -EACCES;
-
-    } else if (getuid() == p_itable[offset].owner) {
-        // check it permissions match "owner" permissions 
-        if ((opRequested & owner) == opRequested) return 0;
-
-    } else if (getuid() == p_itable[offset].group) {
-        // check it permissions match "group" permissions 
-        if ((opRequested & group) == opRequested) return 0;
-
-    } else {
-        // check it permissions match "other" permissions 
-        if ((opRequested & other) == opRequested) return 0;
-    }
+    // the owner, group and other permissions are matched against the process credentials and the decision is cached
+    mask = soAccessMask(nInode, p_in);
+    soPutInode(p_in, false);
+    if ((opRequested & mask) == opRequested) return 0;
 
     // if any of permissions access fail, don't grant access
     return -EACCES;
@@ -19,6 +19,9 @@
 #include "sofs_inode.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_validation.h"
+#include "sofs_atime.h"
+#include "sofs_inodecache.h"
 #ifdef CLEAN_INODE
 #include "sofs_ifuncs_3.h"
 #endif
@@ -32,7 +35,8 @@
  *  \brief Read specific inode data from the table of inodes.
  *
  *  The inode may be either in use and belong to one of the legal file types or be free in the dirty state.
- *  Upon reading, the <em>time of last file access</em> field is set to current time, if the inode is in use.
+ *  Upon reading, the <em>time of last file access</em> field is set to current time, if the inode is in use, according
+ *  to the policy selected by \e soSetAtimePolicy.
  *
  *  \param p_inode pointer to the buffer where inode data must be read into
  *  \param nInode number of the inode to be read from
@@ -58,8 +62,8 @@ int soReadInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
 
   SOSuperBlock *p_sb;  // ponteiro para o super bloco 
   int stat;				// variavel para indicar  estado
-  uint32_t nBlk, offset; // variável para o numero do bloco e seu offset
   SOInode *pInode; // ponteiro para o inode a ser lido
+  bool touched; // o tempo de ultimo acesso foi actualizado
 
   	 /* carregar super bloco */
   if((stat = soLoadSuperBlock()) != 0)
@@ -72,7 +76,7 @@ int soReadInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
   //    return stat;
 
     /*If inode Table is consistency*/
-  if((stat = soQCheckInT(p_sb)) != 0)
+  if((stat = soVCheckInT(p_sb)) != 0)
       return stat;  
 
   //check if the buffer pointer is NULL  
@@ -87,38 +91,43 @@ int soReadInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
   if(nInode >= p_sb->iTotal)
   	  return -EINVAL;
 
-	/* Convert the inode number which translates to an entry of the inode table */
-  if((stat = soConvertRefInT(nInode, &nBlk, &offset)) != 0)
+  //obtem uma referencia para o nó I na cache de nós I (le o bloco da tabela de nós I, se nao estiver la)
+  if((stat = soGetInode(nInode, &pInode)) != 0)
       return stat;
 
-	/*Carrega o conteudo do um bloco especifico da tabela de inodes*/
-  if((stat = soLoadBlockInT(nBlk)) != 0)
-  	  return stat;
-
-
-  //obtem o ponteiro para o bloco que contem o nóI*/
-  pInode = soGetBlockInT();
-
-
   //verifica se o nó em uso é inconsistente
   if(status == IUIN)
   {
-      if((stat = soQCheckInodeIU(p_sb, &pInode[offset])) != 0)
+      if((stat = soVCheckInodeIU(p_sb, pInode)) != 0)
+      {
+          soPutInode(pInode, false);
           return stat;
-
-     //update the access time to the current time
-      pInode[offset].vD1.aTime = time(NULL); 
+      }
   }
 
    // verifica se o nó I livre no estado sujo é insconsistente 
   if(status == FDIN)
   {
-      if((stat = soQCheckFDInode(p_sb, &pInode[offset])) != 0)
+      if((stat = soVCheckFDInode(p_sb, pInode)) != 0)
+      {
+          soPutInode(pInode, false);
           return stat;
+      }
 
   }  
 
-  memcpy(p_inode, &pInode[offset], sizeof(SOInode));
+  memcpy(p_inode, pInode, sizeof(SOInode));
+
+  //update the access time according to the selected policy, the cached inode becoming dirty if it has to be stored
+  touched = (status == IUIN) && soTouchAtime(pInode, nInode, p_inode);
+  soPutInode(pInode, touched);
+
+  //under the strict policy, it is stored right away (only its block, not the whole cache)
+  if(touched && (soGetAtimePolicy() == ATIME_STRICT))
+  {
+      if((stat = soSyncInode(nInode)) != 0)
+          return stat;
+  }
 
   /*guardar tabela de nós I*/
   //if((stat = soStoreBlockInT()) != 0)
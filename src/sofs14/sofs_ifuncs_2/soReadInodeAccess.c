@@ -0,0 +1,53 @@
+/**
+ *  \file soReadInodeAccess.c (implementation file)
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "sofs_probe.h"
+#include "sofs_inode.h"
+#include "sofs_ifuncs_2.h"
+#include "sofs_accesscache.h"
+
+/**
+ *  \brief Read specific inode data from the table of inodes and get its access permissions in a single pass.
+ *
+ *  The inode must be in use and belong to one of the legal file types.
+ *  It is read as by \e soReadInode and the set of operations the calling process is allowed to perform on it is
+ *  returned, as it would be checked by \e soAccessGranted, without a new pass over the table of inodes. Callers may
+ *  thus check several operations in the order and with the error codes they require.
+ *
+ *  \param p_inode pointer to the buffer where inode data must be read into
+ *  \param nInode number of the inode to be read from
+ *  \param p_mask pointer to a location where the allowed operations are to be stored:
+ *                a bitwise combination of R, W, and X
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the <em>pointers</em> is \c NULL or the <em>inode number</em> is out of range
+ *  \return -\c EIUININVAL, if the inode in use is inconsistent
+ *  \return -\c ELDCININVAL, if the list of data cluster references belonging to an inode is inconsistent
+ *  \return -\c EDCINVAL, if the data cluster header is inconsistent
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soReadInodeAccess (SOInode *p_inode, uint32_t nInode, uint32_t *p_mask)
+{
+  soColorProbe (515, "07;31", "soReadInodeAccess (%p, %"PRIu32", %p)\n", p_inode, nInode, p_mask);
+
+  int stat;
+
+  if (p_mask == NULL) return -EINVAL;
+
+  /* the inode in use is checked for consistency upon being read, so its data may be used for the decision */
+
+  if ((stat = soReadInode (p_inode, nInode, IUIN)) != 0)
+     return stat;
+  *p_mask = soAccessMask (nInode, p_inode);
+
+  return 0;
+}
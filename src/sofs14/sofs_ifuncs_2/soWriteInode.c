@@ -17,6 +17,10 @@
 #include "sofs_inode.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_validation.h"
+#include "sofs_inodecache.h"
+#include "sofs_symlinkcache.h"
+#include "sofs_accesscache.h"
 
 /** \brief inode in use status */
 #define IUIN  0
@@ -51,8 +55,8 @@ int soWriteInode(SOInode *p_inode, uint32_t nInode, uint32_t status) {
     soColorProbe(512, "07;31", "soWriteInode (%p, %"PRIu32", %"PRIu32")\n", p_inode, nInode, status);
 
     int stat; // variavel para o estado de erro
-    uint32_t nBlock, offset; //variaveis para localizar o inode pretendido
-    SOInode *p_in; // ponteiro para o inode a ser escrito
+    SOInode inode; // copia do inode a ser escrito
+    SOInode *p_in; // ponteiro para o inode a ser escrito, na cache de inodes
     SOSuperBlock *p_sb; //ponteiro para o superbloco
 
 
@@ -63,7 +67,7 @@ int soWriteInode(SOInode *p_inode, uint32_t nInode, uint32_t status) {
     p_sb = soGetSuperBlock();
 
     //Quick check on the inode Table consistency
-    if ((stat = soQCheckInT(p_sb)) != 0)
+    if ((stat = soVCheckWrite(VCHK_INT, p_sb, NULL)) != 0)
         return stat;
 
     //check if pointer to the inode beeing written is not NULL
@@ -77,38 +81,41 @@ int soWriteInode(SOInode *p_inode, uint32_t nInode, uint32_t status) {
     if (!(nInode >= 0 && nInode < p_sb->iTotal))
         return -EINVAL;
 
-    //find the inode we want in the specific block and it's offset
-    if ((stat = soConvertRefInT(nInode, &nBlock, &offset)) != 0)
-        return stat;
-
-    //load the inode block we want
-    if ((stat = soLoadBlockInT(nBlock)) != 0)
-        return stat;
-
-    //get a pointer to the block containing the inode we want
-    p_in = soGetBlockInT();
-
-    //copy the inode data to the inode we want
-    memcpy(&p_in[offset], p_inode, sizeof (SOInode));
+    //copy the inode data, so that it is checked before it replaces the one in the table
+    memcpy(&inode, p_inode, sizeof (SOInode));
 
     //Quick check of the inode in use consistency
     if (status == IUIN) {
-        if ((stat = soQCheckInodeIU(p_sb, &p_in[offset])) != 0)
+        if ((stat = soVCheckWrite(VCHK_INODEIU, p_sb, &inode)) != 0)
             return stat;
 
         //update the access time and modified time to the current time
-        p_in[offset].vD1.aTime = time(NULL);
-        p_in[offset].vD2.mTime = p_in[offset].vD1.aTime;
+        inode.vD1.aTime = time(NULL);
+        inode.vD2.mTime = inode.vD1.aTime;
     }
 
     //Quick check of the inode in the dirty state consistency
     if (status == FDIN) {
-        if ((stat = soQCheckFDInode(p_sb, &p_in[offset])) != 0)
+        if ((stat = soVCheckWrite(VCHK_FDINODE, p_sb, &inode)) != 0)
             return stat;
     }
 
-    //store the inode back to the inode table
-    if ((stat = soStoreBlockInT()) != 0)
+    //get a reference to the inode in the cache of inodes
+    if ((stat = soGetInode(nInode, &p_in)) != 0)
+        return stat;
+
+    //a change of permissions or owner may change the resolution of the symbolic links and the access decisions
+    if ((p_in->mode != inode.mode) || (p_in->owner != inode.owner) || (p_in->group != inode.group)) {
+        soForgetSymlinkResolutions();
+        soInvalidateAccess(nInode);
+    }
+
+    //the cached inode is replaced and written back to the inode table later on
+    memcpy(p_in, &inode, sizeof (SOInode));
+    soPutInode(p_in, true);
+
+    //a free inode is written through, since the consistency check of the table of inodes reads it from the disk
+    if ((status == FDIN) && ((stat = soSyncInode(nInode)) != 0))
         return stat;
 
     //store the super block back
@@ -18,6 +18,7 @@
 #include "sofs_basicconsist.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
+#include "sofs_refscan.h"
 
 /** \brief operation get the physical number of the referenced data cluster */
 #define GET         0
@@ -61,7 +62,8 @@ int soCleanDataCluster (uint32_t nInode, uint32_t nLClust)
 {
     soColorProbe (415, "07;31", "soCleanDataCluster (%"PRIu32", %"PRIu32")\n", nInode, nLClust);
 
-    int stat, i, j; // stat = error stat of the function; i= auxiliary variable for iterations
+    int stat; // stat = error stat of the function
+    uint32_t i, j, k, n; // auxiliary variables for iterations
     SOSuperBlock *p_sb; // pointer to the super block
     SOInode inode; // inode instance to clean the references
     uint32_t clusterCount = 0; // physical number of the cluster
@@ -112,11 +114,10 @@ int soCleanDataCluster (uint32_t nInode, uint32_t nLClust)
             return stat;
         p_clusterS = soGetDirRefClust();
         //clean all references in i1
-        for(i = 0; i < RPC; i++){
-            if(p_clusterS->info.ref[i-N_DIRECT] != NULL_CLUSTER){
-                if((stat = soHandleFileCluster(nInode, i + N_DIRECT, CLEAN, NULL)) != 0)
-                    return stat;
-            }
+        for(i = soFindNextRef(p_clusterS->info.ref, 0, RPC); i < RPC;
+            i = soFindNextRef(p_clusterS->info.ref, i + 1, RPC)){
+            if((stat = soHandleFileCluster(nInode, i + N_DIRECT, CLEAN, NULL)) != 0)
+                return stat;
         }
         return 0;
     }
@@ -127,21 +128,19 @@ int soCleanDataCluster (uint32_t nInode, uint32_t nLClust)
 
         p_clusterS = soGetDirRefClust();
 
-        for(i = 0; i < RPC; i++){
-            if(p_clusterS->info.ref[i] != NULL_CLUSTER){
-                //if nLCuster is found clean it
-                if(p_clusterS->info.ref[i] == nLClust){
-                    if((stat = soHandleFileCluster(nInode, i + N_DIRECT, CLEAN, NULL)) != 0)
-                        return stat;
-                    return 0;
-                }
-                else
-                    clusterCount++;
-            }
-            //if we parsed all the clusters in the inode and it's not found
-            if(clusterCount == inode.cluCount)
-                return -EDCINVAL;
+        //look for nLCluster and count the references that come before it
+        k = soFindRef(p_clusterS->info.ref, 0, RPC, nLClust);
+        n = soCountRefs(p_clusterS->info.ref, k);
+        //if we parsed all the clusters in the inode and it's not found
+        if(clusterCount + n >= inode.cluCount)
+            return -EDCINVAL;
+        //if nLCuster is found clean it
+        if(k < RPC){
+            if((stat = soHandleFileCluster(nInode, k + N_DIRECT, CLEAN, NULL)) != 0)
+                return stat;
+            return 0;
         }
+        clusterCount += n;
     }
 
 
@@ -153,18 +152,17 @@ int soCleanDataCluster (uint32_t nInode, uint32_t nLClust)
 
         p_clusterS = soGetSngIndRefClust();
         //clean all clusters in indirect and direct references
-        for(i = 0; i < RPC; i++){
-            if(p_clusterS->info.ref[i] != NULL_CLUSTER){
-                if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_clusterS->info.ref[i] * BLOCKS_PER_CLUSTER)) != 0)
-                    return stat;
+        for(i = soFindNextRef(p_clusterS->info.ref, 0, RPC); i < RPC;
+            i = soFindNextRef(p_clusterS->info.ref, i + 1, RPC)){
+            if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_clusterS->info.ref[i] * BLOCKS_PER_CLUSTER)) != 0)
+                return stat;
 
-                p_clusterD = soGetDirRefClust();
+            p_clusterD = soGetDirRefClust();
 
-                for(j = 0; j < RPC; j++){
-                    if(p_clusterD->info.ref[j] != NULL_CLUSTER)
-                        if((stat = soHandleFileCluster(nInode, N_DIRECT + (RPC*(i+1)) + j, CLEAN, NULL)) != 0)
-                            return stat;
-                }  
+            for(j = soFindNextRef(p_clusterD->info.ref, 0, RPC); j < RPC;
+                j = soFindNextRef(p_clusterD->info.ref, j + 1, RPC)){
+                if((stat = soHandleFileCluster(nInode, N_DIRECT + (RPC*(i+1)) + j, CLEAN, NULL)) != 0)
+                    return stat;
             }
         }
         return 0;
@@ -176,49 +174,44 @@ int soCleanDataCluster (uint32_t nInode, uint32_t nLClust)
 
         p_clusterS = soGetSngIndRefClust();
         //parse i2 references
-        for(i = 0; i < RPC; i++){
-            if(p_clusterS->info.ref[i] != NULL_CLUSTER){
+        for(i = soFindNextRef(p_clusterS->info.ref, 0, RPC); i < RPC;
+            i = soFindNextRef(p_clusterS->info.ref, i + 1, RPC)){
 
-                //if nLClust is in direct references
-                if(p_clusterS->info.ref[i] == nLClust){
-                    if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_clusterS->info.ref[i] * BLOCKS_PER_CLUSTER)) != 0)
-                        return stat;
+            //if nLClust is in direct references
+            if(p_clusterS->info.ref[i] == nLClust){
+                if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_clusterS->info.ref[i] * BLOCKS_PER_CLUSTER)) != 0)
+                    return stat;
 
-                    p_clusterD = soGetDirRefClust();
-                    //clean all indirect references for the direct reference entry
-                    for(j = 0; j < RPC; j++){
-                        if(p_clusterD->info.ref[j] != NULL_CLUSTER)
-                            if((stat = soHandleFileCluster(nInode, N_DIRECT + (RPC*(i+1)) + j, CLEAN, NULL)) != 0)
-                                return stat;
-                    } 
-                }
-                //if it's not in the direct references, let's look in all the indirect
-                else{
-                    if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_clusterS->info.ref[i] * BLOCKS_PER_CLUSTER)) != 0)
+                p_clusterD = soGetDirRefClust();
+                //clean all indirect references for the direct reference entry
+                for(j = soFindNextRef(p_clusterD->info.ref, 0, RPC); j < RPC;
+                    j = soFindNextRef(p_clusterD->info.ref, j + 1, RPC)){
+                    if((stat = soHandleFileCluster(nInode, N_DIRECT + (RPC*(i+1)) + j, CLEAN, NULL)) != 0)
                         return stat;
-
-                    p_clusterD = soGetDirRefClust();
-                    //search all the indirect references for each of the direct references
-                    for(j = 0; j < RPC; j++){
-                        if(p_clusterD->info.ref[j] != NULL_CLUSTER){
-                            //if nLCluster is found clean it
-                            if(p_clusterD->info.ref[j] == nLClust){
-                                if((stat = soHandleFileCluster(nInode, N_DIRECT + (RPC*(i+1)) + j, CLEAN, NULL)) != 0)
-                                    return stat;
-                                return 0;
-                            }
-                            else
-                                clusterCount++;
-                        }
-                        if(clusterCount == inode.cluCount)
-                            return -EDCINVAL;      
-                    }
-                    clusterCount++;
                 }
-                //if we parsed all the clusters in the inode and it's not found
-                if(clusterCount == inode.cluCount)
+            }
+            //if it's not in the direct references, let's look in all the indirect
+            else{
+                if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_clusterS->info.ref[i] * BLOCKS_PER_CLUSTER)) != 0)
+                    return stat;
+
+                p_clusterD = soGetDirRefClust();
+                //search all the indirect references for each of the direct references
+                k = soFindRef(p_clusterD->info.ref, 0, RPC, nLClust);
+                n = soCountRefs(p_clusterD->info.ref, k);
+                if(clusterCount + n >= inode.cluCount)
                     return -EDCINVAL;
+                //if nLCluster is found clean it
+                if(k < RPC){
+                    if((stat = soHandleFileCluster(nInode, N_DIRECT + (RPC*(i+1)) + k, CLEAN, NULL)) != 0)
+                        return stat;
+                    return 0;
+                }
+                clusterCount += n + 1;
             }
+            //if we parsed all the clusters in the inode and it's not found
+            if(clusterCount == inode.cluCount)
+                return -EDCINVAL;
         }
     }
     return 0;
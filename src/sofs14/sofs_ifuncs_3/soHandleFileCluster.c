@@ -19,6 +19,7 @@
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
 #include "../sofs_ifuncs_3.h"
+#include "sofs_refscan.h"
 
 /** \brief operation get the logical number of the referenced data cluster for an inode in use */
 #define GET         0
@@ -379,9 +380,7 @@ int soHandleSIndirect(SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uin
             p_dc->info.ref[ref_offset] = NULL_CLUSTER;
             p_inode->cluCount--;
 
-            for (clusterref_pos = 0; clusterref_pos < RPC; clusterref_pos++) {
-                if (p_dc->info.ref[clusterref_pos] != NULL_CLUSTER) break;
-            }
+            clusterref_pos = soFindNextRef(p_dc->info.ref, 0, RPC);
 
             if (clusterref_pos == RPC) {
                 if ((stat = soStoreDirRefClust()) != 0)
@@ -447,6 +446,7 @@ int soHandleDIndirect(SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uin
     uint32_t nclust; // pointer no cluster number
     uint32_t i; // auxiliary variable for counting
     uint32_t clusterref_pos; // cluster reference position
+    bool newD = false; // the double indirect reference data cluster is allocated here
 
     if (op > 4) return -EINVAL;
 
@@ -508,6 +508,7 @@ int soHandleDIndirect(SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uin
 
                 p_dcS->info.ref[ref_Soffset] = nclust;
                 p_inode->cluCount++;
+                newD = true;
 
                 if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_dcS->info.ref[ref_Soffset] * BLOCKS_PER_CLUSTER)) != 0)
                     return stat;
@@ -533,6 +534,16 @@ int soHandleDIndirect(SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uin
             if ((stat = soAttachLogicalCluster(p_sb, nInode, clustInd, p_dcD->info.ref[ref_Doffset])) != 0)
                 return stat;
 
+            // the adjacent data clusters are looked up through the same buffer, so it may hold another cluster now
+            if ((stat = soLoadDirRefClust(p_sb->dZoneStart + p_dcS->info.ref[ref_Soffset] * BLOCKS_PER_CLUSTER)) != 0)
+                return stat;
+
+            p_dcD = soGetDirRefClust();
+
+            if (newD)
+                for (i = 0; i < RPC; i++) p_dcD->info.ref[i] = NULL_CLUSTER;
+            p_dcD->info.ref[ref_Doffset] = nclust;
+
             if ((stat = soStoreDirRefClust()) != 0)
                 return stat;
 
@@ -573,9 +584,7 @@ int soHandleDIndirect(SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uin
             p_dcD->info.ref[ref_Doffset] = NULL_CLUSTER;
             p_inode->cluCount--;
 
-            for (clusterref_pos = 0; clusterref_pos < RPC; clusterref_pos++) {
-                if (p_dcD->info.ref[clusterref_pos] != NULL_CLUSTER) break;
-            }
+            clusterref_pos = soFindNextRef(p_dcD->info.ref, 0, RPC);
 
             if ((stat = soStoreDirRefClust()) != 0)
                 return stat;
@@ -591,9 +600,7 @@ int soHandleDIndirect(SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uin
                 if ((stat = soStoreSngIndRefClust()) != 0)
                     return stat;
 
-                for (clusterref_pos = 0; clusterref_pos < RPC; clusterref_pos++) {
-                    if (p_dcS->info.ref[clusterref_pos] != NULL_CLUSTER) break;
-                }
+                clusterref_pos = soFindNextRef(p_dcS->info.ref, 0, RPC);
 
                 if (clusterref_pos == RPC) {
                     if ((stat = soFreeDataCluster(p_inode->i2)) != 0)
@@ -18,6 +18,7 @@
 #include "sofs_basicconsist.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
+#include "sofs_refscan.h"
 
 /** \brief operation get the physical number of the referenced data cluster */
 #define GET         0
@@ -30,9 +31,13 @@
 /** \brief operation dissociate the referenced data cluster from the inode which describes the file */
 #define CLEAN       4
 
-/* allusion to internal function */
+/* allusion to internal functions */
 
-int soHandleFileCluster (uint32_t nInode, uint32_t clustInd, uint32_t op, uint32_t *p_outVal);
+int soCleanLogicalCluster (SOSuperBlock *p_sb, uint32_t nInode, uint32_t nLClust);
+static int handleDIndirect (SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uint32_t clustIndIn, uint32_t op);
+static int handleSIndirect (SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uint32_t clustIndIn, uint32_t op);
+static int releaseCluster (SOSuperBlock *p_sb, uint32_t nInode, uint32_t nClust, uint32_t op);
+static int endBatch (bool batch);
 
 /**
  *  \brief Handle all data clusters from the list of references starting at a given point.
@@ -56,6 +61,10 @@ int soHandleFileCluster (uint32_t nInode, uint32_t clustInd, uint32_t op, uint32
  *  Thus, the inode must be in use and belong to one of the legal file types for the operations FREE and FREE_CLEAN and
  *  must be free in the dirty state for the operation CLEAN.
  *
+ *  The whole range is handled in a single pass: the inode is read and written once, each cluster of references is
+ *  loaded and stored once, the free data clusters are searched once to check the ones being freed and the superblock
+ *  is stored once, at the end, rather than once per data cluster.
+ *
  *  \param nInode number of the inode associated to the file
  *  \param clustIndIn index to the list of direct references belonging to the inode which is referred (it contains the
  *                    index of the first data cluster to be processed)
@@ -80,100 +89,231 @@ int soHandleFileClusters (uint32_t nInode, uint32_t clustIndIn, uint32_t op)
 {
   soColorProbe (414, "07;31", "soHandleFileClusters (%"PRIu32", %"PRIu32", %"PRIu32")\n", nInode, clustIndIn, op);
 
- SOSuperBlock* p_sb; //carrega o super block para um ponteiro
+    SOSuperBlock* p_sb; //carrega o super block para um ponteiro
     SOInode inode; //inode onde se vai operar
-    SODataClust *clusti2, *clusti1; //data cluster as a node
     int stat; //retorno das validações
-    int index, line, column; //variaveis de incremento dos ciclos
-    int status; //estado do inode (dirty state or use state)
+    uint32_t index; //variavel de incremento do ciclo
+    uint32_t status; //estado do inode (dirty state or use state)
+    bool batch; //os clusters livres sao procurados uma unica vez
 
     /* carregar super block para um ponteiro */
     if ((stat = soLoadSuperBlock()) != 0) return stat;
     p_sb = soGetSuperBlock();
 
     /*Validação de Conformidade*/
-    if ((nInode < 0) || (nInode >= p_sb->iTotal)) return -EINVAL; /* verificar se o índice do i-node é válido */
+    if (nInode >= p_sb->iTotal) return -EINVAL; /* verificar se o índice do i-node é válido */
 
     if (clustIndIn >= MAX_FILE_CLUSTERS) return -EINVAL; /* verificar se o índice do cluster é válido */
 
     if (op < 2 || op > 4) return -EINVAL; /* verificar se a operação é válida: FREE(2), FREE_CLEAN(3) e CLEAN(4) */
 
-    /* lê o inode */
-    if (op == CLEAN)// FDIN = free inode in dirty state
-    {
-        if ((stat = soReadInode(&inode, nInode, FDIN)) != 0) return stat;
-        status = FDIN;
-    } else //IUIN = inode in use state 
-    {
-        if ((stat = soReadInode(&inode, nInode, IUIN)) != 0) return stat;
-        status = IUIN;
-        if ((inode.mode & INODE_TYPE_MASK) == 0) return -EIUININVAL; //if the inode in use is inconsistent
-    }
+    /* lê o inode, uma única vez: as referências são retiradas da cópia local, que é escrita no fim */
+    status = (op == CLEAN) ? FDIN : IUIN;
+    if ((stat = soReadInode(&inode, nInode, status)) != 0) return stat;
+    if ((status == IUIN) && ((inode.mode & INODE_TYPE_MASK) == 0)) return -EIUININVAL; //if the inode in use is inconsistent
 
+    //the superblock is stored once, when all the data clusters were handled, and the free data clusters are searched
+    //once, rather than once per data cluster freed (CLEAN frees only the clusters of references)
+    batch = (op != CLEAN) || (inode.i1 != NULL_CLUSTER) || (inode.i2 != NULL_CLUSTER);
+    if (batch && ((stat = soBeginFreeBatch()) != 0)) return stat;
+    soBeginMetaTransaction();
 
     /*Referencias duplamente indirectas*/
+    if ((stat = handleDIndirect(p_sb, nInode, &inode, clustIndIn, op)) != 0) {
+        endBatch(batch);
+        return stat;
+    }
 
-    if (inode.i2 != NULL_CLUSTER)
+    /*Referencias simplesmente indirectas*/
+    if ((stat = handleSIndirect(p_sb, nInode, &inode, clustIndIn, op)) != 0) {
+        endBatch(batch);
+        return stat;
+    }
+
+    /*Referencias Directas*/
+    for (index = clustIndIn; index < N_DIRECT; index++) /* percorrer as referencias directas */
     {
+        if (inode.d[index] == NULL_CLUSTER) continue;
+        if ((stat = releaseCluster(p_sb, nInode, inode.d[index], op)) != 0) {
+            endBatch(batch);
+            return stat;
+        }
+        if (op != FREE) {
+            inode.d[index] = NULL_CLUSTER;
+            inode.cluCount -= 1;
+        }
+    }
+
+    /* o inode é escrito uma única vez */
+    if ((stat = soWriteInode(&inode, nInode, status)) != 0) {
+        endBatch(batch);
+        return stat;
+    }
+
+    return endBatch(batch);
+}
+
+/**
+ *  \brief End the batch begun to handle the data clusters.
+ *
+ *  \param batch \c true, if a batch of data clusters to be freed was begun, \c false, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by \e soEndMetaTransaction, otherwise
+ */
 
-        if ((stat = soLoadSngIndRefClust((inode.i2 * BLOCKS_PER_CLUSTER) + p_sb->dZoneStart)) != 0) return stat; 
+static int endBatch (bool batch)
+{
+    if (batch) soEndFreeBatch();
 
-        clusti2 = soGetSngIndRefClust(); //pointer to the contents of a specific cluster of the table of single indirect references
+    return soEndMetaTransaction();
+}
 
-        index = N_DIRECT + RPC; //tamanho da tabela das referencias simplesmentre indirectas
+/**
+ *  \brief Handle the data clusters referred to by the list of double indirect references, starting at a given point.
+ *
+ *  Each cluster of direct references is loaded and stored once, whatever the number of references taken from it, and
+ *  it is freed and dissociated itself, as is the cluster of single indirect references, when it becomes empty
+ *  (FREE AND CLEAN / CLEAN).
+ *
+ *  \param p_sb pointer to a buffer where the superblock data is stored
+ *  \param nInode number of the inode associated to the file
+ *  \param p_inode pointer to a buffer which stores the inode contents
+ *  \param clustIndIn index of the first data cluster to be processed
+ *  \param op operation to be performed (FREE, FREE AND CLEAN, CLEAN)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> of the function which failed, otherwise
+ */
+
+static int handleDIndirect (SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uint32_t clustIndIn, uint32_t op)
+{
+    SODataClust *clusti2, *clusti1; //data cluster as a node
+    uint32_t index, line, column; //variaveis de incremento dos ciclos
+    int stat; //retorno das validações
+
+    if (p_inode->i2 == NULL_CLUSTER) return 0;
+
+    line = (clustIndIn > N_DIRECT + RPC) ? (clustIndIn - N_DIRECT - RPC) / RPC : 0;
+
+    if ((stat = soLoadSngIndRefClust((p_inode->i2 * BLOCKS_PER_CLUSTER) + p_sb->dZoneStart)) != 0) return stat;
+    clusti2 = soGetSngIndRefClust(); //pointer to the contents of a specific cluster of the table of single indirect references
+    if (clusti2->stat != nInode) return -EWGINODENB;
+
+    // the references which are NULL_CLUSTER are skipped a group at a time
+    for (line = soFindNextRef(clusti2->info.ref, line, RPC); line < RPC;
+         line = soFindNextRef(clusti2->info.ref, line + 1, RPC))
+    {
+        index = N_DIRECT + RPC + line * RPC; //indice do primeiro cluster referenciado por esta linha
+        column = (clustIndIn > index) ? clustIndIn - index : 0;
 
-        while (inode.i2 != NULL_CLUSTER && index < MAX_FILE_CLUSTERS)
+        if ((stat = soLoadDirRefClust((clusti2->info.ref[line] * BLOCKS_PER_CLUSTER) + p_sb->dZoneStart)) != 0)
+            return stat;
+        clusti1 = soGetDirRefClust(); //pointer to the contents of a specific cluster of the table of direct references
+        if (clusti1->stat != nInode) return -EWGINODENB;
+
+        for (column = soFindNextRef(clusti1->info.ref, column, RPC); column < RPC;
+             column = soFindNextRef(clusti1->info.ref, column + 1, RPC))
         {
-            line = (index - (RPC + N_DIRECT)) / RPC;
-            if (clusti2->info.ref[line] != NULL_CLUSTER) 
-            {
-                if ((stat = soLoadDirRefClust((clusti2->info.ref[line] * BLOCKS_PER_CLUSTER) + p_sb->dZoneStart)) != 0) return stat;//????
-
-                clusti1 = soGetDirRefClust(); //pointer to the contents of a specific cluster of the table of direct references
-
-                for (column = ((index - (RPC + N_DIRECT)) % RPC); column < RPC; column++, index++)
-                {
-                    if (clusti1->info.ref[column] != NULL_CLUSTER && clustIndIn <= index) 
-                    {
-                        if ((stat = soHandleFileCluster(nInode, index, op, NULL)) != 0) return stat;
-                        if ((stat = soReadInode(&inode, nInode, status)) != 0) return stat;
-                    }
-                }
-            } 
-            else
-                index += RPC;
+            if ((stat = releaseCluster(p_sb, nInode, clusti1->info.ref[column], op)) != 0) return stat;
+            if (op != FREE) {
+                clusti1->info.ref[column] = NULL_CLUSTER;
+                p_inode->cluCount -= 1;
+            }
+        }
+        if (op == FREE) continue;
 
+        //the cluster of direct references is stored once, and freed if it became empty
+        if ((stat = soStoreDirRefClust()) != 0) return stat;
+        if (soFindNextRef(clusti1->info.ref, 0, RPC) == RPC) {
+            if ((stat = releaseCluster(p_sb, nInode, clusti2->info.ref[line], FREE_CLEAN)) != 0) return stat;
+            clusti2->info.ref[line] = NULL_CLUSTER;
+            p_inode->cluCount -= 1;
         }
     }
+    if (op == FREE) return 0;
 
-    /*Referencias simplesmente indirectas*/
-    if (inode.i1 != NULL_CLUSTER) //reference to the data cluster that holds the next group of direct references
-    {
-        if ((stat = soLoadDirRefClust((inode.i1 * BLOCKS_PER_CLUSTER) + p_sb->dZoneStart)) != 0) return stat;
+    if ((stat = soStoreSngIndRefClust()) != 0) return stat;
+    if (soFindNextRef(clusti2->info.ref, 0, RPC) == RPC) {
+        if ((stat = releaseCluster(p_sb, nInode, p_inode->i2, FREE_CLEAN)) != 0) return stat;
+        p_inode->i2 = NULL_CLUSTER;
+        p_inode->cluCount -= 1;
+    }
 
-        clusti1 = soGetDirRefClust(); //pointer to the contents of a specific cluster of the table of direct references
+    return 0;
+}
 
-        index = N_DIRECT;
+/**
+ *  \brief Handle the data clusters referred to by the list of single indirect references, starting at a given point.
+ *
+ *  The cluster of direct references is loaded and stored once, whatever the number of references taken from it, and
+ *  it is freed and dissociated itself when it becomes empty (FREE AND CLEAN / CLEAN).
+ *
+ *  \param p_sb pointer to a buffer where the superblock data is stored
+ *  \param nInode number of the inode associated to the file
+ *  \param p_inode pointer to a buffer which stores the inode contents
+ *  \param clustIndIn index of the first data cluster to be processed
+ *  \param op operation to be performed (FREE, FREE AND CLEAN, CLEAN)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> of the function which failed, otherwise
+ */
 
-        while (inode.i1 != NULL_CLUSTER && index < N_DIRECT + RPC)//percorrer as referencias simplesmente indirectas
-        {
+static int handleSIndirect (SOSuperBlock *p_sb, uint32_t nInode, SOInode *p_inode, uint32_t clustIndIn, uint32_t op)
+{
+    SODataClust *clusti1; //data cluster as a node
+    uint32_t column; //variavel de incremento do ciclo
+    int stat; //retorno das validações
 
-            line = index - N_DIRECT; 
+    if ((p_inode->i1 == NULL_CLUSTER) || (clustIndIn >= N_DIRECT + RPC)) return 0;
 
-            if (clusti1->info.ref[line] != NULL_CLUSTER && clustIndIn <= index) /* verificar se esta referência é para um cluster válido */ {
-                if ((stat = soHandleFileCluster(nInode, index, op, NULL)) != 0) return stat; /* executar a operação de HANDLE pretendida neste cluster */
-                if ((stat = soReadInode(&inode, nInode, status)) != 0) return stat; //leitura do inode
-            }
-            index++;
+    if ((stat = soLoadDirRefClust((p_inode->i1 * BLOCKS_PER_CLUSTER) + p_sb->dZoneStart)) != 0) return stat;
+    clusti1 = soGetDirRefClust(); //pointer to the contents of a specific cluster of the table of direct references
+    if (clusti1->stat != nInode) return -EWGINODENB;
+
+    column = (clustIndIn > N_DIRECT) ? clustIndIn - N_DIRECT : 0;
+
+    //percorrer as referencias simplesmente indirectas, saltando as que sao NULL_CLUSTER
+    for (column = soFindNextRef(clusti1->info.ref, column, RPC); column < RPC;
+         column = soFindNextRef(clusti1->info.ref, column + 1, RPC))
+    {
+        if ((stat = releaseCluster(p_sb, nInode, clusti1->info.ref[column], op)) != 0) return stat;
+        if (op != FREE) {
+            clusti1->info.ref[column] = NULL_CLUSTER;
+            p_inode->cluCount -= 1;
         }
     }
+    if (op == FREE) return 0;
 
-    /*Referencias Directas*/
-    for (index = 0; index < N_DIRECT; index++)/* percorrer as referencias directas */ 
-    {
-        if (inode.d[index] != NULL_CLUSTER && clustIndIn <= index)/* verificar se esta referência é para um cluster válido */
-            if ((stat = soHandleFileCluster(nInode, index, op, NULL)) != 0) return stat; /* executar a operação de HANDLE pretendida neste cluster */
+    //the cluster of direct references is stored once, and freed if it became empty
+    if ((stat = soStoreDirRefClust()) != 0) return stat;
+    if (soFindNextRef(clusti1->info.ref, 0, RPC) == RPC) {
+        if ((stat = releaseCluster(p_sb, nInode, p_inode->i1, FREE_CLEAN)) != 0) return stat;
+        p_inode->i1 = NULL_CLUSTER;
+        p_inode->cluCount -= 1;
     }
 
     return 0;
 }
+
+/**
+ *  \brief Free and / or dissociate a data cluster from the inode which describes the file.
+ *
+ *  \param p_sb pointer to a buffer where the superblock data is stored
+ *  \param nInode number of the inode associated to the file
+ *  \param nClust logical number of the data cluster
+ *  \param op operation to be performed (FREE, FREE AND CLEAN, CLEAN)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by \e soFreeDataCluster or \e soCleanLogicalCluster, otherwise
+ */
+
+static int releaseCluster (SOSuperBlock *p_sb, uint32_t nInode, uint32_t nClust, uint32_t op)
+{
+    int stat; //retorno das validações
+
+    if ((op != CLEAN) && ((stat = soFreeDataCluster(nClust)) != 0)) return stat;
+    if (op == FREE) return 0;
+
+    return soCleanLogicalCluster(p_sb, nInode, nClust);
+}
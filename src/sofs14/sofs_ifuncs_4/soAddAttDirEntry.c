@@ -18,6 +18,8 @@
 #include "sofs_direntry.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_dircount.h"
+#include "sofs_symlinkcache.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
 #include "sofs_ifuncs_3.h"
@@ -98,6 +100,9 @@ int soAddAttDirEntry(uint32_t nInodeDir, const char *eName, uint32_t nInodeEnt,
     uint32_t nLClust; // logical cluster number
     SODataClust dcDir; // insertion directory data cluster
     unsigned int i; // counting variable
+    uint32_t mask; // operations allowed on an inode
+    uint32_t count; // number of entries in use of the directory
+    bool known; // the number of entries in use of the directory is known
     SODataClust dcEnt; // entry directory data cluster
 
     if ((stat = soLoadSuperBlock()) != 0)
@@ -117,17 +122,15 @@ int soAddAttDirEntry(uint32_t nInodeDir, const char *eName, uint32_t nInodeEnt,
 
     if (c != NULL) return -EINVAL;
 
-    if ((stat = soReadInode(&inodeDir, nInodeDir, IUIN)) != 0)
+    if ((stat = soReadInodeAccess(&inodeDir, nInodeDir, &mask)) != 0)
         return stat;
 
-    if ((stat = soAccessGranted(nInodeDir, (W))) != 0)
-        return stat;
+    if ((mask & W) != W) return -EACCES;
 
-    if ((stat = soReadInode(&inodeEnt, nInodeEnt, IUIN)) != 0)
+    if ((stat = soReadInodeAccess(&inodeEnt, nInodeEnt, &mask)) != 0)
         return stat;
 
-    if ((stat = soAccessGranted(nInodeEnt, (R))) != 0)
-        return stat;
+    if ((mask & R) != R) return -EACCES;
 
     // check if inode dir is a directory
     if ((inodeDir.mode & INODE_DIR) == 0) return -ENOTDIR;
@@ -146,6 +149,11 @@ int soAddAttDirEntry(uint32_t nInodeDir, const char *eName, uint32_t nInodeEnt,
     else if (stat != -ENOENT)
         return stat;
 
+    // the number of entries in use of the directory is only kept if the operation succeeds
+    known = (soGetDirCount(nInodeDir, &count) == 0);
+    soForgetDirCount(nInodeDir);
+    soForgetSymlinkResolutions();
+
     // calculate cluster position
     clusterIdx = dirIdx / DPC;
 
@@ -271,5 +279,12 @@ int soAddAttDirEntry(uint32_t nInodeDir, const char *eName, uint32_t nInodeEnt,
     if ((stat = soWriteInode(&inodeDir, nInodeDir, IUIN)) != 0)
         return stat;
 
+    if (known)
+        soSetDirCount(nInodeDir, count + 1);
+
+    // an added directory holds only "." and ".."
+    if ((op == ADD) && ((inodeEnt.mode & INODE_DIR) == INODE_DIR))
+        soSetDirCount(nInodeEnt, 0);
+
     return 0;
 }
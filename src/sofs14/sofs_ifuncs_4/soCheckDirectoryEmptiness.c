@@ -0,0 +1,99 @@
+/**
+ *  \file soCheckDirectoryEmptiness.c (implementation file)
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+
+#include "sofs_probe.h"
+#include "sofs_buffercache.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_direntry.h"
+#include "sofs_datacluster.h"
+#include "sofs_basicoper.h"
+#include "sofs_basicconsist.h"
+#include "sofs_validation.h"
+#include "sofs_dircount.h"
+#include "sofs_ifuncs_2.h"
+#include "sofs_ifuncs_3.h"
+
+/**
+ *  \brief Check a directory status of emptiness.
+ *
+ *  The directory contents is parsed to assert if all its entries, except for the first two, are free. Thus, the inode
+ *  associated to the directory must be in use and belong to the directory type.
+ *
+ *  The two first aforementioned entries must be in use and be named, respectively, "." and "..".
+ *
+ *  The directory contents is only parsed if the number of entries in use is not known yet: it is then kept, so that
+ *  further checks on the same directory do not parse it again. The names of the two first entries are checked when
+ *  the contents is parsed.
+ *
+ *  \param nInodeDir number of the inode associated to the directory
+ *
+ *  \return <tt>0 (zero)</tt>, if the directory is empty
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range
+ *  \return -\c ENOTDIR, if the inode type is not a directory
+ *  \return -\c ENOTEMPTY, if the directory is not empty
+ *  \return -\c EDIRINVAL, if the directory is inconsistent
+ *  \return -\c EDEINVAL, if the directory entry is inconsistent
+ *  \return -\c EIUININVAL, if the inode in use is inconsistent
+ *  \return -\c ELDCININVAL, if the list of data cluster references belonging to an inode is inconsistent
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soCheckDirectoryEmptiness (uint32_t nInodeDir)
+{
+    soColorProbe (316, "07;31", "soCheckDirectoryEmptiness (%"PRIu32")\n", nInodeDir);
+
+    SOSuperBlock *p_sb; // pointer to the superblock
+    SOInode inode; // inode associated to the directory
+    SODataClust dc; // cluster of directory entries
+    uint32_t count; // number of entries in use, besides "." and ".."
+    uint32_t nClust, i; // counting variables
+    int stat; // function return status control
+
+    if ((stat = soLoadSuperBlock()) != 0)
+        return stat;
+
+    p_sb = soGetSuperBlock();
+
+    if (nInodeDir >= p_sb->iTotal)
+        return -EINVAL;
+
+    if ((stat = soReadInode(&inode, nInodeDir, IUIN)) != 0)
+        return stat;
+
+    if ((inode.mode & INODE_DIR) != INODE_DIR)
+        return -ENOTDIR;
+
+    if ((stat = soVCheckDirCont(p_sb, &inode)) != 0)
+        return stat;
+
+    // the directory contents is only parsed if the number of entries in use is not known yet
+    if (soGetDirCount(nInodeDir, &count) != 0) {
+        count = 0;
+        for (nClust = 0; nClust < inode.size / (DPC * sizeof (SODirEntry)); nClust++) {
+            if ((stat = soReadFileCluster(nInodeDir, nClust, &dc)) != 0)
+                return stat;
+
+            if ((nClust == 0) && ((strcmp((char *) dc.info.de[0].name, ".") != 0) ||
+                                  (strcmp((char *) dc.info.de[1].name, "..") != 0)))
+                return -EDIRINVAL;
+
+            for (i = (nClust == 0) ? 2 : 0; i < DPC; i++)
+                if (dc.info.de[i].name[0] != '\0')
+                    count += 1;
+        }
+        soSetDirCount(nInodeDir, count);
+    }
+
+    return (count == 0) ? 0 : -ENOTEMPTY;
+}
@@ -18,6 +18,7 @@
 #include "sofs_direntry.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_validation.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
 #include "sofs_ifuncs_3.h"
@@ -67,6 +68,7 @@ int soGetDirEntryByName (uint32_t nInodeDir, const char *eName, uint32_t *p_nIno
   int stat; //variavel para status
   SOSuperBlock *p_sb; //ponteiro para super bloco
   SOInode inode; //variavel para inode
+  uint32_t mask; //operacoes permitidas sobre o inode
   SODataClust dc; //variavel para data cluster
   char *c; //ponteiro para verificaçao de string
   
@@ -93,8 +95,8 @@ int soGetDirEntryByName (uint32_t nInodeDir, const char *eName, uint32_t *p_nIno
   if(strlen(eName) > MAX_NAME)
     return -ENAMETOOLONG;
   
-  //Ler o inode desejado
-  if((stat = soReadInode(&inode, nInodeDir, IUIN)) != 0)
+  //Ler o inode desejado e obter as permissoes do processo num so passo
+  if((stat = soReadInodeAccess(&inode, nInodeDir, &mask)) != 0)
     return stat;
   
   //Verificar se o inode é um directorio
@@ -102,11 +104,11 @@ int soGetDirEntryByName (uint32_t nInodeDir, const char *eName, uint32_t *p_nIno
     return -ENOTDIR;
   
   //Verificar se o inode tem as permisoes de execução
-  if((stat = soAccessGranted(nInodeDir, X)) != 0)
-    return stat;
+  if((mask & X) != X)
+    return -EACCES;
   
   //Verificar inconsistencia do directorio
-  if((stat = soQCheckDirCont(p_sb, &inode)) != 0)
+  if((stat = soVCheckDirCont(p_sb, &inode)) != 0)
     return stat;
   
   //FIM das Validaçoes
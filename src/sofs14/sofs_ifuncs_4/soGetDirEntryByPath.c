@@ -19,6 +19,7 @@
 #include "sofs_direntry.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_symlinkcache.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
 #include "sofs_ifuncs_3.h"
@@ -32,13 +33,13 @@ int soGetDirEntryByName(uint32_t nInodeDir, const char *eName, uint32_t *p_nInod
 
 int soTraversePath(const char *ePath, uint32_t *p_nInodeDir, uint32_t *p_nInodeEnt);
 
-/** \brief Number of symbolic links in the path */
+/** \brief Number of symbolic links in the path (one per thread, so that paths are traversed in parallel) */
 
-static uint32_t nSymLinks = 0;
+static __thread uint32_t nSymLinks = 0;
 
-/** \brief Old directory inode number */
+/** \brief Old directory inode number (one per thread) */
 
-static uint32_t oldNInodeDir = 0;
+static __thread uint32_t oldNInodeDir = 0;
 
 /**
  *  \brief Get an entry by path.
@@ -50,6 +51,9 @@ static uint32_t oldNInodeDir = 0;
  *  The process that calls the operation must have execution (x) permission on all the components of the path with
  *  exception of the rightmost one.
  *
+ *  The targets of the symbolic links and the results of their resolution are kept in the cache of symbolic links, so
+ *  that following the same symbolic link again neither reads its data cluster nor traverses its target path.
+ *
  *  \param ePath pointer to the string holding the name of the path
  *  \param p_nInodeDir pointer to the location where the number of the inode associated to the directory that holds the
  *                     entry is to be stored
@@ -202,16 +206,27 @@ int soTraversePath(const char *ePath, uint32_t *p_nInodeDir, uint32_t *p_nInodeE
 
         if (inode.mode & INODE_SYMLINK) {
 
+            uint32_t nInodeLink = *p_nInodeEnt; // atalho a seguir
+            uint32_t nInodeFrom = *p_nInodeDir; // directorio de onde e seguido
+
+            // se o atalho ja foi resolvido a partir deste directorio, nada mudou entretanto
+            if (soGetSymlinkResolution(nInodeLink, nInodeFrom, p_nInodeDir, p_nInodeEnt) == 0)
+                return 0;
 
             //printf("SymLink: %s\n", name);
             char save[MAX_PATH + 1];
-            if ((stat = soReadFileCluster(*p_nInodeEnt, 0, &dc)) != 0) //  0 -> clusterNumber,symlinks fits in clust 0
-                return stat;
+            // o alvo so e lido do cluster se ainda nao for conhecido
+            if (soGetSymlinkTarget(nInodeLink, save) != 0) {
+                if ((stat = soReadFileCluster(nInodeLink, 0, &dc)) != 0) //  0 -> clusterNumber,symlinks fits in clust 0
+                    return stat;
+                strncpy(save, (char*) dc.info.de[0].name, MAX_PATH);
+                save[MAX_PATH] = '\0';
+                soSetSymlinkTarget(nInodeLink, save);
+            }
 
-            if (dc.info.de[0].name[0] != '/') { // se nao comecar por barra, nao e caminho absoluto
+            if (save[0] != '/') { // se nao comecar por barra, nao e caminho absoluto
 
                 //              printf("Not an absolut path\n");
-                strcpy(save, (char*) dc.info.de[0].name);
 
                 nSymLinks++;
                 oldNInodeDir = *p_nInodeDir;
@@ -221,12 +236,13 @@ int soTraversePath(const char *ePath, uint32_t *p_nInodeDir, uint32_t *p_nInodeE
 
             } else {
                 //                printf("Absolut path\n");
-                strcpy(save, (char*) dc.info.de[0].name);
                 if ((stat = soTraversePath(save, p_nInodeDir, p_nInodeEnt)) != 0)
                     return stat;
 
             }
 
+            soSetSymlinkResolution(nInodeLink, nInodeFrom, *p_nInodeDir, *p_nInodeEnt);
+
         }
 
     }
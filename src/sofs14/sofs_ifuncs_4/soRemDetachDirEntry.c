@@ -18,6 +18,8 @@
 #include "sofs_direntry.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_dircount.h"
+#include "sofs_symlinkcache.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
 #include "sofs_ifuncs_3.h"
@@ -87,18 +89,21 @@ int soRemDetachDirEntry (uint32_t nInodeDir, const char *eName, uint32_t op)
     SOInode inodeEnt, inodeDir; // inode given and indode of the entry
     SODataClust dirEnt; //Data cluster of the entry
     uint32_t nInodeEnt, idx; //auxiliary variables
+    uint32_t mask; //operations allowed on the directory
+    uint32_t count; //number of entries in use of the directory
+    bool known; //the number of entries in use of the directory is known
     int stat, i; //error variable and iterable variable 
    
-    if((stat = soReadInode(&inodeDir, nInodeDir, IUIN)) != 0)      
+    if((stat = soReadInodeAccess(&inodeDir, nInodeDir, &mask)) != 0)
         return stat;
 
     if((inodeDir.mode & INODE_DIR) != INODE_DIR)
         return -ENOTDIR;
 
-    if((stat = soAccessGranted(nInodeDir, X)) != 0)
-        return stat;
+    if((mask & X) != X)
+        return -EACCES;
 
-    if((stat = soAccessGranted(nInodeDir, W)) != 0)
+    if((mask & W) != W)
         return -EPERM;
 
     if(eName == NULL)
@@ -122,6 +127,11 @@ int soRemDetachDirEntry (uint32_t nInodeDir, const char *eName, uint32_t op)
     if((stat=soReadInode(&inodeEnt, nInodeEnt, IUIN)) !=0)      
         return stat;
 
+    //the number of entries in use of the directory is only kept if the operation succeeds
+    known = (soGetDirCount(nInodeDir, &count) == 0);
+    soForgetDirCount(nInodeDir);
+    soForgetSymlinkResolutions();
+
     if(op == REM){
         //check if it's a directory and if it's empty
         if((inodeEnt.mode & INODE_DIR) == INODE_DIR){
@@ -159,6 +169,7 @@ int soRemDetachDirEntry (uint32_t nInodeDir, const char *eName, uint32_t op)
             //free the inode it self
             if((stat=soFreeInode(nInodeEnt)) != 0)
                     return stat;
+            soForgetDirCount(nInodeEnt);
                    
             if((stat=soWriteInode(&inodeDir, nInodeDir, IUIN)) != 0)
                     return stat;
@@ -203,7 +214,8 @@ int soRemDetachDirEntry (uint32_t nInodeDir, const char *eName, uint32_t op)
             return stat;
     }
    
-    
+    if(known)
+        soSetDirCount(nInodeDir, count - 1);
 
     return 0;
 }
@@ -18,6 +18,7 @@
 #include "sofs_direntry.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_symlinkcache.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
 #include "sofs_ifuncs_3.h"
@@ -69,6 +70,7 @@ int soRenameDirEntry(uint32_t nInodeDir, const char *oldName, const char *newNam
     SOInode inode; //ponteiro para o inode 
     SOSuperBlock* p_sb; //ponteiro para o superbloco 
     uint32_t nInodeEnt, idx, idx1, idx2;
+    uint32_t mask; //operacoes permitidas sobre o directorio
 
     //verifica se o superblock foi bem carregado
     if ((erro = soLoadSuperBlock())) return erro;
@@ -87,17 +89,17 @@ int soRenameDirEntry(uint32_t nInodeDir, const char *oldName, const char *newNam
         return -ENAMETOOLONG;
 
     //le o inode associado ao directorio, tem de ser usado e pertencer ao tipo directorio
-    if ((erro = soReadInode(&inode, nInodeDir, IUIN)) != 0)
+    if ((erro = soReadInodeAccess(&inode, nInodeDir, &mask)) != 0)
         return erro;
 
     if ((inode.mode & INODE_TYPE_MASK) != INODE_DIR)
         return -ENOTDIR;
 
     //verificar permissões
-    if ((erro = soAccessGranted(nInodeDir, X)))
+    if ((mask & X) != X)
         return -EACCES;
 
-    if ((erro = soAccessGranted(nInodeDir, W)))
+    if ((mask & W) != W)
         return -EPERM;
 
     //verifica se oldName ja existe
@@ -115,6 +117,7 @@ int soRenameDirEntry(uint32_t nInodeDir, const char *oldName, const char *newNam
     if (!erro)
         return -EEXIST;
     SODataClust dcDir;
+    soForgetSymlinkResolutions(); //os atalhos resolvidos atraves deste directorio deixam de ser validos
     if ((erro = soReadFileCluster(nInodeDir, idx1, &dcDir)))
         return erro;
 
@@ -0,0 +1,407 @@
+/**
+ *  \file sofs_inodecache.c (implementation file)
+ *
+ *  \brief Cache of inodes.
+ *
+ *  The cached inodes are kept in a fixed set of entries, linked in hash chains on the inode number and in a list
+ *  ordered by last access, which is used to select the entry to be evicted when room is needed.
+ *
+ *  The block of the table of inodes held in internal storage is kept up to date with the dirty cached inodes: they are
+ *  merged into it whenever it is loaded and copied into it whenever they are released as dirty.
+ *
+ *  The following operations are defined:
+ *    \li get a reference to a cached inode
+ *    \li release a reference to a cached inode
+ *    \li merge the dirty cached inodes into a block of the table of inodes which was loaded
+ *    \li update the cached inodes from a block of the table of inodes which is about to be stored
+ *    \li write back a dirty cached inode
+ *    \li write back all the dirty cached inodes
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include "sofs_probe.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_basicoper.h"
+#include "sofs_inodecache.h"
+
+/**
+ *  \brief Definition of an entry of the cache of inodes.
+ */
+
+typedef struct soInodeEntry
+{
+   /** \brief inode data (it must be the first field: references to cached inodes point to it) */
+    SOInode inode;
+   /** \brief number of the inode */
+    uint32_t nInode;
+   /** \brief number of references to the inode */
+    uint32_t refCount;
+   /** \brief entry state: \c true, if it holds an inode */
+    bool valid;
+   /** \brief inode state: \c true, if it was changed and not yet written back */
+    bool dirty;
+   /** \brief pointer to the next entry in the hash chain */
+    struct soInodeEntry *hNext;
+   /** \brief pointer to the previous entry in the list ordered by last access */
+    struct soInodeEntry *prev;
+   /** \brief pointer to the next entry in the list ordered by last access */
+    struct soInodeEntry *next;
+} SOInodeEntry;
+
+/**
+ *  \brief Definition of the state of the cache of inodes.
+ */
+
+typedef struct soInodeCacheState
+{
+   /** \brief entries of the cache */
+    SOInodeEntry entry[INODE_CACHE_SIZE];
+   /** \brief heads of the hash chains */
+    SOInodeEntry *bucket[INODE_CACHE_BUCKETS];
+   /** \brief head (most recently used entry) of the list ordered by last access */
+    SOInodeEntry *lruHead;
+   /** \brief tail (least recently used entry) of the list ordered by last access */
+    SOInodeEntry *lruTail;
+   /** \brief logical number of the block of the table of inodes held in internal storage (-1, if none) */
+    int resNBlk;
+   /** \brief pointer to the contents of the block of the table of inodes held in internal storage */
+    SOInode *resBlk;
+} SOInodeCacheState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOInodeCacheState defState = { .lruHead = NULL, .lruTail = NULL, .resNBlk = -1, .resBlk = NULL };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOInodeCacheState *cur = &defState;
+
+/* Allusion to internal functions */
+
+static void init (void);
+static SOInodeEntry *lookup (uint32_t nInode);
+static void unhash (SOInodeEntry *p);
+static void moveAtHead (SOInodeEntry *p);
+static int flushBlock (uint32_t nBlk);
+static int cmpBlk (const void *a, const void *b);
+
+/**
+ *  \brief Get a reference to a cached inode.
+ *
+ *  If the inode is not in the cache, it is read from the table of inodes, eventually after evicting the least recently
+ *  used inode which is not referenced (written back first, together with the other dirty inodes of its block, if it
+ *  is dirty). No consistency checks are performed.
+ *
+ *  \param nInode number of the inode
+ *  \param pp_inode pointer to a location where the pointer to the cached inode is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL or the <em>inode number</em> is out of range
+ *  \return -\c EBUSY, if all the cached inodes are referenced
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soGetInode (uint32_t nInode, SOInode **pp_inode)
+{
+  soColorProbe (731, "07;31", "soGetInode (%"PRIu32", %p)\n", nInode, pp_inode);
+
+  SOInodeEntry *p;
+  uint32_t nBlk, offset;
+  int stat;
+
+  if (pp_inode == NULL) return -EINVAL;
+  if ((stat = soConvertRefInT (nInode, &nBlk, &offset)) != 0)
+     return stat;
+  if (cur->lruHead == NULL) init ();
+
+  if ((p = lookup (nInode)) == NULL)
+     { /* the inode is not in the cache yet: the least recently used entry which is not referenced is taken */
+       for (p = cur->lruTail; (p != NULL) && (p->refCount != 0); p = p->prev) ;
+       if (p == NULL) return -EBUSY;
+       if (p->valid)
+          { if (p->dirty && ((stat = flushBlock (p->nInode / IPB)) != 0))
+               return stat;
+            unhash (p);
+          }
+       if ((stat = soLoadBlockInT (nBlk)) != 0)
+          return stat;
+       p->inode = soGetBlockInT ()[offset];
+       p->nInode = nInode;
+       p->valid = true;
+       p->dirty = false;
+       p->hNext = cur->bucket[nInode % INODE_CACHE_BUCKETS];
+       cur->bucket[nInode % INODE_CACHE_BUCKETS] = p;
+     }
+  moveAtHead (p);
+  p->refCount += 1;
+  *pp_inode = &p->inode;
+
+  return 0;
+}
+
+/**
+ *  \brief Release a reference to a cached inode.
+ *
+ *  \param p_inode pointer to the cached inode, as returned by \e soGetInode
+ *  \param dirty \c true, if the cached inode was changed, \c false, otherwise
+ */
+
+void soPutInode (SOInode *p_inode, bool dirty)
+{
+  SOInodeEntry *p = (SOInodeEntry *) p_inode;
+
+  if (p->refCount > 0) p->refCount -= 1;
+  if (dirty)
+     { p->dirty = true;
+       if ((int) (p->nInode / IPB) == cur->resNBlk)
+          cur->resBlk[p->nInode % IPB] = p->inode;
+     }
+}
+
+/**
+ *  \brief Merge the dirty cached inodes into a block of the table of inodes which was loaded.
+ *
+ *  It should be called whenever a block of the table of inodes is read into internal storage.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes held in internal storage
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+void soMergeInodeBlock (SOInode *p_blk, uint32_t nBlk)
+{
+  SOInodeEntry *p;
+  uint32_t i;
+
+  cur->resNBlk = (int) nBlk;
+  cur->resBlk = p_blk;
+  for (i = 0; i < IPB; i++)
+    if (((p = lookup (nBlk * IPB + i)) != NULL) && p->dirty)
+       p_blk[i] = p->inode;
+}
+
+/**
+ *  \brief Update the cached inodes from a block of the table of inodes which is about to be stored.
+ *
+ *  It should be called whenever a block of the table of inodes is about to be stored. The cached inodes of the block
+ *  are marked clean.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes held in internal storage
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+void soSyncInodeBlock (SOInode *p_blk, uint32_t nBlk)
+{
+  SOInodeEntry *p;
+  uint32_t i;
+
+  for (i = 0; i < IPB; i++)
+    if ((p = lookup (nBlk * IPB + i)) != NULL)
+       { p->inode = p_blk[i];
+         p->dirty = false;
+       }
+}
+
+/**
+ *  \brief Write back a dirty cached inode.
+ *
+ *  The other dirty cached inodes of its block are written back together with it. Nothing is done if the inode is not
+ *  in the cache or is clean.
+ *
+ *  \param nInode number of the inode
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSyncInode (uint32_t nInode)
+{
+  soColorProbe (762, "07;31", "soSyncInode (%"PRIu32")\n", nInode);
+
+  SOInodeEntry *p;
+
+  if (((p = lookup (nInode)) == NULL) || !p->dirty) return 0;
+
+  return flushBlock (nInode / IPB);
+}
+
+/**
+ *  \brief Write back all the dirty cached inodes.
+ *
+ *  The inodes are grouped by block of the table of inodes, so that each block is loaded and stored only once.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSyncInodes (void)
+{
+  soColorProbe (732, "07;31", "soSyncInodes ()\n");
+
+  uint32_t blk[INODE_CACHE_SIZE];
+  uint32_t i, n = 0;
+  int stat;
+
+  for (i = 0; i < INODE_CACHE_SIZE; i++)
+    if (cur->entry[i].valid && cur->entry[i].dirty)
+       blk[n++] = cur->entry[i].nInode / IPB;
+  qsort (blk, n, sizeof (uint32_t), cmpBlk);
+  for (i = 0; i < n; i++)
+    if (((i == 0) || (blk[i] != blk[i-1])) && ((stat = flushBlock (blk[i])) != 0))
+       return stat;
+
+  return 0;
+}
+
+/**
+ *  \brief Allocate the state of the cache of inodes of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewInodeCacheState (void)
+{
+  SOInodeCacheState *p;
+
+  if ((p = calloc (1, sizeof (SOInodeCacheState))) == NULL) return NULL;
+  p->resNBlk = -1;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the cache of inodes of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewInodeCacheState, or \c NULL, for the default context
+ */
+
+void soBindInodeCacheState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOInodeCacheState *) p_state;
+}
+
+/**
+ *  \brief Link all the entries in the list ordered by last access.
+ */
+
+static void init (void)
+{
+  uint32_t i;
+
+  for (i = 0; i < INODE_CACHE_SIZE; i++)
+  { cur->entry[i].prev = (i == 0) ? NULL : &cur->entry[i-1];
+    cur->entry[i].next = (i == INODE_CACHE_SIZE - 1) ? NULL : &cur->entry[i+1];
+  }
+  cur->lruHead = &cur->entry[0];
+  cur->lruTail = &cur->entry[INODE_CACHE_SIZE - 1];
+}
+
+/**
+ *  \brief Search the cache for an inode.
+ *
+ *  \param nInode number of the inode
+ *
+ *  \return pointer to the entry, if it was found
+ *  \return \c NULL, otherwise
+ */
+
+static SOInodeEntry *lookup (uint32_t nInode)
+{
+  SOInodeEntry *p;
+
+  for (p = cur->bucket[nInode % INODE_CACHE_BUCKETS]; p != NULL; p = p->hNext)
+    if (p->nInode == nInode) break;
+
+  return p;
+}
+
+/**
+ *  \brief Remove an entry from its hash chain.
+ *
+ *  \param p pointer to the entry
+ */
+
+static void unhash (SOInodeEntry *p)
+{
+  SOInodeEntry **pp;
+
+  for (pp = &cur->bucket[p->nInode % INODE_CACHE_BUCKETS]; *pp != p; pp = &(*pp)->hNext) ;
+  *pp = p->hNext;
+  p->hNext = NULL;
+  p->valid = false;
+}
+
+/**
+ *  \brief Move an entry to the head of the list ordered by last access.
+ *
+ *  \param p pointer to the entry
+ */
+
+static void moveAtHead (SOInodeEntry *p)
+{
+  if (p == cur->lruHead) return;
+  p->prev->next = p->next;
+  if (p->next != NULL)
+     p->next->prev = p->prev;
+     else cur->lruTail = p->prev;
+  p->prev = NULL;
+  p->next = cur->lruHead;
+  cur->lruHead->prev = p;
+  cur->lruHead = p;
+}
+
+/**
+ *  \brief Write back the dirty cached inodes of a block of the table of inodes.
+ *
+ *  They are merged into the block when it is loaded (or were already copied into it, if it is held in internal
+ *  storage) and marked clean when it is stored.
+ *
+ *  \param nBlk logical number of the block of the table of inodes
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by \e soLoadBlockInT or \e soStoreBlockInT, otherwise
+ */
+
+static int flushBlock (uint32_t nBlk)
+{
+  int stat;
+
+  if ((stat = soLoadBlockInT (nBlk)) != 0)
+     return stat;
+  return soStoreBlockInT ();
+}
+
+/**
+ *  \brief Compare two logical numbers of blocks (for sorting).
+ *
+ *  \param a pointer to the first number
+ *  \param b pointer to the second number
+ *
+ *  \return <em>a negative value, zero or a positive value</em>, if the first is smaller, equal or greater
+ */
+
+static int cmpBlk (const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+  return (x > y) - (x < y);
+}
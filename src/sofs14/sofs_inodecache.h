@@ -0,0 +1,152 @@
+/**
+ *  \file sofs_inodecache.h (interface file)
+ *
+ *  \brief Cache of inodes.
+ *
+ *  Reading or writing an inode requires loading the block of the table of inodes where it is stored and, for writing,
+ *  storing it back. Since the same inodes are read and written several times by each operation, and over and over by
+ *  consecutive operations, the inodes are kept in a cache of inode objects, hashed on the inode number.
+ *
+ *  Each cached inode has a reference count, so that it is not evicted while it is being used, and a dirty flag.
+ *  Dirty inodes are written back in batches, grouped by block of the table of inodes, when room is needed in the
+ *  cache or upon synchronization. In the meantime, they are merged into any block of the table of inodes loaded into
+ *  internal storage, so that the functions which operate directly upon it see the current data; whenever a block of
+ *  the table of inodes is stored, the cached copies of its inodes are updated from it and marked clean.
+ *
+ *  The consistency check of the table of inodes reads the blocks of the free inodes directly from the buffer cache,
+ *  bypassing the merge. Free inodes are therefore written through: the functions which change the list of free inodes
+ *  load and store the blocks of the table of inodes themselves, and \e soWriteInode writes back a free inode in the
+ *  dirty state right away.
+ *
+ *  The following operations are defined:
+ *    \li get a reference to a cached inode
+ *    \li release a reference to a cached inode
+ *    \li merge the dirty cached inodes into a block of the table of inodes which was loaded
+ *    \li update the cached inodes from a block of the table of inodes which is about to be stored
+ *    \li write back a dirty cached inode
+ *    \li write back all the dirty cached inodes
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_INODECACHE_H_
+#define SOFS_INODECACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sofs_inode.h"
+
+/** \brief Number of inodes kept in the cache */
+#define INODE_CACHE_SIZE     128
+/** \brief Number of hash chains of the cache */
+#define INODE_CACHE_BUCKETS  64
+
+/**
+ *  \brief Get a reference to a cached inode.
+ *
+ *  If the inode is not in the cache, it is read from the table of inodes, eventually after evicting the least recently
+ *  used inode which is not referenced (written back first, together with the other dirty inodes of its block, if it
+ *  is dirty). No consistency checks are performed.
+ *
+ *  \param nInode number of the inode
+ *  \param pp_inode pointer to a location where the pointer to the cached inode is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL or the <em>inode number</em> is out of range
+ *  \return -\c EBUSY, if all the cached inodes are referenced
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soGetInode (uint32_t nInode, SOInode **pp_inode);
+
+/**
+ *  \brief Release a reference to a cached inode.
+ *
+ *  \param p_inode pointer to the cached inode, as returned by \e soGetInode
+ *  \param dirty \c true, if the cached inode was changed, \c false, otherwise
+ */
+
+extern void soPutInode (SOInode *p_inode, bool dirty);
+
+/**
+ *  \brief Merge the dirty cached inodes into a block of the table of inodes which was loaded.
+ *
+ *  It should be called whenever a block of the table of inodes is read into internal storage.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes held in internal storage
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+extern void soMergeInodeBlock (SOInode *p_blk, uint32_t nBlk);
+
+/**
+ *  \brief Update the cached inodes from a block of the table of inodes which is about to be stored.
+ *
+ *  It should be called whenever a block of the table of inodes is about to be stored. The cached inodes of the block
+ *  are marked clean.
+ *
+ *  \param p_blk pointer to the contents of the block of the table of inodes held in internal storage
+ *  \param nBlk logical number of the block of the table of inodes
+ */
+
+extern void soSyncInodeBlock (SOInode *p_blk, uint32_t nBlk);
+
+/**
+ *  \brief Write back a dirty cached inode.
+ *
+ *  The other dirty cached inodes of its block are written back together with it. Nothing is done if the inode is not
+ *  in the cache or is clean.
+ *
+ *  \param nInode number of the inode
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSyncInode (uint32_t nInode);
+
+/**
+ *  \brief Write back all the dirty cached inodes.
+ *
+ *  The inodes are grouped by block of the table of inodes, so that each block is loaded and stored only once.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSyncInodes (void);
+
+/**
+ *  \brief Allocate the state of the cache of inodes of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewInodeCacheState (void);
+
+/**
+ *  \brief Bind the state of the cache of inodes of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewInodeCacheState, or \c NULL, for the default context
+ */
+
+extern void soBindInodeCacheState (void *p_state);
+
+#endif /* SOFS_INODECACHE_H_ */
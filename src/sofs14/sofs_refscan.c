@@ -0,0 +1,249 @@
+/**
+ *  \file sofs_refscan.c (implementation file)
+ *
+ *  \brief Scans of arrays of references to data clusters.
+ *
+ *  Each scan has a version for every instruction set: the vector versions compare a group of references to the value
+ *  sought for at once and turn the result into a bit mask, one bit per reference; the references past the last whole
+ *  group are left to the scalar version. The instruction set is detected on the first scan.
+ *
+ *  The following operations are defined:
+ *    \li find the next reference to a data cluster
+ *    \li find a reference to a given data cluster
+ *    \li count the references to data clusters.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "sofs_datacluster.h"
+#include "sofs_refscan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+/** \brief the vector instructions of the x86 family may be generated */
+#define REFSCAN_X86
+#endif
+
+/** \brief instruction set: none, one reference at a time */
+#define SCALAR  0
+/** \brief instruction set: SSE2, four references at a time */
+#define SSE2    1
+/** \brief instruction set: AVX2, eight references at a time */
+#define AVX2    2
+
+/*
+ *  Internal data structure
+ */
+/** \brief Detection of the instruction set, which is done once for all threads */
+static pthread_once_t detected = PTHREAD_ONCE_INIT;
+/** \brief Instruction set used by the scans */
+static int level = SCALAR;
+
+/* Allusion to internal functions */
+
+static void detect (void);
+static uint32_t scan (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq);
+static uint32_t scanScalar (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq);
+static uint32_t countScalar (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val);
+#ifdef REFSCAN_X86
+static uint32_t scanSSE2 (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq);
+static uint32_t countSSE2 (const uint32_t *ref, uint32_t n, uint32_t val);
+static uint32_t scanAVX2 (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq);
+static uint32_t countAVX2 (const uint32_t *ref, uint32_t n, uint32_t val);
+#endif
+
+/**
+ *  \brief Find the next reference to a data cluster.
+ *
+ *  \param ref pointer to the array of references
+ *  \param start index of the first reference to be examined
+ *  \param n number of references of the array
+ *
+ *  \return index of the first reference, from \e start on, which is not \c NULL_CLUSTER, or \e n, if there is none
+ */
+
+uint32_t soFindNextRef (const uint32_t *ref, uint32_t start, uint32_t n)
+{
+  return scan (ref, start, n, NULL_CLUSTER, false);
+}
+
+/**
+ *  \brief Find a reference to a given data cluster.
+ *
+ *  \param ref pointer to the array of references
+ *  \param start index of the first reference to be examined
+ *  \param n number of references of the array
+ *  \param nClust logical number of the data cluster
+ *
+ *  \return index of the first reference, from \e start on, which is equal to \e nClust, or \e n, if there is none
+ */
+
+uint32_t soFindRef (const uint32_t *ref, uint32_t start, uint32_t n, uint32_t nClust)
+{
+  return scan (ref, start, n, nClust, true);
+}
+
+/**
+ *  \brief Count the references to data clusters.
+ *
+ *  \param ref pointer to the array of references
+ *  \param n number of references of the array
+ *
+ *  \return number of references which are not \c NULL_CLUSTER
+ */
+
+uint32_t soCountRefs (const uint32_t *ref, uint32_t n)
+{
+  pthread_once (&detected, detect);
+#ifdef REFSCAN_X86
+  if (level == AVX2) return n - countAVX2 (ref, n, NULL_CLUSTER);
+  if (level == SSE2) return n - countSSE2 (ref, n, NULL_CLUSTER);
+#endif
+  return n - countScalar (ref, 0, n, NULL_CLUSTER);
+}
+
+/**
+ *  \brief Detect the widest instruction set supported by the processor.
+ */
+
+static void detect (void)
+{
+#ifdef REFSCAN_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+     level = AVX2;
+     else if (__builtin_cpu_supports ("sse2"))
+             level = SSE2;
+#endif
+}
+
+/**
+ *  \brief Find the first reference, from a given index on, which is (or is not) equal to a given value.
+ *
+ *  \param ref pointer to the array of references
+ *  \param i index of the first reference to be examined
+ *  \param n number of references of the array
+ *  \param val value sought for
+ *  \param eq \c true, if the reference must be equal to the value; \c false, if it must be different
+ *
+ *  \return index of the reference, or \e n, if there is none
+ */
+
+static uint32_t scan (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq)
+{
+  pthread_once (&detected, detect);
+#ifdef REFSCAN_X86
+  if (level == AVX2) return scanAVX2 (ref, i, n, val, eq);
+  if (level == SSE2) return scanSSE2 (ref, i, n, val, eq);
+#endif
+  return scanScalar (ref, i, n, val, eq);
+}
+
+/**
+ *  \brief Find the first reference which is (or is not) equal to a given value, one reference at a time.
+ */
+
+static uint32_t scanScalar (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq)
+{
+  for (; i < n; i++)
+    if ((ref[i] == val) == eq) break;
+
+  return (i < n) ? i : n;
+}
+
+/**
+ *  \brief Count the references, from a given index on, which are equal to a given value, one reference at a time.
+ */
+
+static uint32_t countScalar (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val)
+{
+  uint32_t cnt = 0;
+
+  for (; i < n; i++)
+    if (ref[i] == val) cnt += 1;
+
+  return cnt;
+}
+
+#ifdef REFSCAN_X86
+
+/**
+ *  \brief Find the first reference which is (or is not) equal to a given value, four references at a time.
+ */
+
+__attribute__ ((target ("sse2")))
+static uint32_t scanSSE2 (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq)
+{
+  __m128i v = _mm_set1_epi32 ((int) val), x;
+  int m;
+
+  for (; i + 4 <= n; i += 4)
+  { x = _mm_cmpeq_epi32 (_mm_loadu_si128 ((const __m128i *) (ref + i)), v);
+    m = _mm_movemask_ps (_mm_castsi128_ps (x));
+    if (!eq) m ^= 0x0F;
+    if (m != 0) return i + __builtin_ctz (m);
+  }
+
+  return scanScalar (ref, i, n, val, eq);
+}
+
+/**
+ *  \brief Count the references which are equal to a given value, four references at a time.
+ */
+
+__attribute__ ((target ("sse2")))
+static uint32_t countSSE2 (const uint32_t *ref, uint32_t n, uint32_t val)
+{
+  __m128i v = _mm_set1_epi32 ((int) val), x;
+  uint32_t i, cnt = 0;
+
+  for (i = 0; i + 4 <= n; i += 4)
+  { x = _mm_cmpeq_epi32 (_mm_loadu_si128 ((const __m128i *) (ref + i)), v);
+    cnt += __builtin_popcount (_mm_movemask_ps (_mm_castsi128_ps (x)));
+  }
+
+  return cnt + countScalar (ref, i, n, val);
+}
+
+/**
+ *  \brief Find the first reference which is (or is not) equal to a given value, eight references at a time.
+ */
+
+__attribute__ ((target ("avx2")))
+static uint32_t scanAVX2 (const uint32_t *ref, uint32_t i, uint32_t n, uint32_t val, bool eq)
+{
+  __m256i v = _mm256_set1_epi32 ((int) val), x;
+  int m;
+
+  for (; i + 8 <= n; i += 8)
+  { x = _mm256_cmpeq_epi32 (_mm256_loadu_si256 ((const __m256i *) (ref + i)), v);
+    m = _mm256_movemask_ps (_mm256_castsi256_ps (x));
+    if (!eq) m ^= 0xFF;
+    if (m != 0) return i + __builtin_ctz (m);
+  }
+
+  return scanScalar (ref, i, n, val, eq);
+}
+
+/**
+ *  \brief Count the references which are equal to a given value, eight references at a time.
+ */
+
+__attribute__ ((target ("avx2")))
+static uint32_t countAVX2 (const uint32_t *ref, uint32_t n, uint32_t val)
+{
+  __m256i v = _mm256_set1_epi32 ((int) val), x;
+  uint32_t i, cnt = 0;
+
+  for (i = 0; i + 8 <= n; i += 8)
+  { x = _mm256_cmpeq_epi32 (_mm256_loadu_si256 ((const __m256i *) (ref + i)), v);
+    cnt += __builtin_popcount (_mm256_movemask_ps (_mm256_castsi256_ps (x)));
+  }
+
+  return cnt + countScalar (ref, i, n, val);
+}
+
+#endif /* REFSCAN_X86 */
@@ -0,0 +1,58 @@
+/**
+ *  \file sofs_refscan.h (interface file)
+ *
+ *  \brief Scans of arrays of references to data clusters.
+ *
+ *  Walking the list of references of a file means going through the clusters of references, \c RPC references at a
+ *  time, most of them often set to \c NULL_CLUSTER. The scans compare several references at once, using the vector
+ *  instructions of the processor (AVX2 or SSE2, whichever is the widest supported, detected at run time), and fall back
+ *  to comparing one reference at a time on processors that have none.
+ *
+ *  The following operations are defined:
+ *    \li find the next reference to a data cluster
+ *    \li find a reference to a given data cluster
+ *    \li count the references to data clusters.
+ */
+
+#ifndef SOFS_REFSCAN_H_
+#define SOFS_REFSCAN_H_
+
+#include <stdint.h>
+
+/**
+ *  \brief Find the next reference to a data cluster.
+ *
+ *  \param ref pointer to the array of references
+ *  \param start index of the first reference to be examined
+ *  \param n number of references of the array
+ *
+ *  \return index of the first reference, from \e start on, which is not \c NULL_CLUSTER, or \e n, if there is none
+ */
+
+extern uint32_t soFindNextRef (const uint32_t *ref, uint32_t start, uint32_t n);
+
+/**
+ *  \brief Find a reference to a given data cluster.
+ *
+ *  \param ref pointer to the array of references
+ *  \param start index of the first reference to be examined
+ *  \param n number of references of the array
+ *  \param nClust logical number of the data cluster
+ *
+ *  \return index of the first reference, from \e start on, which is equal to \e nClust, or \e n, if there is none
+ */
+
+extern uint32_t soFindRef (const uint32_t *ref, uint32_t start, uint32_t n, uint32_t nClust);
+
+/**
+ *  \brief Count the references to data clusters.
+ *
+ *  \param ref pointer to the array of references
+ *  \param n number of references of the array
+ *
+ *  \return number of references which are not \c NULL_CLUSTER
+ */
+
+extern uint32_t soCountRefs (const uint32_t *ref, uint32_t n);
+
+#endif /* SOFS_REFSCAN_H_ */
@@ -0,0 +1,165 @@
+/**
+ *  \file sofs_statfs.c (implementation file)
+ *
+ *  \brief Snapshot of the file system statistics.
+ *
+ *  The snapshot is only changed when the counters of the superblock differ from it, so that storing the superblock
+ *  seldom takes the lock.
+ *
+ *  The following operations are defined:
+ *    \li take a snapshot of the counters of the superblock
+ *    \li discard the snapshot
+ *    \li get the file system statistics from the snapshot
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/statvfs.h>
+
+#include "sofs_probe.h"
+#include "sofs_const.h"
+#include "sofs_superblock.h"
+#include "sofs_direntry.h"
+#include "sofs_statfs.h"
+
+/**
+ *  \brief Definition of the state of the snapshot.
+ */
+
+typedef struct soStatFSState
+{
+   /** \brief lock of the snapshot */
+    pthread_mutex_t statCR;
+   /** \brief snapshot state: \c true, if it was taken */
+    bool valid;
+   /** \brief total number of data clusters */
+    uint32_t dZoneTotal;
+   /** \brief number of free data clusters */
+    uint32_t dZoneFree;
+   /** \brief total number of inodes */
+    uint32_t iTotal;
+   /** \brief number of free inodes */
+    uint32_t iFree;
+} SOStatFSState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOStatFSState defState = { .statCR = PTHREAD_MUTEX_INITIALIZER, .valid = false };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOStatFSState *cur = &defState;
+
+/**
+ *  \brief Take a snapshot of the counters of the superblock.
+ *
+ *  It should be called whenever the superblock is loaded or stored. The calls are supposed to be mutually exclusive,
+ *  as are all the operations which change the superblock, so the snapshot is compared without taking the lock.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ */
+
+void soTakeStatFS (SOSuperBlock *p_sb)
+{
+  if (cur->valid && (cur->dZoneFree == p_sb->dZoneFree) && (cur->iFree == p_sb->iFree) &&
+      (cur->dZoneTotal == p_sb->dZoneTotal) && (cur->iTotal == p_sb->iTotal))
+     return;
+
+  if (pthread_mutex_lock (&cur->statCR) != 0) return;
+  cur->dZoneTotal = p_sb->dZoneTotal;
+  cur->dZoneFree = p_sb->dZoneFree;
+  cur->iTotal = p_sb->iTotal;
+  cur->iFree = p_sb->iFree;
+  cur->valid = true;
+  pthread_mutex_unlock (&cur->statCR);
+}
+
+/**
+ *  \brief Discard the snapshot.
+ *
+ *  It should be called when the file system is unmounted.
+ */
+
+void soDropStatFS (void)
+{
+  if (pthread_mutex_lock (&cur->statCR) != 0) return;
+  cur->valid = false;
+  pthread_mutex_unlock (&cur->statCR);
+}
+
+/**
+ *  \brief Get the file system statistics from the snapshot.
+ *
+ *  The values are the same \e soStatFS reports.
+ *
+ *  \param st pointer to a statvfs structure where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EAGAIN, if no snapshot was taken yet
+ *  \return -\c ENOLCK, if the lock can not be taken
+ */
+
+int soGetStatFS (struct statvfs *st)
+{
+  soColorProbe (738, "07;31", "soGetStatFS (%p)\n", st);
+
+  if (st == NULL) return -EINVAL;
+
+  memset (st, 0, sizeof (struct statvfs));
+  if (pthread_mutex_lock (&cur->statCR) != 0) return -ENOLCK;
+  if (!cur->valid)
+     { pthread_mutex_unlock (&cur->statCR);
+       return -EAGAIN;
+     }
+  st->f_blocks = cur->dZoneTotal;
+  st->f_bfree = st->f_bavail = cur->dZoneFree;
+  st->f_files = cur->iTotal;
+  st->f_ffree = st->f_favail = cur->iFree;
+  pthread_mutex_unlock (&cur->statCR);
+
+  st->f_bsize = CLUSTER_SIZE;
+  st->f_frsize = BLOCK_SIZE;
+  st->f_fsid = MAGIC_NUMBER;
+  st->f_flag = 0;
+  st->f_namemax = MAX_NAME;
+
+  return 0;
+}
+
+/**
+ *  \brief Allocate the state of the snapshot of the file system statistics of a new file system context.
+ *
+ *  The state is set as it is when the process starts: no snapshot was taken.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewStatFSState (void)
+{
+  SOStatFSState *p;
+
+  if ((p = calloc (1, sizeof (SOStatFSState))) == NULL) return NULL;
+  pthread_mutex_init (&p->statCR, NULL);
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the snapshot of the file system statistics of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewStatFSState, or \c NULL, for the default context
+ */
+
+void soBindStatFSState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOStatFSState *) p_state;
+}
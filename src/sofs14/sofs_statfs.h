@@ -0,0 +1,86 @@
+/**
+ *  \file sofs_statfs.h (interface file)
+ *
+ *  \brief Snapshot of the file system statistics.
+ *
+ *  Getting the file system statistics through \e soStatFS requires resolving a path and loading and checking the
+ *  superblock, all of it with mutual exclusion with the other operations. Since it is called very often by tools which
+ *  monitor the file system, a snapshot of the counters it reports (total and free data clusters, total and free
+ *  inodes) is kept in memory: it is taken whenever the superblock is loaded and whenever it is stored, which every
+ *  allocator does after changing the counters, so that it tracks them as they change. The statistics are then served
+ *  from the snapshot, without touching the storage device.
+ *
+ *  The snapshot is protected by its own lock, so that it may be read concurrently with any other operation.
+ *
+ *  The following operations are defined:
+ *    \li take a snapshot of the counters of the superblock
+ *    \li discard the snapshot
+ *    \li get the file system statistics from the snapshot
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_STATFS_H_
+#define SOFS_STATFS_H_
+
+#include <sys/statvfs.h>
+
+#include "sofs_superblock.h"
+
+/**
+ *  \brief Take a snapshot of the counters of the superblock.
+ *
+ *  It should be called whenever the superblock is loaded or stored.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ */
+
+extern void soTakeStatFS (SOSuperBlock *p_sb);
+
+/**
+ *  \brief Discard the snapshot.
+ *
+ *  It should be called when the file system is unmounted.
+ */
+
+extern void soDropStatFS (void);
+
+/**
+ *  \brief Get the file system statistics from the snapshot.
+ *
+ *  The values are the same \e soStatFS reports.
+ *
+ *  \param st pointer to a statvfs structure where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL
+ *  \return -\c EAGAIN, if no snapshot was taken yet
+ *  \return -\c ENOLCK, if the lock can not be taken
+ */
+
+extern int soGetStatFS (struct statvfs *st);
+
+/**
+ *  \brief Allocate the state of the snapshot of the file system statistics of a new file system context.
+ *
+ *  The state is set as it is when the process starts: no snapshot was taken.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewStatFSState (void);
+
+/**
+ *  \brief Bind the state of the snapshot of the file system statistics of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewStatFSState, or \c NULL, for the default context
+ */
+
+extern void soBindStatFSState (void *p_state);
+
+#endif /* SOFS_STATFS_H_ */
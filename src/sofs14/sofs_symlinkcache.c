@@ -0,0 +1,242 @@
+/**
+ *  \file sofs_symlinkcache.c (implementation file)
+ *
+ *  \brief Cache of symbolic links.
+ *
+ *  The cache is direct-mapped on the inode number: a symbolic link whose target is set takes the place of any other
+ *  symbolic link mapped to the same entry, which will have its target read again when needed.
+ *
+ *  The resolutions are forgotten all at once by advancing a generation number: a resolution is only valid if it was
+ *  set in the current generation.
+ *
+ *  The following operations are defined:
+ *    \li get the target of a symbolic link
+ *    \li set the target of a symbolic link
+ *    \li get the resolution of a symbolic link
+ *    \li set the resolution of a symbolic link
+ *    \li forget a symbolic link
+ *    \li forget the resolutions of all symbolic links
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "sofs_probe.h"
+#include "sofs_direntry.h"
+#include "sofs_symlinkcache.h"
+
+/**
+ *  \brief Definition of an entry of the cache of symbolic links.
+ */
+
+typedef struct soSymlinkEntry
+{
+   /** \brief entry state: \c true, if it holds a target */
+    bool valid;
+   /** \brief number of the inode associated to the symbolic link */
+    uint32_t nInode;
+   /** \brief target path */
+    char target[MAX_PATH+1];
+   /** \brief resolution state: \c true, if it holds a resolution */
+    bool resolved;
+   /** \brief generation the resolution was set in */
+    uint32_t gen;
+   /** \brief user ID of the process the resolution was set for */
+    uid_t uid;
+   /** \brief group ID of the process the resolution was set for */
+    gid_t gid;
+   /** \brief number of the inode associated to the directory the symbolic link was followed from */
+    uint32_t nInodeDir;
+   /** \brief number of the inode associated to the directory that holds the entry the symbolic link resolves to */
+    uint32_t nInodeResDir;
+   /** \brief number of the inode associated to the entry the symbolic link resolves to */
+    uint32_t nInodeResEnt;
+} SOSymlinkEntry;
+
+/**
+ *  \brief Definition of the state of the cache of symbolic links.
+ */
+
+typedef struct soSymlinkCacheState
+{
+   /** \brief cache of symbolic links */
+    SOSymlinkEntry entry[SYMLINK_CACHE_SIZE];
+   /** \brief current generation of resolutions */
+    uint32_t curGen;
+} SOSymlinkCacheState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOSymlinkCacheState defState = { .curGen = 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOSymlinkCacheState *cur = &defState;
+
+/**
+ *  \brief Get the target of a symbolic link.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param target pointer to a buffer, at least <tt>MAX_PATH + 1</tt> long, where the target path is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it is known
+ *  \return -\c ENOENT, if it is not known
+ */
+
+int soGetSymlinkTarget (uint32_t nInode, char *target)
+{
+  SOSymlinkEntry *p = &cur->entry[nInode % SYMLINK_CACHE_SIZE];
+
+  if (!p->valid || (p->nInode != nInode))
+     return -ENOENT;
+  strcpy (target, p->target);
+
+  return 0;
+}
+
+/**
+ *  \brief Set the target of a symbolic link.
+ *
+ *  The symbolic link takes the place of any other one mapped to the same entry.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param target pointer to the string holding the target path
+ */
+
+void soSetSymlinkTarget (uint32_t nInode, const char *target)
+{
+  soColorProbe (739, "07;31", "soSetSymlinkTarget (%"PRIu32", \"%s\")\n", nInode, target);
+
+  SOSymlinkEntry *p = &cur->entry[nInode % SYMLINK_CACHE_SIZE];
+
+  p->valid = true;
+  p->nInode = nInode;
+  strncpy (p->target, target, MAX_PATH);
+  p->target[MAX_PATH] = '\0';
+  p->resolved = false;
+}
+
+/**
+ *  \brief Get the resolution of a symbolic link.
+ *
+ *  It is only known if it was set for the same directory, with the same process credentials, and nothing it depends
+ *  upon was changed since.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param nInodeDir number of the inode associated to the directory the symbolic link is followed from
+ *  \param p_nInodeDir pointer to the location where the number of the inode associated to the directory that holds the
+ *                     entry the symbolic link resolves to is to be stored
+ *  \param p_nInodeEnt pointer to the location where the number of the inode associated to the entry the symbolic link
+ *                     resolves to is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it is known
+ *  \return -\c ENOENT, if it is not known
+ */
+
+int soGetSymlinkResolution (uint32_t nInode, uint32_t nInodeDir, uint32_t *p_nInodeDir, uint32_t *p_nInodeEnt)
+{
+  SOSymlinkEntry *p = &cur->entry[nInode % SYMLINK_CACHE_SIZE];
+
+  if (!p->valid || (p->nInode != nInode) || !p->resolved || (p->gen != cur->curGen) || (p->nInodeDir != nInodeDir) ||
+      (p->uid != getuid ()) || (p->gid != getgid ()))
+     return -ENOENT;
+  *p_nInodeDir = p->nInodeResDir;
+  *p_nInodeEnt = p->nInodeResEnt;
+
+  return 0;
+}
+
+/**
+ *  \brief Set the resolution of a symbolic link.
+ *
+ *  The target of the symbolic link must be known.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param nInodeDir number of the inode associated to the directory the symbolic link is followed from
+ *  \param nInodeResDir number of the inode associated to the directory that holds the entry the symbolic link resolves
+ *                      to
+ *  \param nInodeResEnt number of the inode associated to the entry the symbolic link resolves to
+ */
+
+void soSetSymlinkResolution (uint32_t nInode, uint32_t nInodeDir, uint32_t nInodeResDir, uint32_t nInodeResEnt)
+{
+  SOSymlinkEntry *p = &cur->entry[nInode % SYMLINK_CACHE_SIZE];
+
+  if (!p->valid || (p->nInode != nInode)) return;
+  p->resolved = true;
+  p->gen = cur->curGen;
+  p->uid = getuid ();
+  p->gid = getgid ();
+  p->nInodeDir = nInodeDir;
+  p->nInodeResDir = nInodeResDir;
+  p->nInodeResEnt = nInodeResEnt;
+}
+
+/**
+ *  \brief Forget a symbolic link.
+ *
+ *  It should be called when its inode is freed.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ */
+
+void soForgetSymlink (uint32_t nInode)
+{
+  SOSymlinkEntry *p = &cur->entry[nInode % SYMLINK_CACHE_SIZE];
+
+  if (p->nInode == nInode) p->valid = false;
+}
+
+/**
+ *  \brief Forget the resolutions of all symbolic links.
+ *
+ *  It should be called before any directory entry is added, attached, removed, detached or renamed, and before the
+ *  permissions or the owner of any inode are changed.
+ */
+
+void soForgetSymlinkResolutions (void)
+{
+  uint32_t i;
+
+  cur->curGen += 1;
+  if (cur->curGen == 0)                          /* the generation number wrapped around */
+     for (i = 0; i < SYMLINK_CACHE_SIZE; i++)
+       cur->entry[i].resolved = false;
+}
+
+/**
+ *  \brief Allocate the state of the cache of symbolic links of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewSymlinkCacheState (void)
+{
+  SOSymlinkCacheState *p;
+
+  if ((p = calloc (1, sizeof (SOSymlinkCacheState))) == NULL) return NULL;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the cache of symbolic links of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewSymlinkCacheState, or \c NULL, for the default context
+ */
+
+void soBindSymlinkCacheState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOSymlinkCacheState *) p_state;
+}
@@ -0,0 +1,136 @@
+/**
+ *  \file sofs_symlinkcache.h (interface file)
+ *
+ *  \brief Cache of symbolic links.
+ *
+ *  Following a symbolic link while traversing a path requires reading the first data cluster of the link, to get its
+ *  target, and traversing the target path, component by component. So, for each symbolic link, the target path is
+ *  kept once it is read, and so is the result of its resolution: the numbers of the inodes associated to the entry it
+ *  resolves to and to the directory that holds it.
+ *
+ *  The target of a symbolic link never changes while its inode is in use: it is forgotten when the inode is freed.
+ *  The resolution, on the other hand, depends on the directory it is followed from (the target may be a relative
+ *  path), on the process credentials and on the contents and permissions of the directories along the target path.
+ *  So, it is kept together with the first two and it is forgotten whenever any directory entry is added, attached,
+ *  removed, detached or renamed, or the permissions or the owner of any inode are changed.
+ *
+ *  The cache is direct-mapped on the inode number. The on-disk format is not changed.
+ *
+ *  The following operations are defined:
+ *    \li get the target of a symbolic link
+ *    \li set the target of a symbolic link
+ *    \li get the resolution of a symbolic link
+ *    \li set the resolution of a symbolic link
+ *    \li forget a symbolic link
+ *    \li forget the resolutions of all symbolic links
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           that better represents the error cause.
+ *           (execute command <em>man errno</em> to get the list of system errors)
+ */
+
+#ifndef SOFS_SYMLINKCACHE_H_
+#define SOFS_SYMLINKCACHE_H_
+
+#include <stdint.h>
+
+/** \brief Number of entries of the cache of symbolic links */
+#define SYMLINK_CACHE_SIZE  64
+
+/**
+ *  \brief Get the target of a symbolic link.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param target pointer to a buffer, at least <tt>MAX_PATH + 1</tt> long, where the target path is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it is known
+ *  \return -\c ENOENT, if it is not known
+ */
+
+extern int soGetSymlinkTarget (uint32_t nInode, char *target);
+
+/**
+ *  \brief Set the target of a symbolic link.
+ *
+ *  The symbolic link takes the place of any other one mapped to the same entry.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param target pointer to the string holding the target path
+ */
+
+extern void soSetSymlinkTarget (uint32_t nInode, const char *target);
+
+/**
+ *  \brief Get the resolution of a symbolic link.
+ *
+ *  It is only known if it was set for the same directory, with the same process credentials, and nothing it depends
+ *  upon was changed since.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param nInodeDir number of the inode associated to the directory the symbolic link is followed from
+ *  \param p_nInodeDir pointer to the location where the number of the inode associated to the directory that holds the
+ *                     entry the symbolic link resolves to is to be stored
+ *  \param p_nInodeEnt pointer to the location where the number of the inode associated to the entry the symbolic link
+ *                     resolves to is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, if it is known
+ *  \return -\c ENOENT, if it is not known
+ */
+
+extern int soGetSymlinkResolution (uint32_t nInode, uint32_t nInodeDir, uint32_t *p_nInodeDir, uint32_t *p_nInodeEnt);
+
+/**
+ *  \brief Set the resolution of a symbolic link.
+ *
+ *  The target of the symbolic link must be known.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ *  \param nInodeDir number of the inode associated to the directory the symbolic link is followed from
+ *  \param nInodeResDir number of the inode associated to the directory that holds the entry the symbolic link resolves
+ *                      to
+ *  \param nInodeResEnt number of the inode associated to the entry the symbolic link resolves to
+ */
+
+extern void soSetSymlinkResolution (uint32_t nInode, uint32_t nInodeDir, uint32_t nInodeResDir, uint32_t nInodeResEnt);
+
+/**
+ *  \brief Forget a symbolic link.
+ *
+ *  It should be called when its inode is freed.
+ *
+ *  \param nInode number of the inode associated to the symbolic link
+ */
+
+extern void soForgetSymlink (uint32_t nInode);
+
+/**
+ *  \brief Forget the resolutions of all symbolic links.
+ *
+ *  It should be called before any directory entry is added, attached, removed, detached or renamed, and before the
+ *  permissions or the owner of any inode are changed.
+ */
+
+extern void soForgetSymlinkResolutions (void);
+
+/**
+ *  \brief Allocate the state of the cache of symbolic links of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewSymlinkCacheState (void);
+
+/**
+ *  \brief Bind the state of the cache of symbolic links of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewSymlinkCacheState, or \c NULL, for the default context
+ */
+
+extern void soBindSymlinkCacheState (void *p_state);
+
+#endif /* SOFS_SYMLINKCACHE_H_ */
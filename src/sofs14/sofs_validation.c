@@ -0,0 +1,486 @@
+/**
+ *  \file sofs_validation.c (implementation file)
+ *
+ *  \brief Validation levels for the quick consistency checks.
+ *
+ *  Under \c VALID_TRUSTED, the objects successfully checked are kept in a small direct-mapped table, holding the kind
+ *  of check, a fingerprint of the object and the generation of the contents of the storage device when the check was
+ *  performed. The fingerprint covers the object, the fields of the superblock the check depends on and, when it
+ *  applies, the logical number of the data cluster. Since the checks may also read data clusters the object refers to, any write to the storage device which
+ *  changes its contents invalidates the whole table.
+ *
+ *  The following operations are defined:
+ *    \li select the validation level
+ *    \li get the counters of a kind of check
+ *    \li reset all the counters
+ *    \li print all the counters
+ *    \li quick check of the superblock metadata
+ *    \li quick check of the table of inodes metadata
+ *    \li quick check of the data zone metadata
+ *    \li quick check of a free inode in the dirty state
+ *    \li quick check of an inode in use
+ *    \li quick check of the header of a data cluster
+ *    \li quick check of the contents of a directory
+ *    \li quick check of metadata which is about to be changed
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "sofs_probe.h"
+#include "sofs_buffercache.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_basicconsist.h"
+#include "sofs_validation.h"
+
+/**
+ *  \brief Definition of an entry of the table of objects already checked.
+ */
+
+typedef struct soValidEntry
+{
+   /** \brief entry state: \c true, if it holds an object */
+    bool valid;
+   /** \brief kind of check */
+    uint32_t check;
+   /** \brief fingerprint of the object */
+    uint64_t fp;
+   /** \brief generation of the contents of the storage device when the check was performed */
+    uint32_t gen;
+} SOValidEntry;
+
+/**
+ *  \brief Definition of the state of the validation of metadata.
+ */
+
+typedef struct soValidationState
+{
+   /** \brief selected validation level */
+    uint32_t validLevel;
+   /** \brief sampling period under VALID_SAMPLED */
+    uint32_t validPeriod;
+   /** \brief counters of each kind of check */
+    SOValidStats stats[VCHK_COUNT];
+   /** \brief table of objects already checked */
+    SOValidEntry trusted[VALID_TRUSTED_SIZE];
+} SOValidationState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOValidationState defState = { .validLevel = VALID_FULL, .validPeriod = VALID_DEFAULT_PERIOD };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOValidationState *cur = &defState;
+/** \brief Names of the kinds of check */
+static const char *checkName[VCHK_COUNT] = { "SuperBlock", "InT", "DZ", "FDInode", "InodeIU", "StatDC", "DirCont" };
+
+/* Allusion to internal functions */
+
+static uint64_t fingerprint (uint32_t check, SOSuperBlock *p_sb, void *p_obj, size_t size, uint32_t nClust);
+static bool required (uint32_t check, SOSuperBlock *p_sb, void *p_obj, size_t size, uint32_t nClust, bool sample,
+                      uint64_t *p_fp);
+static int done (uint32_t check, uint64_t fp, int stat);
+
+/**
+ *  \brief Select the validation level.
+ *
+ *  \param level the validation level (\c VALID_FULL, \c VALID_SAMPLED or \c VALID_TRUSTED)
+ *  \param period sampling period under \c VALID_SAMPLED (ignored, otherwise)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the validation level is invalid or the sampling period is zero
+ */
+
+int soSetValidation (uint32_t level, uint32_t period)
+{
+  soColorProbe (730, "07;31", "soSetValidation (%"PRIu32", %"PRIu32")\n", level, period);
+
+  if ((level != VALID_FULL) && (level != VALID_SAMPLED) && (level != VALID_TRUSTED))
+     return -EINVAL;
+  if ((level == VALID_SAMPLED) && (period == 0))
+     return -EINVAL;
+
+  cur->validLevel = level;
+  if (level == VALID_SAMPLED) cur->validPeriod = period;
+  memset (cur->trusted, 0, sizeof (cur->trusted));
+
+  return 0;
+}
+
+/**
+ *  \brief Get the counters of a kind of check.
+ *
+ *  \param check the kind of check (\c VCHK_SUPERBLOCK, ..., \c VCHK_DIRCONT)
+ *  \param p_stats pointer to a location where the counters are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL or the kind of check is invalid
+ */
+
+int soGetValidationStats (uint32_t check, SOValidStats *p_stats)
+{
+  if ((p_stats == NULL) || (check >= VCHK_COUNT))
+     return -EINVAL;
+  *p_stats = cur->stats[check];
+
+  return 0;
+}
+
+/**
+ *  \brief Reset all the counters.
+ */
+
+void soResetValidationStats (void)
+{
+  memset (cur->stats, 0, sizeof (cur->stats));
+}
+
+/**
+ *  \brief Print all the counters.
+ *
+ *  \param fp stream the counters are to be printed to
+ */
+
+void soPrintValidationStats (FILE *fp)
+{
+  uint32_t i;
+
+  fprintf (fp, "%-12s %10s %10s %10s %10s\n", "check", "calls", "performed", "skipped", "failed");
+  for (i = 0; i < VCHK_COUNT; i++)
+    fprintf (fp, "%-12s %10"PRIu32" %10"PRIu32" %10"PRIu32" %10"PRIu32"\n", checkName[i], cur->stats[i].calls,
+             cur->stats[i].performed, cur->stats[i].skipped, cur->stats[i].failed);
+}
+
+/**
+ *  \brief Quick check of the superblock metadata, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckSuperBlock, otherwise
+ */
+
+int soVCheckSuperBlock (SOSuperBlock *p_sb)
+{
+  uint64_t fp;
+
+  if (!required (VCHK_SUPERBLOCK, p_sb, NULL, 0, 0, true, &fp)) return 0;
+  return done (VCHK_SUPERBLOCK, fp, soQCheckSuperBlock (p_sb));
+}
+
+/**
+ *  \brief Quick check of the table of inodes metadata, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckInT, otherwise
+ */
+
+int soVCheckInT (SOSuperBlock *p_sb)
+{
+  uint64_t fp;
+
+  if (!required (VCHK_INT, p_sb, NULL, 0, 0, true, &fp)) return 0;
+  return done (VCHK_INT, fp, soQCheckInT (p_sb));
+}
+
+/**
+ *  \brief Quick check of the data zone metadata, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckDZ, otherwise
+ */
+
+int soVCheckDZ (SOSuperBlock *p_sb)
+{
+  uint64_t fp;
+
+  if (!required (VCHK_DZ, p_sb, NULL, 0, 0, true, &fp)) return 0;
+  return done (VCHK_DZ, fp, soQCheckDZ (p_sb));
+}
+
+/**
+ *  \brief Quick check of a free inode in the dirty state, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckFDInode, otherwise
+ */
+
+int soVCheckFDInode (SOSuperBlock *p_sb, SOInode *p_inode)
+{
+  uint64_t fp;
+
+  if (!required (VCHK_FDINODE, p_sb, p_inode, sizeof (SOInode), 0, true, &fp)) return 0;
+  return done (VCHK_FDINODE, fp, soQCheckFDInode (p_sb, p_inode));
+}
+
+/**
+ *  \brief Quick check of an inode in use, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckInodeIU, otherwise
+ */
+
+int soVCheckInodeIU (SOSuperBlock *p_sb, SOInode *p_inode)
+{
+  uint64_t fp;
+
+  if (!required (VCHK_INODEIU, p_sb, p_inode, sizeof (SOInode), 0, true, &fp)) return 0;
+  return done (VCHK_INODEIU, fp, soQCheckInodeIU (p_sb, p_inode));
+}
+
+/**
+ *  \brief Quick check of the header of a data cluster, according to the selected validation level.
+ *
+ *  Only the consistency is checked: the allocation status is not returned. Callers which need it must call
+ *  \e soQCheckStatDC directly.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param nClust logical number of the data cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckStatDC, otherwise
+ */
+
+int soVCheckStatDC (SOSuperBlock *p_sb, uint32_t nClust)
+{
+  uint64_t fp;
+  uint32_t stat;
+
+  if (!required (VCHK_STATDC, p_sb, NULL, 0, nClust, true, &fp)) return 0;
+  return done (VCHK_STATDC, fp, soQCheckStatDC (p_sb, nClust, &stat));
+}
+
+/**
+ *  \brief Quick check of the contents of a directory, according to the selected validation level.
+ *
+ *  The inode is supposed to be already known to represent a directory.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckDirCont, otherwise
+ */
+
+int soVCheckDirCont (SOSuperBlock *p_sb, SOInode *p_inode)
+{
+  uint64_t fp;
+
+  if (!required (VCHK_DIRCONT, p_sb, p_inode, sizeof (SOInode), 0, true, &fp)) return 0;
+  return done (VCHK_DIRCONT, fp, soQCheckDirCont (p_sb, p_inode));
+}
+
+/**
+ *  \brief Quick check of metadata which is about to be changed, according to the selected validation level.
+ *
+ *  It stands for the checks performed before the table of inodes or the data zone are changed: sampling does not
+ *  apply to them, so they are always performed, except under \c VALID_TRUSTED on objects already checked.
+ *
+ *  \param check the kind of check (\c VCHK_INT, \c VCHK_DZ, \c VCHK_FDINODE or \c VCHK_INODEIU)
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored (ignored, for \c VCHK_INT and \c VCHK_DZ)
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -\c EINVAL, if the kind of check is invalid
+ *  \return -<em>error</em> returned by the corresponding \e soQCheck* function, otherwise
+ */
+
+int soVCheckWrite (uint32_t check, SOSuperBlock *p_sb, SOInode *p_inode)
+{
+  uint64_t fp;
+
+  switch (check)
+  { case VCHK_INT:
+      if (!required (VCHK_INT, p_sb, NULL, 0, 0, false, &fp)) return 0;
+      return done (VCHK_INT, fp, soQCheckInT (p_sb));
+    case VCHK_DZ:
+      if (!required (VCHK_DZ, p_sb, NULL, 0, 0, false, &fp)) return 0;
+      return done (VCHK_DZ, fp, soQCheckDZ (p_sb));
+    case VCHK_FDINODE:
+      if (!required (VCHK_FDINODE, p_sb, p_inode, sizeof (SOInode), 0, false, &fp)) return 0;
+      return done (VCHK_FDINODE, fp, soQCheckFDInode (p_sb, p_inode));
+    case VCHK_INODEIU:
+      if (!required (VCHK_INODEIU, p_sb, p_inode, sizeof (SOInode), 0, false, &fp)) return 0;
+      return done (VCHK_INODEIU, fp, soQCheckInodeIU (p_sb, p_inode));
+    default:
+      return -EINVAL;
+  }
+}
+
+/**
+ *  \brief Allocate the state of the validation of metadata of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the validation level is full and no object is trusted.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewValidationState (void)
+{
+  SOValidationState *p;
+
+  if ((p = calloc (1, sizeof (SOValidationState))) == NULL) return NULL;
+  p->validLevel = VALID_FULL;
+  p->validPeriod = VALID_DEFAULT_PERIOD;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the validation of metadata of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewValidationState, or \c NULL, for the default context
+ */
+
+void soBindValidationState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOValidationState *) p_state;
+}
+
+/**
+ *  \brief Compute the fingerprint of an object (64-bit FNV-1a hash).
+ *
+ *  Only the fields of the superblock the kind of check depends on are covered: the whole superblock, when it is the
+ *  object itself; the fields describing the table of inodes and the list of free inodes, for the table of inodes; the
+ *  fields describing the data zone and the list of free data clusters, for the data zone; and the geometry of the
+ *  device, which sets the range of the references, for the remaining kinds. So, allocating or freeing an inode, for
+ *  instance, does not invalidate the checks on inodes in use.
+ *
+ *  \param check the kind of check
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_obj pointer to a buffer where the object is stored (\c NULL, if there is none)
+ *  \param size size of the object in bytes
+ *  \param nClust logical number of the data cluster
+ *
+ *  \return <em>the fingerprint</em>
+ */
+
+static uint64_t fingerprint (uint32_t check, SOSuperBlock *p_sb, void *p_obj, size_t size, uint32_t nClust)
+{
+  uint32_t geom[5];                              /* geometry of the device */
+  uint64_t h = 0xcbf29ce484222325ULL;
+  unsigned char *p;
+  size_t i, n;
+
+  h = (h ^ check) * 0x100000001b3ULL;
+  h = (h ^ nClust) * 0x100000001b3ULL;
+  switch (check)
+  { case VCHK_SUPERBLOCK:
+      p = (unsigned char *) p_sb;
+      n = sizeof (SOSuperBlock);
+      break;
+    case VCHK_INT:
+      p = (unsigned char *) &p_sb->iTableStart;
+      n = offsetof (SOSuperBlock, iTail) + sizeof (p_sb->iTail) - offsetof (SOSuperBlock, iTableStart);
+      break;
+    case VCHK_DZ:
+      p = (unsigned char *) &p_sb->dZoneStart;
+      n = offsetof (SOSuperBlock, dTail) + sizeof (p_sb->dTail) - offsetof (SOSuperBlock, dZoneStart);
+      break;
+    default:
+      geom[0] = p_sb->nTotal;
+      geom[1] = p_sb->iTableStart;
+      geom[2] = p_sb->iTotal;
+      geom[3] = p_sb->dZoneStart;
+      geom[4] = p_sb->dZoneTotal;
+      p = (unsigned char *) geom;
+      n = sizeof (geom);
+  }
+  for (i = 0; i < n; i++)
+    h = (h ^ p[i]) * 0x100000001b3ULL;
+  if (p_obj != NULL)
+     for (p = (unsigned char *) p_obj, i = 0; i < size; i++)
+       h = (h ^ p[i]) * 0x100000001b3ULL;
+
+  return h;
+}
+
+/**
+ *  \brief Determine whether a check is to be performed, according to the selected validation level.
+ *
+ *  The call is counted and, if the check is to be skipped, so is the skip. Checks on \c NULL pointers are always
+ *  performed, so that the error is reported.
+ *
+ *  \param check the kind of check
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_obj pointer to a buffer where the object is stored (\c NULL, if there is none)
+ *  \param size size of the object in bytes (zero, if there is none)
+ *  \param nClust logical number of the data cluster
+ *  \param sample \c true, if the check may be skipped under \c VALID_SAMPLED, \c false, otherwise
+ *  \param p_fp pointer to a location where the fingerprint of the object is stored under \c VALID_TRUSTED
+ *
+ *  \return \c true, if the check is to be performed, \c false, otherwise
+ */
+
+static bool required (uint32_t check, SOSuperBlock *p_sb, void *p_obj, size_t size, uint32_t nClust, bool sample,
+                      uint64_t *p_fp)
+{
+  SOValidEntry *p;
+  bool perform = true;
+
+  *p_fp = 0;
+  cur->stats[check].calls += 1;
+  if ((p_sb == NULL) || ((size != 0) && (p_obj == NULL)))
+     perform = true;
+     else if ((cur->validLevel == VALID_SAMPLED) && sample)
+             perform = ((cur->stats[check].calls - 1) % cur->validPeriod) == 0;
+     else if (cur->validLevel == VALID_TRUSTED)
+             { *p_fp = fingerprint (check, p_sb, p_obj, size, nClust);
+               p = &cur->trusted[*p_fp % VALID_TRUSTED_SIZE];
+               perform = !p->valid || (p->check != check) || (p->fp != *p_fp) ||
+                         (p->gen != soGetCacheGeneration ());
+             }
+  if (!perform) cur->stats[check].skipped += 1;
+
+  return perform;
+}
+
+/**
+ *  \brief Account for a check which was performed.
+ *
+ *  Under \c VALID_TRUSTED, the object is recorded as checked, if the check was successful.
+ *
+ *  \param check the kind of check
+ *  \param fp fingerprint of the object
+ *  \param stat value returned by the check
+ *
+ *  \return <em>the value returned by the check</em>
+ */
+
+static int done (uint32_t check, uint64_t fp, int stat)
+{
+  SOValidEntry *p;
+
+  cur->stats[check].performed += 1;
+  if (stat != 0)
+     cur->stats[check].failed += 1;
+     else if ((cur->validLevel == VALID_TRUSTED) && (fp != 0))
+             { p = &cur->trusted[fp % VALID_TRUSTED_SIZE];
+               p->valid = true;
+               p->check = check;
+               p->fp = fp;
+               p->gen = soGetCacheGeneration ();
+             }
+
+  return stat;
+}
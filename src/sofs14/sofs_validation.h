@@ -0,0 +1,256 @@
+/**
+ *  \file sofs_validation.h (interface file)
+ *
+ *  \brief Validation levels for the quick consistency checks.
+ *
+ *  Every internal function quickly checks the consistency of the metadata it is about to act upon, by calling one of
+ *  the \e soQCheck* functions, before doing it. The checks are repeated over and over on the same objects, namely on
+ *  the superblock, and some of them read the data clusters the object refers to. So, one of the following validation
+ *  levels may be selected upon mounting:
+ *    \li \c VALID_FULL - every check is performed (default)
+ *    \li \c VALID_SAMPLED - only one out of every \e N calls of each kind of check is performed, except for the checks
+ *        performed before the table of inodes or the data zone are changed
+ *    \li \c VALID_TRUSTED - a check is skipped if it was already successfully performed on the same object and nothing
+ *        was written to the storage device since then
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ *
+ *  The checks whose outcome the calling function relies upon (for instance, to determine the allocation status of a
+ *  data cluster, or whether an inode is a directory) are not to be replaced by the functions defined here.
+ *
+ *  For each kind of check, the number of calls and the number of checks performed, skipped and failed are counted.
+ *
+ *  The following operations are defined:
+ *    \li select the validation level
+ *    \li get the counters of a kind of check
+ *    \li reset all the counters
+ *    \li print all the counters
+ *    \li quick check of the superblock metadata
+ *    \li quick check of the table of inodes metadata
+ *    \li quick check of the data zone metadata
+ *    \li quick check of a free inode in the dirty state
+ *    \li quick check of an inode in use
+ *    \li quick check of the header of a data cluster
+ *    \li quick check of the contents of a directory
+ *    \li quick check of metadata which is about to be changed.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           or the local error that better represents the error cause. Local errors are out of the range of the
+ *           system errors.
+ */
+
+#ifndef SOFS_VALIDATION_H_
+#define SOFS_VALIDATION_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+
+/** \brief every check is performed */
+#define VALID_FULL              0
+/** \brief one out of every N calls of each kind of check is performed */
+#define VALID_SAMPLED           1
+/** \brief checks on objects already checked and unchanged are skipped */
+#define VALID_TRUSTED           2
+
+/** \brief default sampling period under \c VALID_SAMPLED */
+#define VALID_DEFAULT_PERIOD    16
+/** \brief number of entries of the table of objects already checked under \c VALID_TRUSTED */
+#define VALID_TRUSTED_SIZE      256
+
+/** \brief quick check of the superblock metadata */
+#define VCHK_SUPERBLOCK         0
+/** \brief quick check of the table of inodes metadata */
+#define VCHK_INT                1
+/** \brief quick check of the data zone metadata */
+#define VCHK_DZ                 2
+/** \brief quick check of a free inode in the dirty state */
+#define VCHK_FDINODE            3
+/** \brief quick check of an inode in use */
+#define VCHK_INODEIU            4
+/** \brief quick check of the header of a data cluster */
+#define VCHK_STATDC             5
+/** \brief quick check of the contents of a directory */
+#define VCHK_DIRCONT            6
+/** \brief number of kinds of check */
+#define VCHK_COUNT              7
+
+/**
+ *  \brief Definition of the counters of a kind of check.
+ */
+
+typedef struct soValidStats
+{
+   /** \brief number of calls */
+    uint32_t calls;
+   /** \brief number of checks performed */
+    uint32_t performed;
+   /** \brief number of checks skipped */
+    uint32_t skipped;
+   /** \brief number of checks performed which failed */
+    uint32_t failed;
+} SOValidStats;
+
+/**
+ *  \brief Select the validation level.
+ *
+ *  \param level the validation level (\c VALID_FULL, \c VALID_SAMPLED or \c VALID_TRUSTED)
+ *  \param period sampling period under \c VALID_SAMPLED (ignored, otherwise)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the validation level is invalid or the sampling period is zero
+ */
+
+extern int soSetValidation (uint32_t level, uint32_t period);
+
+/**
+ *  \brief Get the counters of a kind of check.
+ *
+ *  \param check the kind of check (\c VCHK_SUPERBLOCK, ..., \c VCHK_DIRCONT)
+ *  \param p_stats pointer to a location where the counters are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer is \c NULL or the kind of check is invalid
+ */
+
+extern int soGetValidationStats (uint32_t check, SOValidStats *p_stats);
+
+/**
+ *  \brief Reset all the counters.
+ */
+
+extern void soResetValidationStats (void);
+
+/**
+ *  \brief Print all the counters.
+ *
+ *  \param fp stream the counters are to be printed to
+ */
+
+extern void soPrintValidationStats (FILE *fp);
+
+/**
+ *  \brief Quick check of the superblock metadata, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckSuperBlock, otherwise
+ */
+
+extern int soVCheckSuperBlock (SOSuperBlock *p_sb);
+
+/**
+ *  \brief Quick check of the table of inodes metadata, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckInT, otherwise
+ */
+
+extern int soVCheckInT (SOSuperBlock *p_sb);
+
+/**
+ *  \brief Quick check of the data zone metadata, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckDZ, otherwise
+ */
+
+extern int soVCheckDZ (SOSuperBlock *p_sb);
+
+/**
+ *  \brief Quick check of a free inode in the dirty state, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckFDInode, otherwise
+ */
+
+extern int soVCheckFDInode (SOSuperBlock *p_sb, SOInode *p_inode);
+
+/**
+ *  \brief Quick check of an inode in use, according to the selected validation level.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckInodeIU, otherwise
+ */
+
+extern int soVCheckInodeIU (SOSuperBlock *p_sb, SOInode *p_inode);
+
+/**
+ *  \brief Quick check of the header of a data cluster, according to the selected validation level.
+ *
+ *  Only the consistency is checked: the allocation status is not returned. Callers which need it must call
+ *  \e soQCheckStatDC directly.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param nClust logical number of the data cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckStatDC, otherwise
+ */
+
+extern int soVCheckStatDC (SOSuperBlock *p_sb, uint32_t nClust);
+
+/**
+ *  \brief Quick check of the contents of a directory, according to the selected validation level.
+ *
+ *  The inode is supposed to be already known to represent a directory.
+ *
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -<em>error</em> returned by \e soQCheckDirCont, otherwise
+ */
+
+extern int soVCheckDirCont (SOSuperBlock *p_sb, SOInode *p_inode);
+
+/**
+ *  \brief Quick check of metadata which is about to be changed, according to the selected validation level.
+ *
+ *  It stands for the checks performed before the table of inodes or the data zone are changed: sampling does not
+ *  apply to them, so they are always performed, except under \c VALID_TRUSTED on objects already checked.
+ *
+ *  \param check the kind of check (\c VCHK_INT, \c VCHK_DZ, \c VCHK_FDINODE or \c VCHK_INODEIU)
+ *  \param p_sb pointer to a buffer where the superblock is stored
+ *  \param p_inode pointer to a buffer where the inode is stored (ignored, for \c VCHK_INT and \c VCHK_DZ)
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the check was skipped
+ *  \return -\c EINVAL, if the kind of check is invalid
+ *  \return -<em>error</em> returned by the corresponding \e soQCheck* function, otherwise
+ */
+
+extern int soVCheckWrite (uint32_t check, SOSuperBlock *p_sb, SOInode *p_inode);
+
+/**
+ *  \brief Allocate the state of the validation of metadata of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the validation level is full and no object is trusted.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewValidationState (void);
+
+/**
+ *  \brief Bind the state of the validation of metadata of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewValidationState, or \c NULL, for the default context
+ */
+
+extern void soBindValidationState (void *p_state);
+
+#endif /* SOFS_VALIDATION_H_ */
@@ -0,0 +1,799 @@
+/**
+ *  \file sofs_xattr.c (implementation file)
+ *
+ *  \brief Extended attributes of files.
+ *
+ *  The packed list of extended attributes of a file is stored either in the inline area of its entry of the table of
+ *  references to extended attributes, or in its extended attribute cluster. The lists of the files accessed most
+ *  recently are kept in a direct-mapped cache, together with the position of each pair in the list.
+ *
+ *  The index cluster and the table clusters accessed most recently are kept as well, in a direct-mapped cache, and
+ *  written through. So, once the table cluster of a file is cached, looking up its list reads at most its extended
+ *  attribute cluster, and nothing, if the list is stored inline.
+ *
+ *  The following operations are defined:
+ *    \li get the value of an extended attribute of a file
+ *    \li set the value of an extended attribute of a file
+ *    \li list the names of the extended attributes of a file
+ *    \li remove an extended attribute of a file
+ *    \li free all the extended attributes of a file
+ *    \li allocate the state of a new file system context
+ *    \li bind the state of a file system context to the calling thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/xattr.h>
+
+#include "sofs_probe.h"
+#include "sofs_buffercache.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_datacluster.h"
+#include "sofs_basicoper.h"
+#include "sofs_ifuncs_1.h"
+#include "sofs_xattr.h"
+
+/** \brief maximum number of extended attributes of a file */
+#define XATTR_MAX_COUNT  (BSLPC / (XATTR_HDR_SIZE + 1))
+
+/**
+ *  \brief Definition of a parsed list of extended attributes.
+ */
+
+typedef struct soXattrList
+{
+   /** \brief entry state: \c true, if it holds the list of a file */
+    bool valid;
+   /** \brief number of the inode associated to the file */
+    uint32_t nInode;
+   /** \brief length of the packed list */
+    uint32_t len;
+   /** \brief number of extended attributes */
+    uint32_t count;
+   /** \brief position of each pair in the packed list */
+    uint16_t pos[XATTR_MAX_COUNT];
+   /** \brief packed list */
+    unsigned char raw[BSLPC];
+} SOXattrList;
+
+/**
+ *  \brief Definition of a cached table cluster.
+ */
+
+typedef struct soXattrTable
+{
+   /** \brief entry state: \c true, if it holds a table cluster */
+    bool valid;
+   /** \brief index of the table cluster in the index cluster */
+    uint32_t slot;
+   /** \brief logical number of the table cluster */
+    uint32_t nTab;
+   /** \brief contents of the table cluster */
+    SODataClust dc;
+} SOXattrTable;
+
+/**
+ *  \brief Definition of the state of the cache of parsed lists of extended attributes.
+ */
+
+typedef struct soXattrCacheState
+{
+   /** \brief cache of parsed lists of extended attributes */
+    SOXattrList cache[XATTR_CACHE_SIZE];
+   /** \brief state of the index cluster: \c true, if it was looked up */
+    bool idxValid;
+   /** \brief logical number of the index cluster (\c NULL_CLUSTER, if there is none) */
+    uint32_t nIdx;
+   /** \brief contents of the index cluster */
+    SODataClust idx;
+   /** \brief cache of table clusters */
+    SOXattrTable tab[XATTR_TABLE_CACHE_SIZE];
+} SOXattrCacheState;
+
+/*
+ *  Internal data structure
+ */
+/** \brief State of the default file system context */
+static SOXattrCacheState defState = { 0 };
+/** \brief State of the file system context bound to the calling thread */
+static __thread SOXattrCacheState *cur = &defState;
+
+/* Allusion to internal functions */
+
+static int loadList (uint32_t nInode, SOXattrList **pp_list);
+static int storeList (uint32_t nInode, SOXattrList *p_list);
+static int parseList (SOXattrList *p_list, uint32_t area);
+static int findPair (SOXattrList *p_list, const char *name);
+static void copyWithout (SOXattrList *p_dest, SOXattrList *p_src, int skip);
+static int loadIndex (bool alloc, SODataClust **pp_idx);
+static int loadTable (uint32_t nInode, bool alloc, SOXattrTable **pp_tab);
+static int storeTable (SOXattrTable *p_tab);
+static int newRefCluster (uint32_t *p_nClust, SODataClust *p_dc, bool entries);
+static int releaseCluster (uint32_t nClust);
+
+/**
+ *  \brief Get the value of an extended attribute of a file.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is to be stored
+ *  \param size size of the buffer (if zero, only the length of the value is returned)
+ *
+ *  \return <em>length of the value</em>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range or the name is \c NULL or empty
+ *  \return -\c ENODATA, if there is no extended attribute with the given name
+ *  \return -\c ERANGE, if the buffer is too small to hold the value
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soGetXattr (uint32_t nInode, const char *name, void *value, uint32_t size)
+{
+  soColorProbe (734, "07;31", "soGetXattr (%"PRIu32", \"%s\", %p, %"PRIu32")\n", nInode, name, value, size);
+
+  SOXattrList *p_list;
+  unsigned char *p;
+  uint32_t vLen;
+  int i, stat;
+
+  if ((name == NULL) || (name[0] == '\0')) return -EINVAL;
+  if ((stat = loadList (nInode, &p_list)) != 0)
+     return stat;
+  if ((i = findPair (p_list, name)) < 0)
+     return -ENODATA;
+
+  p = p_list->raw + p_list->pos[i];
+  vLen = p[1] | (p[2] << 8);
+  if (size == 0) return (int) vLen;
+  if ((value == NULL) || (size < vLen)) return -ERANGE;
+  memcpy (value, p + XATTR_HDR_SIZE + p[0], vLen);
+
+  return (int) vLen;
+}
+
+/**
+ *  \brief Set the value of an extended attribute of a file.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is stored
+ *  \param size length of the value
+ *  \param flags \c XATTR_CREATE, if the extended attribute must not exist, \c XATTR_REPLACE, if it must exist, or
+ *               <tt>0 (zero)</tt>, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range or the name is \c NULL or empty or the pointer to
+ *                      the value is \c NULL and the length is not zero
+ *  \return -\c ERANGE, if the name is too long
+ *  \return -\c EEXIST, if \c XATTR_CREATE was given and the extended attribute exists
+ *  \return -\c ENODATA, if \c XATTR_REPLACE was given and the extended attribute does not exist
+ *  \return -\c ENOSPC, if the list of extended attributes would not fit into a data cluster, or the inode number is out
+ *                      of the range covered by the table of references to extended attributes, or there are no free
+ *                      data clusters
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSetXattr (uint32_t nInode, const char *name, const void *value, uint32_t size, int flags)
+{
+  soColorProbe (735, "07;31", "soSetXattr (%"PRIu32", \"%s\", %p, %"PRIu32", %d)\n", nInode, name, value, size, flags);
+
+  SOXattrList list;                                          /* list being built */
+  SOXattrList *p_list;
+  unsigned char *p;
+  uint32_t nLen;
+  int i, stat;
+
+  if ((name == NULL) || (name[0] == '\0') || ((value == NULL) && (size != 0))) return -EINVAL;
+  if ((nLen = strlen (name)) > XATTR_NAME_LEN) return -ERANGE;
+  if (size > BSLPC) return -ENOSPC;
+  if ((stat = loadList (nInode, &p_list)) != 0)
+     return stat;
+  i = findPair (p_list, name);
+  if (((flags & XATTR_CREATE) == XATTR_CREATE) && (i >= 0)) return -EEXIST;
+  if (((flags & XATTR_REPLACE) == XATTR_REPLACE) && (i < 0)) return -ENODATA;
+
+  /* the new pair is appended to the list, without the old one */
+
+  copyWithout (&list, p_list, i);
+  if (list.len + XATTR_HDR_SIZE + nLen + size > BSLPC) return -ENOSPC;
+  p = list.raw + list.len;
+  p[0] = (unsigned char) nLen;
+  p[1] = (unsigned char) (size & 0xff);
+  p[2] = (unsigned char) (size >> 8);
+  memcpy (p + XATTR_HDR_SIZE, name, nLen);
+  memcpy (p + XATTR_HDR_SIZE + nLen, value, size);
+  list.pos[list.count] = list.len;
+  list.count += 1;
+  list.len += XATTR_HDR_SIZE + nLen + size;
+
+  if ((stat = storeList (nInode, &list)) != 0)
+     { p_list->valid = false;
+       return stat;
+     }
+  *p_list = list;
+
+  return 0;
+}
+
+/**
+ *  \brief List the names of the extended attributes of a file.
+ *
+ *  The names are stored one after the other, each one terminated by a null character.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param list pointer to the buffer where the names are to be stored
+ *  \param size size of the buffer (if zero, only the length of the list is returned)
+ *
+ *  \return <em>length of the list</em>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range
+ *  \return -\c ERANGE, if the buffer is too small to hold the list
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soListXattr (uint32_t nInode, char *list, uint32_t size)
+{
+  soColorProbe (736, "07;31", "soListXattr (%"PRIu32", %p, %"PRIu32")\n", nInode, list, size);
+
+  SOXattrList *p_list;
+  unsigned char *p;
+  uint32_t i, total, n;
+  int stat;
+
+  if ((stat = loadList (nInode, &p_list)) != 0)
+     return stat;
+
+  for (i = 0, total = 0; i < p_list->count; i++)
+    total += p_list->raw[p_list->pos[i]] + 1;
+  if (size == 0) return (int) total;
+  if ((list == NULL) || (size < total)) return -ERANGE;
+
+  for (i = 0, n = 0; i < p_list->count; i++)
+  { p = p_list->raw + p_list->pos[i];
+    memcpy (list + n, p + XATTR_HDR_SIZE, p[0]);
+    n += p[0];
+    list[n++] = '\0';
+  }
+
+  return (int) total;
+}
+
+/**
+ *  \brief Remove an extended attribute of a file.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param name name of the extended attribute
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range or the name is \c NULL or empty
+ *  \return -\c ENODATA, if there is no extended attribute with the given name
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soRemoveXattr (uint32_t nInode, const char *name)
+{
+  soColorProbe (737, "07;31", "soRemoveXattr (%"PRIu32", \"%s\")\n", nInode, name);
+
+  SOXattrList list;                                          /* list being built */
+  SOXattrList *p_list;
+  int i, stat;
+
+  if ((name == NULL) || (name[0] == '\0')) return -EINVAL;
+  if ((stat = loadList (nInode, &p_list)) != 0)
+     return stat;
+  if ((i = findPair (p_list, name)) < 0)
+     return -ENODATA;
+
+  copyWithout (&list, p_list, i);
+  if ((stat = storeList (nInode, &list)) != 0)
+     { p_list->valid = false;
+       return stat;
+     }
+  *p_list = list;
+
+  return 0;
+}
+
+/**
+ *  \brief Free all the extended attributes of a file.
+ *
+ *  It should be called when the inode is about to be freed.
+ *
+ *  \param nInode number of the inode associated to the file
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soFreeXattr (uint32_t nInode)
+{
+  SOSuperBlock *p_sb;
+  SOXattrTable *p_tab;
+  SOXattrRef *p_ref;
+  uint32_t nClust;
+  int stat;
+
+  if ((stat = soLoadSuperBlock ()) != 0)
+     return stat;
+  p_sb = soGetSuperBlock ();
+  if (nInode >= p_sb->iTotal) return -EINVAL;
+
+  cur->cache[nInode % XATTR_CACHE_SIZE].valid = false;
+  if ((stat = loadTable (nInode, false, &p_tab)) != 0)
+     return stat;
+  if (p_tab == NULL) return 0;
+
+  p_ref = (SOXattrRef *) p_tab->dc.info.data + nInode % XPC;
+  if ((p_ref->clust == NULL_CLUSTER) && (p_ref->inl[0] == 0)) return 0;
+  nClust = p_ref->clust;
+  p_ref->clust = NULL_CLUSTER;
+  memset (p_ref->inl, 0, XATTR_INLINE_SIZE);
+  if ((stat = storeTable (p_tab)) != 0)
+     return stat;
+  if (nClust != NULL_CLUSTER)
+     return releaseCluster (nClust);
+
+  return 0;
+}
+
+/**
+ *  \brief Allocate the state of the cache of extended attributes of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+void *soNewXattrCacheState (void)
+{
+  SOXattrCacheState *p;
+
+  if ((p = calloc (1, sizeof (SOXattrCacheState))) == NULL) return NULL;
+
+  return p;
+}
+
+/**
+ *  \brief Bind the state of the cache of extended attributes of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewXattrCacheState, or \c NULL, for the default context
+ */
+
+void soBindXattrCacheState (void *p_state)
+{
+  cur = (p_state == NULL) ? &defState : (SOXattrCacheState *) p_state;
+}
+
+/**
+ *  \brief Get the parsed list of extended attributes of a file.
+ *
+ *  If it is not in the cache, the entry of the table of references to extended attributes is looked up (the table
+ *  cluster is read, if it is not cached) and, if there is one, the extended attribute cluster is read and the list is
+ *  parsed.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param pp_list pointer to a location where the pointer to the cached list is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range
+ *  \return -\c ELIBBAD, if the list is inconsistent
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int loadList (uint32_t nInode, SOXattrList **pp_list)
+{
+  SOSuperBlock *p_sb;
+  SOXattrList *p_list = &cur->cache[nInode % XATTR_CACHE_SIZE];
+  SOXattrTable *p_tab;
+  SODataClust dc;
+  SOXattrRef *p_ref;
+  int stat;
+
+  if ((stat = soLoadSuperBlock ()) != 0)
+     return stat;
+  p_sb = soGetSuperBlock ();
+  if (nInode >= p_sb->iTotal) return -EINVAL;
+
+  *pp_list = p_list;
+  if (p_list->valid && (p_list->nInode == nInode))
+     return 0;
+
+  p_list->valid = false;
+  p_list->nInode = nInode;
+  memset (p_list->raw, 0, BSLPC);
+  if ((stat = loadTable (nInode, false, &p_tab)) != 0)
+     return stat;
+  if (p_tab == NULL)
+     return parseList (p_list, 0);
+
+  p_ref = (SOXattrRef *) p_tab->dc.info.data + nInode % XPC;
+  if (p_ref->clust == NULL_CLUSTER)
+     { memcpy (p_list->raw, p_ref->inl, XATTR_INLINE_SIZE);
+       return parseList (p_list, XATTR_INLINE_SIZE);
+     }
+  if ((stat = soReadCacheCluster (p_sb->dZoneStart + p_ref->clust * BLOCKS_PER_CLUSTER, &dc)) != 0)
+     return stat;
+  memcpy (p_list->raw, dc.info.data, BSLPC);
+
+  return parseList (p_list, BSLPC);
+}
+
+/**
+ *  \brief Store the packed list of extended attributes of a file.
+ *
+ *  The list is stored in the inline area, if it fits into it, the extended attribute cluster being freed if there is
+ *  one; otherwise, it is stored in the extended attribute cluster, which is allocated if there is none.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param p_list pointer to the list
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int storeList (uint32_t nInode, SOXattrList *p_list)
+{
+  SOSuperBlock *p_sb;
+  SOXattrTable *p_tab;
+  SODataClust xc;
+  SOXattrRef *p_ref;
+  uint32_t nClust;
+  int stat;
+
+  /* an empty list needs no table cluster */
+
+  if ((stat = loadTable (nInode, p_list->len != 0, &p_tab)) != 0)
+     return stat;
+  if (p_tab == NULL) return 0;
+  p_ref = (SOXattrRef *) p_tab->dc.info.data + nInode % XPC;
+
+  if (p_list->len <= XATTR_INLINE_SIZE)
+     { nClust = p_ref->clust;
+       p_ref->clust = NULL_CLUSTER;
+       memset (p_ref->inl, 0, XATTR_INLINE_SIZE);
+       memcpy (p_ref->inl, p_list->raw, p_list->len);
+       if ((stat = storeTable (p_tab)) != 0)
+          return stat;
+       return (nClust != NULL_CLUSTER) ? releaseCluster (nClust) : 0;
+     }
+
+  if (p_ref->clust == NULL_CLUSTER)
+     { if ((stat = soAllocDataCluster (nInode, &nClust)) != 0)
+          return stat;
+       p_ref->clust = nClust;
+       memset (p_ref->inl, 0, XATTR_INLINE_SIZE);
+       if ((stat = storeTable (p_tab)) != 0)
+          return stat;
+     }
+  p_sb = soGetSuperBlock ();
+  if ((stat = soReadCacheCluster (p_sb->dZoneStart + p_ref->clust * BLOCKS_PER_CLUSTER, &xc)) != 0)
+     return stat;
+  memset (xc.info.data, 0, BSLPC);
+  memcpy (xc.info.data, p_list->raw, p_list->len);
+
+  return soWriteCacheCluster (p_sb->dZoneStart + p_ref->clust * BLOCKS_PER_CLUSTER, &xc);
+}
+
+/**
+ *  \brief Parse a packed list of extended attributes.
+ *
+ *  \param p_list pointer to the list
+ *  \param area size of the storage area the list was read from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ELIBBAD, if a pair goes past the end of the storage area
+ */
+
+static int parseList (SOXattrList *p_list, uint32_t area)
+{
+  unsigned char *p;
+  uint32_t pos = 0;
+
+  p_list->count = 0;
+  while ((pos + XATTR_HDR_SIZE <= area) && (p_list->raw[pos] != 0))
+  { p = p_list->raw + pos;
+    if (pos + XATTR_HDR_SIZE + p[0] + (p[1] | (p[2] << 8)) > area)
+       return -ELIBBAD;
+    p_list->pos[p_list->count++] = pos;
+    pos += XATTR_HDR_SIZE + p[0] + (p[1] | (p[2] << 8));
+  }
+  p_list->len = pos;
+  p_list->valid = true;
+
+  return 0;
+}
+
+/**
+ *  \brief Search a parsed list of extended attributes for a name.
+ *
+ *  \param p_list pointer to the list
+ *  \param name name of the extended attribute
+ *
+ *  \return <em>index of the pair</em>, if it was found
+ *  \return <tt>-1</tt>, otherwise
+ */
+
+static int findPair (SOXattrList *p_list, const char *name)
+{
+  unsigned char *p;
+  uint32_t i, nLen = strlen (name);
+
+  for (i = 0; i < p_list->count; i++)
+  { p = p_list->raw + p_list->pos[i];
+    if ((p[0] == nLen) && (memcmp (p + XATTR_HDR_SIZE, name, nLen) == 0))
+       return (int) i;
+  }
+
+  return -1;
+}
+
+/**
+ *  \brief Copy a parsed list of extended attributes, leaving a pair out.
+ *
+ *  \param p_dest pointer to the copy
+ *  \param p_src pointer to the list
+ *  \param skip index of the pair to be left out (if negative, none is)
+ */
+
+static void copyWithout (SOXattrList *p_dest, SOXattrList *p_src, int skip)
+{
+  unsigned char *p;
+  uint32_t i, n;
+
+  p_dest->valid = true;
+  p_dest->nInode = p_src->nInode;
+  p_dest->len = p_dest->count = 0;
+  memset (p_dest->raw, 0, BSLPC);
+  for (i = 0; i < p_src->count; i++)
+    if ((int) i != skip)
+       { p = p_src->raw + p_src->pos[i];
+         n = XATTR_HDR_SIZE + p[0] + (p[1] | (p[2] << 8));
+         memcpy (p_dest->raw + p_dest->len, p, n);
+         p_dest->pos[p_dest->count++] = p_dest->len;
+         p_dest->len += n;
+       }
+}
+
+/**
+ *  \brief Get the index cluster.
+ *
+ *  Its logical number is kept in the reserved area of the superblock. It is read only once: the cached copy is written
+ *  through, whenever a reference to a table cluster changes.
+ *
+ *  \param alloc \c true, if the index cluster is to be allocated, if it does not exist yet
+ *  \param pp_idx pointer to a location where the pointer to the cached index cluster is to be stored (\c NULL, if it
+ *                does not exist and was not allocated)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int loadIndex (bool alloc, SODataClust **pp_idx)
+{
+  SOSuperBlock *p_sb;
+  uint32_t nIdx;
+  int stat;
+
+  *pp_idx = NULL;
+  if ((stat = soLoadSuperBlock ()) != 0)
+     return stat;
+  p_sb = soGetSuperBlock ();
+
+  if (!cur->idxValid)
+     { memcpy (&nIdx, p_sb->reserved, sizeof (uint32_t));
+       if ((nIdx == 0) || (nIdx >= p_sb->dZoneTotal))
+          nIdx = NULL_CLUSTER;
+          else if ((stat = soReadCacheCluster (p_sb->dZoneStart + nIdx * BLOCKS_PER_CLUSTER, &cur->idx)) != 0)
+                  return stat;
+       cur->nIdx = nIdx;
+       cur->idxValid = true;
+     }
+  if (cur->nIdx == NULL_CLUSTER)
+     { if (!alloc) return 0;
+       if ((stat = newRefCluster (&nIdx, &cur->idx, false)) != 0)
+          return stat;
+       if ((stat = soLoadSuperBlock ()) != 0)
+          return stat;
+       p_sb = soGetSuperBlock ();
+       memcpy (p_sb->reserved, &nIdx, sizeof (uint32_t));
+       if ((stat = soStoreSuperBlock ()) != 0)
+          return stat;
+       cur->nIdx = nIdx;
+     }
+  *pp_idx = &cur->idx;
+
+  return 0;
+}
+
+/**
+ *  \brief Get the table cluster which holds the entry of an inode.
+ *
+ *  The table cluster is read only if it is not cached: the cached copy is written through by \e storeTable.
+ *
+ *  \param nInode number of the inode
+ *  \param alloc \c true, if the index cluster and the table cluster are to be allocated, if they do not exist yet
+ *  \param pp_tab pointer to a location where the pointer to the cached table cluster is to be stored (\c NULL, if it
+ *                does not exist and was not allocated)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOSPC, if the inode number is out of the range covered by the table (when allocating)
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int loadTable (uint32_t nInode, bool alloc, SOXattrTable **pp_tab)
+{
+  SOSuperBlock *p_sb;
+  SODataClust *p_idx;
+  SOXattrTable *p_tab;
+  uint32_t slot = nInode / XPC;
+  int stat;
+
+  *pp_tab = NULL;
+  if (slot >= RPC)
+     return (alloc) ? -ENOSPC : 0;
+  p_tab = &cur->tab[slot % XATTR_TABLE_CACHE_SIZE];
+  if (p_tab->valid && (p_tab->slot == slot))
+     { *pp_tab = p_tab;
+       return 0;
+     }
+
+  if ((stat = loadIndex (alloc, &p_idx)) != 0)
+     return stat;
+  if (p_idx == NULL) return 0;
+  p_tab->valid = false;
+  if (p_idx->info.ref[slot] == NULL_CLUSTER)
+     { if (!alloc) return 0;
+       if ((stat = newRefCluster (&p_idx->info.ref[slot], &p_tab->dc, true)) != 0)
+          return stat;
+       p_sb = soGetSuperBlock ();
+       if ((stat = soWriteCacheCluster (p_sb->dZoneStart + cur->nIdx * BLOCKS_PER_CLUSTER, p_idx)) != 0)
+          return stat;
+     }
+     else { p_sb = soGetSuperBlock ();
+            if ((stat = soReadCacheCluster (p_sb->dZoneStart + p_idx->info.ref[slot] * BLOCKS_PER_CLUSTER,
+                                            &p_tab->dc)) != 0)
+               return stat;
+          }
+  p_tab->slot = slot;
+  p_tab->nTab = p_idx->info.ref[slot];
+  p_tab->valid = true;
+  *pp_tab = p_tab;
+
+  return 0;
+}
+
+/**
+ *  \brief Store a table cluster.
+ *
+ *  If none of its entries is in use any longer, it is freed instead and its reference is removed from the index
+ *  cluster, which is itself freed, and its logical number removed from the superblock, if it holds no other reference.
+ *
+ *  \param p_tab pointer to the cached table cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int storeTable (SOXattrTable *p_tab)
+{
+  SOSuperBlock *p_sb = soGetSuperBlock ();
+  SOXattrRef *p_ref = (SOXattrRef *) p_tab->dc.info.data;
+  uint32_t i, nIdx;
+  int stat;
+
+  for (i = 0; i < XPC; i++)
+    if ((p_ref[i].clust != NULL_CLUSTER) || (p_ref[i].inl[0] != 0)) break;
+  if (i < XPC)
+     return soWriteCacheCluster (p_sb->dZoneStart + p_tab->nTab * BLOCKS_PER_CLUSTER, &p_tab->dc);
+
+  /* the table cluster is empty */
+
+  p_tab->valid = false;
+  if ((stat = releaseCluster (p_tab->nTab)) != 0)
+     return stat;
+  cur->idx.info.ref[p_tab->slot] = NULL_CLUSTER;
+  for (i = 0; i < RPC; i++)
+    if (cur->idx.info.ref[i] != NULL_CLUSTER) break;
+  p_sb = soGetSuperBlock ();
+  if (i < RPC)
+     return soWriteCacheCluster (p_sb->dZoneStart + cur->nIdx * BLOCKS_PER_CLUSTER, &cur->idx);
+
+  /* and so is the index cluster */
+
+  nIdx = cur->nIdx;
+  cur->nIdx = NULL_CLUSTER;
+  if ((stat = releaseCluster (nIdx)) != 0)
+     return stat;
+  if ((stat = soLoadSuperBlock ()) != 0)
+     return stat;
+  p_sb = soGetSuperBlock ();
+  memset (p_sb->reserved, 0, sizeof (uint32_t));
+
+  return soStoreSuperBlock ();
+}
+
+/**
+ *  \brief Allocate an index cluster or a table cluster, on behalf of the root directory, and initialize it.
+ *
+ *  It is not in the list of references of the root directory: it belongs to the superblock, through the reserved
+ *  area, and it is freed when it becomes empty.
+ *
+ *  \param p_nClust pointer to a location where the logical number of the data cluster is to be stored
+ *  \param p_dc pointer to a buffer where the contents of the data cluster is to be stored
+ *  \param entries \c true, if it is a table cluster, \c false, if it is an index cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int newRefCluster (uint32_t *p_nClust, SODataClust *p_dc, bool entries)
+{
+  SOSuperBlock *p_sb;
+  SOXattrRef *p_ref;
+  uint32_t i, nClust;
+  int stat;
+
+  if ((stat = soAllocDataCluster (0, &nClust)) != 0)
+     return stat;
+  p_sb = soGetSuperBlock ();
+  if ((stat = soReadCacheCluster (p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER, p_dc)) != 0)
+     return stat;
+  memset (p_dc->info.data, 0, BSLPC);
+  if (entries)
+     for (i = 0, p_ref = (SOXattrRef *) p_dc->info.data; i < XPC; i++)
+       p_ref[i].clust = NULL_CLUSTER;
+     else for (i = 0; i < RPC; i++)
+            p_dc->info.ref[i] = NULL_CLUSTER;
+  if ((stat = soWriteCacheCluster (p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER, p_dc)) != 0)
+     return stat;
+  *p_nClust = nClust;
+
+  return 0;
+}
+
+/**
+ *  \brief Free an extended attribute cluster and dissociate it from the inode it was allocated on behalf of.
+ *
+ *  It is not in the list of references of the inode, so it must be left clean when it is freed.
+ *
+ *  \param nClust logical number of the data cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>error</em> returned by the lower level functions, otherwise
+ */
+
+static int releaseCluster (uint32_t nClust)
+{
+  SOSuperBlock *p_sb;
+  SODataClust dc;
+  int stat;
+
+  if ((stat = soFreeDataCluster (nClust)) != 0)
+     return stat;
+  p_sb = soGetSuperBlock ();
+  if ((stat = soReadCacheCluster (p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER, &dc)) != 0)
+     return stat;
+  dc.stat = NULL_INODE;
+
+  return soWriteCacheCluster (p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER, &dc);
+}
@@ -0,0 +1,201 @@
+/**
+ *  \file sofs_xattr.h (interface file)
+ *
+ *  \brief Extended attributes of files.
+ *
+ *  The extended attributes of a file are kept as packed name/value pairs. Each pair is stored as
+ *    \li one byte with the length of the name
+ *    \li two bytes with the length of the value (least significant byte first)
+ *    \li the name, without the terminating null character
+ *    \li the value;
+ *  the list ends with a zero length name or at the end of the storage area.
+ *
+ *  The inode has no room for a reference to the extended attributes and its layout can not be changed. So, they are
+ *  located through a table of references to extended attributes, indexed by the inode number, which is stored in data
+ *  clusters: an index cluster, whose logical number is kept in the reserved area of the superblock, holds the
+ *  references to the table clusters, each one holding the entries of \c XPC consecutive inodes. An entry contains
+ *    \li the reference to the extended attribute cluster of the inode, where the list is stored, or \c NULL_CLUSTER
+ *    \li an inline area, where the list is stored instead, if it fits into it and there is no extended attribute
+ *        cluster.
+ *
+ *  Thus, a file whose extended attributes are small takes no data cluster of its own. The index and the table clusters
+ *  are allocated on behalf of the root directory, but they are not in its list of references: they belong to the
+ *  superblock, through its reserved area, are allocated when they are first needed and are freed as soon as they hold
+ *  no entry in use. The extended attribute cluster of a file is allocated on its behalf, but it is not in its list of
+ *  references either: it is freed when the attributes no longer need it or when the inode is freed.
+ *
+ *  The lists of the files accessed most recently are kept in a cache, parsed, so that repeated lookups do not read the
+ *  storage device. The index cluster and the table clusters accessed most recently are cached too: looking up a list
+ *  which is not cached reads its table cluster, only if it is not cached either, and its extended attribute cluster,
+ *  only if the list is not stored inline.
+ *
+ *  The following operations are defined:
+ *    \li get the value of an extended attribute of a file
+ *    \li set the value of an extended attribute of a file
+ *    \li list the names of the extended attributes of a file
+ *    \li remove an extended attribute of a file
+ *    \li free all the extended attributes of a file.
+ *
+ *  \remarks In case an error occurs, all functions return a negative value which is the symmetric of the system error
+ *           or the local error that better represents the error cause. Local errors are out of the range of the
+ *           system errors.
+ */
+
+#ifndef SOFS_XATTR_H_
+#define SOFS_XATTR_H_
+
+#include <stdint.h>
+
+#include "sofs_datacluster.h"
+
+/** \brief size of the inline area of an entry of the table of references to extended attributes */
+#define XATTR_INLINE_SIZE  28
+
+/** \brief maximum length of the name of an extended attribute */
+#define XATTR_NAME_LEN     255
+
+/** \brief number of bytes which precede the name of an extended attribute in the packed list */
+#define XATTR_HDR_SIZE     3
+
+/** \brief number of parsed lists of extended attributes kept in the cache */
+#define XATTR_CACHE_SIZE   32
+
+/** \brief number of table clusters kept in the cache */
+#define XATTR_TABLE_CACHE_SIZE  8
+
+/**
+ *  \brief Definition of an entry of the table of references to extended attributes.
+ */
+
+typedef struct soXattrRef
+{
+   /** \brief reference to the extended attribute cluster of the inode (\c NULL_CLUSTER, if none) */
+    uint32_t clust;
+   /** \brief packed list of extended attributes, if there is no extended attribute cluster */
+    unsigned char inl[XATTR_INLINE_SIZE];
+} SOXattrRef;
+
+/** \brief number of entries of the table of references to extended attributes per data cluster */
+#define XPC  (BSLPC / sizeof (SOXattrRef))
+
+/**
+ *  \brief Get the value of an extended attribute of a file.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is to be stored
+ *  \param size size of the buffer (if zero, only the length of the value is returned)
+ *
+ *  \return <em>length of the value</em>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range or the name is \c NULL or empty
+ *  \return -\c ENODATA, if there is no extended attribute with the given name
+ *  \return -\c ERANGE, if the buffer is too small to hold the value
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soGetXattr (uint32_t nInode, const char *name, void *value, uint32_t size);
+
+/**
+ *  \brief Set the value of an extended attribute of a file.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is stored
+ *  \param size length of the value
+ *  \param flags \c XATTR_CREATE, if the extended attribute must not exist, \c XATTR_REPLACE, if it must exist, or
+ *               <tt>0 (zero)</tt>, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range or the name is \c NULL or empty or the pointer to
+ *                      the value is \c NULL and the length is not zero
+ *  \return -\c ERANGE, if the name is too long
+ *  \return -\c EEXIST, if \c XATTR_CREATE was given and the extended attribute exists
+ *  \return -\c ENODATA, if \c XATTR_REPLACE was given and the extended attribute does not exist
+ *  \return -\c ENOSPC, if the list of extended attributes would not fit into a data cluster, or the inode number is out
+ *                      of the range covered by the table of references to extended attributes, or there are no free
+ *                      data clusters
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSetXattr (uint32_t nInode, const char *name, const void *value, uint32_t size, int flags);
+
+/**
+ *  \brief List the names of the extended attributes of a file.
+ *
+ *  The names are stored one after the other, each one terminated by a null character.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param list pointer to the buffer where the names are to be stored
+ *  \param size size of the buffer (if zero, only the length of the list is returned)
+ *
+ *  \return <em>length of the list</em>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range
+ *  \return -\c ERANGE, if the buffer is too small to hold the list
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soListXattr (uint32_t nInode, char *list, uint32_t size);
+
+/**
+ *  \brief Remove an extended attribute of a file.
+ *
+ *  \param nInode number of the inode associated to the file
+ *  \param name name of the extended attribute
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range or the name is \c NULL or empty
+ *  \return -\c ENODATA, if there is no extended attribute with the given name
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soRemoveXattr (uint32_t nInode, const char *name);
+
+/**
+ *  \brief Free all the extended attributes of a file.
+ *
+ *  It should be called when the inode is about to be freed.
+ *
+ *  \param nInode number of the inode associated to the file
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>inode number</em> is out of range
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soFreeXattr (uint32_t nInode);
+
+/**
+ *  \brief Allocate the state of the cache of extended attributes of a new file system context.
+ *
+ *  The state is set as it is when the process starts: the cache is empty.
+ *
+ *  \return <em>pointer to the state</em>, on success
+ *  \return \c NULL, if there is not enough memory
+ */
+
+extern void *soNewXattrCacheState (void);
+
+/**
+ *  \brief Bind the state of the cache of extended attributes of a file system context to the calling thread.
+ *
+ *  \param p_state pointer to the state, as returned by \e soNewXattrCacheState, or \c NULL, for the default context
+ */
+
+extern void soBindXattrCacheState (void *p_state);
+
+#endif /* SOFS_XATTR_H_ */
@@ -0,0 +1,110 @@
+/**
+ *  \file soLseek.c (implementation file)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/statvfs.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <utime.h>
+#include <libgen.h>
+#include <string.h>
+
+#include "sofs_probe.h"
+#include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_buffercache.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_direntry.h"
+#include "sofs_datacluster.h"
+#include "sofs_basicoper.h"
+#include "sofs_basicconsist.h"
+#include "sofs_ifuncs_1.h"
+#include "sofs_ifuncs_2.h"
+#include "sofs_ifuncs_3.h"
+#include "sofs_ifuncs_4.h"
+#include "sofs_syscalls.h"
+
+/**
+ *  \brief Find the next region of data or the next hole in a regular file.
+ *
+ *  It tries to emulate <em>lseek</em> system call for the values \c SEEK_DATA and \c SEEK_HOLE of <tt>whence</tt>.
+ *  A hole is a region of the file whose data clusters were never allocated, the region past the end of file counting
+ *  as a hole; so, the positions returned are aligned to the boundaries of the data clusters, or equal to the given
+ *  position or to the size of the file.
+ *
+ *  The list of references of the file is parsed from the data cluster where <tt>pos</tt> lies, no data cluster being
+ *  read.
+ *
+ *  \param ePath path to the file
+ *  \param pos starting [byte] position in the file data continuum
+ *  \param whence \c SEEK_DATA, to find the next region of data, or \c SEEK_HOLE, to find the next hole, at or after
+ *                <tt>pos</tt>
+ *
+ *  \return <em>the [byte] position found</em>, on success
+ *  \return -\c EINVAL, if the pointer to the string is \c NULL or or the path string is a \c NULL string or the path does
+ *                      not describe an absolute path or <tt>pos</tt> is negative or <tt>whence</tt> is not one of
+ *                      the values above
+ *  \return -\c ENXIO, if <tt>pos</tt> is not before the end of file or, for \c SEEK_DATA, there is no data past it
+ *  \return -\c ENAMETOOLONG, if the path name or any of its components exceed the maximum allowed length
+ *  \return -\c ENOTDIR, if any of the components of <tt>ePath</tt>, but the last one, is not a directory
+ *  \return -\c EISDIR, if <tt>ePath</tt> describes a directory
+ *  \return -\c ELOOP, if the path resolves to more than one symbolic link
+ *  \return -\c ENOENT, if no entry with a name equal to any of the components of <tt>ePath</tt> is found
+ *  \return -\c EACCES, if the process that calls the operation has not execution permission on any of the components
+ *                      of <tt>ePath</tt>, but the last one
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soLseek (const char *ePath, int32_t pos, int whence)
+{
+  soColorProbe (237, "07;31", "soLseek (\"%s\", %"PRIi32", %d)\n", ePath, pos, whence);
+
+  SOInode inode;                                             /* inode associated to the file */
+  uint32_t nInode;                                           /* number of the inode associated to the file */
+  uint32_t clustInd, lastInd;                                /* indexes to the list of references */
+  uint32_t nClust;                                           /* logical number of the data cluster */
+  int stat;                                                  /* function return status */
+
+  /* validation of the arguments */
+
+  if ((ePath == NULL) || (ePath[0] != '/') || (pos < 0) || ((whence != SEEK_DATA) && (whence != SEEK_HOLE)))
+     return -EINVAL;
+  if (strlen (ePath) > MAX_PATH)
+     return -ENAMETOOLONG;
+  if ((stat = soGetDirEntryByPath (ePath, NULL, &nInode)) != 0)
+     return stat;
+  if ((stat = soReadInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+  if ((inode.mode & INODE_DIR) == INODE_DIR)
+     return -EISDIR;
+  if ((uint32_t) pos >= inode.size)
+     return -ENXIO;
+
+  /* the data clusters up to the end of file are looked up, until one in the state sought for is found */
+
+  lastInd = (inode.size - 1) / BSLPC;
+  for (clustInd = (uint32_t) pos / BSLPC; clustInd <= lastInd; clustInd++)
+  { if ((stat = soHandleFileCluster (nInode, clustInd, GET, &nClust)) != 0)
+       return stat;
+    if ((nClust != NULL_CLUSTER) == (whence == SEEK_DATA))
+       break;
+  }
+
+  if (clustInd > lastInd)
+     return (whence == SEEK_DATA) ? -ENXIO : (int) inode.size;
+  if (clustInd * BSLPC <= (uint32_t) pos)
+     return pos;
+  return (int) (clustInd * BSLPC);
+}
@@ -39,6 +39,10 @@
  *
  *  It tries to emulate <em>read</em> system call.
  *
+ *  A file may be sparse: the data clusters of the regions which were never written (holes) are not allocated. Holes
+ *  read as zeros and are not read from the storage device. Each data cluster is located once: it is read directly
+ *  through the buffercache, at the number its reference yields.
+ *
  *  \param ePath path to the file
  *  \param buff pointer to the buffer where data to be read is to be stored
  *  \param count number of bytes to be read
@@ -68,124 +72,78 @@ int soRead (const char *ePath, void *buff, uint32_t count, int32_t pos)
 {
   soColorProbe (229, "07;31", "soRead (\"%s\", %p, %u, %u)\n", ePath, buff, count, pos);
 
-  int stat; // variavel para o estado
-  SOSuperBlock *p_sb; // ponteiro para o super bloco
-  SOInode p_inode; // pointer to inode table for nBlk block position
-  uint32_t p_nInodeEnt; // ponteiro para a localizacao onde o nº do nó I associado à entrada é armazenado
-  uint32_t offset; // numero do offset ()
-  uint32_t p_clustInd; // ponteiro para indice do cluster
-  uint32_t p_clustIndF; // ponteiro para indice do cluster final
-  uint32_t offsetFinal; // offset final
-  int bytesRead = 0; // variável para indicar o numero de bytes lidos em sucesso
-
-  SODataClust p_buff; // ponteiro para o buffer
-
+  int stat; // function return status
+  SOSuperBlock *p_sb; // pointer to the superblock
+  SOInode inode; // inode associated to the file
+  SODataClust dc; // data cluster being read
+  uint32_t nInode; // number of the inode associated to the file
+  uint32_t mask; // operations allowed on the file
+  uint32_t clustInd, offset; // location of the current byte position in the file
+  uint32_t nClust; // logical number of the current data cluster
+  uint32_t n; // number of bytes to be copied from the current data cluster
+  uint32_t bytesRead = 0; // number of bytes read so far
 
   /*------VALIDATIONS----------*/
 
-  /* carregar super bloco*/
-  if( (stat = soLoadSuperBlock()) != 0)
-  	return stat;
-
-  /* obter super bloco*/
-  p_sb = soGetSuperBlock();
-
-  /* if the pointer to the string is null */
-  if(ePath == NULL)
-  	return -EINVAL;
+  if ((ePath == NULL) || (ePath[0] != '/') || (buff == NULL) || (pos < 0))
+    return -EINVAL;
 
- /* if the path does not describe a absolute path*/
-  if(ePath[0] != '/')
-  	return -EINVAL;
+  if (strlen(ePath) > MAX_PATH)
+    return -ENAMETOOLONG;
 
-  /*if the path name or any of its components exceed the maximum allowed length*/
-  if(strlen(ePath) > MAX_PATH) 
-  	return -ENAMETOOLONG;
+  if ((uint32_t) pos > MAX_FILE_SIZE)
+    return -EFBIG;
 
-   /* Obter o Inode associado ao ePath e verificar se há erros */
-  if( (stat = soGetDirEntryByPath(ePath, NULL, &p_nInodeEnt)) != 0)
+  if ((stat = soGetDirEntryByPath(ePath, NULL, &nInode)) != 0)
     return stat;
 
-  /* Ler e verificar o inode (tem que ser um ficheiro regular) */
-  if( (stat = soReadInode(&p_inode, p_nInodeEnt, IUIN)) != 0)
-  	return stat;
-
-  /*verificar se ePath descreve um directorio*/
-  if( (stat = soQCheckDirCont(p_sb, &p_inode)) != 0)
-    return -EISDIR;
-
-  /*if any of the components of ePath, but the last one, is not a directory*/
-  if( (stat != -ENOTDIR))
+  if ((stat = soReadInodeAccess(&inode, nInode, &mask)) != 0)
     return stat;
 
-  /*verificar se o processo tem permissão de execucção*/
-  if( (stat = soAccessGranted(p_nInodeEnt, X)) != 0)
-  	return -EACCES;
+  if ((inode.mode & INODE_DIR) == INODE_DIR)
+    return -EISDIR;
 
-  /*verificar se o processo tem permissao de leitura*/
-  if( (stat = soAccessGranted(p_nInodeEnt, R)) != 0)
-  	return -EPERM;
-
-  /*if the starting [byte] position in the file data continuum assumes a value passing its maximum size*/
-  /*Verifica se o pos está fora do ficheiro*/
-  if(pos > p_inode.size)
-    return -EFBIG;
+  if ((mask & R) != R)
+    return -EPERM;
 
   /*------END OF VALIDATIONS-------*/
 
-
-  /* Corrige o count se pos+count ultrapassar o limite do ficheiro */
-  if((pos + count) > p_inode.size)
-    count = p_inode.size - pos;
-
-  /* vai obter o clustInd e offset apartir do pos */
-  if( (stat = soConvertBPIDC(pos, &p_clustInd, &offset)) != 0)
-    return stat;
-
-  // byte position é definido como :
-    // pos = clustInd * BSLPC + offset
-
-  /* vai obter o clustInd e offset do final do ficheiro apartir do pos + count */
-  if( (stat = soConvertBPIDC(pos + count, &p_clustIndF, &offsetFinal)) != 0)
+  if ((stat = soLoadSuperBlock()) != 0)
     return stat;
+  p_sb = soGetSuperBlock();
 
-  /* leitura do 1º cluster do inode*/
-  if( (stat = soReadFileCluster(p_nInodeEnt, p_clustInd, &p_buff)) != 0)
-    return stat;
+  // nothing is read past the end of file
+  if ((uint32_t) pos >= inode.size)
+    return 0;
+  if (count > inode.size - (uint32_t) pos)
+    count = inode.size - (uint32_t) pos;
 
- /* Se for necessario ler um pedaço do mesmo cluster */
-  if(p_clustInd == p_clustIndF)
+  // the file is read one data cluster at a time: a data cluster which was never allocated (a hole) reads as zeros,
+  // without reading anything from the storage device
+  while (bytesRead < count)
   {
-    memcpy(buff, &p_buff.info.data[BSLPC] + offset, (offsetFinal - offset));
-    bytesRead = offsetFinal - offset;
-    return bytesRead; 
-  }
-
-  /*Se for para ler mais que 1 cluster, ler o resto do primeiro */
-  memcpy(buff, &p_buff.info.data[BSLPC] + offset, (BSLPC - offset));
-  bytesRead = BSLPC - offset;
-
-  p_clustInd++; // incrementa o indice do cluster
-
-  /* ler proximo cluster*/
-  if( (stat = soReadFileCluster(p_nInodeEnt, p_clustInd, &p_buff)) != 0)
-    return stat;
+    if ((stat = soConvertBPIDC((uint32_t) pos + bytesRead, &clustInd, &offset)) != 0)
+      return stat;
 
-  /* ler clusters "intermédios" */ 
-  while(p_clustInd < p_clustIndF)
-  {
-    memcpy(buff+bytesRead, &p_buff.info.data[BSLPC], BSLPC);
-    bytesRead += BSLPC;
+    n = BSLPC - offset;
+    if (n > count - bytesRead)
+      n = count - bytesRead;
 
-    /*ler proximo cluster */
-    if( (stat = soReadFileCluster(p_nInodeEnt, p_clustInd, &p_buff)) != 0)
+    if ((stat = soHandleFileCluster(nInode, clustInd, GET, &nClust)) != 0)
       return stat;
-  }
-
 
-  /* caso o que cluster que vamos ler é o ultimo*/
-  memcpy(buff + bytesRead, &p_buff.info.data[BSLPC], offsetFinal);
-  bytesRead += offsetFinal;
+    if (nClust == NULL_CLUSTER)
+      memset((char *) buff + bytesRead, '\0', n);
+    else
+    {
+      // the reference was just looked up: it is not looked up again by soReadFileCluster
+      if ((stat = soReadCacheCluster(p_sb->dZoneStart + nClust * BLOCKS_PER_CLUSTER, &dc)) != 0)
+        return stat;
+      memcpy((char *) buff + bytesRead, dc.info.data + offset, n);
+    }
+
+    bytesRead += n;
+  }
 
   return bytesRead;
 }
@@ -0,0 +1,84 @@
+/**
+ *  \file soRemovexattr.c (implementation file)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/statvfs.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <utime.h>
+#include <libgen.h>
+#include <string.h>
+
+#include "sofs_probe.h"
+#include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_buffercache.h"
+#include "sofs_superblock.h"
+#include "sofs_inode.h"
+#include "sofs_direntry.h"
+#include "sofs_datacluster.h"
+#include "sofs_basicoper.h"
+#include "sofs_basicconsist.h"
+#include "sofs_ifuncs_1.h"
+#include "sofs_ifuncs_2.h"
+#include "sofs_ifuncs_3.h"
+#include "sofs_ifuncs_4.h"
+#include "sofs_xattr.h"
+#include "sofs_syscalls.h"
+
+/**
+ *  \brief Remove an extended attribute of a file.
+ *
+ *  It tries to emulate <em>removexattr</em> system call.
+ *
+ *  \param ePath path to the file
+ *  \param name name of the extended attribute
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer to the string is \c NULL or or the path string is a \c NULL string or the path does
+ *                      not describe an absolute path or the name is \c NULL or empty
+ *  \return -\c ENAMETOOLONG, if the path name or any of its components exceed the maximum allowed length
+ *  \return -\c ENOTDIR, if any of the components of <tt>ePath</tt>, but the last one, is not a directory
+ *  \return -\c ELOOP, if the path resolves to more than one symbolic link
+ *  \return -\c ENOENT, if no entry with a name equal to any of the components of <tt>ePath</tt> is found
+ *  \return -\c EACCES, if the process that calls the operation has not execution permission on any of the components
+ *                      of <tt>ePath</tt>, but the last one
+ *  \return -\c EPERM, if the process that calls the operation has not write permission on the file described by
+ *                     <tt>ePath</tt>
+ *  \return -\c ENODATA, if there is no extended attribute with the given name
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soRemovexattr (const char *ePath, const char *name)
+{
+  soColorProbe (241, "07;31", "soRemovexattr (\"%s\", \"%s\")\n", ePath, name);
+
+  SOInode inode;                                             /* inode associated to the file */
+  uint32_t nInode;                                           /* number of the inode associated to the file */
+  uint32_t mask;                                             /* operations allowed on the file */
+  int stat;                                                  /* function return status */
+
+  if ((ePath == NULL) || (ePath[0] != '/') || (name == NULL) || (name[0] == '\0'))
+     return -EINVAL;
+  if (strlen (ePath) > MAX_PATH)
+     return -ENAMETOOLONG;
+  if ((stat = soGetDirEntryByPath (ePath, NULL, &nInode)) != 0)
+     return stat;
+  if ((stat = soReadInodeAccess (&inode, nInode, &mask)) != 0)
+     return stat;
+  if ((mask & W) != W)
+     return -EPERM;
+
+  return soRemoveXattr (nInode, name);
+}
@@ -29,12 +29,18 @@
 #include "sofs_datacluster.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_dircount.h"
+#include "sofs_symlinkcache.h"
 #include "sofs_ifuncs_1.h"
 #include "sofs_ifuncs_2.h"
 #include "sofs_ifuncs_3.h"
 #include "sofs_ifuncs_4.h"
 #include "sofs_syscalls.h"
 
+/* Allusion to internal function */
+
+static int renameSinglePass (const char *oldPath, const char *newPath, bool *p_done);
+
 /**
  *  \brief Change the name or the location of a file in the directory hierarchy of the file system.
  *
@@ -84,6 +90,7 @@ int soRename(const char *oldPath, const char *newPath) {
     char oldPathStrB[MAX_NAME + 1]; // basename of oldPath copy
     char newPathStrB[MAX_NAME + 1]; // basename of newPath copy
     char newPathStrD[MAX_PATH + 1]; // dirname of newPath
+    bool done; // the rename was carried out in a single pass
 
     if (oldPath == NULL || newPath == NULL) return -EINVAL;
 
@@ -103,6 +110,10 @@ int soRename(const char *oldPath, const char *newPath) {
 
     // END OF VALIDATIONS
 
+    // renames which do not change the structure of the directory tree are carried out in a single pass
+    if (((stat = renameSinglePass(oldPath, newPath, &done)) != 0) || done)
+        return stat;
+
     // Read function parameters and process them
 
     if ((stat = soGetDirEntryByPath(oldPath, &nInodeOld_dir, &nInodeOld_ent)) != 0)
@@ -206,3 +217,180 @@ int soRename(const char *oldPath, const char *newPath) {
 
     return 0;
 }
+
+/**
+ *  \brief Rename a file, which is not a directory being moved, in a single pass.
+ *
+ *  The parent directories of both paths are resolved only once and the entries are looked up only once in them. The
+ *  clusters of directory entries involved are read once and kept while the rename is carried out, and each one of them,
+ *  and each inode involved, is written at most once. The following cases are handled:
+ *     \li the entry is renamed within the same directory and <tt>newPath</tt> does not exist
+ *     \li a file or a symbolic link is moved to another directory, where <tt>newPath</tt> does not exist and there is
+ *         a free entry, so that no data cluster has to be allocated
+ *     \li a file or a symbolic link replaces an existing file or symbolic link (for instance, an atomic replacement
+ *         through a temporary file).
+ *
+ *  Any other case, or any condition which should be reported as an error, is left to the general path, so that the
+ *  outcome is the same; nothing is changed until all conditions are checked.
+ *
+ *  \param oldPath path to an existing file
+ *  \param newPath new path to the same file in replacement of the old one
+ *  \param p_done pointer to a location where \c true is stored if the rename was carried out, \c false, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success or if the rename was not carried out
+ *  \return -\c ENOSPC, if there are no free data clusters
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+static int renameSinglePass (const char *oldPath, const char *newPath, bool *p_done)
+{
+    int stat; // function status return control
+    uint32_t nInodeOld_dir, nInodeOld_ent; // oldPath inode numbers for directory and entry
+    uint32_t nInodeNew_dir, nInodeNew_ent; // newPath inode numbers for directory and entry (if it exists)
+    uint32_t idxOld, idxNew; // indexes of the entries in the directories
+    uint32_t mask; // operations allowed on an inode
+    uint32_t count; // number of entries in use of a directory
+    bool same, exists; // both entries are in the same directory / newPath entry exists
+    SOInode oldDirInode, newDirInode, entInode, newEntInode; // inodes involved
+    SODataClust dcOld, dcNew; // clusters of directory entries involved
+    SODataClust *p_dcNew; // cluster where newPath entry is set (dcOld, if it is the same cluster)
+    char oldPathStr[MAX_PATH + 1], newPathStr[MAX_PATH + 1]; // copies of the paths
+    char oldName[MAX_PATH + 1], newName[MAX_PATH + 1]; // base names
+    char *oldDir, *newDir; // parent directories
+
+    *p_done = false;
+
+    strcpy(oldPathStr, oldPath);
+    strcpy(oldName, basename(oldPathStr));
+    strcpy(oldPathStr, oldPath);
+    oldDir = dirname(oldPathStr);
+    strcpy(newPathStr, newPath);
+    strcpy(newName, basename(newPathStr));
+    strcpy(newPathStr, newPath);
+    newDir = dirname(newPathStr);
+
+    if ((oldPath[0] != '/') || (newPath[0] != '/') || (strlen(oldName) > MAX_NAME) || (strlen(newName) > MAX_NAME) ||
+        (strcmp(oldName, "/") == 0) || (strcmp(oldName, ".") == 0) || (strcmp(oldName, "..") == 0) ||
+        (strcmp(newName, "/") == 0) || (strcmp(newName, ".") == 0) || (strcmp(newName, "..") == 0))
+        return 0;
+    same = (strcmp(oldDir, newDir) == 0);
+
+    // both parent directories are resolved once, they must be directories the process may search and change
+
+    if ((soGetDirEntryByPath(oldDir, NULL, &nInodeOld_dir) != 0) ||
+        (soReadInodeAccess(&oldDirInode, nInodeOld_dir, &mask) != 0) ||
+        ((oldDirInode.mode & INODE_DIR) != INODE_DIR) || ((mask & (W | X)) != (W | X)))
+        return 0;
+    if (same) {
+        nInodeNew_dir = nInodeOld_dir;
+        newDirInode = oldDirInode;
+    }
+    else if ((soGetDirEntryByPath(newDir, NULL, &nInodeNew_dir) != 0) || (nInodeNew_dir == nInodeOld_dir) ||
+             (soReadInodeAccess(&newDirInode, nInodeNew_dir, &mask) != 0) ||
+             ((newDirInode.mode & INODE_DIR) != INODE_DIR) || ((mask & (W | X)) != (W | X)))
+        return 0;
+
+    // each entry is looked up once
+
+    if ((soGetDirEntryByName(nInodeOld_dir, oldName, &nInodeOld_ent, &idxOld) != 0) ||
+        (soReadInodeAccess(&entInode, nInodeOld_ent, &mask) != 0))
+        return 0;
+    if ((stat = soGetDirEntryByName(nInodeNew_dir, newName, &nInodeNew_ent, &idxNew)) == 0)
+        exists = true;
+    else if (stat == -ENOENT)
+        exists = false;
+    else return 0;
+
+    if (exists) {
+        // replacing an entry by itself, or by another link to the same file, leaves everything as it is
+        if (nInodeNew_ent == nInodeOld_ent) {
+            *p_done = true;
+            return 0;
+        }
+        if (((entInode.mode & INODE_DIR) == INODE_DIR) || ((mask & R) != R) ||
+            (soReadInode(&newEntInode, nInodeNew_ent, IUIN) != 0) || ((newEntInode.mode & INODE_DIR) == INODE_DIR))
+            return 0;
+    }
+    else if (!same && (((entInode.mode & INODE_DIR) == INODE_DIR) || ((mask & R) != R) ||
+                       (idxNew / DPC >= newDirInode.size / (DPC * sizeof (SODirEntry)))))
+        return 0;
+
+    // END OF VALIDATIONS: the clusters of directory entries involved are read once
+
+    soForgetSymlinkResolutions();
+
+    if ((stat = soReadFileCluster(nInodeOld_dir, idxOld / DPC, &dcOld)) != 0)
+        return stat;
+
+    if (!exists && same) {
+        // plain rename: only the name of the entry changes, within the cluster already read
+        memset(dcOld.info.de[idxOld % DPC].name, '\0', MAX_NAME + 1);
+        strcpy((char *) dcOld.info.de[idxOld % DPC].name, newName);
+        if ((stat = soWriteFileCluster(nInodeOld_dir, idxOld / DPC, &dcOld)) != 0)
+            return stat;
+        *p_done = true;
+        return 0;
+    }
+
+    if (same && (idxOld / DPC == idxNew / DPC))
+        p_dcNew = &dcOld;
+    else {
+        if ((stat = soReadFileCluster(nInodeNew_dir, idxNew / DPC, &dcNew)) != 0)
+            return stat;
+        p_dcNew = &dcNew;
+    }
+
+    // newPath entry is set to the file first, oldPath entry is detached afterwards
+
+    if (!exists) {
+        memset(p_dcNew->info.de[idxNew % DPC].name, '\0', MAX_NAME + 1);
+        strcpy((char *) p_dcNew->info.de[idxNew % DPC].name, newName);
+    }
+    p_dcNew->info.de[idxNew % DPC].nInode = nInodeOld_ent;
+    memset(dcOld.info.de[idxOld % DPC].name, '\0', MAX_NAME + 1);
+    dcOld.info.de[idxOld % DPC].nInode = NULL_INODE;
+
+    if ((p_dcNew != &dcOld) && ((stat = soWriteFileCluster(nInodeNew_dir, idxNew / DPC, p_dcNew)) != 0))
+        return stat;
+    if ((stat = soWriteFileCluster(nInodeOld_dir, idxOld / DPC, &dcOld)) != 0)
+        return stat;
+
+    // the number of entries in use changes only in the directory the file leaves, unless it replaces another one
+
+    if (soGetDirCount(nInodeOld_dir, &count) == 0)
+        soSetDirCount(nInodeOld_dir, count - 1);
+    if (!exists && (soGetDirCount(nInodeNew_dir, &count) == 0))
+        soSetDirCount(nInodeNew_dir, count + 1);
+
+    // the replaced file loses a reference, it is freed if it was the last one
+
+    if (exists) {
+        newEntInode.refCount -= 1;
+        if (newEntInode.refCount == 0) {
+            if ((stat = soHandleFileClusters(nInodeNew_ent, 0, FREE)) != 0)
+                return stat;
+            if ((stat = soReadInode(&newEntInode, nInodeNew_ent, IUIN)) != 0)
+                return stat;
+            newEntInode.refCount = 0;
+            if ((stat = soWriteInode(&newEntInode, nInodeNew_ent, IUIN)) != 0)
+                return stat;
+            if ((stat = soFreeInode(nInodeNew_ent)) != 0)
+                return stat;
+        }
+        else if ((stat = soWriteInode(&newEntInode, nInodeNew_ent, IUIN)) != 0)
+            return stat;
+    }
+
+    // the directories are written once, to record the time of their modification
+
+    if ((stat = soWriteInode(&oldDirInode, nInodeOld_dir, IUIN)) != 0)
+        return stat;
+    if (!same && ((stat = soWriteInode(&newDirInode, nInodeNew_dir, IUIN)) != 0))
+        return stat;
+
+    *p_done = true;
+    return 0;
+}
@@ -39,6 +39,11 @@
  *
  *  It tries to emulate <em>truncate</em> system call.
  *
+ *  If the file shrinks, all the data clusters past the new end of file are freed and dissociated from the inode in a
+ *  single pass over its lists of references, and the part of the last data cluster which remains past the new end of
+ *  file is zeroed, so that it reads as zeros should the file grow again. If the file grows, no data cluster is
+ *  allocated: the new region is a hole, which reads as zeros until it is written.
+ *
  *  \param ePath path to the file
  *  \param length new size for the regular size
  *
@@ -63,9 +68,73 @@
 
 int soTruncate (const char *ePath, off_t length)
 {
-  soColorProbe (231, "07;31", "soTruncate (\"%s\", %u)\n", ePath, length);
+  soColorProbe (231, "07;31", "soTruncate (\"%s\", %"PRIi64")\n", ePath, (int64_t) length);
+
+  SOInode inode;                                             /* inode associated to the file */
+  SODataClust dc;                                            /* data cluster where the end of file lies */
+  uint32_t nInode;                                           /* number of the inode associated to the file */
+  uint32_t mask;                                             /* operations allowed on the file */
+  uint32_t boundary;                                         /* smallest of the old and the new sizes */
+  uint32_t clustInd, offset;                                 /* location of the boundary in the file */
+  uint32_t nClust;                                           /* logical number of the data cluster */
+  int stat;                                                  /* function return status */
+
+  /* validation of the arguments */
+
+  if ((ePath == NULL) || (ePath[0] != '/') || (length < 0))
+     return -EINVAL;
+  if (strlen (ePath) > MAX_PATH)
+     return -ENAMETOOLONG;
+  if (length > MAX_FILE_SIZE)
+     return -EFBIG;
+
+  /* the file must be a regular file the process may write */
+
+  if ((stat = soGetDirEntryByPath (ePath, NULL, &nInode)) != 0)
+     return stat;
+  if ((stat = soReadInodeAccess (&inode, nInode, &mask)) != 0)
+     return stat;
+  if ((inode.mode & INODE_DIR) == INODE_DIR)
+     return -EISDIR;
+  if ((inode.mode & INODE_FILE) != INODE_FILE)
+     return -EINVAL;
+  if ((mask & W) != W)
+     return -EPERM;
+
+  /* the bytes of the last data cluster left past the end of file are zeroed, a hole needs no zeroing */
+
+  boundary = (length < inode.size) ? (uint32_t) length : inode.size;
+  if ((boundary != (uint32_t) length) || (boundary != inode.size))
+     { if ((stat = soConvertBPIDC (boundary, &clustInd, &offset)) != 0)
+          return stat;
+       if (offset != 0)
+          { if ((stat = soHandleFileCluster (nInode, clustInd, GET, &nClust)) != 0)
+               return stat;
+            if (nClust != NULL_CLUSTER)
+               { if ((stat = soReadFileCluster (nInode, clustInd, &dc)) != 0)
+                    return stat;
+                 memset (dc.info.data + offset, '\0', BSLPC - offset);
+                 if ((stat = soWriteFileCluster (nInode, clustInd, &dc)) != 0)
+                    return stat;
+               }
+          }
+     }
+
+  /* the data clusters past the new end of file are freed all at once */
+
+  if ((uint32_t) length < inode.size)
+     { clustInd = ((uint32_t) length + BSLPC - 1) / BSLPC;
+       if ((clustInd < MAX_FILE_CLUSTERS) && ((stat = soHandleFileClusters (nInode, clustInd, FREE_CLEAN)) != 0))
+          return stat;
+     }
+
+  /* the inode is read again, since its lists of references may have changed */
 
-  /* insert your code here */
+  if ((stat = soReadInode (&inode, nInode, IUIN)) != 0)
+     return stat;
+  inode.size = (uint32_t) length;
+  if ((stat = soWriteInode (&inode, nInode, IUIN)) != 0)
+     return stat;
 
   return 0;
 }
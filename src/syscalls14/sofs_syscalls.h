@@ -24,6 +24,7 @@
  *      \li read data from an open regular file
  *      \li write data into an open regular file
  *      \li truncate a regular file to a specified length
+ *      \li find the next region of data or the next hole in a regular file
  *      \li synchronize a file's in-core state with storage device
  *      \li create a directory
  *      \li delete a directory
@@ -31,7 +32,11 @@
  *      \li read a directory entry from a directory
  *      \li close a directory
  *      \li make a new name for a regular file or a directory
- *      \li read the value of a symbolic link.
+ *      \li read the value of a symbolic link
+ *      \li set the value of an extended attribute of a file
+ *      \li get the value of an extended attribute of a file
+ *      \li list the names of the extended attributes of a file
+ *      \li remove an extended attribute of a file.
  *
  *  \author Artur Carneiro Pereira September 2007
  *  \author Miguel Oliveira e Silva September 2009
@@ -51,6 +56,15 @@
 #include <utime.h>
 #include <libgen.h>
 
+#ifndef SEEK_DATA
+/** \brief seek to the next region of data (as defined by Linux) */
+#define SEEK_DATA  3
+#endif
+#ifndef SEEK_HOLE
+/** \brief seek to the next hole (as defined by Linux) */
+#define SEEK_HOLE  4
+#endif
+
 /**
  *  \brief Mount the SOFS14 file system.
  *
@@ -558,6 +572,9 @@ extern int soMknod (const char *ePath, mode_t mode);
  *
  *  It tries to emulate <em>read</em> system call.
  *
+ *  A file may be sparse: the data clusters of the regions which were never written (holes) are not allocated. Holes
+ *  read as zeros and are not read from the storage device.
+ *
  *  \param ePath path to the file
  *  \param buff pointer to the buffer where data to be read is to be stored
  *  \param count number of bytes to be read
@@ -646,6 +663,39 @@ extern int soWrite (const char *ePath, void *buff, uint32_t count, int32_t pos);
 
 extern int soTruncate (const char *ePath, off_t length);
 
+/**
+ *  \brief Find the next region of data or the next hole in a regular file.
+ *
+ *  It tries to emulate <em>lseek</em> system call for the values \c SEEK_DATA and \c SEEK_HOLE of <tt>whence</tt>.
+ *  A hole is a region of the file whose data clusters were never allocated, the region past the end of file counting
+ *  as a hole; so, the positions returned are aligned to the boundaries of the data clusters, or equal to the given
+ *  position or to the size of the file.
+ *
+ *  \param ePath path to the file
+ *  \param pos starting [byte] position in the file data continuum
+ *  \param whence \c SEEK_DATA, to find the next region of data, or \c SEEK_HOLE, to find the next hole, at or after
+ *                <tt>pos</tt>
+ *
+ *  \return <em>the [byte] position found</em>, on success
+ *  \return -\c EINVAL, if the pointer to the string is \c NULL or or the path string is a \c NULL string or the path does
+ *                      not describe an absolute path or <tt>pos</tt> is negative or <tt>whence</tt> is not one of
+ *                      the values above
+ *  \return -\c ENXIO, if <tt>pos</tt> is not before the end of file or, for \c SEEK_DATA, there is no data past it
+ *  \return -\c ENAMETOOLONG, if the path name or any of its components exceed the maximum allowed length
+ *  \return -\c ENOTDIR, if any of the components of <tt>ePath</tt>, but the last one, is not a directory
+ *  \return -\c EISDIR, if <tt>ePath</tt> describes a directory
+ *  \return -\c ELOOP, if the path resolves to more than one symbolic link
+ *  \return -\c ENOENT, if no entry with a name equal to any of the components of <tt>ePath</tt> is found
+ *  \return -\c EACCES, if the process that calls the operation has not execution permission on any of the components
+ *                      of <tt>ePath</tt>, but the last one
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soLseek (const char *ePath, int32_t pos, int whence);
+
 /**
  *  \brief Create a directory.
  *
@@ -807,4 +857,128 @@ extern int soSymlink (const char *effPath, const char *ePath);
 
 extern int soReadlink (const char *ePath, const char *buff, int32_t size);
 
+/**
+ *  \brief Set the value of an extended attribute of a file.
+ *
+ *  It tries to emulate <em>setxattr</em> system call.
+ *
+ *  \param ePath path to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is stored
+ *  \param size length of the value
+ *  \param flags \c XATTR_CREATE, if the extended attribute must not exist, \c XATTR_REPLACE, if it must exist, or
+ *               <tt>0 (zero)</tt>, otherwise
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer to the string is \c NULL or or the path string is a \c NULL string or the path does
+ *                      not describe an absolute path or the name is \c NULL or empty
+ *  \return -\c ENAMETOOLONG, if the path name or any of its components exceed the maximum allowed length
+ *  \return -\c ENOTDIR, if any of the components of <tt>ePath</tt>, but the last one, is not a directory
+ *  \return -\c ELOOP, if the path resolves to more than one symbolic link
+ *  \return -\c ENOENT, if no entry with a name equal to any of the components of <tt>ePath</tt> is found
+ *  \return -\c EACCES, if the process that calls the operation has not execution permission on any of the components
+ *                      of <tt>ePath</tt>, but the last one
+ *  \return -\c EPERM, if the process that calls the operation has not write permission on the file described by
+ *                     <tt>ePath</tt>
+ *  \return -\c ERANGE, if the name is too long
+ *  \return -\c EEXIST, if \c XATTR_CREATE was given and the extended attribute exists
+ *  \return -\c ENODATA, if \c XATTR_REPLACE was given and the extended attribute does not exist
+ *  \return -\c ENOSPC, if the extended attributes of the file would not fit into a data cluster or there are no free
+ *                      data clusters
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSetxattr (const char *ePath, const char *name, const void *value, uint32_t size, int flags);
+
+/**
+ *  \brief Get the value of an extended attribute of a file.
+ *
+ *  It tries to emulate <em>getxattr</em> system call.
+ *
+ *  \param ePath path to the file
+ *  \param name name of the extended attribute
+ *  \param value pointer to the buffer where the value is to be stored
+ *  \param size size of the buffer (if zero, only the length of the value is returned)
+ *
+ *  \return <em>length of the value</em>, on success
+ *  \return -\c EINVAL, if the pointer to the string is \c NULL or or the path string is a \c NULL string or the path does
+ *                      not describe an absolute path or the name is \c NULL or empty
+ *  \return -\c ENAMETOOLONG, if the path name or any of its components exceed the maximum allowed length
+ *  \return -\c ENOTDIR, if any of the components of <tt>ePath</tt>, but the last one, is not a directory
+ *  \return -\c ELOOP, if the path resolves to more than one symbolic link
+ *  \return -\c ENOENT, if no entry with a name equal to any of the components of <tt>ePath</tt> is found
+ *  \return -\c EACCES, if the process that calls the operation has not execution permission on any of the components
+ *                      of <tt>ePath</tt>, but the last one
+ *  \return -\c EPERM, if the process that calls the operation has not read permission on the file described by
+ *                     <tt>ePath</tt>
+ *  \return -\c ENODATA, if there is no extended attribute with the given name
+ *  \return -\c ERANGE, if the buffer is too small to hold the value
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soGetxattr (const char *ePath, const char *name, void *value, uint32_t size);
+
+/**
+ *  \brief List the names of the extended attributes of a file.
+ *
+ *  It tries to emulate <em>listxattr</em> system call.
+ *
+ *  \param ePath path to the file
+ *  \param list pointer to the buffer where the names, each one terminated by a null character, are to be stored
+ *  \param size size of the buffer (if zero, only the length of the list is returned)
+ *
+ *  \return <em>length of the list</em>, on success
+ *  \return -\c EINVAL, if the pointer to the string is \c NULL or or the path string is a \c NULL string or the path does
+ *                      not describe an absolute path
+ *  \return -\c ENAMETOOLONG, if the path name or any of its components exceed the maximum allowed length
+ *  \return -\c ENOTDIR, if any of the components of <tt>ePath</tt>, but the last one, is not a directory
+ *  \return -\c ELOOP, if the path resolves to more than one symbolic link
+ *  \return -\c ENOENT, if no entry with a name equal to any of the components of <tt>ePath</tt> is found
+ *  \return -\c EACCES, if the process that calls the operation has not execution permission on any of the components
+ *                      of <tt>ePath</tt>, but the last one
+ *  \return -\c EPERM, if the process that calls the operation has not read permission on the file described by
+ *                     <tt>ePath</tt>
+ *  \return -\c ERANGE, if the buffer is too small to hold the list
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soListxattr (const char *ePath, char *list, uint32_t size);
+
+/**
+ *  \brief Remove an extended attribute of a file.
+ *
+ *  It tries to emulate <em>removexattr</em> system call.
+ *
+ *  \param ePath path to the file
+ *  \param name name of the extended attribute
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the pointer to the string is \c NULL or or the path string is a \c NULL string or the path does
+ *                      not describe an absolute path or the name is \c NULL or empty
+ *  \return -\c ENAMETOOLONG, if the path name or any of its components exceed the maximum allowed length
+ *  \return -\c ENOTDIR, if any of the components of <tt>ePath</tt>, but the last one, is not a directory
+ *  \return -\c ELOOP, if the path resolves to more than one symbolic link
+ *  \return -\c ENOENT, if no entry with a name equal to any of the components of <tt>ePath</tt> is found
+ *  \return -\c EACCES, if the process that calls the operation has not execution permission on any of the components
+ *                      of <tt>ePath</tt>, but the last one
+ *  \return -\c EPERM, if the process that calls the operation has not write permission on the file described by
+ *                     <tt>ePath</tt>
+ *  \return -\c ENODATA, if there is no extended attribute with the given name
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soRemovexattr (const char *ePath, const char *name);
+
 #endif /* SOFS_SYSCALLS_H_ */
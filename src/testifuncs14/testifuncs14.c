@@ -39,6 +39,7 @@
                    -b       --- set batch mode (default: not batch)
                    -l depth --- set log depth (default: 0,0)
                    -L file  --- log file (default: stdout)
+                   -n num   --- set number of shards of the arena of cache memory (default: one per NUMA node)
                    -h       --- print this help.</PRE>
  *
  *  \author Artur Carneiro Pereira - October 2005
@@ -59,6 +60,7 @@
 
 #include "sofs_probe.h"
 #include "sofs_const.h"
+#include "sofs_arena.h"
 #include "sofs_buffercache.h"
 #include "sofs_superblock.h"
 #include "sofs_inode.h"
@@ -66,6 +68,7 @@
 #include "sofs_datacluster.h"
 #include "sofs_basicoper.h"
 #include "sofs_basicconsist.h"
+#include "sofs_inodecache.h"
 #include "sofs_ifuncs_1.h"
 #define  IFUNCS_2
 #ifdef IFUNCS_2
@@ -197,7 +200,7 @@ int main (int argc, char *argv[])
   int opt;                                       /* selected option */
 
   do
-  { switch ((opt = getopt (argc, argv, "l:L:bh")))
+  { switch ((opt = getopt (argc, argv, "l:L:n:bh")))
     { case 'l': /* log depth */
                 if (sscanf (optarg, "%d,%d", &lower, &higher) != 2)
                    { fprintf (stderr, "%s: Bad argument to l option.\n", basename (argv[0]));
@@ -214,6 +217,13 @@ int main (int argc, char *argv[])
                    }
                 soOpenProbe (fl);
                 break;
+      case 'n': /* number of shards of the arena */
+                if ((atoi (optarg) <= 0) || (soSetArenaNodes ((uint32_t) atoi (optarg)) != 0))
+                   { fprintf (stderr, "%s: Invalid number of shards.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
       case 'b': /* batch mode */
                 batch = 1;                       /* set batch mode for processing: no input messages are issued */
                 break;
@@ -283,9 +293,9 @@ int main (int argc, char *argv[])
   }
 
 
-  /* close the unbuffered communication channel with the storage device */
+  /* write back the cached inodes and close the unbuffered communication channel with the storage device */
 
-  if ((status = soCloseBufferCache ()) != 0)
+  if (((status = soSyncInodes ()) != 0) || ((status = soCloseBufferCache ()) != 0))
      { printError (status, basename (argv[0]));
        return EXIT_FAILURE;
      }
@@ -309,6 +319,7 @@ static void printUsage (char *cmd_name)
           "  -b       --- set batch mode (default: not batch)\n"
           "  -l depth --- set log depth (default: 0,0)\n"
           "  -L file  --- log file (default: stdout)\n"
+          "  -n num   --- set number of shards of the arena of cache memory (default: one per NUMA node)\n"
           "  -h       --- print this help\n", cmd_name);
 }
 